@@ -54,6 +54,10 @@
 #include "extensions/metadata.h"
 #include "pipewire-jack-extensions.h"
 
+#ifdef HAVE_AUDIOMIXER
+#include "mix-ops.h"
+#endif
+
 #define JACK_DEFAULT_VIDEO_TYPE	"32 bit float RGBA video"
 
 #define JACK_CLIENT_NAME_SIZE		128
@@ -65,7 +69,7 @@
 
 #define MAX_BUFFER_FRAMES		8192
 
-#define MAX_ALIGN			16
+#define MAX_ALIGN			32
 #define MAX_PORTS			1024
 #define MAX_BUFFERS			2
 #define MAX_BUFFER_DATAS		1u
@@ -99,10 +103,6 @@ static bool mlock_warned = false;
 
 #define OBJECT_CHUNK	8
 
-typedef void (*mix2_func) (float *dst, float *src1, float *src2, int n_samples);
-
-static mix2_func mix2;
-
 struct object {
 	struct spa_list link;
 
@@ -329,6 +329,9 @@ struct client {
 	struct spa_fraction latency;
 
 	struct spa_list free_mix;
+#ifdef HAVE_AUDIOMIXER
+	struct mix_ops mix;
+#endif
 
 	uint32_t n_port_pool[2];
 	struct port *port_pool[2][MAX_PORTS];
@@ -616,40 +619,21 @@ static struct buffer *dequeue_buffer(struct mix *mix)
 	return b;
 }
 
-#if defined (__SSE__)
-#include <xmmintrin.h>
-static void mix2_sse(float *dst, float *src1, float *src2, int n_samples)
+static void mix_input_buffers(struct client *c, float *dst,
+		const void *src[], uint32_t n_src, uint32_t n_samples)
 {
-	int n, unrolled;
-	__m128 in[2];
-
-	if (SPA_IS_ALIGNED(src1, 16) &&
-	    SPA_IS_ALIGNED(src2, 16) &&
-	    SPA_IS_ALIGNED(dst, 16))
-		unrolled = n_samples / 4;
-	else
-		unrolled = 0;
+#ifdef HAVE_AUDIOMIXER
+	mix_ops_process(&c->mix, dst, src, n_src, n_samples);
+#else
+	uint32_t i, n;
 
-	for (n = 0; unrolled--; n += 4) {
-		in[0] = _mm_load_ps(&src1[n]),
-		in[1] = _mm_load_ps(&src2[n]),
-		in[0] = _mm_add_ps(in[0], in[1]);
-		_mm_store_ps(&dst[n], in[0]);
-	}
-	for (; n < n_samples; n++) {
-		in[0] = _mm_load_ss(&src1[n]),
-		in[1] = _mm_load_ss(&src2[n]),
-		in[0] = _mm_add_ss(in[0], in[1]);
-		_mm_store_ss(&dst[n], in[0]);
+	memcpy(dst, src[0], n_samples * sizeof(float));
+	for (i = 1; i < n_src; i++) {
+		const float *s = src[i];
+		for (n = 0; n < n_samples; n++)
+			dst[n] += s[n];
 	}
-}
 #endif
-
-static void mix2_c(float *dst, float *src1, float *src2, int n_samples)
-{
-	int i;
-	for (i = 0; i < n_samples; i++)
-		dst[i] = src1[i] + src2[i];
 }
 
 SPA_EXPORT
@@ -1211,6 +1195,9 @@ static inline void signal_sync(struct client *c)
 
 			pw_log_trace_fp(NAME" %p: signal %p %p", c, l, state);
 
+			if (pw_node_activation_wake(l->activation))
+				continue;
+
 			if (SPA_UNLIKELY(write(l->signalfd, &cmd, sizeof(cmd)) != sizeof(cmd)))
 				pw_log_warn(NAME" %p: write failed %m", c);
 		}
@@ -2502,10 +2489,12 @@ jack_client_t * jack_client_open (const char *client_name,
                                   jack_status_t *status, ...)
 {
 	struct client *client;
+#ifdef HAVE_AUDIOMIXER
 	const struct spa_support *support;
 	uint32_t n_support;
-	const char *str;
 	struct spa_cpu *cpu_iface;
+#endif
+	const char *str;
 	struct spa_node_info ni;
 	va_list ap;
 
@@ -2586,17 +2575,16 @@ jack_client_t * jack_client_open (const char *client_name,
 	spa_list_init(&client->context.ports);
 	spa_list_init(&client->context.links);
 
+#ifdef HAVE_AUDIOMIXER
 	support = pw_context_get_support(client->context.context, &n_support);
 
-	mix2 = mix2_c;
 	cpu_iface = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_CPU);
-	if (cpu_iface) {
-#if defined (__SSE__)
-		uint32_t flags = spa_cpu_get_flags(cpu_iface);
-		if (flags & SPA_CPU_FLAG_SSE)
-			mix2 = mix2_sse;
+	client->mix.fmt = SPA_AUDIO_FORMAT_F32;
+	client->mix.n_channels = 1;
+	client->mix.cpu_flags = cpu_iface ? spa_cpu_get_flags(cpu_iface) : 0;
+	mix_ops_init(&client->mix);
 #endif
-	}
+
 	client->loop = client->context.context->data_loop_impl;
 
 	spa_list_init(&client->links);
@@ -3544,7 +3532,8 @@ static void *get_buffer_input_float(struct port *p, jack_nframes_t frames)
 	struct mix *mix;
 	struct buffer *b;
 	struct spa_io_buffers *io;
-	int layer = 0;
+	const void *src[CONNECTION_NUM_FOR_PORT];
+	uint32_t n_src = 0;
 	void *ptr = NULL;
 
 	spa_list_for_each(mix, &p->mix, port_link) {
@@ -3558,16 +3547,19 @@ static void *get_buffer_input_float(struct port *p, jack_nframes_t frames)
 
 		io->status = SPA_STATUS_NEED_DATA;
 		b = &mix->buffers[io->buffer_id];
-		if (layer++ == 0)
-			ptr = b->datas[0].data;
-		else  {
-			mix2(p->emptyptr, ptr, b->datas[0].data, frames);
-			ptr = p->emptyptr;
-			p->zeroed = false;
-		}
+		if (n_src < CONNECTION_NUM_FOR_PORT)
+			src[n_src++] = b->datas[0].data;
 	}
-	if (ptr == NULL)
+	if (n_src == 0) {
 		ptr = init_buffer(p);
+	} else if (n_src == 1) {
+		ptr = (void*)src[0];
+	} else {
+		/* mix all inputs in one pass over the output */
+		mix_input_buffers(p->client, p->emptyptr, src, n_src, frames);
+		ptr = p->emptyptr;
+		p->zeroed = false;
+	}
 	return ptr;
 }
 
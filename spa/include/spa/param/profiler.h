@@ -77,6 +77,16 @@ enum spa_profiler {
 							  *      Long : finish,
 							  *      Int : status,
 							  *      Fraction : latency))  */
+	SPA_PROFILER_followerFanout,			/**< buffers shared between the links of
+							  *  an output port of the driver or a
+							  *  follower, one for each port
+							  *  (Struct(
+							  *      Int : node id,
+							  *      Int : port id,
+							  *      Long : buffers,
+							  *      Long : links the buffers were passed to,
+							  *      Int : links of the last buffer,
+							  *      Int : max links of a buffer))  */
 
 	SPA_PROFILER_START_CUSTOM	= 0x1000000,
 };
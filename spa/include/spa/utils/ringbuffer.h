@@ -166,6 +166,51 @@ static inline void spa_ringbuffer_write_update(struct spa_ringbuffer *rbuf, int3
 	__atomic_store_n(&rbuf->writeindex, index, __ATOMIC_RELEASE);
 }
 
+/**
+ * Get the read index and a pointer to the data that can be read from
+ * \a buffer without wrapping around. \a buffer must be mapped twice after
+ * itself, like with PW_MEMMAP_FLAG_TWICE, so that all available bytes can be
+ * accessed from \a data.
+ *
+ * \param rbuf a spa_ringbuffer
+ * \param buffer the memory of the ringbuffer, mapped twice
+ * \param size the size of \a buffer, not counting the second mapping
+ * \param index the value of readindex
+ * \param data pointer to the first byte to read
+ * \return number of available bytes to read, see spa_ringbuffer_get_read_index()
+ */
+static inline int32_t
+spa_ringbuffer_get_read_span(struct spa_ringbuffer *rbuf,
+			     const void *buffer, uint32_t size,
+			     uint32_t *index, const void **data)
+{
+	int32_t avail = spa_ringbuffer_get_read_index(rbuf, index);
+	*data = SPA_MEMBER(buffer, *index % size, const void);
+	return avail;
+}
+
+/**
+ * Get the write index and a pointer to the memory that can be written in
+ * \a buffer without wrapping around. \a buffer must be mapped twice after
+ * itself, like with PW_MEMMAP_FLAG_TWICE.
+ *
+ * \param rbuf a spa_ringbuffer
+ * \param buffer the memory of the ringbuffer, mapped twice
+ * \param size the size of \a buffer, not counting the second mapping
+ * \param index the value of writeindex
+ * \param data pointer to the first byte to write
+ * \return number of bytes that can be written, values < 0 mean there was
+ *         an overrun.
+ */
+static inline int32_t
+spa_ringbuffer_get_write_span(struct spa_ringbuffer *rbuf,
+			      void *buffer, uint32_t size,
+			      uint32_t *index, void **data)
+{
+	int32_t filled = spa_ringbuffer_get_write_index(rbuf, index);
+	*data = SPA_MEMBER(buffer, *index % size, void);
+	return (int32_t) size - filled;
+}
 
 #ifdef __cplusplus
 }  /* extern "C" */
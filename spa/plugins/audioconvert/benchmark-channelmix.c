@@ -0,0 +1,211 @@
+/* Spa
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include "test-helper.h"
+#include "channelmix-ops.h"
+
+static uint32_t cpu_flags;
+
+typedef void (*channelmix_func_t) (struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+			uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples);
+
+struct stats {
+	uint32_t n_samples;
+	uint32_t src_chan;
+	uint32_t dst_chan;
+	bool sparse;
+	uint64_t perf;
+	const char *name;
+	const char *impl;
+};
+
+#define MAX_SAMPLES	4096
+#define MAX_CHANNELS	16
+
+#define MAX_COUNT 200
+
+static float samp_in[MAX_CHANNELS][MAX_SAMPLES];
+static float samp_out[MAX_CHANNELS][MAX_SAMPLES];
+
+static const int sample_sizes[] = { 0, 1, 128, 513, 4096 };
+
+#define MAX_RESULTS	SPA_N_ELEMENTS(sample_sizes) * 200
+
+static uint32_t n_results = 0;
+static struct stats results[MAX_RESULTS];
+
+/* every other coefficient is 0 when sparse */
+static void run_test1(const char *name, const char *impl, channelmix_func_t func,
+		uint32_t src_chan, uint32_t dst_chan, bool sparse, int n_samples)
+{
+	uint32_t i, j;
+	const void *ip[src_chan];
+	void *op[dst_chan];
+	struct timespec ts;
+	uint64_t count, t1, t2;
+	struct channelmix mix;
+
+	spa_zero(mix);
+	mix.src_chan = src_chan;
+	mix.dst_chan = dst_chan;
+	for (i = 0; i < dst_chan; i++) {
+		for (j = 0; j < src_chan; j++)
+			mix.matrix[i][j] = (sparse && ((i + j) & 1)) ? 0.0f : 0.5f + i * 0.01f;
+		lr4_set(&mix.lr4[i], BQ_LOWPASS, 0.01f);
+	}
+	for (j = 0; j < src_chan; j++)
+		ip[j] = samp_in[j];
+	for (j = 0; j < dst_chan; j++)
+		op[j] = samp_out[j];
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	count = 0;
+	for (i = 0; i < MAX_COUNT; i++) {
+		func(&mix, dst_chan, op, src_chan, ip, n_samples);
+		count++;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	spa_assert(n_results < MAX_RESULTS);
+
+	results[n_results++] = (struct stats) {
+		.n_samples = n_samples,
+		.src_chan = src_chan,
+		.dst_chan = dst_chan,
+		.sparse = sparse,
+		.perf = count * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1),
+		.name = name,
+		.impl = impl
+	};
+}
+
+static void run_test(const char *name, const char *impl, channelmix_func_t func,
+		uint32_t src_chan, uint32_t dst_chan, bool sparse)
+{
+	size_t i;
+	for (i = 0; i < SPA_N_ELEMENTS(sample_sizes); i++)
+		run_test1(name, impl, func, src_chan, dst_chan, sparse, sample_sizes[i]);
+}
+
+#define RUN_TEST(name,src_chan,dst_chan,sparse)						\
+do {											\
+	run_test(#name, "c", channelmix_##name##_c, src_chan, dst_chan, sparse);	\
+	RUN_TEST_SSE(name,src_chan,dst_chan,sparse);					\
+	RUN_TEST_AVX(name,src_chan,dst_chan,sparse);					\
+	RUN_TEST_NEON(name,src_chan,dst_chan,sparse);					\
+} while (0)
+
+#if defined (HAVE_SSE)
+#define RUN_TEST_SSE(name,src_chan,dst_chan,sparse)					\
+	if (cpu_flags & SPA_CPU_FLAG_SSE)						\
+		run_test(#name, "sse", channelmix_##name##_sse, src_chan, dst_chan, sparse)
+#else
+#define RUN_TEST_SSE(...)
+#endif
+#if defined (HAVE_AVX)
+#define RUN_TEST_AVX(name,src_chan,dst_chan,sparse)					\
+	if (cpu_flags & SPA_CPU_FLAG_AVX)						\
+		run_test(#name, "avx", channelmix_##name##_avx, src_chan, dst_chan, sparse)
+#else
+#define RUN_TEST_AVX(...)
+#endif
+#if defined (HAVE_NEON)
+#define RUN_TEST_NEON(name,src_chan,dst_chan,sparse)					\
+	if (cpu_flags & SPA_CPU_FLAG_NEON)						\
+		run_test(#name, "neon", channelmix_##name##_neon, src_chan, dst_chan, sparse)
+#else
+#define RUN_TEST_NEON(...)
+#endif
+
+static void test_layouts(void)
+{
+	RUN_TEST(copy, 2, 2, false);
+	RUN_TEST(f32_1_2, 1, 2, false);
+	RUN_TEST(f32_2_1, 2, 1, false);
+	RUN_TEST(f32_4_1, 4, 1, false);
+	RUN_TEST(f32_3p1_1, 4, 1, false);
+	RUN_TEST(f32_2_4, 2, 4, false);
+	RUN_TEST(f32_2_3p1, 2, 4, false);
+	RUN_TEST(f32_2_5p1, 2, 6, false);
+	RUN_TEST(f32_5p1_2, 6, 2, false);
+	RUN_TEST(f32_5p1_3p1, 6, 4, false);
+	RUN_TEST(f32_5p1_4, 6, 4, false);
+	RUN_TEST(f32_7p1_2, 8, 2, false);
+	RUN_TEST(f32_7p1_3p1, 8, 4, false);
+	RUN_TEST(f32_7p1_4, 8, 4, false);
+}
+
+static void test_n_m(void)
+{
+	RUN_TEST(f32_n_m, 16, 8, false);
+	RUN_TEST(f32_n_m, 12, 2, false);
+	RUN_TEST(f32_n_m, 16, 8, true);
+	RUN_TEST(f32_n_m, 12, 2, true);
+}
+
+static int compare_func(const void *_a, const void *_b)
+{
+	const struct stats *a = _a, *b = _b;
+	int diff;
+	if ((diff = strcmp(a->name, b->name)) != 0) return diff;
+	if ((diff = a->n_samples - b->n_samples) != 0) return diff;
+	if ((diff = a->src_chan - b->src_chan) != 0) return diff;
+	if ((diff = a->dst_chan - b->dst_chan) != 0) return diff;
+	if ((diff = a->sparse - b->sparse) != 0) return diff;
+	if ((diff = b->perf - a->perf) != 0) return diff;
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t i;
+
+	cpu_flags = get_cpu_flags();
+	printf("got get CPU flags %d\n", cpu_flags);
+
+	test_layouts();
+	test_n_m();
+
+	qsort(results, n_results, sizeof(struct stats), compare_func);
+
+	for (i = 0; i < n_results; i++) {
+		struct stats *s = &results[i];
+		fprintf(stderr, "%-12."PRIu64" \t%-32.32s %s \t samples %d, channels %d -> %d%s\n",
+				s->perf, s->name, s->impl, s->n_samples, s->src_chan, s->dst_chan,
+				s->sparse ? " sparse" : "");
+	}
+	return 0;
+}
@@ -58,7 +58,7 @@ static uint8_t samp_out[MAX_SAMPLES * MAX_CHANNELS * 4];
 static const int sample_sizes[] = { 0, 1, 128, 513, 4096 };
 static const int channel_counts[] = { 1, 2, 4, 6, 8, 11 };
 
-#define MAX_RESULTS	SPA_N_ELEMENTS(sample_sizes) * SPA_N_ELEMENTS(channel_counts) * 70
+#define MAX_RESULTS	SPA_N_ELEMENTS(sample_sizes) * SPA_N_ELEMENTS(channel_counts) * 140
 
 static uint32_t n_results = 0;
 static struct stats results[MAX_RESULTS];
@@ -127,17 +127,37 @@ static void run_test(const char *name, const char *impl, bool in_packed, bool ou
 static void test_f32_u8(void)
 {
 	run_test("test_f32_u8", "c", true, true, conv_f32_to_u8_c);
+#if defined (HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2) {
+		run_test("test_f32_u8", "sse2", true, true, conv_f32_to_u8_sse2);
+	}
+#endif
 	run_test("test_f32d_u8", "c", false, true, conv_f32d_to_u8_c);
 	run_test("test_f32_u8d", "c", true, false, conv_f32_to_u8d_c);
 	run_test("test_f32d_u8d", "c", false, false, conv_f32d_to_u8d_c);
+#if defined (HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2) {
+		run_test("test_f32d_u8d", "sse2", false, false, conv_f32d_to_u8d_sse2);
+	}
+#endif
 }
 
 static void test_u8_f32(void)
 {
 	run_test("test_u8_f32", "c", true, true, conv_u8_to_f32_c);
+#if defined (HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2) {
+		run_test("test_u8_f32", "sse2", true, true, conv_u8_to_f32_sse2);
+	}
+#endif
 	run_test("test_u8d_f32", "c", false, true, conv_u8d_to_f32_c);
 	run_test("test_u8_f32d", "c", true, false, conv_u8_to_f32d_c);
 	run_test("test_u8d_f32d", "c", false, false, conv_u8d_to_f32d_c);
+#if defined (HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2) {
+		run_test("test_u8d_f32d", "sse2", false, false, conv_u8d_to_f32d_sse2);
+	}
+#endif
 }
 
 static void test_f32_s16(void)
@@ -156,6 +176,11 @@ static void test_f32_s16(void)
 		run_testc("test_f32d_s16_2", "avx2", false, true, conv_f32d_to_s16_2_avx2, 2);
 		run_testc("test_f32d_s16_4", "avx2", false, true, conv_f32d_to_s16_4_avx2, 4);
 	}
+#endif
+#if defined (HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_f32d_s16", "avx512", false, true, conv_f32d_to_s16_avx512);
+	}
 #endif
 	run_test("test_f32_s16d", "c", true, false, conv_f32_to_s16d_c);
 	run_test("test_f32d_s16d", "c", false, false, conv_f32d_to_s16d_c);
@@ -177,6 +202,11 @@ static void test_s16_f32(void)
 		run_test("test_s16_f32d", "avx2", true, false, conv_s16_to_f32d_avx2);
 		run_testc("test_s16_f32d_2", "avx2", true, false, conv_s16_to_f32d_2_avx2, 2);
 	}
+#endif
+#if defined (HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_s16_f32d", "avx512", true, false, conv_s16_to_f32d_avx512);
+	}
 #endif
 	run_test("test_s16d_f32d", "c", false, false, conv_s16d_to_f32d_c);
 }
@@ -194,6 +224,16 @@ static void test_f32_s32(void)
 	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
 		run_test("test_f32d_s32", "avx2", false, true, conv_f32d_to_s32_avx2);
 	}
+#endif
+#if defined (HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_f32d_s32", "avx512", false, true, conv_f32d_to_s32_avx512);
+	}
+#endif
+#if defined (HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON) {
+		run_test("test_f32d_s32", "neon", false, true, conv_f32d_to_s32_neon);
+	}
 #endif
 	run_test("test_f32_s32d", "c", true, false, conv_f32_to_s32d_c);
 	run_test("test_f32d_s32d", "c", false, false, conv_f32d_to_s32d_c);
@@ -212,6 +252,16 @@ static void test_s32_f32(void)
 	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
 		run_test("test_s32_f32d", "avx2", true, false, conv_s32_to_f32d_avx2);
 	}
+#endif
+#if defined (HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_s32_f32d", "avx512", true, false, conv_s32_to_f32d_avx512);
+	}
+#endif
+#if defined (HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON) {
+		run_test("test_s32_f32d", "neon", true, false, conv_s32_to_f32d_neon);
+	}
 #endif
 	run_test("test_s32_f32d", "c", true, false, conv_s32_to_f32d_c);
 	run_test("test_s32d_f32d", "c", false, false, conv_s32d_to_f32d_c);
@@ -257,6 +307,26 @@ static void test_f32_s24_32(void)
 {
 	run_test("test_f32_s24_32", "c", true, true, conv_f32_to_s24_32_c);
 	run_test("test_f32d_s24_32", "c", false, true, conv_f32d_to_s24_32_c);
+#if defined (HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2) {
+		run_test("test_f32d_s24_32", "sse2", false, true, conv_f32d_to_s24_32_sse2);
+	}
+#endif
+#if defined (HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_f32d_s24_32", "avx2", false, true, conv_f32d_to_s24_32_avx2);
+	}
+#endif
+#if defined (HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_f32d_s24_32", "avx512", false, true, conv_f32d_to_s24_32_avx512);
+	}
+#endif
+#if defined (HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON) {
+		run_test("test_f32d_s24_32", "neon", false, true, conv_f32d_to_s24_32_neon);
+	}
+#endif
 	run_test("test_f32_s24_32d", "c", true, false, conv_f32_to_s24_32d_c);
 	run_test("test_f32d_s24_32d", "c", false, false, conv_f32d_to_s24_32d_c);
 }
@@ -266,6 +336,26 @@ static void test_s24_32_f32(void)
 	run_test("test_s24_32_f32", "c", true, true, conv_s24_32_to_f32_c);
 	run_test("test_s24_32d_f32", "c", false, true, conv_s24_32d_to_f32_c);
 	run_test("test_s24_32_f32d", "c", true, false, conv_s24_32_to_f32d_c);
+#if defined (HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2) {
+		run_test("test_s24_32_f32d", "sse2", true, false, conv_s24_32_to_f32d_sse2);
+	}
+#endif
+#if defined (HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_s24_32_f32d", "avx2", true, false, conv_s24_32_to_f32d_avx2);
+	}
+#endif
+#if defined (HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_s24_32_f32d", "avx512", true, false, conv_s24_32_to_f32d_avx512);
+	}
+#endif
+#if defined (HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON) {
+		run_test("test_s24_32_f32d", "neon", true, false, conv_s24_32_to_f32d_neon);
+	}
+#endif
 	run_test("test_s24_32d_f32d", "c", false, false, conv_s24_32d_to_f32d_c);
 }
 
@@ -275,6 +365,26 @@ static void test_interleave(void)
 	run_test("test_interleave_16", "c", false, true, conv_interleave_16_c);
 	run_test("test_interleave_24", "c", false, true, conv_interleave_24_c);
 	run_test("test_interleave_32", "c", false, true, conv_interleave_32_c);
+#if defined (HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2) {
+		run_test("test_interleave_32", "sse2", false, true, conv_interleave_32_sse2);
+	}
+#endif
+#if defined (HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_interleave_32", "avx2", false, true, conv_interleave_32_avx2);
+	}
+#endif
+#if defined (HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_interleave_32", "avx512", false, true, conv_interleave_32_avx512);
+	}
+#endif
+#if defined (HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON) {
+		run_test("test_interleave_32", "neon", false, true, conv_interleave_32_neon);
+	}
+#endif
 }
 
 static void test_deinterleave(void)
@@ -283,6 +393,26 @@ static void test_deinterleave(void)
 	run_test("test_deinterleave_16", "c", true, false, conv_deinterleave_16_c);
 	run_test("test_deinterleave_24", "c", true, false, conv_deinterleave_24_c);
 	run_test("test_deinterleave_32", "c", true, false, conv_deinterleave_32_c);
+#if defined (HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2) {
+		run_test("test_deinterleave_32", "sse2", true, false, conv_deinterleave_32_sse2);
+	}
+#endif
+#if defined (HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_deinterleave_32", "avx2", true, false, conv_deinterleave_32_avx2);
+	}
+#endif
+#if defined (HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_deinterleave_32", "avx512", true, false, conv_deinterleave_32_avx512);
+	}
+#endif
+#if defined (HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON) {
+		run_test("test_deinterleave_32", "neon", true, false, conv_deinterleave_32_neon);
+	}
+#endif
 }
 
 static int compare_func(const void *_a, const void *_b)
@@ -320,8 +450,10 @@ int main(int argc, char *argv[])
 
 	for (i = 0; i < n_results; i++) {
 		struct stats *s = &results[i];
-		fprintf(stderr, "%-12."PRIu64" \t%-32.32s %s \t samples %d, channels %d\n",
-				s->perf, s->name, s->impl, s->n_samples, s->n_channels);
+		/* throughput in million samples per second */
+		fprintf(stderr, "%-12."PRIu64" \t%-32.32s %-6s \t samples %d, channels %d \t%10.1f Msamples/s\n",
+				s->perf, s->name, s->impl, s->n_samples, s->n_channels,
+				s->perf * s->n_samples * s->n_channels / 1e6);
 	}
 	return 0;
 }
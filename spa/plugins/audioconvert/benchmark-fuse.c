@@ -0,0 +1,332 @@
+/* Spa
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include <spa/node/node.h>
+#include <spa/node/io.h>
+#include <spa/param/param.h>
+#include <spa/param/props.h>
+#include <spa/param/audio/format-utils.h>
+#include <spa/pod/builder.h>
+
+#include "test-helper.h"
+#include "fmt-ops.h"
+
+/* Compares the unpack node followed by the channelmix node, the way
+ * audioconvert chains them when there is no resampling, against the
+ * channelmix node unpacking the interleaved input itself. In the fused
+ * case the unpack node is a passthrough. */
+
+#define MAX_SAMPLES	4096
+#define MAX_CHANNELS	8
+#define MAX_SIZE	(MAX_SAMPLES * MAX_CHANNELS * sizeof(float))
+
+#define MAX_COUNT	200
+
+#define PLUGIN_LIB	"audioconvert/libspa-audioconvert.so"
+
+static struct spa_support support[1];
+static uint32_t n_support;
+
+static uint8_t mem[3][MAX_SIZE] SPA_ALIGNED(64);
+
+static const uint32_t positions[MAX_CHANNELS] = {
+	SPA_AUDIO_CHANNEL_FL, SPA_AUDIO_CHANNEL_FR,
+	SPA_AUDIO_CHANNEL_FC, SPA_AUDIO_CHANNEL_LFE,
+	SPA_AUDIO_CHANNEL_SL, SPA_AUDIO_CHANNEL_SR,
+	SPA_AUDIO_CHANNEL_RL, SPA_AUDIO_CHANNEL_RR,
+};
+
+static const int sample_sizes[] = { 256, 1024, 4096 };
+
+struct port_buffer {
+	struct spa_buffer buffer;
+	struct spa_data datas[MAX_CHANNELS];
+	struct spa_chunk chunks[MAX_CHANNELS];
+	struct spa_buffer *buffers[1];
+};
+
+struct chain {
+	struct spa_handle *convert_handle;
+	struct spa_node *convert;
+	struct spa_handle *mix_handle;
+	struct spa_node *mix;
+
+	/* input, link and output */
+	struct spa_io_buffers io[3];
+	struct port_buffer bufs[3];
+};
+
+static struct spa_node *make_node(struct spa_handle **handle, const char *name)
+{
+	void *iface;
+
+	if ((*handle = load_handle(support, n_support, PLUGIN_LIB, name)) == NULL)
+		return NULL;
+	if (spa_handle_get_interface(*handle, SPA_TYPE_INTERFACE_Node, &iface) < 0)
+		return NULL;
+	return iface;
+}
+
+static int set_format(struct spa_node *node, enum spa_direction direction,
+		uint32_t format, uint32_t channels)
+{
+	uint8_t buffer[1024];
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+	struct spa_audio_info_raw info;
+
+	spa_zero(info);
+	info.format = format;
+	info.rate = 48000;
+	info.channels = channels;
+	memcpy(info.position, positions, channels * sizeof(uint32_t));
+
+	return spa_node_port_set_param(node, direction, 0, SPA_PARAM_Format, 0,
+			spa_format_audio_raw_build(&b, SPA_PARAM_Format, &info));
+}
+
+static void init_buffer(struct port_buffer *pb, uint8_t *data,
+		uint32_t format, uint32_t channels)
+{
+	uint32_t i, n_datas, maxsize;
+
+	if (SPA_AUDIO_FORMAT_IS_PLANAR(format)) {
+		n_datas = channels;
+		maxsize = MAX_SAMPLES * convert_sample_width(format);
+	} else {
+		n_datas = 1;
+		maxsize = MAX_SAMPLES * convert_sample_width(format) * channels;
+	}
+	spa_zero(*pb);
+	for (i = 0; i < n_datas; i++) {
+		pb->datas[i].type = SPA_DATA_MemPtr;
+		pb->datas[i].flags = SPA_DATA_FLAG_DYNAMIC;
+		pb->datas[i].maxsize = maxsize;
+		pb->datas[i].data = data + i * maxsize;
+		pb->datas[i].chunk = &pb->chunks[i];
+	}
+	pb->buffer.n_datas = n_datas;
+	pb->buffer.datas = pb->datas;
+	pb->buffers[0] = &pb->buffer;
+}
+
+static int use_buffer(struct spa_node *node, enum spa_direction direction,
+		struct port_buffer *pb, struct spa_io_buffers *io)
+{
+	int res;
+
+	if ((res = spa_node_port_use_buffers(node, direction, 0, 0, pb->buffers, 1)) < 0)
+		return res;
+	*io = SPA_IO_BUFFERS_INIT;
+	return spa_node_port_set_io(node, direction, 0, SPA_IO_Buffers, io, sizeof(*io));
+}
+
+static int setup_chain(struct chain *c, uint32_t src_fmt, uint32_t link_fmt,
+		uint32_t src_chan, uint32_t dst_chan, float volume)
+{
+	uint8_t buffer[1024];
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+	int res;
+
+	spa_zero(*c);
+	if ((c->convert = make_node(&c->convert_handle, SPA_NAME_AUDIO_PROCESS_FORMAT)) == NULL ||
+	    (c->mix = make_node(&c->mix_handle, SPA_NAME_AUDIO_PROCESS_CHANNELMIX)) == NULL)
+		return -errno;
+
+	if ((res = set_format(c->convert, SPA_DIRECTION_INPUT, src_fmt, src_chan)) < 0 ||
+	    (res = set_format(c->convert, SPA_DIRECTION_OUTPUT, link_fmt, src_chan)) < 0 ||
+	    (res = set_format(c->mix, SPA_DIRECTION_INPUT, link_fmt, src_chan)) < 0 ||
+	    (res = set_format(c->mix, SPA_DIRECTION_OUTPUT, SPA_AUDIO_FORMAT_F32P, dst_chan)) < 0)
+		return res;
+
+	if ((res = spa_node_set_param(c->mix, SPA_PARAM_Props, 0,
+			spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_Props, SPA_PARAM_Props,
+				SPA_PROP_volume, SPA_POD_Float(volume)))) < 0)
+		return res;
+
+	init_buffer(&c->bufs[0], mem[0], src_fmt, src_chan);
+	init_buffer(&c->bufs[1], mem[1], link_fmt, src_chan);
+	init_buffer(&c->bufs[2], mem[2], SPA_AUDIO_FORMAT_F32P, dst_chan);
+
+	if ((res = use_buffer(c->convert, SPA_DIRECTION_INPUT, &c->bufs[0], &c->io[0])) < 0 ||
+	    (res = use_buffer(c->convert, SPA_DIRECTION_OUTPUT, &c->bufs[1], &c->io[1])) < 0 ||
+	    (res = use_buffer(c->mix, SPA_DIRECTION_INPUT, &c->bufs[1], &c->io[1])) < 0 ||
+	    (res = use_buffer(c->mix, SPA_DIRECTION_OUTPUT, &c->bufs[2], &c->io[2])) < 0)
+		return res;
+
+	spa_node_send_command(c->convert, &SPA_NODE_COMMAND_INIT(SPA_NODE_COMMAND_Start));
+	spa_node_send_command(c->mix, &SPA_NODE_COMMAND_INIT(SPA_NODE_COMMAND_Start));
+
+	return 0;
+}
+
+static void clear_chain(struct chain *c)
+{
+	if (c->convert_handle) {
+		spa_handle_clear(c->convert_handle);
+		free(c->convert_handle);
+	}
+	if (c->mix_handle) {
+		spa_handle_clear(c->mix_handle);
+		free(c->mix_handle);
+	}
+}
+
+static int run_chain(struct chain *c, uint32_t src_fmt, uint32_t src_chan,
+		uint32_t n_samples)
+{
+	int res;
+
+	c->bufs[0].chunks[0].offset = 0;
+	c->bufs[0].chunks[0].size = n_samples * convert_sample_width(src_fmt) * src_chan;
+	c->io[0].status = SPA_STATUS_HAVE_DATA;
+	c->io[0].buffer_id = 0;
+
+	if ((res = spa_node_process(c->convert)) < 0)
+		return res;
+	if ((res = spa_node_process(c->mix)) < 0)
+		return res;
+	if (c->io[2].status != SPA_STATUS_HAVE_DATA)
+		return -EIO;
+
+	/* consume the output, it is recycled in the next cycle */
+	c->io[2].status = SPA_STATUS_NEED_DATA;
+	return 0;
+}
+
+static int run_test(const char *name, uint32_t src_fmt, uint32_t link_fmt,
+		uint32_t src_chan, uint32_t dst_chan, float volume,
+		uint32_t n_samples, uint64_t *nsec)
+{
+	struct chain c;
+	struct timespec ts;
+	uint64_t t1, t2;
+	uint32_t i;
+	int res;
+
+	if ((res = setup_chain(&c, src_fmt, link_fmt, src_chan, dst_chan, volume)) < 0)
+		goto done;
+
+	/* warm up */
+	if ((res = run_chain(&c, src_fmt, src_chan, n_samples)) < 0)
+		goto done;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+	for (i = 0; i < MAX_COUNT; i++) {
+		if ((res = run_chain(&c, src_fmt, src_chan, n_samples)) < 0)
+			goto done;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	*nsec = (t2 - t1) / MAX_COUNT;
+done:
+	clear_chain(&c);
+	if (res < 0)
+		fprintf(stderr, "%s: %s\n", name, spa_strerror(res));
+	return res;
+}
+
+static void fill_input(uint32_t format)
+{
+	uint32_t i;
+
+	if (format == SPA_AUDIO_FORMAT_F32) {
+		float *d = (float *)mem[0];
+		for (i = 0; i < MAX_SIZE / sizeof(float); i++)
+			d[i] = drand48() * 2.0 - 1.0;
+	} else {
+		for (i = 0; i < MAX_SIZE; i++)
+			mem[0][i] = rand();
+	}
+}
+
+static int run_tests(const char *name, uint32_t src_fmt,
+		uint32_t src_chan, uint32_t dst_chan, float volume)
+{
+	uint64_t chained, fused;
+	uint32_t i, n_samples;
+	int res;
+
+	fill_input(src_fmt);
+
+	for (i = 0; i < SPA_N_ELEMENTS(sample_sizes); i++) {
+		n_samples = sample_sizes[i];
+
+		if ((res = run_test(name, src_fmt, SPA_AUDIO_FORMAT_F32P,
+				src_chan, dst_chan, volume, n_samples, &chained)) < 0)
+			return res;
+		if ((res = run_test(name, src_fmt, src_fmt,
+				src_chan, dst_chan, volume, n_samples, &fused)) < 0)
+			return res;
+
+		fprintf(stdout, "%-6s %3u -> %-3u %6.2f %8u %12.1f %12.1f %8.2fx\n",
+				name, src_chan, dst_chan, volume, n_samples,
+				chained / 1e3, fused / 1e3,
+				fused > 0 ? (double)chained / fused : 0.0);
+	}
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	struct spa_handle *cpu_handle;
+	void *iface;
+	int res;
+
+	if ((cpu_handle = load_handle(NULL, 0, "support/libspa-support.so",
+					SPA_NAME_SUPPORT_CPU)) != NULL &&
+	    spa_handle_get_interface(cpu_handle, SPA_TYPE_INTERFACE_CPU, &iface) >= 0) {
+		support[n_support++] = SPA_SUPPORT_INIT(SPA_TYPE_INTERFACE_CPU, iface);
+		printf("got get CPU flags %d\n", spa_cpu_get_flags((struct spa_cpu*)iface));
+	}
+
+	fprintf(stdout, "%-6s %10s %6s %8s %12s %12s %9s\n",
+			"format", "channels", "volume", "samples",
+			"chained(us)", "fused(us)", "speedup");
+
+	if ((res = run_tests("s16", SPA_AUDIO_FORMAT_S16, 2, 2, 1.0f)) < 0 ||
+	    (res = run_tests("s16", SPA_AUDIO_FORMAT_S16, 2, 2, 0.5f)) < 0 ||
+	    (res = run_tests("s16", SPA_AUDIO_FORMAT_S16, 6, 2, 1.0f)) < 0 ||
+	    (res = run_tests("s16", SPA_AUDIO_FORMAT_S16, 8, 2, 1.0f)) < 0 ||
+	    (res = run_tests("s24", SPA_AUDIO_FORMAT_S24, 2, 2, 0.5f)) < 0 ||
+	    (res = run_tests("s32", SPA_AUDIO_FORMAT_S32, 6, 2, 1.0f)) < 0 ||
+	    (res = run_tests("f32", SPA_AUDIO_FORMAT_F32, 2, 2, 0.5f)) < 0 ||
+	    (res = run_tests("f32", SPA_AUDIO_FORMAT_F32, 6, 2, 1.0f)) < 0)
+		return EXIT_FAILURE;
+
+	free(cpu_handle);
+
+	return EXIT_SUCCESS;
+}
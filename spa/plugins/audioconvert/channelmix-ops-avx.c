@@ -0,0 +1,74 @@
+/* Spa
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "channelmix-ops-impl.h"
+
+#include <immintrin.h>
+
+static void conv_avx(float *d, const float **s, const float *c,
+		uint32_t n_c, uint32_t n_samples)
+{
+	uint32_t n, k, unrolled;
+	__m256 v, a[4];
+	__m128 t;
+
+	if (n_c == 0) {
+		memset(d, 0, n_samples * sizeof(float));
+		return;
+	}
+	if (n_c == 1 && c[0] == 1.0f) {
+		spa_memcpy(d, s[0], n_samples * sizeof(float));
+		return;
+	}
+	unrolled = n_samples & ~31;
+
+	for (n = 0; n < unrolled; n += 32) {
+		v = _mm256_broadcast_ss(&c[0]);
+		a[0] = _mm256_mul_ps(_mm256_loadu_ps(&s[0][n+ 0]), v);
+		a[1] = _mm256_mul_ps(_mm256_loadu_ps(&s[0][n+ 8]), v);
+		a[2] = _mm256_mul_ps(_mm256_loadu_ps(&s[0][n+16]), v);
+		a[3] = _mm256_mul_ps(_mm256_loadu_ps(&s[0][n+24]), v);
+		for (k = 1; k < n_c; k++) {
+			v = _mm256_broadcast_ss(&c[k]);
+			a[0] = _mm256_add_ps(a[0], _mm256_mul_ps(_mm256_loadu_ps(&s[k][n+ 0]), v));
+			a[1] = _mm256_add_ps(a[1], _mm256_mul_ps(_mm256_loadu_ps(&s[k][n+ 8]), v));
+			a[2] = _mm256_add_ps(a[2], _mm256_mul_ps(_mm256_loadu_ps(&s[k][n+16]), v));
+			a[3] = _mm256_add_ps(a[3], _mm256_mul_ps(_mm256_loadu_ps(&s[k][n+24]), v));
+		}
+		_mm256_storeu_ps(&d[n+ 0], a[0]);
+		_mm256_storeu_ps(&d[n+ 8], a[1]);
+		_mm256_storeu_ps(&d[n+16], a[2]);
+		_mm256_storeu_ps(&d[n+24], a[3]);
+	}
+	for (; n < n_samples; n++) {
+		t = _mm_mul_ss(_mm_load_ss(&s[0][n]), _mm_load_ss(&c[0]));
+		for (k = 1; k < n_c; k++)
+			t = _mm_add_ss(t, _mm_mul_ss(_mm_load_ss(&s[k][n]), _mm_load_ss(&c[k])));
+		_mm_store_ss(&d[n], t);
+	}
+}
+
+MAKE_CHANNELMIX_COPY(avx);
+MAKE_CHANNELMIX_N_M(avx);
+MAKE_CHANNELMIX_LAYOUTS(avx);
@@ -0,0 +1,253 @@
+/* Spa
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "channelmix-ops.h"
+
+/* The SIMD channelmix functions reduce every layout to a sparse matrix
+ * product. Each destination channel is the sum of the source channels
+ * with a non-zero coefficient. The architecture specific files provide
+ * the conv_<arch>() kernel that does one row and expand the
+ * MAKE_CHANNELMIX_* macros below to make the channelmix functions. */
+
+#define MAX_LAYOUT	8
+
+#define DEFINE_CHANNELMIX(name,arch)						\
+void channelmix_##name##_##arch(struct channelmix *mix,				\
+		uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],			\
+		uint32_t n_src, const void * SPA_RESTRICT src[n_src],		\
+		uint32_t n_samples)
+
+typedef void (*channelmix_conv_t) (float *d, const float **s, const float *c,
+		uint32_t n_c, uint32_t n_samples);
+
+/* mix rows of matrix into d, with the rows stride floats apart */
+static inline void channelmix_rows(struct channelmix *mix, channelmix_conv_t conv,
+		uint32_t n_dst, float **d, uint32_t n_src, const float **s,
+		const float *matrix, uint32_t stride, uint32_t n_samples)
+{
+	uint32_t i, j, n_c;
+	const float *ss[SPA_AUDIO_MAX_CHANNELS];
+	float c[SPA_AUDIO_MAX_CHANNELS];
+	bool zero = SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_ZERO);
+
+	for (i = 0; i < n_dst; i++) {
+		const float *m = &matrix[i * stride];
+		for (j = 0, n_c = 0; !zero && j < n_src; j++) {
+			if (m[j] == 0.0f)
+				continue;
+			ss[n_c] = s[j];
+			c[n_c++] = m[j];
+		}
+		conv(d[i], ss, c, n_c, n_samples);
+	}
+}
+
+static inline void channelmix_lfe(struct channelmix *mix, float **d,
+		uint32_t lfe, float v, uint32_t n_samples)
+{
+	if (v > 0.0f)
+		lr4_process(&mix->lr4[lfe], d[lfe], n_samples);
+}
+
+/* The layout matrices, these match the C implementations */
+#define DEFINE_LAYOUT(name)	static inline void layout_##name(struct channelmix *mix, \
+					float m[MAX_LAYOUT][MAX_LAYOUT])
+#define MM(i,j)			mix->matrix[i][j]
+
+DEFINE_LAYOUT(f32_1_2)
+{
+	m[0][0] = MM(0,0);
+	m[1][0] = SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_EQUAL) ? MM(0,0) : MM(1,0);
+}
+
+DEFINE_LAYOUT(f32_2_1)
+{
+	bool eq = SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_EQUAL);
+	m[0][0] = MM(0,0);
+	m[0][1] = eq ? MM(0,0) : MM(0,1);
+}
+
+DEFINE_LAYOUT(f32_4_1)
+{
+	bool eq = SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_EQUAL);
+	m[0][0] = MM(0,0);
+	m[0][1] = eq ? MM(0,0) : MM(0,1);
+	m[0][2] = eq ? MM(0,0) : MM(0,2);
+	m[0][3] = eq ? MM(0,0) : MM(0,3);
+}
+
+DEFINE_LAYOUT(f32_3p1_1)
+{
+	bool eq = SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_EQUAL);
+	m[0][0] = MM(0,0);
+	m[0][1] = eq ? MM(0,0) : MM(0,1);
+	m[0][2] = eq ? MM(0,0) : MM(0,2);
+	m[0][3] = eq ? MM(0,0) : 0.0f;
+}
+
+DEFINE_LAYOUT(f32_2_4)
+{
+	m[0][0] = MM(0,0);
+	m[1][1] = MM(1,1);
+	m[2][0] = MM(2,0);
+	m[3][1] = MM(3,1);
+}
+
+DEFINE_LAYOUT(f32_2_3p1)
+{
+	m[0][0] = MM(0,0);
+	m[1][1] = MM(1,1);
+	m[2][0] = m[2][1] = (MM(2,0) + MM(2,1)) * 0.5f;
+	m[3][0] = m[3][1] = (MM(3,0) + MM(3,1)) * 0.5f;
+}
+
+DEFINE_LAYOUT(f32_2_5p1)
+{
+	layout_f32_2_3p1(mix, m);
+	m[4][0] = MM(4,0);
+	m[5][1] = MM(5,1);
+}
+
+DEFINE_LAYOUT(f32_5p1_2)
+{
+	m[0][0] = MM(0,0);
+	m[1][1] = MM(1,1);
+	m[0][2] = m[1][2] = (MM(0,2) + MM(1,2)) * 0.5f;
+	m[0][3] = m[1][3] = (MM(0,3) + MM(1,3)) * 0.5f;
+	m[0][4] = MM(0,4);
+	m[1][5] = MM(1,5);
+}
+
+DEFINE_LAYOUT(f32_5p1_3p1)
+{
+	m[0][0] = MM(0,0);
+	m[1][1] = MM(1,1);
+	m[2][2] = MM(2,2);
+	m[3][3] = MM(3,3);
+	m[0][4] = MM(0,4);
+	m[1][5] = MM(1,5);
+}
+
+DEFINE_LAYOUT(f32_5p1_4)
+{
+	m[0][0] = MM(0,0);
+	m[1][1] = MM(1,1);
+	m[0][2] = m[1][2] = MM(0,2);
+	m[0][3] = m[1][3] = MM(0,3);
+	m[2][4] = MM(2,4);
+	m[3][5] = MM(3,5);
+}
+
+DEFINE_LAYOUT(f32_7p1_2)
+{
+	layout_f32_5p1_2(mix, m);
+	m[0][6] = MM(0,6);
+	m[1][7] = MM(1,7);
+}
+
+DEFINE_LAYOUT(f32_7p1_3p1)
+{
+	m[0][0] = MM(0,0);
+	m[1][1] = MM(1,1);
+	m[2][2] = MM(2,2);
+	m[3][3] = MM(3,3);
+	m[0][4] = m[0][6] = (MM(0,4) + MM(0,6)) * 0.5f;
+	m[1][5] = m[1][7] = (MM(1,5) + MM(1,7)) * 0.5f;
+}
+
+DEFINE_LAYOUT(f32_7p1_4)
+{
+	m[0][0] = MM(0,0);
+	m[1][1] = MM(1,1);
+	m[0][2] = m[1][2] = (MM(0,2) + MM(1,2)) * 0.5f;
+	m[0][3] = m[1][3] = (MM(0,3) + MM(1,3)) * 0.5f;
+	m[0][4] = m[2][4] = MM(2,4);
+	m[1][5] = m[3][5] = MM(3,5);
+	m[2][6] = MM(2,6);
+	m[3][7] = MM(3,7);
+}
+
+#undef MM
+
+#define MAKE_CHANNELMIX_COPY(arch)						\
+DEFINE_CHANNELMIX(copy,arch)							\
+{										\
+	uint32_t i;								\
+	float **d = (float **)dst;						\
+	const float **s = (const float **)src;					\
+	bool zero = SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_ZERO);		\
+	bool identity = SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_IDENTITY);	\
+										\
+	for (i = 0; i < n_dst; i++) {						\
+		const float one = 1.0f;						\
+		conv_##arch(d[i], &s[i], identity ? &one : &mix->matrix[i][i],	\
+				zero ? 0 : 1, n_samples);			\
+	}									\
+}
+
+#define MAKE_CHANNELMIX_N_M(arch)						\
+DEFINE_CHANNELMIX(f32_n_m,arch)							\
+{										\
+	channelmix_rows(mix, conv_##arch, n_dst, (float **)dst,			\
+			n_src, (const float **)src, &mix->matrix[0][0],		\
+			SPA_AUDIO_MAX_CHANNELS, n_samples);			\
+}
+
+#define MAKE_CHANNELMIX_LAYOUT(name,arch)					\
+DEFINE_CHANNELMIX(name,arch)							\
+{										\
+	float m[MAX_LAYOUT][MAX_LAYOUT] = {{ 0.0f }};				\
+	layout_##name(mix, m);							\
+	channelmix_rows(mix, conv_##arch, n_dst, (float **)dst,			\
+			n_src, (const float **)src, &m[0][0],			\
+			MAX_LAYOUT, n_samples);					\
+}
+
+/* upmix to LFE, filtered */
+#define MAKE_CHANNELMIX_LAYOUT_LFE(name,arch)					\
+DEFINE_CHANNELMIX(name,arch)							\
+{										\
+	float m[MAX_LAYOUT][MAX_LAYOUT] = {{ 0.0f }};				\
+	layout_##name(mix, m);							\
+	channelmix_rows(mix, conv_##arch, n_dst, (float **)dst,			\
+			n_src, (const float **)src, &m[0][0],			\
+			MAX_LAYOUT, n_samples);					\
+	if (!SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_ZERO))			\
+		channelmix_lfe(mix, (float **)dst, 3, m[3][0], n_samples);	\
+}
+
+#define MAKE_CHANNELMIX_LAYOUTS(arch)						\
+MAKE_CHANNELMIX_LAYOUT(f32_1_2,arch)						\
+MAKE_CHANNELMIX_LAYOUT(f32_2_1,arch)						\
+MAKE_CHANNELMIX_LAYOUT(f32_4_1,arch)						\
+MAKE_CHANNELMIX_LAYOUT(f32_3p1_1,arch)						\
+MAKE_CHANNELMIX_LAYOUT(f32_2_4,arch)						\
+MAKE_CHANNELMIX_LAYOUT_LFE(f32_2_3p1,arch)					\
+MAKE_CHANNELMIX_LAYOUT_LFE(f32_2_5p1,arch)					\
+MAKE_CHANNELMIX_LAYOUT(f32_5p1_2,arch)						\
+MAKE_CHANNELMIX_LAYOUT(f32_5p1_3p1,arch)					\
+MAKE_CHANNELMIX_LAYOUT(f32_5p1_4,arch)						\
+MAKE_CHANNELMIX_LAYOUT(f32_7p1_2,arch)						\
+MAKE_CHANNELMIX_LAYOUT(f32_7p1_3p1,arch)					\
+MAKE_CHANNELMIX_LAYOUT(f32_7p1_4,arch)
@@ -0,0 +1,72 @@
+/* Spa
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "channelmix-ops-impl.h"
+
+#include <arm_neon.h>
+
+static void conv_neon(float *d, const float **s, const float *c,
+		uint32_t n_c, uint32_t n_samples)
+{
+	uint32_t n, k, unrolled;
+	float32x4_t a[4];
+	float t;
+
+	if (n_c == 0) {
+		memset(d, 0, n_samples * sizeof(float));
+		return;
+	}
+	if (n_c == 1 && c[0] == 1.0f) {
+		spa_memcpy(d, s[0], n_samples * sizeof(float));
+		return;
+	}
+	unrolled = n_samples & ~15;
+
+	for (n = 0; n < unrolled; n += 16) {
+		a[0] = vmulq_n_f32(vld1q_f32(&s[0][n+ 0]), c[0]);
+		a[1] = vmulq_n_f32(vld1q_f32(&s[0][n+ 4]), c[0]);
+		a[2] = vmulq_n_f32(vld1q_f32(&s[0][n+ 8]), c[0]);
+		a[3] = vmulq_n_f32(vld1q_f32(&s[0][n+12]), c[0]);
+		for (k = 1; k < n_c; k++) {
+			a[0] = vmlaq_n_f32(a[0], vld1q_f32(&s[k][n+ 0]), c[k]);
+			a[1] = vmlaq_n_f32(a[1], vld1q_f32(&s[k][n+ 4]), c[k]);
+			a[2] = vmlaq_n_f32(a[2], vld1q_f32(&s[k][n+ 8]), c[k]);
+			a[3] = vmlaq_n_f32(a[3], vld1q_f32(&s[k][n+12]), c[k]);
+		}
+		vst1q_f32(&d[n+ 0], a[0]);
+		vst1q_f32(&d[n+ 4], a[1]);
+		vst1q_f32(&d[n+ 8], a[2]);
+		vst1q_f32(&d[n+12], a[3]);
+	}
+	for (; n < n_samples; n++) {
+		t = s[0][n] * c[0];
+		for (k = 1; k < n_c; k++)
+			t += s[k][n] * c[k];
+		d[n] = t;
+	}
+}
+
+MAKE_CHANNELMIX_COPY(neon);
+MAKE_CHANNELMIX_N_M(neon);
+MAKE_CHANNELMIX_LAYOUTS(neon);
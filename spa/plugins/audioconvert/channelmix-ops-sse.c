@@ -22,10 +22,52 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
-#include "channelmix-ops.h"
+#include "channelmix-ops-impl.h"
 
 #include <xmmintrin.h>
 
+static void conv_sse(float *d, const float **s, const float *c,
+		uint32_t n_c, uint32_t n_samples)
+{
+	uint32_t n, k, unrolled;
+	__m128 v, a[4];
+
+	if (n_c == 0) {
+		memset(d, 0, n_samples * sizeof(float));
+		return;
+	}
+	if (n_c == 1 && c[0] == 1.0f) {
+		spa_memcpy(d, s[0], n_samples * sizeof(float));
+		return;
+	}
+	unrolled = n_samples & ~15;
+
+	for (n = 0; n < unrolled; n += 16) {
+		v = _mm_set1_ps(c[0]);
+		a[0] = _mm_mul_ps(_mm_loadu_ps(&s[0][n+ 0]), v);
+		a[1] = _mm_mul_ps(_mm_loadu_ps(&s[0][n+ 4]), v);
+		a[2] = _mm_mul_ps(_mm_loadu_ps(&s[0][n+ 8]), v);
+		a[3] = _mm_mul_ps(_mm_loadu_ps(&s[0][n+12]), v);
+		for (k = 1; k < n_c; k++) {
+			v = _mm_set1_ps(c[k]);
+			a[0] = _mm_add_ps(a[0], _mm_mul_ps(_mm_loadu_ps(&s[k][n+ 0]), v));
+			a[1] = _mm_add_ps(a[1], _mm_mul_ps(_mm_loadu_ps(&s[k][n+ 4]), v));
+			a[2] = _mm_add_ps(a[2], _mm_mul_ps(_mm_loadu_ps(&s[k][n+ 8]), v));
+			a[3] = _mm_add_ps(a[3], _mm_mul_ps(_mm_loadu_ps(&s[k][n+12]), v));
+		}
+		_mm_storeu_ps(&d[n+ 0], a[0]);
+		_mm_storeu_ps(&d[n+ 4], a[1]);
+		_mm_storeu_ps(&d[n+ 8], a[2]);
+		_mm_storeu_ps(&d[n+12], a[3]);
+	}
+	for (; n < n_samples; n++) {
+		a[0] = _mm_mul_ss(_mm_load_ss(&s[0][n]), _mm_load_ss(&c[0]));
+		for (k = 1; k < n_c; k++)
+			a[0] = _mm_add_ss(a[0], _mm_mul_ss(_mm_load_ss(&s[k][n]), _mm_load_ss(&c[k])));
+		_mm_store_ss(&d[n], a[0]);
+	}
+}
+
 void channelmix_copy_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
 		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
 {
@@ -70,167 +112,6 @@ void channelmix_copy_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_REST
 	}
 }
 
-void
-channelmix_f32_2_4_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
-		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
-{
-	uint32_t i, n, unrolled;
-	float **d = (float **)dst;
-	const float **s = (const float **)src;
-	const float m00 = mix->matrix[0][0];
-	const float m11 = mix->matrix[1][1];
-	__m128 in;
-	const float *sFL = s[0], *sFR = s[1];
-	float *dFL = d[0], *dFR = d[1], *dRL = d[2], *dRR = d[3];
-
-	if (SPA_IS_ALIGNED(sFL, 16) &&
-	    SPA_IS_ALIGNED(sFR, 16) &&
-	    SPA_IS_ALIGNED(dFL, 16) &&
-	    SPA_IS_ALIGNED(dFR, 16) &&
-	    SPA_IS_ALIGNED(dRL, 16) &&
-	    SPA_IS_ALIGNED(dRR, 16))
-		unrolled = n_samples & ~3;
-	else
-		unrolled = 0;
-
-	if (SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_ZERO)) {
-		for (i = 0; i < n_dst; i++)
-			memset(d[i], 0, n_samples * sizeof(float));
-	}
-	else if (m00 == 1.0f && m11 == 1.0f) {
-		for(n = 0; n < unrolled; n += 4) {
-			in = _mm_load_ps(&sFL[n]);
-			_mm_store_ps(&dFL[n], in);
-			_mm_store_ps(&dRL[n], in);
-			in = _mm_load_ps(&sFR[n]);
-			_mm_store_ps(&dFR[n], in);
-			_mm_store_ps(&dRR[n], in);
-		}
-		for(; n < n_samples; n++) {
-			in = _mm_load_ss(&sFL[n]);
-			_mm_store_ss(&dFL[n], in);
-			_mm_store_ss(&dRL[n], in);
-			in = _mm_load_ss(&sFR[n]);
-			_mm_store_ss(&dFR[n], in);
-			_mm_store_ss(&dRR[n], in);
-		}
-	}
-	else {
-		const __m128 v0 = _mm_set1_ps(m00);
-		const __m128 v1 = _mm_set1_ps(m11);
-		for(n = 0; n < unrolled; n += 4) {
-			in = _mm_mul_ps(_mm_load_ps(&sFL[n]), v0);
-			_mm_store_ps(&dFL[n], in);
-			_mm_store_ps(&dRL[n], in);
-			in = _mm_mul_ps(_mm_load_ps(&sFR[n]), v1);
-			_mm_store_ps(&dFR[n], in);
-			_mm_store_ps(&dRR[n], in);
-		}
-		for(; n < n_samples; n++) {
-			in = _mm_mul_ss(_mm_load_ss(&sFL[n]), v0);
-			_mm_store_ss(&dFL[n], in);
-			_mm_store_ss(&dRL[n], in);
-			in = _mm_mul_ss(_mm_load_ss(&sFR[n]), v1);
-			_mm_store_ss(&dFR[n], in);
-			_mm_store_ss(&dRR[n], in);
-		}
-	}
-}
-
-/* FL+FR+FC+LFE+SL+SR -> FL+FR */
-void
-channelmix_f32_5p1_2_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
-		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
-{
-	uint32_t n, unrolled;
-	float **d = (float **) dst;
-	const float **s = (const float **) src;
-	const float m00 = mix->matrix[0][0];
-	const float m11 = mix->matrix[1][1];
-	const __m128 clev = _mm_set1_ps((mix->matrix[0][2] + mix->matrix[1][2]) * 0.5f);
-	const __m128 llev = _mm_set1_ps((mix->matrix[0][3] + mix->matrix[1][3]) * 0.5f);
-	const __m128 slev0 = _mm_set1_ps(mix->matrix[0][4]);
-	const __m128 slev1 = _mm_set1_ps(mix->matrix[1][5]);
-	__m128 in, ctr;
-	const float *sFL = s[0], *sFR = s[1], *sFC = s[2], *sLFE = s[3], *sSL = s[4], *sSR = s[5];
-	float *dFL = d[0], *dFR = d[1];
-
-	if (SPA_IS_ALIGNED(sFL, 16) &&
-	    SPA_IS_ALIGNED(sFR, 16) &&
-	    SPA_IS_ALIGNED(sFC, 16) &&
-	    SPA_IS_ALIGNED(sLFE, 16) &&
-	    SPA_IS_ALIGNED(sSL, 16) &&
-	    SPA_IS_ALIGNED(sSR, 16) &&
-	    SPA_IS_ALIGNED(dFL, 16) &&
-	    SPA_IS_ALIGNED(dFR, 16))
-		unrolled = n_samples & ~3;
-	else
-		unrolled = 0;
-
-	if (SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_ZERO)) {
-		memset(dFL, 0, n_samples * sizeof(float));
-		memset(dFR, 0, n_samples * sizeof(float));
-	}
-	else if (m00 == 1.0f && m11 == 1.0f) {
-		for(n = 0; n < unrolled; n += 4) {
-			ctr = _mm_mul_ps(_mm_load_ps(&sFC[n]), clev);
-			ctr = _mm_add_ps(ctr, _mm_mul_ps(_mm_load_ps(&sLFE[n]), llev));
-			in = _mm_mul_ps(_mm_load_ps(&sSL[n]), slev0);
-			in = _mm_add_ps(in, ctr);
-			in = _mm_add_ps(in, _mm_load_ps(&sFL[n]));
-			_mm_store_ps(&dFL[n], in);
-			in = _mm_mul_ps(_mm_load_ps(&sSR[n]), slev1);
-			in = _mm_add_ps(in, ctr);
-			in = _mm_add_ps(in, _mm_load_ps(&sFR[n]));
-			_mm_store_ps(&dFR[n], in);
-		}
-		for(; n < n_samples; n++) {
-			ctr = _mm_mul_ss(_mm_load_ss(&sFC[n]), clev);
-			ctr = _mm_add_ss(ctr, _mm_mul_ss(_mm_load_ss(&sLFE[n]), llev));
-			in = _mm_mul_ss(_mm_load_ss(&sSL[n]), slev0);
-			in = _mm_add_ss(in, ctr);
-			in = _mm_add_ss(in, _mm_load_ss(&sFL[n]));
-			_mm_store_ss(&dFL[n], in);
-			in = _mm_mul_ss(_mm_load_ss(&sSR[n]), slev1);
-			in = _mm_add_ss(in, ctr);
-			in = _mm_add_ss(in, _mm_load_ss(&sFR[n]));
-			_mm_store_ss(&dFR[n], in);
-		}
-	}
-	else {
-		const __m128 v0 = _mm_set1_ps(m00);
-		const __m128 v1 = _mm_set1_ps(m11);
-		for(n = 0; n < unrolled; n += 4) {
-			ctr = _mm_mul_ps(_mm_load_ps(&sFC[n]), clev);
-			ctr = _mm_add_ps(ctr, _mm_mul_ps(_mm_load_ps(&sLFE[n]), llev));
-			in = _mm_mul_ps(_mm_load_ps(&sSL[n]), slev0);
-			in = _mm_add_ps(in, ctr);
-			in = _mm_add_ps(in, _mm_load_ps(&sFL[n]));
-			in = _mm_mul_ps(in, v0);
-			_mm_store_ps(&dFL[n], in);
-			in = _mm_mul_ps(_mm_load_ps(&sSR[n]), slev1);
-			in = _mm_add_ps(in, ctr);
-			in = _mm_add_ps(in, _mm_load_ps(&sFR[n]));
-			in = _mm_mul_ps(in, v1);
-			_mm_store_ps(&dFR[n], in);
-		}
-		for(; n < n_samples; n++) {
-			ctr = _mm_mul_ss(_mm_load_ss(&sFC[n]), clev);
-			ctr = _mm_add_ss(ctr, _mm_mul_ss(_mm_load_ss(&sLFE[n]), llev));
-			in = _mm_mul_ss(_mm_load_ss(&sSL[n]), slev0);
-			in = _mm_add_ss(in, ctr);
-			in = _mm_add_ss(in, _mm_load_ss(&sFL[n]));
-			in = _mm_mul_ss(in, v0);
-			_mm_store_ss(&dFL[n], in);
-			in = _mm_mul_ss(_mm_load_ss(&sSR[n]), slev1);
-			in = _mm_add_ss(in, ctr);
-			in = _mm_add_ss(in, _mm_load_ss(&sFR[n]));
-			in = _mm_mul_ss(in, v1);
-			_mm_store_ss(&dFR[n], in);
-		}
-	}
-}
-
 /* FL+FR+FC+LFE+SL+SR -> FL+FR+FC+LFE*/
 void
 channelmix_f32_5p1_3p1_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
@@ -309,81 +190,16 @@ channelmix_f32_5p1_3p1_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_RE
 	}
 }
 
-/* FL+FR+FC+LFE+SL+SR -> FL+FR+RL+RR*/
-void
-channelmix_f32_5p1_4_sse(struct channelmix *mix, uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
-		uint32_t n_src, const void * SPA_RESTRICT src[n_src], uint32_t n_samples)
-{
-	uint32_t i, n, unrolled;
-	float **d = (float **) dst;
-	const float **s = (const float **) src;
-	const __m128 clev = _mm_set1_ps(mix->matrix[0][2]);
-	const __m128 llev = _mm_set1_ps(mix->matrix[0][3]);
-	const float m00 = mix->matrix[0][0];
-	const float m11 = mix->matrix[1][1];
-	const float m24 = mix->matrix[2][4];
-	const float m35 = mix->matrix[3][5];
-	__m128 ctr;
-	const float *sFL = s[0], *sFR = s[1], *sFC = s[2], *sLFE = s[3], *sSL = s[4], *sSR = s[5];
-	float *dFL = d[0], *dFR = d[1], *dRL = d[2], *dRR = d[3];
-
-	if (SPA_IS_ALIGNED(sFL, 16) &&
-	    SPA_IS_ALIGNED(sFR, 16) &&
-	    SPA_IS_ALIGNED(sFC, 16) &&
-	    SPA_IS_ALIGNED(sLFE, 16) &&
-	    SPA_IS_ALIGNED(sSL, 16) &&
-	    SPA_IS_ALIGNED(sSR, 16) &&
-	    SPA_IS_ALIGNED(dFL, 16) &&
-	    SPA_IS_ALIGNED(dFR, 16) &&
-	    SPA_IS_ALIGNED(dRL, 16) &&
-	    SPA_IS_ALIGNED(dRR, 16))
-		unrolled = n_samples & ~3;
-	else
-		unrolled = 0;
-
-	if (SPA_FLAG_IS_SET(mix->flags, CHANNELMIX_FLAG_ZERO)) {
-		for (i = 0; i < n_dst; i++)
-			memset(d[i], 0, n_samples * sizeof(float));
-	}
-	else if (m00 == 1.0f && m11 == 1.0f && m24 == 1.0f && m35 == 1.0f) {
-		for(n = 0; n < unrolled; n += 4) {
-			ctr = _mm_mul_ps(_mm_load_ps(&sFC[n]), clev);
-			ctr = _mm_add_ps(ctr, _mm_mul_ps(_mm_load_ps(&sLFE[n]), llev));
-			_mm_store_ps(&dFL[n], _mm_add_ps(_mm_load_ps(&sFL[n]), ctr));
-			_mm_store_ps(&dFR[n], _mm_add_ps(_mm_load_ps(&sFR[n]), ctr));
-			_mm_store_ps(&dRL[n], _mm_load_ps(&sSL[n]));
-			_mm_store_ps(&dRR[n], _mm_load_ps(&sSR[n]));
-		}
-		for(; n < n_samples; n++) {
-			ctr = _mm_mul_ss(_mm_load_ss(&sFC[n]), clev);
-			ctr = _mm_add_ss(ctr, _mm_mul_ss(_mm_load_ss(&sLFE[n]), llev));
-			_mm_store_ss(&dFL[n], _mm_add_ss(_mm_load_ss(&sFL[n]), ctr));
-			_mm_store_ss(&dFR[n], _mm_add_ss(_mm_load_ss(&sFR[n]), ctr));
-			_mm_store_ss(&dRL[n], _mm_load_ss(&sSL[n]));
-			_mm_store_ss(&dRR[n], _mm_load_ss(&sSR[n]));
-		}
-	}
-	else {
-		const __m128 v0 = _mm_set1_ps(m00);
-		const __m128 v1 = _mm_set1_ps(m11);
-		const __m128 v4 = _mm_set1_ps(m24);
-		const __m128 v5 = _mm_set1_ps(m35);
-
-		for(n = 0; n < unrolled; n += 4) {
-			ctr = _mm_mul_ps(_mm_load_ps(&sFC[n]), clev);
-			ctr = _mm_add_ps(ctr, _mm_mul_ps(_mm_load_ps(&sLFE[n]), llev));
-			_mm_store_ps(&dFL[n], _mm_mul_ps(_mm_add_ps(_mm_load_ps(&sFL[n]), ctr), v0));
-			_mm_store_ps(&dFR[n], _mm_mul_ps(_mm_add_ps(_mm_load_ps(&sFR[n]), ctr), v1));
-			_mm_store_ps(&dRL[n], _mm_mul_ps(_mm_load_ps(&sSL[n]), v4));
-			_mm_store_ps(&dRR[n], _mm_mul_ps(_mm_load_ps(&sSR[n]), v5));
-		}
-		for(; n < n_samples; n++) {
-			ctr = _mm_mul_ss(_mm_load_ss(&sFC[n]), clev);
-			ctr = _mm_add_ss(ctr, _mm_mul_ss(_mm_load_ss(&sLFE[n]), llev));
-			_mm_store_ss(&dFL[n], _mm_mul_ss(_mm_add_ss(_mm_load_ss(&sFL[n]), ctr), v0));
-			_mm_store_ss(&dFR[n], _mm_mul_ss(_mm_add_ss(_mm_load_ss(&sFR[n]), ctr), v1));
-			_mm_store_ss(&dRL[n], _mm_mul_ss(_mm_load_ss(&sSL[n]), v4));
-			_mm_store_ss(&dRR[n], _mm_mul_ss(_mm_load_ss(&sSR[n]), v5));
-		}
-	}
-}
+MAKE_CHANNELMIX_N_M(sse);
+MAKE_CHANNELMIX_LAYOUT(f32_1_2,sse);
+MAKE_CHANNELMIX_LAYOUT(f32_2_1,sse);
+MAKE_CHANNELMIX_LAYOUT(f32_4_1,sse);
+MAKE_CHANNELMIX_LAYOUT(f32_3p1_1,sse);
+MAKE_CHANNELMIX_LAYOUT(f32_2_4,sse);
+MAKE_CHANNELMIX_LAYOUT_LFE(f32_2_3p1,sse);
+MAKE_CHANNELMIX_LAYOUT_LFE(f32_2_5p1,sse);
+MAKE_CHANNELMIX_LAYOUT(f32_5p1_2,sse);
+MAKE_CHANNELMIX_LAYOUT(f32_5p1_4,sse);
+MAKE_CHANNELMIX_LAYOUT(f32_7p1_2,sse);
+MAKE_CHANNELMIX_LAYOUT(f32_7p1_3p1,sse);
+MAKE_CHANNELMIX_LAYOUT(f32_7p1_4,sse);
@@ -60,6 +60,16 @@ static const struct channelmix_info {
 	uint32_t cpu_flags;
 } channelmix_table[] =
 {
+#if defined (HAVE_NEON)
+	{ 2, MASK_MONO, 2, MASK_MONO, channelmix_copy_neon, SPA_CPU_FLAG_NEON },
+	{ 2, MASK_STEREO, 2, MASK_STEREO, channelmix_copy_neon, SPA_CPU_FLAG_NEON },
+	{ EQ, 0, EQ, 0, channelmix_copy_neon, SPA_CPU_FLAG_NEON },
+#endif
+#if defined (HAVE_AVX)
+	{ 2, MASK_MONO, 2, MASK_MONO, channelmix_copy_avx, SPA_CPU_FLAG_AVX },
+	{ 2, MASK_STEREO, 2, MASK_STEREO, channelmix_copy_avx, SPA_CPU_FLAG_AVX },
+	{ EQ, 0, EQ, 0, channelmix_copy_avx, SPA_CPU_FLAG_AVX },
+#endif
 #if defined (HAVE_SSE)
 	{ 2, MASK_MONO, 2, MASK_MONO, channelmix_copy_sse, SPA_CPU_FLAG_SSE },
 	{ 2, MASK_STEREO, 2, MASK_STEREO, channelmix_copy_sse, SPA_CPU_FLAG_SSE },
@@ -69,34 +79,95 @@ static const struct channelmix_info {
 	{ 2, MASK_STEREO, 2, MASK_STEREO, channelmix_copy_c, 0 },
 	{ EQ, 0, EQ, 0, channelmix_copy_c, 0 },
 
+#if defined (HAVE_NEON)
+	{ 1, MASK_MONO, 2, MASK_STEREO, channelmix_f32_1_2_neon, SPA_CPU_FLAG_NEON },
+	{ 2, MASK_STEREO, 1, MASK_MONO, channelmix_f32_2_1_neon, SPA_CPU_FLAG_NEON },
+	{ 4, MASK_QUAD, 1, MASK_MONO, channelmix_f32_4_1_neon, SPA_CPU_FLAG_NEON },
+	{ 4, MASK_3_1, 1, MASK_MONO, channelmix_f32_3p1_1_neon, SPA_CPU_FLAG_NEON },
+#endif
+#if defined (HAVE_AVX)
+	{ 1, MASK_MONO, 2, MASK_STEREO, channelmix_f32_1_2_avx, SPA_CPU_FLAG_AVX },
+	{ 2, MASK_STEREO, 1, MASK_MONO, channelmix_f32_2_1_avx, SPA_CPU_FLAG_AVX },
+	{ 4, MASK_QUAD, 1, MASK_MONO, channelmix_f32_4_1_avx, SPA_CPU_FLAG_AVX },
+	{ 4, MASK_3_1, 1, MASK_MONO, channelmix_f32_3p1_1_avx, SPA_CPU_FLAG_AVX },
+#endif
+#if defined (HAVE_SSE)
+	{ 1, MASK_MONO, 2, MASK_STEREO, channelmix_f32_1_2_sse, SPA_CPU_FLAG_SSE },
+	{ 2, MASK_STEREO, 1, MASK_MONO, channelmix_f32_2_1_sse, SPA_CPU_FLAG_SSE },
+	{ 4, MASK_QUAD, 1, MASK_MONO, channelmix_f32_4_1_sse, SPA_CPU_FLAG_SSE },
+	{ 4, MASK_3_1, 1, MASK_MONO, channelmix_f32_3p1_1_sse, SPA_CPU_FLAG_SSE },
+#endif
 	{ 1, MASK_MONO, 2, MASK_STEREO, channelmix_f32_1_2_c, 0 },
 	{ 2, MASK_STEREO, 1, MASK_MONO, channelmix_f32_2_1_c, 0 },
 	{ 4, MASK_QUAD, 1, MASK_MONO, channelmix_f32_4_1_c, 0 },
 	{ 4, MASK_3_1, 1, MASK_MONO, channelmix_f32_3p1_1_c, 0 },
+
+#if defined (HAVE_NEON)
+	{ 2, MASK_STEREO, 4, MASK_QUAD, channelmix_f32_2_4_neon, SPA_CPU_FLAG_NEON },
+	{ 2, MASK_STEREO, 4, MASK_3_1, channelmix_f32_2_3p1_neon, SPA_CPU_FLAG_NEON },
+	{ 2, MASK_STEREO, 6, MASK_5_1, channelmix_f32_2_5p1_neon, SPA_CPU_FLAG_NEON },
+#endif
+#if defined (HAVE_AVX)
+	{ 2, MASK_STEREO, 4, MASK_QUAD, channelmix_f32_2_4_avx, SPA_CPU_FLAG_AVX },
+	{ 2, MASK_STEREO, 4, MASK_3_1, channelmix_f32_2_3p1_avx, SPA_CPU_FLAG_AVX },
+	{ 2, MASK_STEREO, 6, MASK_5_1, channelmix_f32_2_5p1_avx, SPA_CPU_FLAG_AVX },
+#endif
 #if defined (HAVE_SSE)
 	{ 2, MASK_STEREO, 4, MASK_QUAD, channelmix_f32_2_4_sse, SPA_CPU_FLAG_SSE },
+	{ 2, MASK_STEREO, 4, MASK_3_1, channelmix_f32_2_3p1_sse, SPA_CPU_FLAG_SSE },
+	{ 2, MASK_STEREO, 6, MASK_5_1, channelmix_f32_2_5p1_sse, SPA_CPU_FLAG_SSE },
 #endif
 	{ 2, MASK_STEREO, 4, MASK_QUAD, channelmix_f32_2_4_c, 0 },
 	{ 2, MASK_STEREO, 4, MASK_3_1, channelmix_f32_2_3p1_c, 0 },
 	{ 2, MASK_STEREO, 6, MASK_5_1, channelmix_f32_2_5p1_c, 0 },
-#if defined (HAVE_SSE)
-	{ 6, MASK_5_1, 2, MASK_STEREO, channelmix_f32_5p1_2_sse, SPA_CPU_FLAG_SSE },
+
+#if defined (HAVE_NEON)
+	{ 6, MASK_5_1, 2, MASK_STEREO, channelmix_f32_5p1_2_neon, SPA_CPU_FLAG_NEON },
+	{ 6, MASK_5_1, 4, MASK_QUAD, channelmix_f32_5p1_4_neon, SPA_CPU_FLAG_NEON },
+	{ 6, MASK_5_1, 4, MASK_3_1, channelmix_f32_5p1_3p1_neon, SPA_CPU_FLAG_NEON },
+#endif
+#if defined (HAVE_AVX)
+	{ 6, MASK_5_1, 2, MASK_STEREO, channelmix_f32_5p1_2_avx, SPA_CPU_FLAG_AVX },
+	{ 6, MASK_5_1, 4, MASK_QUAD, channelmix_f32_5p1_4_avx, SPA_CPU_FLAG_AVX },
+	{ 6, MASK_5_1, 4, MASK_3_1, channelmix_f32_5p1_3p1_avx, SPA_CPU_FLAG_AVX },
 #endif
-	{ 6, MASK_5_1, 2, MASK_STEREO, channelmix_f32_5p1_2_c, 0 },
 #if defined (HAVE_SSE)
+	{ 6, MASK_5_1, 2, MASK_STEREO, channelmix_f32_5p1_2_sse, SPA_CPU_FLAG_SSE },
 	{ 6, MASK_5_1, 4, MASK_QUAD, channelmix_f32_5p1_4_sse, SPA_CPU_FLAG_SSE },
+	{ 6, MASK_5_1, 4, MASK_3_1, channelmix_f32_5p1_3p1_sse, SPA_CPU_FLAG_SSE },
 #endif
+	{ 6, MASK_5_1, 2, MASK_STEREO, channelmix_f32_5p1_2_c, 0 },
 	{ 6, MASK_5_1, 4, MASK_QUAD, channelmix_f32_5p1_4_c, 0 },
+	{ 6, MASK_5_1, 4, MASK_3_1, channelmix_f32_5p1_3p1_c, 0 },
 
+#if defined (HAVE_NEON)
+	{ 8, MASK_7_1, 2, MASK_STEREO, channelmix_f32_7p1_2_neon, SPA_CPU_FLAG_NEON },
+	{ 8, MASK_7_1, 4, MASK_QUAD, channelmix_f32_7p1_4_neon, SPA_CPU_FLAG_NEON },
+	{ 8, MASK_7_1, 4, MASK_3_1, channelmix_f32_7p1_3p1_neon, SPA_CPU_FLAG_NEON },
+#endif
+#if defined (HAVE_AVX)
+	{ 8, MASK_7_1, 2, MASK_STEREO, channelmix_f32_7p1_2_avx, SPA_CPU_FLAG_AVX },
+	{ 8, MASK_7_1, 4, MASK_QUAD, channelmix_f32_7p1_4_avx, SPA_CPU_FLAG_AVX },
+	{ 8, MASK_7_1, 4, MASK_3_1, channelmix_f32_7p1_3p1_avx, SPA_CPU_FLAG_AVX },
+#endif
 #if defined (HAVE_SSE)
-	{ 6, MASK_5_1, 4, MASK_3_1, channelmix_f32_5p1_3p1_sse, SPA_CPU_FLAG_SSE },
+	{ 8, MASK_7_1, 2, MASK_STEREO, channelmix_f32_7p1_2_sse, SPA_CPU_FLAG_SSE },
+	{ 8, MASK_7_1, 4, MASK_QUAD, channelmix_f32_7p1_4_sse, SPA_CPU_FLAG_SSE },
+	{ 8, MASK_7_1, 4, MASK_3_1, channelmix_f32_7p1_3p1_sse, SPA_CPU_FLAG_SSE },
 #endif
-	{ 6, MASK_5_1, 4, MASK_3_1, channelmix_f32_5p1_3p1_c, 0 },
-
 	{ 8, MASK_7_1, 2, MASK_STEREO, channelmix_f32_7p1_2_c, 0 },
 	{ 8, MASK_7_1, 4, MASK_QUAD, channelmix_f32_7p1_4_c, 0 },
 	{ 8, MASK_7_1, 4, MASK_3_1, channelmix_f32_7p1_3p1_c, 0 },
 
+#if defined (HAVE_NEON)
+	{ ANY, 0, ANY, 0, channelmix_f32_n_m_neon, SPA_CPU_FLAG_NEON },
+#endif
+#if defined (HAVE_AVX)
+	{ ANY, 0, ANY, 0, channelmix_f32_n_m_avx, SPA_CPU_FLAG_AVX },
+#endif
+#if defined (HAVE_SSE)
+	{ ANY, 0, ANY, 0, channelmix_f32_n_m_sse, SPA_CPU_FLAG_SSE },
+#endif
 	{ ANY, 0, ANY, 0, channelmix_f32_n_m_c, 0 },
 };
 
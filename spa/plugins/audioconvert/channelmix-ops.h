@@ -106,9 +106,54 @@ DEFINE_FUNCTION(f32_7p1_4, c);
 
 #if defined (HAVE_SSE)
 DEFINE_FUNCTION(copy, sse);
+DEFINE_FUNCTION(f32_n_m, sse);
+DEFINE_FUNCTION(f32_1_2, sse);
+DEFINE_FUNCTION(f32_2_1, sse);
+DEFINE_FUNCTION(f32_4_1, sse);
+DEFINE_FUNCTION(f32_3p1_1, sse);
 DEFINE_FUNCTION(f32_2_4, sse);
+DEFINE_FUNCTION(f32_2_3p1, sse);
+DEFINE_FUNCTION(f32_2_5p1, sse);
 DEFINE_FUNCTION(f32_5p1_2, sse);
 DEFINE_FUNCTION(f32_5p1_3p1, sse);
 DEFINE_FUNCTION(f32_5p1_4, sse);
+DEFINE_FUNCTION(f32_7p1_2, sse);
+DEFINE_FUNCTION(f32_7p1_3p1, sse);
 DEFINE_FUNCTION(f32_7p1_4, sse);
 #endif
+#if defined (HAVE_AVX)
+DEFINE_FUNCTION(copy, avx);
+DEFINE_FUNCTION(f32_n_m, avx);
+DEFINE_FUNCTION(f32_1_2, avx);
+DEFINE_FUNCTION(f32_2_1, avx);
+DEFINE_FUNCTION(f32_4_1, avx);
+DEFINE_FUNCTION(f32_3p1_1, avx);
+DEFINE_FUNCTION(f32_2_4, avx);
+DEFINE_FUNCTION(f32_2_3p1, avx);
+DEFINE_FUNCTION(f32_2_5p1, avx);
+DEFINE_FUNCTION(f32_5p1_2, avx);
+DEFINE_FUNCTION(f32_5p1_3p1, avx);
+DEFINE_FUNCTION(f32_5p1_4, avx);
+DEFINE_FUNCTION(f32_7p1_2, avx);
+DEFINE_FUNCTION(f32_7p1_3p1, avx);
+DEFINE_FUNCTION(f32_7p1_4, avx);
+#endif
+#if defined (HAVE_NEON)
+DEFINE_FUNCTION(copy, neon);
+DEFINE_FUNCTION(f32_n_m, neon);
+DEFINE_FUNCTION(f32_1_2, neon);
+DEFINE_FUNCTION(f32_2_1, neon);
+DEFINE_FUNCTION(f32_4_1, neon);
+DEFINE_FUNCTION(f32_3p1_1, neon);
+DEFINE_FUNCTION(f32_2_4, neon);
+DEFINE_FUNCTION(f32_2_3p1, neon);
+DEFINE_FUNCTION(f32_2_5p1, neon);
+DEFINE_FUNCTION(f32_5p1_2, neon);
+DEFINE_FUNCTION(f32_5p1_3p1, neon);
+DEFINE_FUNCTION(f32_5p1_4, neon);
+DEFINE_FUNCTION(f32_7p1_2, neon);
+DEFINE_FUNCTION(f32_7p1_3p1, neon);
+DEFINE_FUNCTION(f32_7p1_4, neon);
+#endif
+
+#undef DEFINE_FUNCTION
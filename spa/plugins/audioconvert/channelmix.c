@@ -42,6 +42,7 @@
 #include <spa/debug/types.h>
 
 #include "channelmix-ops.h"
+#include "fmt-ops.h"
 
 #define NAME "channelmix"
 
@@ -54,6 +55,8 @@
 
 #define DEFAULT_CONTROL_BUFFER_SIZE	32768
 
+#define MAX_FUSE_SAMPLES	8192
+
 struct impl;
 
 #define DEFAULT_MUTE	false
@@ -145,7 +148,12 @@ struct impl {
 	struct channelmix mix;
 	unsigned int started:1;
 	unsigned int is_passthrough:1;
+	unsigned int is_fused:1;
 	uint32_t cpu_flags;
+
+	/* unpacks interleaved input into fuse_data before mixing */
+	struct convert conv;
+	float fuse_data[MAX_FUSE_SAMPLES + 16];
 };
 
 #define IS_CONTROL_PORT(this,d,id)	(id == 1 && d == SPA_DIRECTION_INPUT)
@@ -316,11 +324,12 @@ static int setup_convert(struct impl *this,
 
 	emit_props_changed(this);
 
-	this->is_passthrough = SPA_FLAG_IS_SET(this->mix.flags, CHANNELMIX_FLAG_IDENTITY);
+	this->is_passthrough = SPA_FLAG_IS_SET(this->mix.flags, CHANNELMIX_FLAG_IDENTITY) &&
+		!this->is_fused;
 
-	spa_log_debug(this->log, NAME " %p: got channelmix features %08x:%08x flags:%08x passthrough:%d",
+	spa_log_debug(this->log, NAME " %p: got channelmix features %08x:%08x flags:%08x passthrough:%d fused:%d",
 			this, this->cpu_flags, this->mix.cpu_flags,
-			this->mix.flags, this->is_passthrough);
+			this->mix.flags, this->is_passthrough, this->is_fused);
 
 
 	return 0;
@@ -592,9 +601,39 @@ static int impl_node_remove_port(void *object,
 	return -ENOTSUP;
 }
 
+/* the interleaved format the peer prefers, when we can unpack it ourselves */
+static uint32_t fuse_format(struct impl *this, const struct spa_pod *filter)
+{
+	const struct spa_pod_prop *p;
+	const struct spa_pod *val;
+	uint32_t n_values, choice, format;
+	struct convert conv = { 0 };
+
+	if (filter == NULL ||
+	    (p = spa_pod_find_prop(filter, NULL, SPA_FORMAT_AUDIO_format)) == NULL)
+		return SPA_AUDIO_FORMAT_UNKNOWN;
+
+	val = spa_pod_get_values(&p->value, &n_values, &choice);
+	if (val->type != SPA_TYPE_Id || n_values == 0)
+		return SPA_AUDIO_FORMAT_UNKNOWN;
+
+	format = ((const uint32_t *)SPA_POD_BODY_CONST(val))[0];
+	if (!SPA_AUDIO_FORMAT_IS_INTERLEAVED(format))
+		return SPA_AUDIO_FORMAT_UNKNOWN;
+
+	conv.src_fmt = format;
+	conv.dst_fmt = SPA_AUDIO_FORMAT_F32P;
+	conv.cpu_flags = this->cpu_flags;
+	if (convert_init(&conv) < 0)
+		return SPA_AUDIO_FORMAT_UNKNOWN;
+
+	return format;
+}
+
 static int port_enum_formats(void *object,
 			     enum spa_direction direction, uint32_t port_id,
 			     uint32_t index,
+			     const struct spa_pod *filter,
 			     struct spa_pod **param,
 			     struct spa_pod_builder *builder)
 {
@@ -610,6 +649,7 @@ static int port_enum_formats(void *object,
 		} else {
 			struct spa_pod_frame f;
 			struct port *other;
+			uint32_t format = SPA_AUDIO_FORMAT_UNKNOWN;
 
 			other = GET_PORT(this, SPA_DIRECTION_REVERSE(direction), 0);
 
@@ -618,8 +658,23 @@ static int port_enum_formats(void *object,
 			spa_pod_builder_add(builder,
 				SPA_FORMAT_mediaType,      SPA_POD_Id(SPA_MEDIA_TYPE_audio),
 				SPA_FORMAT_mediaSubtype,   SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw),
-				SPA_FORMAT_AUDIO_format,   SPA_POD_Id(SPA_AUDIO_FORMAT_F32P),
 				0);
+			/* take interleaved input as is and unpack it while mixing,
+			 * this saves the peer a conversion pass */
+			if (direction == SPA_DIRECTION_INPUT)
+				format = fuse_format(this, filter);
+			if (format != SPA_AUDIO_FORMAT_UNKNOWN) {
+				spa_pod_builder_add(builder,
+					SPA_FORMAT_AUDIO_format,   SPA_POD_CHOICE_ENUM_Id(3,
+								format,
+								format,
+								SPA_AUDIO_FORMAT_F32P),
+					0);
+			} else {
+				spa_pod_builder_add(builder,
+					SPA_FORMAT_AUDIO_format,   SPA_POD_Id(SPA_AUDIO_FORMAT_F32P),
+					0);
+			}
 			if (other->have_format) {
 				spa_pod_builder_add(builder,
 					SPA_FORMAT_AUDIO_rate, SPA_POD_Int(other->format.info.raw.rate),
@@ -676,7 +731,7 @@ impl_node_port_enum_params(void *object, int seq,
 	switch (id) {
 	case SPA_PARAM_EnumFormat:
 		if ((res = port_enum_formats(this, direction, port_id,
-						result.index, &param, &b)) <= 0)
+						result.index, filter, &param, &b)) <= 0)
 			return res;
 		break;
 
@@ -780,6 +835,32 @@ impl_node_port_enum_params(void *object, int seq,
 	return 0;
 }
 
+static int setup_fuse(struct impl *this, struct spa_audio_info *info)
+{
+	int res;
+
+	if (this->is_fused) {
+		convert_free(&this->conv);
+		this->is_fused = false;
+	}
+	if (info->info.raw.format == SPA_AUDIO_FORMAT_F32P)
+		return 0;
+
+	this->conv.src_fmt = info->info.raw.format;
+	this->conv.dst_fmt = SPA_AUDIO_FORMAT_F32P;
+	this->conv.n_channels = info->info.raw.channels;
+	this->conv.cpu_flags = this->cpu_flags;
+
+	if ((res = convert_init(&this->conv)) < 0)
+		return res;
+
+	this->is_fused = true;
+
+	spa_log_debug(this->log, NAME " %p: got converter features %08x:%08x", this,
+			this->cpu_flags, this->conv.cpu_flags);
+	return 0;
+}
+
 static int clear_buffers(struct impl *this, struct port *port)
 {
 	if (port->n_buffers > 0) {
@@ -809,6 +890,10 @@ static int port_set_format(void *object,
 			clear_buffers(this, port);
 			if (this->mix.process)
 				channelmix_free(&this->mix);
+			if (this->is_fused && direction == SPA_DIRECTION_INPUT) {
+				convert_free(&this->conv);
+				this->is_fused = false;
+			}
 		}
 	} else {
 		struct spa_audio_info info = { 0 };
@@ -828,11 +913,22 @@ static int port_set_format(void *object,
 			if (spa_format_audio_raw_parse(format, &info.info.raw) < 0)
 				return -EINVAL;
 
-			if (info.info.raw.format != SPA_AUDIO_FORMAT_F32P)
+			if (info.info.raw.format != SPA_AUDIO_FORMAT_F32P &&
+			    (direction == SPA_DIRECTION_OUTPUT ||
+			     !SPA_AUDIO_FORMAT_IS_INTERLEAVED(info.info.raw.format)))
 				return -EINVAL;
 
-			port->stride = sizeof(float);
-			port->blocks = info.info.raw.channels;
+			if (direction == SPA_DIRECTION_INPUT &&
+			    (res = setup_fuse(this, &info)) < 0)
+				return res;
+
+			port->stride = convert_sample_width(info.info.raw.format);
+			if (SPA_AUDIO_FORMAT_IS_PLANAR(info.info.raw.format)) {
+				port->blocks = info.info.raw.channels;
+			} else {
+				port->stride *= info.info.raw.channels;
+				port->blocks = 1;
+			}
 
 			if (other->have_format) {
 				if ((res = setup_convert(this, direction, &info)) < 0)
@@ -1006,15 +1102,60 @@ static int impl_node_port_reuse_buffer(void *object, uint32_t port_id, uint32_t
 	return 0;
 }
 
+/* unpack the interleaved input in blocks that stay in the cache and mix
+ * each block right away */
+static void channelmix_fuse_process(struct impl *this,
+				    uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+				    uint32_t n_src, const void * SPA_RESTRICT src[n_src],
+				    uint32_t n_samples)
+{
+	struct port *inport = GET_IN_PORT(this, 0);
+	uint32_t i, offs, chunk, block, n_chan = this->conv.n_channels;
+	float *data = SPA_PTR_ALIGN(this->fuse_data, 64, float);
+	const void *s[1];
+	void *t[n_chan], *d[n_dst];
+
+	if (SPA_FLAG_IS_SET(this->mix.flags, CHANNELMIX_FLAG_IDENTITY)) {
+		convert_process(&this->conv, dst, src, n_samples);
+		return;
+	}
+
+	block = SPA_ROUND_DOWN_N(MAX_FUSE_SAMPLES / n_chan, 16);
+	for (i = 0; i < n_chan; i++)
+		t[i] = data + i * block;
+
+	for (offs = 0; offs < n_samples; offs += chunk) {
+		chunk = SPA_MIN(n_samples - offs, block);
+
+		s[0] = SPA_MEMBER(src[0], offs * inport->stride, void);
+		convert_process(&this->conv, t, s, chunk);
+
+		for (i = 0; i < n_dst; i++)
+			d[i] = SPA_MEMBER(dst[i], offs * sizeof(float), void);
+		channelmix_process(&this->mix, n_dst, d, n_chan, (const void **)t, chunk);
+	}
+}
+
+static inline void do_process(struct impl *this,
+			      uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
+			      uint32_t n_src, const void * SPA_RESTRICT src[n_src],
+			      uint32_t n_samples)
+{
+	if (this->is_fused)
+		channelmix_fuse_process(this, n_dst, dst, n_src, src, n_samples);
+	else
+		channelmix_process(&this->mix, n_dst, dst, n_src, src, n_samples);
+}
+
 static int channelmix_process_control(struct impl *this, struct port *ctrlport,
 				      uint32_t n_dst, void * SPA_RESTRICT dst[n_dst],
 				      uint32_t n_src, const void * SPA_RESTRICT src[n_src],
 				      uint32_t n_samples)
 {
 	struct spa_pod_control *c, *prev = NULL;
+	struct port *inport = GET_IN_PORT(this, 0);
 	uint32_t avail_samples = n_samples;
 	uint32_t i;
-	const float **s = (const float **)src;
 	float **d = (float **)dst;
 
 	SPA_POD_SEQUENCE_FOREACH(ctrlport->ctrl, c) {
@@ -1051,9 +1192,9 @@ static int channelmix_process_control(struct impl *this, struct port *ctrlport,
 		spa_log_trace_fp(this->log, NAME " %p: process %d %d", this,
 				c->offset, chunk);
 
-		channelmix_process(&this->mix, n_dst, dst, n_src, src, chunk);
+		do_process(this, n_dst, dst, n_src, src, chunk);
 		for (i = 0; i < n_src; i++)
-			s[i] += chunk;
+			src[i] = SPA_MEMBER(src[i], chunk * inport->stride, void);
 		for (i = 0; i < n_dst; i++)
 			d[i] += chunk;
 
@@ -1067,7 +1208,7 @@ static int channelmix_process_control(struct impl *this, struct port *ctrlport,
 	 * remaining samples */
 	spa_log_trace_fp(this->log, NAME " %p: remain %d", this, avail_samples);
 	if (avail_samples > 0)
-		channelmix_process(&this->mix, n_dst, dst, n_src, src, avail_samples);
+		do_process(this, n_dst, dst, n_src, src, avail_samples);
 
 	return 1;
 }
@@ -1165,7 +1306,7 @@ static int impl_node_process(void *object)
 					ctrlport->ctrl = NULL;
 				}
 			} else {
-				channelmix_process(&this->mix, n_dst_datas, dst_datas,
+				do_process(this, n_dst_datas, dst_datas,
 						n_src_datas, src_datas, n_samples);
 			}
 		}
@@ -1060,3 +1060,377 @@ conv_f32d_to_s16_2_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const v
 		d += 2;
 	}
 }
+
+extern void conv_s24_32_to_f32d_2s_sse2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples);
+extern void conv_f32d_to_s24_32_2s_sse2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples);
+extern void conv_deinterleave_32_2s_sse2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples);
+extern void conv_interleave_32_2s_sse2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples);
+
+/* transpose 4 rows of 4 samples in each 128 bits lane */
+#define TRANSPOSE_4x4_256(r0, r1, r2, r3)				\
+({									\
+	__m256 _t0 = _mm256_unpacklo_ps(r0, r1);			\
+	__m256 _t1 = _mm256_unpackhi_ps(r0, r1);			\
+	__m256 _t2 = _mm256_unpacklo_ps(r2, r3);			\
+	__m256 _t3 = _mm256_unpackhi_ps(r2, r3);			\
+	r0 = _mm256_shuffle_ps(_t0, _t2, _MM_SHUFFLE(1, 0, 1, 0));	\
+	r1 = _mm256_shuffle_ps(_t0, _t2, _MM_SHUFFLE(3, 2, 3, 2));	\
+	r2 = _mm256_shuffle_ps(_t1, _t3, _MM_SHUFFLE(1, 0, 1, 0));	\
+	r3 = _mm256_shuffle_ps(_t1, _t3, _MM_SHUFFLE(3, 2, 3, 2));	\
+})
+
+/* load 4 samples of frame 0 in the low lane and of frame 4 in the high lane */
+static inline __m256 load_4s_2f_avx2(const void *s, uint32_t n_channels)
+{
+	const float *f = s;
+	return _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(f)),
+			_mm_loadu_ps(f + 4*n_channels), 1);
+}
+
+static inline void store_4s_2f_avx2(void *d, uint32_t n_channels, __m256 v)
+{
+	float *f = d;
+	_mm_storeu_ps(f, _mm256_castps256_ps128(v));
+	_mm_storeu_ps(f + 4*n_channels, _mm256_extractf128_ps(v, 1));
+}
+
+static void
+conv_s24_32_to_f32d_1s_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int32_t *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled;
+	__m256i in, idx;
+	__m256 out, factor = _mm256_set1_ps(1.0f / S24_SCALE);
+
+	idx = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+			_mm256_set1_epi32(n_channels));
+
+	if (SPA_IS_ALIGNED(d0, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in = _mm256_i32gather_epi32(s, idx, 4);
+		out = _mm256_mul_ps(_mm256_cvtepi32_ps(in), factor);
+		_mm256_store_ps(&d0[n], out);
+		s += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S24_TO_F32(s[0]);
+		s += n_channels;
+	}
+}
+
+static void
+conv_s24_32_to_f32d_4s_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int32_t *s = src;
+	float *d0 = dst[0], *d1 = dst[1], *d2 = dst[2], *d3 = dst[3];
+	uint32_t n, unrolled;
+	__m256 in[4], factor = _mm256_set1_ps(1.0f / S24_SCALE);
+
+	if (SPA_IS_ALIGNED(d0, 32) &&
+	    SPA_IS_ALIGNED(d1, 32) &&
+	    SPA_IS_ALIGNED(d2, 32) &&
+	    SPA_IS_ALIGNED(d3, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in[0] = load_4s_2f_avx2(&s[0*n_channels], n_channels);
+		in[1] = load_4s_2f_avx2(&s[1*n_channels], n_channels);
+		in[2] = load_4s_2f_avx2(&s[2*n_channels], n_channels);
+		in[3] = load_4s_2f_avx2(&s[3*n_channels], n_channels);
+
+		in[0] = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_castps_si256(in[0])), factor);
+		in[1] = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_castps_si256(in[1])), factor);
+		in[2] = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_castps_si256(in[2])), factor);
+		in[3] = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_castps_si256(in[3])), factor);
+
+		TRANSPOSE_4x4_256(in[0], in[1], in[2], in[3]);
+
+		_mm256_store_ps(&d0[n], in[0]);
+		_mm256_store_ps(&d1[n], in[1]);
+		_mm256_store_ps(&d2[n], in[2]);
+		_mm256_store_ps(&d3[n], in[3]);
+		s += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S24_TO_F32(s[0]);
+		d1[n] = S24_TO_F32(s[1]);
+		d2[n] = S24_TO_F32(s[2]);
+		d3[n] = S24_TO_F32(s[3]);
+		s += n_channels;
+	}
+}
+
+void
+conv_s24_32_to_f32d_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const int32_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_s24_32_to_f32d_4s_avx2(conv, &dst[i], &s[i], n_channels, n_samples);
+#if defined (HAVE_SSE2)
+	for(; i + 1 < n_channels; i += 2)
+		conv_s24_32_to_f32d_2s_sse2(conv, &dst[i], &s[i], n_channels, n_samples);
+#endif
+	for(; i < n_channels; i++)
+		conv_s24_32_to_f32d_1s_avx2(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+static void
+conv_f32d_to_s24_32_1s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	int32_t *d = dst;
+	uint32_t n, unrolled;
+	__m256 in;
+	__m256i out;
+	__m256 scale = _mm256_set1_ps(S24_SCALE);
+	__m256 max = _mm256_set1_ps(1.0f), min = _mm256_set1_ps(-1.0f);
+
+	if (SPA_IS_ALIGNED(s0, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in = _mm256_min_ps(_mm256_max_ps(_mm256_load_ps(&s0[n]), min), max);
+		out = _mm256_cvttps_epi32(_mm256_mul_ps(in, scale));
+
+		d[0*n_channels] = _mm256_extract_epi32(out, 0);
+		d[1*n_channels] = _mm256_extract_epi32(out, 1);
+		d[2*n_channels] = _mm256_extract_epi32(out, 2);
+		d[3*n_channels] = _mm256_extract_epi32(out, 3);
+		d[4*n_channels] = _mm256_extract_epi32(out, 4);
+		d[5*n_channels] = _mm256_extract_epi32(out, 5);
+		d[6*n_channels] = _mm256_extract_epi32(out, 6);
+		d[7*n_channels] = _mm256_extract_epi32(out, 7);
+		d += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		*d = F32_TO_S24(s0[n]);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s24_32_4s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	int32_t *d = dst;
+	uint32_t n, unrolled;
+	__m256 in[4];
+	__m256 scale = _mm256_set1_ps(S24_SCALE);
+	__m256 max = _mm256_set1_ps(1.0f), min = _mm256_set1_ps(-1.0f);
+
+	if (SPA_IS_ALIGNED(s0, 32) &&
+	    SPA_IS_ALIGNED(s1, 32) &&
+	    SPA_IS_ALIGNED(s2, 32) &&
+	    SPA_IS_ALIGNED(s3, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in[0] = _mm256_min_ps(_mm256_max_ps(_mm256_load_ps(&s0[n]), min), max);
+		in[1] = _mm256_min_ps(_mm256_max_ps(_mm256_load_ps(&s1[n]), min), max);
+		in[2] = _mm256_min_ps(_mm256_max_ps(_mm256_load_ps(&s2[n]), min), max);
+		in[3] = _mm256_min_ps(_mm256_max_ps(_mm256_load_ps(&s3[n]), min), max);
+
+		in[0] = _mm256_castsi256_ps(_mm256_cvttps_epi32(_mm256_mul_ps(in[0], scale)));
+		in[1] = _mm256_castsi256_ps(_mm256_cvttps_epi32(_mm256_mul_ps(in[1], scale)));
+		in[2] = _mm256_castsi256_ps(_mm256_cvttps_epi32(_mm256_mul_ps(in[2], scale)));
+		in[3] = _mm256_castsi256_ps(_mm256_cvttps_epi32(_mm256_mul_ps(in[3], scale)));
+
+		TRANSPOSE_4x4_256(in[0], in[1], in[2], in[3]);
+
+		store_4s_2f_avx2(&d[0*n_channels], n_channels, in[0]);
+		store_4s_2f_avx2(&d[1*n_channels], n_channels, in[1]);
+		store_4s_2f_avx2(&d[2*n_channels], n_channels, in[2]);
+		store_4s_2f_avx2(&d[3*n_channels], n_channels, in[3]);
+		d += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = F32_TO_S24(s0[n]);
+		d[1] = F32_TO_S24(s1[n]);
+		d[2] = F32_TO_S24(s2[n]);
+		d[3] = F32_TO_S24(s3[n]);
+		d += n_channels;
+	}
+}
+
+void
+conv_f32d_to_s24_32_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int32_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s24_32_4s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+#if defined (HAVE_SSE2)
+	for(; i + 1 < n_channels; i += 2)
+		conv_f32d_to_s24_32_2s_sse2(conv, &d[i], &src[i], n_channels, n_samples);
+#endif
+	for(; i < n_channels; i++)
+		conv_f32d_to_s24_32_1s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+}
+
+static void
+conv_deinterleave_32_1s_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled;
+	__m256i idx;
+
+	idx = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+			_mm256_set1_epi32(n_channels));
+
+	if (SPA_IS_ALIGNED(d0, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		_mm256_store_ps(&d0[n], _mm256_i32gather_ps(s, idx, 4));
+		s += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = s[0];
+		s += n_channels;
+	}
+}
+
+static void
+conv_deinterleave_32_4s_avx2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s = src;
+	float *d0 = dst[0], *d1 = dst[1], *d2 = dst[2], *d3 = dst[3];
+	uint32_t n, unrolled;
+	__m256 in[4];
+
+	if (SPA_IS_ALIGNED(d0, 32) &&
+	    SPA_IS_ALIGNED(d1, 32) &&
+	    SPA_IS_ALIGNED(d2, 32) &&
+	    SPA_IS_ALIGNED(d3, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in[0] = load_4s_2f_avx2(&s[0*n_channels], n_channels);
+		in[1] = load_4s_2f_avx2(&s[1*n_channels], n_channels);
+		in[2] = load_4s_2f_avx2(&s[2*n_channels], n_channels);
+		in[3] = load_4s_2f_avx2(&s[3*n_channels], n_channels);
+
+		TRANSPOSE_4x4_256(in[0], in[1], in[2], in[3]);
+
+		_mm256_store_ps(&d0[n], in[0]);
+		_mm256_store_ps(&d1[n], in[1]);
+		_mm256_store_ps(&d2[n], in[2]);
+		_mm256_store_ps(&d3[n], in[3]);
+		s += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = s[0];
+		d1[n] = s[1];
+		d2[n] = s[2];
+		d3[n] = s[3];
+		s += n_channels;
+	}
+}
+
+void
+conv_deinterleave_32_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const float *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_deinterleave_32_4s_avx2(conv, &dst[i], &s[i], n_channels, n_samples);
+#if defined (HAVE_SSE2)
+	for(; i + 1 < n_channels; i += 2)
+		conv_deinterleave_32_2s_sse2(conv, &dst[i], &s[i], n_channels, n_samples);
+#endif
+	for(; i < n_channels; i++)
+		conv_deinterleave_32_1s_avx2(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+static void
+conv_interleave_32_4s_avx2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	float *d = dst;
+	uint32_t n, unrolled;
+	__m256 in[4];
+
+	if (SPA_IS_ALIGNED(s0, 32) &&
+	    SPA_IS_ALIGNED(s1, 32) &&
+	    SPA_IS_ALIGNED(s2, 32) &&
+	    SPA_IS_ALIGNED(s3, 32))
+		unrolled = n_samples & ~7;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 8) {
+		in[0] = _mm256_load_ps(&s0[n]);
+		in[1] = _mm256_load_ps(&s1[n]);
+		in[2] = _mm256_load_ps(&s2[n]);
+		in[3] = _mm256_load_ps(&s3[n]);
+
+		TRANSPOSE_4x4_256(in[0], in[1], in[2], in[3]);
+
+		store_4s_2f_avx2(&d[0*n_channels], n_channels, in[0]);
+		store_4s_2f_avx2(&d[1*n_channels], n_channels, in[1]);
+		store_4s_2f_avx2(&d[2*n_channels], n_channels, in[2]);
+		store_4s_2f_avx2(&d[3*n_channels], n_channels, in[3]);
+		d += 8*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = s0[n];
+		d[1] = s1[n];
+		d[2] = s2[n];
+		d[3] = s3[n];
+		d += n_channels;
+	}
+}
+
+void
+conv_interleave_32_avx2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	float *d = dst[0];
+	uint32_t i = 0, j, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_interleave_32_4s_avx2(conv, &d[i], &src[i], n_channels, n_samples);
+#if defined (HAVE_SSE2)
+	for(; i + 1 < n_channels; i += 2)
+		conv_interleave_32_2s_sse2(conv, &d[i], &src[i], n_channels, n_samples);
+#endif
+	for(; i < n_channels; i++) {
+		const float *s = src[i];
+		for (j = 0; j < n_samples; j++)
+			d[j * n_channels + i] = s[j];
+	}
+}
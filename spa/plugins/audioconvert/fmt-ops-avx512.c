@@ -0,0 +1,631 @@
+/* Spa
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+
+#include "fmt-ops.h"
+
+#include <immintrin.h>
+
+/* The planar buffers are often only 16 or 32 bytes aligned so all loads and
+ * stores are unaligned. Channels are handled in groups of 4 with 16 frames
+ * in 4 lanes, the remaining channels with gathers and scatters. */
+
+#define TRANSPOSE_4x4_512(r0, r1, r2, r3)				\
+({									\
+	__m512 _t0 = _mm512_unpacklo_ps(r0, r1);			\
+	__m512 _t1 = _mm512_unpackhi_ps(r0, r1);			\
+	__m512 _t2 = _mm512_unpacklo_ps(r2, r3);			\
+	__m512 _t3 = _mm512_unpackhi_ps(r2, r3);			\
+	r0 = _mm512_shuffle_ps(_t0, _t2, _MM_SHUFFLE(1, 0, 1, 0));	\
+	r1 = _mm512_shuffle_ps(_t0, _t2, _MM_SHUFFLE(3, 2, 3, 2));	\
+	r2 = _mm512_shuffle_ps(_t1, _t3, _MM_SHUFFLE(1, 0, 1, 0));	\
+	r3 = _mm512_shuffle_ps(_t1, _t3, _MM_SHUFFLE(3, 2, 3, 2));	\
+})
+
+/* load 4 samples of frames 0, 4, 8 and 12 in the 4 lanes */
+static inline __m512 load_4s_4f_avx512(const void *s, uint32_t n_channels)
+{
+	const float *f = s;
+	__m512 r = _mm512_castps128_ps512(_mm_loadu_ps(f));
+	r = _mm512_insertf32x4(r, _mm_loadu_ps(f + 4*n_channels), 1);
+	r = _mm512_insertf32x4(r, _mm_loadu_ps(f + 8*n_channels), 2);
+	return _mm512_insertf32x4(r, _mm_loadu_ps(f + 12*n_channels), 3);
+}
+
+static inline void store_4s_4f_avx512(void *d, uint32_t n_channels, __m512 v)
+{
+	float *f = d;
+	_mm_storeu_ps(f, _mm512_castps512_ps128(v));
+	_mm_storeu_ps(f + 4*n_channels, _mm512_extractf32x4_ps(v, 1));
+	_mm_storeu_ps(f + 8*n_channels, _mm512_extractf32x4_ps(v, 2));
+	_mm_storeu_ps(f + 12*n_channels, _mm512_extractf32x4_ps(v, 3));
+}
+
+static inline __m512i frame_index_avx512(uint32_t n_channels)
+{
+	return _mm512_mullo_epi32(_mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7,
+				8, 9, 10, 11, 12, 13, 14, 15),
+			_mm512_set1_epi32(n_channels));
+}
+
+static void
+conv_s16_to_f32d_1s_avx512(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int16_t *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled = n_samples & ~15;
+	__m512i in, idx = frame_index_avx512(n_channels);
+	__m512 factor = _mm512_set1_ps(1.0f / S16_SCALE);
+
+	if (n_channels == 1) {
+		for(n = 0; n < unrolled; n += 16) {
+			in = _mm512_cvtepi16_epi32(_mm256_loadu_si256((const __m256i*)&s[n]));
+			_mm512_storeu_ps(&d0[n], _mm512_mul_ps(_mm512_cvtepi32_ps(in), factor));
+		}
+		s += unrolled;
+	} else {
+		/* this is the last of more channels, gather 32 bits that end
+		 * with the sample so that we don't read past the buffer */
+		for(n = 0; n < unrolled; n += 16) {
+			in = _mm512_i32gather_epi32(idx, &s[-1], 2);
+			in = _mm512_srai_epi32(in, 16);
+			_mm512_storeu_ps(&d0[n], _mm512_mul_ps(_mm512_cvtepi32_ps(in), factor));
+			s += 16*n_channels;
+		}
+	}
+	for(n = unrolled; n < n_samples; n++) {
+		d0[n] = S16_TO_F32(s[0]);
+		s += n_channels;
+	}
+}
+
+static void
+conv_s16_to_f32d_2s_avx512(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int16_t *s = src;
+	float *d0 = dst[0], *d1 = dst[1];
+	uint32_t n, unrolled = n_samples & ~15;
+	__m512i in, out[2], idx = frame_index_avx512(n_channels);
+	__m512 factor = _mm512_set1_ps(1.0f / S16_SCALE);
+
+	for(n = 0; n < unrolled; n += 16) {
+		in = _mm512_i32gather_epi32(idx, s, 2);
+		out[0] = _mm512_srai_epi32(_mm512_slli_epi32(in, 16), 16);
+		out[1] = _mm512_srai_epi32(in, 16);
+
+		_mm512_storeu_ps(&d0[n], _mm512_mul_ps(_mm512_cvtepi32_ps(out[0]), factor));
+		_mm512_storeu_ps(&d1[n], _mm512_mul_ps(_mm512_cvtepi32_ps(out[1]), factor));
+		s += 16*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S16_TO_F32(s[0]);
+		d1[n] = S16_TO_F32(s[1]);
+		s += n_channels;
+	}
+}
+
+void
+conv_s16_to_f32d_avx512(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const int16_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 1 < n_channels; i += 2)
+		conv_s16_to_f32d_2s_avx512(conv, &dst[i], &s[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_s16_to_f32d_1s_avx512(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+static void
+conv_s32_to_f32d_1s_avx512(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int32_t *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled = n_samples & ~15;
+	__m512i in, idx = frame_index_avx512(n_channels);
+	__m512 factor = _mm512_set1_ps(1.0f / S24_SCALE);
+
+	for(n = 0; n < unrolled; n += 16) {
+		in = _mm512_srai_epi32(_mm512_i32gather_epi32(idx, s, 4), 8);
+		_mm512_storeu_ps(&d0[n], _mm512_mul_ps(_mm512_cvtepi32_ps(in), factor));
+		s += 16*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S32_TO_F32(s[0]);
+		s += n_channels;
+	}
+}
+
+static void
+conv_s32_to_f32d_4s_avx512(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int32_t *s = src;
+	float *d0 = dst[0], *d1 = dst[1], *d2 = dst[2], *d3 = dst[3];
+	uint32_t n, unrolled = n_samples & ~15;
+	__m512 in[4], factor = _mm512_set1_ps(1.0f / S24_SCALE);
+
+	for(n = 0; n < unrolled; n += 16) {
+		in[0] = load_4s_4f_avx512(&s[0*n_channels], n_channels);
+		in[1] = load_4s_4f_avx512(&s[1*n_channels], n_channels);
+		in[2] = load_4s_4f_avx512(&s[2*n_channels], n_channels);
+		in[3] = load_4s_4f_avx512(&s[3*n_channels], n_channels);
+
+		in[0] = _mm512_cvtepi32_ps(_mm512_srai_epi32(_mm512_castps_si512(in[0]), 8));
+		in[1] = _mm512_cvtepi32_ps(_mm512_srai_epi32(_mm512_castps_si512(in[1]), 8));
+		in[2] = _mm512_cvtepi32_ps(_mm512_srai_epi32(_mm512_castps_si512(in[2]), 8));
+		in[3] = _mm512_cvtepi32_ps(_mm512_srai_epi32(_mm512_castps_si512(in[3]), 8));
+
+		TRANSPOSE_4x4_512(in[0], in[1], in[2], in[3]);
+
+		_mm512_storeu_ps(&d0[n], _mm512_mul_ps(in[0], factor));
+		_mm512_storeu_ps(&d1[n], _mm512_mul_ps(in[1], factor));
+		_mm512_storeu_ps(&d2[n], _mm512_mul_ps(in[2], factor));
+		_mm512_storeu_ps(&d3[n], _mm512_mul_ps(in[3], factor));
+		s += 16*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S32_TO_F32(s[0]);
+		d1[n] = S32_TO_F32(s[1]);
+		d2[n] = S32_TO_F32(s[2]);
+		d3[n] = S32_TO_F32(s[3]);
+		s += n_channels;
+	}
+}
+
+void
+conv_s32_to_f32d_avx512(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const int32_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_s32_to_f32d_4s_avx512(conv, &dst[i], &s[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_s32_to_f32d_1s_avx512(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+static void
+conv_s24_32_to_f32d_1s_avx512(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int32_t *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled = n_samples & ~15;
+	__m512i in, idx = frame_index_avx512(n_channels);
+	__m512 factor = _mm512_set1_ps(1.0f / S24_SCALE);
+
+	for(n = 0; n < unrolled; n += 16) {
+		in = _mm512_i32gather_epi32(idx, s, 4);
+		_mm512_storeu_ps(&d0[n], _mm512_mul_ps(_mm512_cvtepi32_ps(in), factor));
+		s += 16*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S24_TO_F32(s[0]);
+		s += n_channels;
+	}
+}
+
+static void
+conv_s24_32_to_f32d_4s_avx512(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int32_t *s = src;
+	float *d0 = dst[0], *d1 = dst[1], *d2 = dst[2], *d3 = dst[3];
+	uint32_t n, unrolled = n_samples & ~15;
+	__m512 in[4], factor = _mm512_set1_ps(1.0f / S24_SCALE);
+
+	for(n = 0; n < unrolled; n += 16) {
+		in[0] = load_4s_4f_avx512(&s[0*n_channels], n_channels);
+		in[1] = load_4s_4f_avx512(&s[1*n_channels], n_channels);
+		in[2] = load_4s_4f_avx512(&s[2*n_channels], n_channels);
+		in[3] = load_4s_4f_avx512(&s[3*n_channels], n_channels);
+
+		in[0] = _mm512_cvtepi32_ps(_mm512_castps_si512(in[0]));
+		in[1] = _mm512_cvtepi32_ps(_mm512_castps_si512(in[1]));
+		in[2] = _mm512_cvtepi32_ps(_mm512_castps_si512(in[2]));
+		in[3] = _mm512_cvtepi32_ps(_mm512_castps_si512(in[3]));
+
+		TRANSPOSE_4x4_512(in[0], in[1], in[2], in[3]);
+
+		_mm512_storeu_ps(&d0[n], _mm512_mul_ps(in[0], factor));
+		_mm512_storeu_ps(&d1[n], _mm512_mul_ps(in[1], factor));
+		_mm512_storeu_ps(&d2[n], _mm512_mul_ps(in[2], factor));
+		_mm512_storeu_ps(&d3[n], _mm512_mul_ps(in[3], factor));
+		s += 16*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S24_TO_F32(s[0]);
+		d1[n] = S24_TO_F32(s[1]);
+		d2[n] = S24_TO_F32(s[2]);
+		d3[n] = S24_TO_F32(s[3]);
+		s += n_channels;
+	}
+}
+
+void
+conv_s24_32_to_f32d_avx512(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const int32_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_s24_32_to_f32d_4s_avx512(conv, &dst[i], &s[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_s24_32_to_f32d_1s_avx512(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+static void
+conv_f32d_to_s16_1s_avx512(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	int16_t *d = dst;
+	uint32_t n, i, unrolled = n_samples & ~15;
+	int32_t tmp[16] SPA_ALIGNED(64);
+	__m512 in, int_max = _mm512_set1_ps(S16_MAX_F);
+	__m512 int_min = _mm512_set1_ps(-S16_MAX_F);
+
+	for(n = 0; n < unrolled; n += 16) {
+		in = _mm512_mul_ps(_mm512_loadu_ps(&s0[n]), int_max);
+		in = _mm512_min_ps(_mm512_max_ps(in, int_min), int_max);
+		_mm512_store_si512(tmp, _mm512_cvtps_epi32(in));
+		for (i = 0; i < 16; i++)
+			d[i*n_channels] = tmp[i];
+		d += 16*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		*d = F32_TO_S16(s0[n]);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s16_2s_avx512(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1];
+	int16_t *d = dst;
+	uint32_t n, unrolled = n_samples & ~15;
+	__m512 in[2], int_max = _mm512_set1_ps(S16_MAX_F);
+	__m512 int_min = _mm512_set1_ps(-S16_MAX_F);
+	__m512i out[2], idx = frame_index_avx512(n_channels);
+
+	for(n = 0; n < unrolled; n += 16) {
+		in[0] = _mm512_mul_ps(_mm512_loadu_ps(&s0[n]), int_max);
+		in[1] = _mm512_mul_ps(_mm512_loadu_ps(&s1[n]), int_max);
+		in[0] = _mm512_min_ps(_mm512_max_ps(in[0], int_min), int_max);
+		in[1] = _mm512_min_ps(_mm512_max_ps(in[1], int_min), int_max);
+
+		out[0] = _mm512_cvtps_epi32(in[0]);
+		out[1] = _mm512_cvtps_epi32(in[1]);
+		/* both samples of a frame in one 32 bits value */
+		out[0] = _mm512_or_si512(_mm512_and_si512(out[0], _mm512_set1_epi32(0xffff)),
+				_mm512_slli_epi32(out[1], 16));
+
+		_mm512_i32scatter_epi32(d, idx, out[0], 2);
+		d += 16*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = F32_TO_S16(s0[n]);
+		d[1] = F32_TO_S16(s1[n]);
+		d += n_channels;
+	}
+}
+
+void
+conv_f32d_to_s16_avx512(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int16_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 1 < n_channels; i += 2)
+		conv_f32d_to_s16_2s_avx512(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s16_1s_avx512(conv, &d[i], &src[i], n_channels, n_samples);
+}
+
+static void
+conv_f32d_to_s32_1s_avx512(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	int32_t *d = dst;
+	uint32_t n, unrolled = n_samples & ~15;
+	__m512 in, scale = _mm512_set1_ps(S32_SCALE);
+	__m512 int_min = _mm512_set1_ps(S32_MIN);
+	__m512i idx = frame_index_avx512(n_channels);
+
+	for(n = 0; n < unrolled; n += 16) {
+		in = _mm512_mul_ps(_mm512_loadu_ps(&s0[n]), scale);
+		in = _mm512_min_ps(in, int_min);
+		_mm512_i32scatter_epi32(d, idx, _mm512_cvtps_epi32(in), 4);
+		d += 16*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		*d = _mm_cvtss_si32(_mm_min_ss(_mm_mul_ss(_mm_load_ss(&s0[n]),
+						_mm512_castps512_ps128(scale)),
+					_mm512_castps512_ps128(int_min)));
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s32_4s_avx512(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	int32_t *d = dst;
+	uint32_t n, unrolled = n_samples & ~15;
+	__m512 in[4], scale = _mm512_set1_ps(S32_SCALE);
+	__m512 int_min = _mm512_set1_ps(S32_MIN);
+
+	for(n = 0; n < unrolled; n += 16) {
+		in[0] = _mm512_min_ps(_mm512_mul_ps(_mm512_loadu_ps(&s0[n]), scale), int_min);
+		in[1] = _mm512_min_ps(_mm512_mul_ps(_mm512_loadu_ps(&s1[n]), scale), int_min);
+		in[2] = _mm512_min_ps(_mm512_mul_ps(_mm512_loadu_ps(&s2[n]), scale), int_min);
+		in[3] = _mm512_min_ps(_mm512_mul_ps(_mm512_loadu_ps(&s3[n]), scale), int_min);
+
+		in[0] = _mm512_castsi512_ps(_mm512_cvtps_epi32(in[0]));
+		in[1] = _mm512_castsi512_ps(_mm512_cvtps_epi32(in[1]));
+		in[2] = _mm512_castsi512_ps(_mm512_cvtps_epi32(in[2]));
+		in[3] = _mm512_castsi512_ps(_mm512_cvtps_epi32(in[3]));
+
+		TRANSPOSE_4x4_512(in[0], in[1], in[2], in[3]);
+
+		store_4s_4f_avx512(&d[0*n_channels], n_channels, in[0]);
+		store_4s_4f_avx512(&d[1*n_channels], n_channels, in[1]);
+		store_4s_4f_avx512(&d[2*n_channels], n_channels, in[2]);
+		store_4s_4f_avx512(&d[3*n_channels], n_channels, in[3]);
+		d += 16*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		__m128 v = _mm_setr_ps(s0[n], s1[n], s2[n], s3[n]);
+		v = _mm_min_ps(_mm_mul_ps(v, _mm512_castps512_ps128(scale)),
+				_mm512_castps512_ps128(int_min));
+		_mm_storeu_si128((__m128i*)d, _mm_cvtps_epi32(v));
+		d += n_channels;
+	}
+}
+
+void
+conv_f32d_to_s32_avx512(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int32_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s32_4s_avx512(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s32_1s_avx512(conv, &d[i], &src[i], n_channels, n_samples);
+}
+
+static void
+conv_f32d_to_s24_32_1s_avx512(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	int32_t *d = dst;
+	uint32_t n, unrolled = n_samples & ~15;
+	__m512 in, scale = _mm512_set1_ps(S24_SCALE);
+	__m512 max = _mm512_set1_ps(1.0f), min = _mm512_set1_ps(-1.0f);
+	__m512i idx = frame_index_avx512(n_channels);
+
+	for(n = 0; n < unrolled; n += 16) {
+		in = _mm512_min_ps(_mm512_max_ps(_mm512_loadu_ps(&s0[n]), min), max);
+		_mm512_i32scatter_epi32(d, idx, _mm512_cvttps_epi32(_mm512_mul_ps(in, scale)), 4);
+		d += 16*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		*d = F32_TO_S24(s0[n]);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s24_32_4s_avx512(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	int32_t *d = dst;
+	uint32_t n, unrolled = n_samples & ~15;
+	__m512 in[4], scale = _mm512_set1_ps(S24_SCALE);
+	__m512 max = _mm512_set1_ps(1.0f), min = _mm512_set1_ps(-1.0f);
+
+	for(n = 0; n < unrolled; n += 16) {
+		in[0] = _mm512_min_ps(_mm512_max_ps(_mm512_loadu_ps(&s0[n]), min), max);
+		in[1] = _mm512_min_ps(_mm512_max_ps(_mm512_loadu_ps(&s1[n]), min), max);
+		in[2] = _mm512_min_ps(_mm512_max_ps(_mm512_loadu_ps(&s2[n]), min), max);
+		in[3] = _mm512_min_ps(_mm512_max_ps(_mm512_loadu_ps(&s3[n]), min), max);
+
+		in[0] = _mm512_castsi512_ps(_mm512_cvttps_epi32(_mm512_mul_ps(in[0], scale)));
+		in[1] = _mm512_castsi512_ps(_mm512_cvttps_epi32(_mm512_mul_ps(in[1], scale)));
+		in[2] = _mm512_castsi512_ps(_mm512_cvttps_epi32(_mm512_mul_ps(in[2], scale)));
+		in[3] = _mm512_castsi512_ps(_mm512_cvttps_epi32(_mm512_mul_ps(in[3], scale)));
+
+		TRANSPOSE_4x4_512(in[0], in[1], in[2], in[3]);
+
+		store_4s_4f_avx512(&d[0*n_channels], n_channels, in[0]);
+		store_4s_4f_avx512(&d[1*n_channels], n_channels, in[1]);
+		store_4s_4f_avx512(&d[2*n_channels], n_channels, in[2]);
+		store_4s_4f_avx512(&d[3*n_channels], n_channels, in[3]);
+		d += 16*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = F32_TO_S24(s0[n]);
+		d[1] = F32_TO_S24(s1[n]);
+		d[2] = F32_TO_S24(s2[n]);
+		d[3] = F32_TO_S24(s3[n]);
+		d += n_channels;
+	}
+}
+
+void
+conv_f32d_to_s24_32_avx512(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int32_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s24_32_4s_avx512(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s24_32_1s_avx512(conv, &d[i], &src[i], n_channels, n_samples);
+}
+
+static void
+conv_deinterleave_32_1s_avx512(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled = n_samples & ~15;
+	__m512i idx = frame_index_avx512(n_channels);
+
+	for(n = 0; n < unrolled; n += 16) {
+		_mm512_storeu_ps(&d0[n], _mm512_i32gather_ps(idx, s, 4));
+		s += 16*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = s[0];
+		s += n_channels;
+	}
+}
+
+static void
+conv_deinterleave_32_4s_avx512(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s = src;
+	float *d0 = dst[0], *d1 = dst[1], *d2 = dst[2], *d3 = dst[3];
+	uint32_t n, unrolled = n_samples & ~15;
+	__m512 in[4];
+
+	for(n = 0; n < unrolled; n += 16) {
+		in[0] = load_4s_4f_avx512(&s[0*n_channels], n_channels);
+		in[1] = load_4s_4f_avx512(&s[1*n_channels], n_channels);
+		in[2] = load_4s_4f_avx512(&s[2*n_channels], n_channels);
+		in[3] = load_4s_4f_avx512(&s[3*n_channels], n_channels);
+
+		TRANSPOSE_4x4_512(in[0], in[1], in[2], in[3]);
+
+		_mm512_storeu_ps(&d0[n], in[0]);
+		_mm512_storeu_ps(&d1[n], in[1]);
+		_mm512_storeu_ps(&d2[n], in[2]);
+		_mm512_storeu_ps(&d3[n], in[3]);
+		s += 16*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = s[0];
+		d1[n] = s[1];
+		d2[n] = s[2];
+		d3[n] = s[3];
+		s += n_channels;
+	}
+}
+
+void
+conv_deinterleave_32_avx512(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const float *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_deinterleave_32_4s_avx512(conv, &dst[i], &s[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_deinterleave_32_1s_avx512(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+static void
+conv_interleave_32_1s_avx512(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	float *d = dst;
+	uint32_t n, unrolled = n_samples & ~15;
+	__m512i idx = frame_index_avx512(n_channels);
+
+	for(n = 0; n < unrolled; n += 16) {
+		_mm512_i32scatter_ps(d, idx, _mm512_loadu_ps(&s0[n]), 4);
+		d += 16*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		*d = s0[n];
+		d += n_channels;
+	}
+}
+
+static void
+conv_interleave_32_4s_avx512(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	float *d = dst;
+	uint32_t n, unrolled = n_samples & ~15;
+	__m512 in[4];
+
+	for(n = 0; n < unrolled; n += 16) {
+		in[0] = _mm512_loadu_ps(&s0[n]);
+		in[1] = _mm512_loadu_ps(&s1[n]);
+		in[2] = _mm512_loadu_ps(&s2[n]);
+		in[3] = _mm512_loadu_ps(&s3[n]);
+
+		TRANSPOSE_4x4_512(in[0], in[1], in[2], in[3]);
+
+		store_4s_4f_avx512(&d[0*n_channels], n_channels, in[0]);
+		store_4s_4f_avx512(&d[1*n_channels], n_channels, in[1]);
+		store_4s_4f_avx512(&d[2*n_channels], n_channels, in[2]);
+		store_4s_4f_avx512(&d[3*n_channels], n_channels, in[3]);
+		d += 16*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = s0[n];
+		d[1] = s1[n];
+		d[2] = s2[n];
+		d[3] = s3[n];
+		d += n_channels;
+	}
+}
+
+void
+conv_interleave_32_avx512(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	float *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_interleave_32_4s_avx512(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_interleave_32_1s_avx512(conv, &d[i], &src[i], n_channels, n_samples);
+}
@@ -28,6 +28,8 @@
 
 #include "fmt-ops.h"
 
+#include <arm_neon.h>
+
 static void
 conv_s16_to_f32d_2s_neon(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
 		uint32_t n_channels, uint32_t n_samples)
@@ -361,3 +363,417 @@ conv_f32d_to_s16_neon(struct convert *conv, void * SPA_RESTRICT dst[], const voi
 	for(; i < n_channels; i++)
 		conv_f32d_to_s16_1s_neon(conv, &d[i], &src[i], n_channels, n_samples);
 }
+
+/* transpose 4 frames of 4 channels into 4 channels of 4 frames and back */
+static inline void transpose_4x4_neon(float32x4_t r[4])
+{
+	float32x4x2_t t0 = vzipq_f32(r[0], r[2]);
+	float32x4x2_t t1 = vzipq_f32(r[1], r[3]);
+	float32x4x2_t u0 = vzipq_f32(t0.val[0], t1.val[0]);
+	float32x4x2_t u1 = vzipq_f32(t0.val[1], t1.val[1]);
+	r[0] = u0.val[0];
+	r[1] = u0.val[1];
+	r[2] = u1.val[0];
+	r[3] = u1.val[1];
+}
+
+static inline float32x4_t load_1s_neon(const float *s, uint32_t n_channels)
+{
+	float32x4_t v = vdupq_n_f32(0.0f);
+	v = vld1q_lane_f32(s, v, 0);
+	v = vld1q_lane_f32(s + n_channels, v, 1);
+	v = vld1q_lane_f32(s + 2*n_channels, v, 2);
+	return vld1q_lane_f32(s + 3*n_channels, v, 3);
+}
+
+static inline void store_1s_neon(float *d, uint32_t n_channels, float32x4_t v)
+{
+	vst1q_lane_f32(d, v, 0);
+	vst1q_lane_f32(d + n_channels, v, 1);
+	vst1q_lane_f32(d + 2*n_channels, v, 2);
+	vst1q_lane_f32(d + 3*n_channels, v, 3);
+}
+
+/* like F32_TO_S24 */
+static inline int32x4_t f32_to_s24_neon(float32x4_t v)
+{
+	v = vminq_f32(vmaxq_f32(v, vdupq_n_f32(-1.0f)), vdupq_n_f32(1.0f));
+	return vcvtq_s32_f32(vmulq_n_f32(v, S24_SCALE));
+}
+
+static void
+conv_s24_32_to_f32d_1s_neon(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int32_t *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled = n_samples & ~3;
+	int32x4_t in;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in = vreinterpretq_s32_f32(load_1s_neon((const float*)s, n_channels));
+		vst1q_f32(&d0[n], vmulq_n_f32(vcvtq_f32_s32(in), 1.0f / S24_SCALE));
+		s += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S24_TO_F32(s[0]);
+		s += n_channels;
+	}
+}
+
+static void
+conv_s24_32_to_f32d_4s_neon(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int32_t *s = src;
+	float *d0 = dst[0], *d1 = dst[1], *d2 = dst[2], *d3 = dst[3];
+	uint32_t n, i, unrolled = n_samples & ~3;
+	float32x4_t in[4];
+
+	for(n = 0; n < unrolled; n += 4) {
+		for (i = 0; i < 4; i++)
+			in[i] = vmulq_n_f32(vcvtq_f32_s32(vld1q_s32(&s[i*n_channels])),
+					1.0f / S24_SCALE);
+
+		transpose_4x4_neon(in);
+
+		vst1q_f32(&d0[n], in[0]);
+		vst1q_f32(&d1[n], in[1]);
+		vst1q_f32(&d2[n], in[2]);
+		vst1q_f32(&d3[n], in[3]);
+		s += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S24_TO_F32(s[0]);
+		d1[n] = S24_TO_F32(s[1]);
+		d2[n] = S24_TO_F32(s[2]);
+		d3[n] = S24_TO_F32(s[3]);
+		s += n_channels;
+	}
+}
+
+void
+conv_s24_32_to_f32d_neon(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const int32_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_s24_32_to_f32d_4s_neon(conv, &dst[i], &s[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_s24_32_to_f32d_1s_neon(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+static void
+conv_s32_to_f32d_1s_neon(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int32_t *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled = n_samples & ~3;
+	int32x4_t in;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in = vreinterpretq_s32_f32(load_1s_neon((const float*)s, n_channels));
+		in = vshrq_n_s32(in, 8);
+		vst1q_f32(&d0[n], vmulq_n_f32(vcvtq_f32_s32(in), 1.0f / S24_SCALE));
+		s += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S32_TO_F32(s[0]);
+		s += n_channels;
+	}
+}
+
+static void
+conv_s32_to_f32d_4s_neon(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int32_t *s = src;
+	float *d0 = dst[0], *d1 = dst[1], *d2 = dst[2], *d3 = dst[3];
+	uint32_t n, i, unrolled = n_samples & ~3;
+	float32x4_t in[4];
+
+	for(n = 0; n < unrolled; n += 4) {
+		for (i = 0; i < 4; i++)
+			in[i] = vmulq_n_f32(vcvtq_f32_s32(vshrq_n_s32(vld1q_s32(&s[i*n_channels]), 8)),
+					1.0f / S24_SCALE);
+
+		transpose_4x4_neon(in);
+
+		vst1q_f32(&d0[n], in[0]);
+		vst1q_f32(&d1[n], in[1]);
+		vst1q_f32(&d2[n], in[2]);
+		vst1q_f32(&d3[n], in[3]);
+		s += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S32_TO_F32(s[0]);
+		d1[n] = S32_TO_F32(s[1]);
+		d2[n] = S32_TO_F32(s[2]);
+		d3[n] = S32_TO_F32(s[3]);
+		s += n_channels;
+	}
+}
+
+void
+conv_s32_to_f32d_neon(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const int32_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_s32_to_f32d_4s_neon(conv, &dst[i], &s[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_s32_to_f32d_1s_neon(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+static void
+conv_f32d_to_s24_32_1s_neon(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	int32_t *d = dst;
+	uint32_t n, unrolled = n_samples & ~3;
+	int32x4_t out;
+
+	for(n = 0; n < unrolled; n += 4) {
+		out = f32_to_s24_neon(vld1q_f32(&s0[n]));
+		store_1s_neon((float*)d, n_channels, vreinterpretq_f32_s32(out));
+		d += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		*d = F32_TO_S24(s0[n]);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s24_32_4s_neon(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	int32_t *d = dst;
+	uint32_t n, i, unrolled = n_samples & ~3;
+	float32x4_t out[4];
+
+	for(n = 0; n < unrolled; n += 4) {
+		out[0] = vreinterpretq_f32_s32(f32_to_s24_neon(vld1q_f32(&s0[n])));
+		out[1] = vreinterpretq_f32_s32(f32_to_s24_neon(vld1q_f32(&s1[n])));
+		out[2] = vreinterpretq_f32_s32(f32_to_s24_neon(vld1q_f32(&s2[n])));
+		out[3] = vreinterpretq_f32_s32(f32_to_s24_neon(vld1q_f32(&s3[n])));
+
+		transpose_4x4_neon(out);
+
+		for (i = 0; i < 4; i++)
+			vst1q_f32((float*)&d[i*n_channels], out[i]);
+		d += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = F32_TO_S24(s0[n]);
+		d[1] = F32_TO_S24(s1[n]);
+		d[2] = F32_TO_S24(s2[n]);
+		d[3] = F32_TO_S24(s3[n]);
+		d += n_channels;
+	}
+}
+
+void
+conv_f32d_to_s24_32_neon(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int32_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s24_32_4s_neon(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s24_32_1s_neon(conv, &d[i], &src[i], n_channels, n_samples);
+}
+
+static void
+conv_f32d_to_s32_1s_neon(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	int32_t *d = dst;
+	uint32_t n, unrolled = n_samples & ~3;
+	int32x4_t out;
+
+	for(n = 0; n < unrolled; n += 4) {
+		out = vshlq_n_s32(f32_to_s24_neon(vld1q_f32(&s0[n])), 8);
+		store_1s_neon((float*)d, n_channels, vreinterpretq_f32_s32(out));
+		d += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		*d = F32_TO_S32(s0[n]);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s32_4s_neon(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	int32_t *d = dst;
+	uint32_t n, i, unrolled = n_samples & ~3;
+	float32x4_t out[4];
+
+	for(n = 0; n < unrolled; n += 4) {
+		out[0] = vreinterpretq_f32_s32(vshlq_n_s32(f32_to_s24_neon(vld1q_f32(&s0[n])), 8));
+		out[1] = vreinterpretq_f32_s32(vshlq_n_s32(f32_to_s24_neon(vld1q_f32(&s1[n])), 8));
+		out[2] = vreinterpretq_f32_s32(vshlq_n_s32(f32_to_s24_neon(vld1q_f32(&s2[n])), 8));
+		out[3] = vreinterpretq_f32_s32(vshlq_n_s32(f32_to_s24_neon(vld1q_f32(&s3[n])), 8));
+
+		transpose_4x4_neon(out);
+
+		for (i = 0; i < 4; i++)
+			vst1q_f32((float*)&d[i*n_channels], out[i]);
+		d += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = F32_TO_S32(s0[n]);
+		d[1] = F32_TO_S32(s1[n]);
+		d[2] = F32_TO_S32(s2[n]);
+		d[3] = F32_TO_S32(s3[n]);
+		d += n_channels;
+	}
+}
+
+void
+conv_f32d_to_s32_neon(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int32_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s32_4s_neon(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s32_1s_neon(conv, &d[i], &src[i], n_channels, n_samples);
+}
+
+static void
+conv_deinterleave_32_1s_neon(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled = n_samples & ~3;
+
+	for(n = 0; n < unrolled; n += 4) {
+		vst1q_f32(&d0[n], load_1s_neon(s, n_channels));
+		s += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = s[0];
+		s += n_channels;
+	}
+}
+
+static void
+conv_deinterleave_32_4s_neon(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s = src;
+	float *d0 = dst[0], *d1 = dst[1], *d2 = dst[2], *d3 = dst[3];
+	uint32_t n, i, unrolled = n_samples & ~3;
+	float32x4_t in[4];
+
+	for(n = 0; n < unrolled; n += 4) {
+		for (i = 0; i < 4; i++)
+			in[i] = vld1q_f32(&s[i*n_channels]);
+
+		transpose_4x4_neon(in);
+
+		vst1q_f32(&d0[n], in[0]);
+		vst1q_f32(&d1[n], in[1]);
+		vst1q_f32(&d2[n], in[2]);
+		vst1q_f32(&d3[n], in[3]);
+		s += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = s[0];
+		d1[n] = s[1];
+		d2[n] = s[2];
+		d3[n] = s[3];
+		s += n_channels;
+	}
+}
+
+void
+conv_deinterleave_32_neon(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const float *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_deinterleave_32_4s_neon(conv, &dst[i], &s[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_deinterleave_32_1s_neon(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+static void
+conv_interleave_32_1s_neon(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	float *d = dst;
+	uint32_t n, unrolled = n_samples & ~3;
+
+	for(n = 0; n < unrolled; n += 4) {
+		store_1s_neon(d, n_channels, vld1q_f32(&s0[n]));
+		d += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		*d = s0[n];
+		d += n_channels;
+	}
+}
+
+static void
+conv_interleave_32_4s_neon(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	float *d = dst;
+	uint32_t n, i, unrolled = n_samples & ~3;
+	float32x4_t out[4];
+
+	for(n = 0; n < unrolled; n += 4) {
+		out[0] = vld1q_f32(&s0[n]);
+		out[1] = vld1q_f32(&s1[n]);
+		out[2] = vld1q_f32(&s2[n]);
+		out[3] = vld1q_f32(&s3[n]);
+
+		transpose_4x4_neon(out);
+
+		for (i = 0; i < 4; i++)
+			vst1q_f32(&d[i*n_channels], out[i]);
+		d += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = s0[n];
+		d[1] = s1[n];
+		d[2] = s2[n];
+		d[3] = s3[n];
+		d += n_channels;
+	}
+}
+
+void
+conv_interleave_32_neon(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	float *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_interleave_32_4s_neon(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_interleave_32_1s_neon(conv, &d[i], &src[i], n_channels, n_samples);
+}
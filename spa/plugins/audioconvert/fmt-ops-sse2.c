@@ -812,3 +812,563 @@ conv_f32d_to_s16_2_sse2(struct convert *conv, void * SPA_RESTRICT dst[], const v
 		d += 2;
 	}
 }
+
+static void
+conv_s24_32_to_f32d_1s_sse2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int32_t *s = src;
+	float *d0 = dst[0];
+	uint32_t n, unrolled;
+	__m128i in;
+	__m128 out, factor = _mm_set1_ps(1.0f / S24_SCALE);
+
+	if (SPA_IS_ALIGNED(d0, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in = _mm_setr_epi32(s[0*n_channels],
+				    s[1*n_channels],
+				    s[2*n_channels],
+				    s[3*n_channels]);
+		out = _mm_cvtepi32_ps(in);
+		out = _mm_mul_ps(out, factor);
+		_mm_store_ps(&d0[n], out);
+		s += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S24_TO_F32(s[0]);
+		s += n_channels;
+	}
+}
+
+void
+conv_s24_32_to_f32d_2s_sse2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int32_t *s = src;
+	float *d0 = dst[0], *d1 = dst[1];
+	uint32_t n, unrolled;
+	__m128i in[2];
+	__m128 t[2], out[2], factor = _mm_set1_ps(1.0f / S24_SCALE);
+
+	if (SPA_IS_ALIGNED(d0, 16) &&
+	    SPA_IS_ALIGNED(d1, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in[0] = _mm_unpacklo_epi64(
+				_mm_loadl_epi64((const __m128i*)&s[0*n_channels]),
+				_mm_loadl_epi64((const __m128i*)&s[1*n_channels]));
+		in[1] = _mm_unpacklo_epi64(
+				_mm_loadl_epi64((const __m128i*)&s[2*n_channels]),
+				_mm_loadl_epi64((const __m128i*)&s[3*n_channels]));
+
+		t[0] = _mm_mul_ps(_mm_cvtepi32_ps(in[0]), factor);	/* a0 b0 a1 b1 */
+		t[1] = _mm_mul_ps(_mm_cvtepi32_ps(in[1]), factor);	/* a2 b2 a3 b3 */
+
+		out[0] = _mm_shuffle_ps(t[0], t[1], _MM_SHUFFLE(2, 0, 2, 0));
+		out[1] = _mm_shuffle_ps(t[0], t[1], _MM_SHUFFLE(3, 1, 3, 1));
+
+		_mm_store_ps(&d0[n], out[0]);
+		_mm_store_ps(&d1[n], out[1]);
+		s += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S24_TO_F32(s[0]);
+		d1[n] = S24_TO_F32(s[1]);
+		s += n_channels;
+	}
+}
+
+static void
+conv_s24_32_to_f32d_4s_sse2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const int32_t *s = src;
+	float *d0 = dst[0], *d1 = dst[1], *d2 = dst[2], *d3 = dst[3];
+	uint32_t n, unrolled;
+	__m128 in[4], factor = _mm_set1_ps(1.0f / S24_SCALE);
+
+	if (SPA_IS_ALIGNED(d0, 16) &&
+	    SPA_IS_ALIGNED(d1, 16) &&
+	    SPA_IS_ALIGNED(d2, 16) &&
+	    SPA_IS_ALIGNED(d3, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in[0] = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)&s[0*n_channels]));
+		in[1] = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)&s[1*n_channels]));
+		in[2] = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)&s[2*n_channels]));
+		in[3] = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i*)&s[3*n_channels]));
+
+		in[0] = _mm_mul_ps(in[0], factor);
+		in[1] = _mm_mul_ps(in[1], factor);
+		in[2] = _mm_mul_ps(in[2], factor);
+		in[3] = _mm_mul_ps(in[3], factor);
+
+		_MM_TRANSPOSE4_PS(in[0], in[1], in[2], in[3]);
+
+		_mm_store_ps(&d0[n], in[0]);
+		_mm_store_ps(&d1[n], in[1]);
+		_mm_store_ps(&d2[n], in[2]);
+		_mm_store_ps(&d3[n], in[3]);
+		s += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = S24_TO_F32(s[0]);
+		d1[n] = S24_TO_F32(s[1]);
+		d2[n] = S24_TO_F32(s[2]);
+		d3[n] = S24_TO_F32(s[3]);
+		s += n_channels;
+	}
+}
+
+void
+conv_s24_32_to_f32d_sse2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const int32_t *s = src[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_s24_32_to_f32d_4s_sse2(conv, &dst[i], &s[i], n_channels, n_samples);
+	for(; i + 1 < n_channels; i += 2)
+		conv_s24_32_to_f32d_2s_sse2(conv, &dst[i], &s[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_s24_32_to_f32d_1s_sse2(conv, &dst[i], &s[i], n_channels, n_samples);
+}
+
+static void
+conv_f32d_to_s24_32_1s_sse2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0];
+	int32_t *d = dst;
+	uint32_t n, unrolled;
+	__m128 in[1];
+	__m128i out[4];
+	__m128 scale = _mm_set1_ps(S24_SCALE);
+	__m128 max = _mm_set1_ps(1.0f), min = _mm_set1_ps(-1.0f);
+
+	if (SPA_IS_ALIGNED(s0, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in[0] = _mm_min_ps(_mm_max_ps(_mm_load_ps(&s0[n]), min), max);
+		in[0] = _mm_mul_ps(in[0], scale);
+		out[0] = _mm_cvttps_epi32(in[0]);
+		out[1] = _mm_shuffle_epi32(out[0], _MM_SHUFFLE(0, 3, 2, 1));
+		out[2] = _mm_shuffle_epi32(out[0], _MM_SHUFFLE(1, 0, 3, 2));
+		out[3] = _mm_shuffle_epi32(out[0], _MM_SHUFFLE(2, 1, 0, 3));
+
+		d[0*n_channels] = _mm_cvtsi128_si32(out[0]);
+		d[1*n_channels] = _mm_cvtsi128_si32(out[1]);
+		d[2*n_channels] = _mm_cvtsi128_si32(out[2]);
+		d[3*n_channels] = _mm_cvtsi128_si32(out[3]);
+		d += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		*d = F32_TO_S24(s0[n]);
+		d += n_channels;
+	}
+}
+
+void
+conv_f32d_to_s24_32_2s_sse2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1];
+	int32_t *d = dst;
+	uint32_t n, unrolled;
+	__m128 in[2];
+	__m128i out[2], t[2];
+	__m128 scale = _mm_set1_ps(S24_SCALE);
+	__m128 max = _mm_set1_ps(1.0f), min = _mm_set1_ps(-1.0f);
+
+	if (SPA_IS_ALIGNED(s0, 16) &&
+	    SPA_IS_ALIGNED(s1, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in[0] = _mm_min_ps(_mm_max_ps(_mm_load_ps(&s0[n]), min), max);
+		in[1] = _mm_min_ps(_mm_max_ps(_mm_load_ps(&s1[n]), min), max);
+
+		out[0] = _mm_cvttps_epi32(_mm_mul_ps(in[0], scale));
+		out[1] = _mm_cvttps_epi32(_mm_mul_ps(in[1], scale));
+
+		t[0] = _mm_unpacklo_epi32(out[0], out[1]);
+		t[1] = _mm_unpackhi_epi32(out[0], out[1]);
+
+		_mm_storel_pd((double*)(d + 0*n_channels), (__m128d)t[0]);
+		_mm_storeh_pd((double*)(d + 1*n_channels), (__m128d)t[0]);
+		_mm_storel_pd((double*)(d + 2*n_channels), (__m128d)t[1]);
+		_mm_storeh_pd((double*)(d + 3*n_channels), (__m128d)t[1]);
+		d += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = F32_TO_S24(s0[n]);
+		d[1] = F32_TO_S24(s1[n]);
+		d += n_channels;
+	}
+}
+
+static void
+conv_f32d_to_s24_32_4s_sse2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	int32_t *d = dst;
+	uint32_t n, unrolled;
+	__m128 in[4];
+	__m128 scale = _mm_set1_ps(S24_SCALE);
+	__m128 max = _mm_set1_ps(1.0f), min = _mm_set1_ps(-1.0f);
+
+	if (SPA_IS_ALIGNED(s0, 16) &&
+	    SPA_IS_ALIGNED(s1, 16) &&
+	    SPA_IS_ALIGNED(s2, 16) &&
+	    SPA_IS_ALIGNED(s3, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in[0] = _mm_min_ps(_mm_max_ps(_mm_load_ps(&s0[n]), min), max);
+		in[1] = _mm_min_ps(_mm_max_ps(_mm_load_ps(&s1[n]), min), max);
+		in[2] = _mm_min_ps(_mm_max_ps(_mm_load_ps(&s2[n]), min), max);
+		in[3] = _mm_min_ps(_mm_max_ps(_mm_load_ps(&s3[n]), min), max);
+
+		in[0] = _mm_mul_ps(in[0], scale);
+		in[1] = _mm_mul_ps(in[1], scale);
+		in[2] = _mm_mul_ps(in[2], scale);
+		in[3] = _mm_mul_ps(in[3], scale);
+
+		_MM_TRANSPOSE4_PS(in[0], in[1], in[2], in[3]);
+
+		_mm_storeu_si128((__m128i*)(d + 0*n_channels), _mm_cvttps_epi32(in[0]));
+		_mm_storeu_si128((__m128i*)(d + 1*n_channels), _mm_cvttps_epi32(in[1]));
+		_mm_storeu_si128((__m128i*)(d + 2*n_channels), _mm_cvttps_epi32(in[2]));
+		_mm_storeu_si128((__m128i*)(d + 3*n_channels), _mm_cvttps_epi32(in[3]));
+		d += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = F32_TO_S24(s0[n]);
+		d[1] = F32_TO_S24(s1[n]);
+		d[2] = F32_TO_S24(s2[n]);
+		d[3] = F32_TO_S24(s3[n]);
+		d += n_channels;
+	}
+}
+
+void
+conv_f32d_to_s24_32_sse2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	int32_t *d = dst[0];
+	uint32_t i = 0, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_f32d_to_s24_32_4s_sse2(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i + 1 < n_channels; i += 2)
+		conv_f32d_to_s24_32_2s_sse2(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++)
+		conv_f32d_to_s24_32_1s_sse2(conv, &d[i], &src[i], n_channels, n_samples);
+}
+
+void
+conv_deinterleave_32_2s_sse2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s = src;
+	float *d0 = dst[0], *d1 = dst[1];
+	uint32_t n, unrolled;
+	__m128 t[2];
+
+	if (SPA_IS_ALIGNED(d0, 16) &&
+	    SPA_IS_ALIGNED(d1, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 4) {
+		t[0] = _mm_loadh_pi(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)&s[0*n_channels])),
+				(const __m64*)&s[1*n_channels]);
+		t[1] = _mm_loadh_pi(_mm_castsi128_ps(_mm_loadl_epi64((const __m128i*)&s[2*n_channels])),
+				(const __m64*)&s[3*n_channels]);
+
+		_mm_store_ps(&d0[n], _mm_shuffle_ps(t[0], t[1], _MM_SHUFFLE(2, 0, 2, 0)));
+		_mm_store_ps(&d1[n], _mm_shuffle_ps(t[0], t[1], _MM_SHUFFLE(3, 1, 3, 1)));
+		s += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = s[0];
+		d1[n] = s[1];
+		s += n_channels;
+	}
+}
+
+static void
+conv_deinterleave_32_4s_sse2(void *data, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src,
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s = src;
+	float *d0 = dst[0], *d1 = dst[1], *d2 = dst[2], *d3 = dst[3];
+	uint32_t n, unrolled;
+	__m128 in[4];
+
+	if (SPA_IS_ALIGNED(d0, 16) &&
+	    SPA_IS_ALIGNED(d1, 16) &&
+	    SPA_IS_ALIGNED(d2, 16) &&
+	    SPA_IS_ALIGNED(d3, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in[0] = _mm_loadu_ps(&s[0*n_channels]);
+		in[1] = _mm_loadu_ps(&s[1*n_channels]);
+		in[2] = _mm_loadu_ps(&s[2*n_channels]);
+		in[3] = _mm_loadu_ps(&s[3*n_channels]);
+
+		_MM_TRANSPOSE4_PS(in[0], in[1], in[2], in[3]);
+
+		_mm_store_ps(&d0[n], in[0]);
+		_mm_store_ps(&d1[n], in[1]);
+		_mm_store_ps(&d2[n], in[2]);
+		_mm_store_ps(&d3[n], in[3]);
+		s += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d0[n] = s[0];
+		d1[n] = s[1];
+		d2[n] = s[2];
+		d3[n] = s[3];
+		s += n_channels;
+	}
+}
+
+void
+conv_deinterleave_32_sse2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	const float *s = src[0];
+	uint32_t i = 0, j, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_deinterleave_32_4s_sse2(conv, &dst[i], &s[i], n_channels, n_samples);
+	for(; i + 1 < n_channels; i += 2)
+		conv_deinterleave_32_2s_sse2(conv, &dst[i], &s[i], n_channels, n_samples);
+	for(; i < n_channels; i++) {
+		float *d = dst[i];
+		for (j = 0; j < n_samples; j++)
+			d[j] = s[j * n_channels + i];
+	}
+}
+
+void
+conv_interleave_32_2s_sse2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1];
+	float *d = dst;
+	uint32_t n, unrolled;
+	__m128 in[2], t[2];
+
+	if (SPA_IS_ALIGNED(s0, 16) &&
+	    SPA_IS_ALIGNED(s1, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in[0] = _mm_load_ps(&s0[n]);
+		in[1] = _mm_load_ps(&s1[n]);
+
+		t[0] = _mm_unpacklo_ps(in[0], in[1]);
+		t[1] = _mm_unpackhi_ps(in[0], in[1]);
+
+		_mm_storel_pi((__m64*)(d + 0*n_channels), t[0]);
+		_mm_storeh_pi((__m64*)(d + 1*n_channels), t[0]);
+		_mm_storel_pi((__m64*)(d + 2*n_channels), t[1]);
+		_mm_storeh_pi((__m64*)(d + 3*n_channels), t[1]);
+		d += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = s0[n];
+		d[1] = s1[n];
+		d += n_channels;
+	}
+}
+
+static void
+conv_interleave_32_4s_sse2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_channels, uint32_t n_samples)
+{
+	const float *s0 = src[0], *s1 = src[1], *s2 = src[2], *s3 = src[3];
+	float *d = dst;
+	uint32_t n, unrolled;
+	__m128 in[4];
+
+	if (SPA_IS_ALIGNED(s0, 16) &&
+	    SPA_IS_ALIGNED(s1, 16) &&
+	    SPA_IS_ALIGNED(s2, 16) &&
+	    SPA_IS_ALIGNED(s3, 16))
+		unrolled = n_samples & ~3;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 4) {
+		in[0] = _mm_load_ps(&s0[n]);
+		in[1] = _mm_load_ps(&s1[n]);
+		in[2] = _mm_load_ps(&s2[n]);
+		in[3] = _mm_load_ps(&s3[n]);
+
+		_MM_TRANSPOSE4_PS(in[0], in[1], in[2], in[3]);
+
+		_mm_storeu_ps(d + 0*n_channels, in[0]);
+		_mm_storeu_ps(d + 1*n_channels, in[1]);
+		_mm_storeu_ps(d + 2*n_channels, in[2]);
+		_mm_storeu_ps(d + 3*n_channels, in[3]);
+		d += 4*n_channels;
+	}
+	for(; n < n_samples; n++) {
+		d[0] = s0[n];
+		d[1] = s1[n];
+		d[2] = s2[n];
+		d[3] = s3[n];
+		d += n_channels;
+	}
+}
+
+void
+conv_interleave_32_sse2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	float *d = dst[0];
+	uint32_t i = 0, j, n_channels = conv->n_channels;
+
+	for(; i + 3 < n_channels; i += 4)
+		conv_interleave_32_4s_sse2(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i + 1 < n_channels; i += 2)
+		conv_interleave_32_2s_sse2(conv, &d[i], &src[i], n_channels, n_samples);
+	for(; i < n_channels; i++) {
+		const float *s = src[i];
+		for (j = 0; j < n_samples; j++)
+			d[j * n_channels + i] = s[j];
+	}
+}
+
+static void
+conv_u8_to_f32_1_sse2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src,
+		uint32_t n_samples)
+{
+	const uint8_t *s = src;
+	float *d = dst;
+	uint32_t n, unrolled;
+	__m128i in, t[2], zero = _mm_setzero_si128();
+	__m128 out[4], factor = _mm_set1_ps(1.0f / U8_OFFS), one = _mm_set1_ps(1.0f);
+
+	if (SPA_IS_ALIGNED(d, 16))
+		unrolled = n_samples & ~15;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 16) {
+		in = _mm_loadu_si128((const __m128i*)&s[n]);
+		t[0] = _mm_unpacklo_epi8(in, zero);
+		t[1] = _mm_unpackhi_epi8(in, zero);
+
+		out[0] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(t[0], zero));
+		out[1] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(t[0], zero));
+		out[2] = _mm_cvtepi32_ps(_mm_unpacklo_epi16(t[1], zero));
+		out[3] = _mm_cvtepi32_ps(_mm_unpackhi_epi16(t[1], zero));
+
+		_mm_store_ps(&d[n+ 0], _mm_sub_ps(_mm_mul_ps(out[0], factor), one));
+		_mm_store_ps(&d[n+ 4], _mm_sub_ps(_mm_mul_ps(out[1], factor), one));
+		_mm_store_ps(&d[n+ 8], _mm_sub_ps(_mm_mul_ps(out[2], factor), one));
+		_mm_store_ps(&d[n+12], _mm_sub_ps(_mm_mul_ps(out[3], factor), one));
+	}
+	for(; n < n_samples; n++)
+		d[n] = U8_TO_F32(s[n]);
+}
+
+void
+conv_u8d_to_f32d_sse2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	uint32_t i, n_channels = conv->n_channels;
+	for(i = 0; i < n_channels; i++)
+		conv_u8_to_f32_1_sse2(conv, dst[i], src[i], n_samples);
+}
+
+void
+conv_u8_to_f32_sse2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	conv_u8_to_f32_1_sse2(conv, dst[0], src[0], n_samples * conv->n_channels);
+}
+
+static void
+conv_f32_to_u8_1_sse2(void *data, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src,
+		uint32_t n_samples)
+{
+	const float *s = src;
+	uint8_t *d = dst;
+	uint32_t n, unrolled;
+	__m128 in[4];
+	__m128i out[4];
+	__m128 scale = _mm_set1_ps(U8_SCALE), offs = _mm_set1_ps(U8_OFFS);
+	__m128 max = _mm_set1_ps(1.0f), min = _mm_set1_ps(-1.0f);
+
+	if (SPA_IS_ALIGNED(s, 16))
+		unrolled = n_samples & ~15;
+	else
+		unrolled = 0;
+
+	for(n = 0; n < unrolled; n += 16) {
+		in[0] = _mm_min_ps(_mm_max_ps(_mm_load_ps(&s[n+ 0]), min), max);
+		in[1] = _mm_min_ps(_mm_max_ps(_mm_load_ps(&s[n+ 4]), min), max);
+		in[2] = _mm_min_ps(_mm_max_ps(_mm_load_ps(&s[n+ 8]), min), max);
+		in[3] = _mm_min_ps(_mm_max_ps(_mm_load_ps(&s[n+12]), min), max);
+
+		out[0] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(in[0], scale), offs));
+		out[1] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(in[1], scale), offs));
+		out[2] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(in[2], scale), offs));
+		out[3] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(in[3], scale), offs));
+
+		/* values are in 0..255, the saturating packs keep them */
+		out[0] = _mm_packs_epi32(out[0], out[1]);
+		out[2] = _mm_packs_epi32(out[2], out[3]);
+		out[0] = _mm_packus_epi16(out[0], out[2]);
+
+		_mm_storeu_si128((__m128i*)&d[n], out[0]);
+	}
+	for(; n < n_samples; n++)
+		d[n] = F32_TO_U8(s[n]);
+}
+
+void
+conv_f32d_to_u8d_sse2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	uint32_t i, n_channels = conv->n_channels;
+	for(i = 0; i < n_channels; i++)
+		conv_f32_to_u8_1_sse2(conv, dst[i], src[i], n_samples);
+}
+
+void
+conv_f32_to_u8_sse2(struct convert *conv, void * SPA_RESTRICT dst[], const void * SPA_RESTRICT src[],
+		uint32_t n_samples)
+{
+	conv_f32_to_u8_1_sse2(conv, dst[0], src[0], n_samples * conv->n_channels);
+}
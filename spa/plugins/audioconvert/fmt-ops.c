@@ -47,17 +47,25 @@ struct conv_info {
 static struct conv_info conv_table[] =
 {
 	/* to f32 */
+#if defined (HAVE_SSE2)
+	{ SPA_AUDIO_FORMAT_U8, SPA_AUDIO_FORMAT_F32, 0, SPA_CPU_FLAG_SSE2, conv_u8_to_f32_sse2 },
+#endif
 	{ SPA_AUDIO_FORMAT_U8, SPA_AUDIO_FORMAT_F32, 0, 0, conv_u8_to_f32_c },
+#if defined (HAVE_SSE2)
+	{ SPA_AUDIO_FORMAT_U8P, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_SSE2, conv_u8d_to_f32d_sse2 },
+#endif
 	{ SPA_AUDIO_FORMAT_U8P, SPA_AUDIO_FORMAT_F32P, 0, 0, conv_u8d_to_f32d_c },
 	{ SPA_AUDIO_FORMAT_U8, SPA_AUDIO_FORMAT_F32P, 0, 0, conv_u8_to_f32d_c },
 	{ SPA_AUDIO_FORMAT_U8P, SPA_AUDIO_FORMAT_F32, 0, 0, conv_u8d_to_f32_c },
 
-
 	{ SPA_AUDIO_FORMAT_S16, SPA_AUDIO_FORMAT_F32, 0, 0, conv_s16_to_f32_c },
 	{ SPA_AUDIO_FORMAT_S16P, SPA_AUDIO_FORMAT_F32P, 0, 0, conv_s16d_to_f32d_c },
 #if defined (HAVE_NEON)
 	{ SPA_AUDIO_FORMAT_S16, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_NEON, conv_s16_to_f32d_neon },
 #endif
+#if defined (HAVE_AVX512)
+	{ SPA_AUDIO_FORMAT_S16, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_AVX512, conv_s16_to_f32d_avx512 },
+#endif
 #if defined (HAVE_AVX2)
 	{ SPA_AUDIO_FORMAT_S16, SPA_AUDIO_FORMAT_F32P, 2, SPA_CPU_FLAG_AVX2, conv_s16_to_f32d_2_avx2 },
 	{ SPA_AUDIO_FORMAT_S16, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_AVX2, conv_s16_to_f32d_avx2 },
@@ -71,9 +79,39 @@ static struct conv_info conv_table[] =
 
 	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_F32, 0, 0, conv_copy32_c },
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_F32P, 0, 0, conv_copy32d_c },
+#if defined (HAVE_NEON)
+	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_NEON, conv_deinterleave_32_neon },
+#endif
+#if defined (HAVE_AVX512)
+	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_AVX512, conv_deinterleave_32_avx512 },
+#endif
+#if defined (HAVE_AVX2)
+	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_AVX2, conv_deinterleave_32_avx2 },
+#endif
+#if defined (HAVE_SSE2)
+	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_SSE2, conv_deinterleave_32_sse2 },
+#endif
 	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_F32P, 0, 0, conv_deinterleave_32_c },
+#if defined (HAVE_NEON)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_F32, 0, SPA_CPU_FLAG_NEON, conv_interleave_32_neon },
+#endif
+#if defined (HAVE_AVX512)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_F32, 0, SPA_CPU_FLAG_AVX512, conv_interleave_32_avx512 },
+#endif
+#if defined (HAVE_AVX2)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_F32, 0, SPA_CPU_FLAG_AVX2, conv_interleave_32_avx2 },
+#endif
+#if defined (HAVE_SSE2)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_F32, 0, SPA_CPU_FLAG_SSE2, conv_interleave_32_sse2 },
+#endif
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_F32, 0, 0, conv_interleave_32_c },
 
+#if defined (HAVE_NEON)
+	{ SPA_AUDIO_FORMAT_S32, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_NEON, conv_s32_to_f32d_neon },
+#endif
+#if defined (HAVE_AVX512)
+	{ SPA_AUDIO_FORMAT_S32, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_AVX512, conv_s32_to_f32d_avx512 },
+#endif
 #if defined (HAVE_AVX2)
 	{ SPA_AUDIO_FORMAT_S32, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_AVX2, conv_s32_to_f32d_avx2 },
 #endif
@@ -106,11 +144,29 @@ static struct conv_info conv_table[] =
 
 	{ SPA_AUDIO_FORMAT_S24_32, SPA_AUDIO_FORMAT_F32, 0, 0, conv_s24_32_to_f32_c },
 	{ SPA_AUDIO_FORMAT_S24_32P, SPA_AUDIO_FORMAT_F32P, 0, 0, conv_s24_32d_to_f32d_c },
+#if defined (HAVE_NEON)
+	{ SPA_AUDIO_FORMAT_S24_32, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_NEON, conv_s24_32_to_f32d_neon },
+#endif
+#if defined (HAVE_AVX512)
+	{ SPA_AUDIO_FORMAT_S24_32, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_AVX512, conv_s24_32_to_f32d_avx512 },
+#endif
+#if defined (HAVE_AVX2)
+	{ SPA_AUDIO_FORMAT_S24_32, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_AVX2, conv_s24_32_to_f32d_avx2 },
+#endif
+#if defined (HAVE_SSE2)
+	{ SPA_AUDIO_FORMAT_S24_32, SPA_AUDIO_FORMAT_F32P, 0, SPA_CPU_FLAG_SSE2, conv_s24_32_to_f32d_sse2 },
+#endif
 	{ SPA_AUDIO_FORMAT_S24_32, SPA_AUDIO_FORMAT_F32P, 0, 0, conv_s24_32_to_f32d_c },
 	{ SPA_AUDIO_FORMAT_S24_32P, SPA_AUDIO_FORMAT_F32, 0, 0, conv_s24_32d_to_f32_c },
 
 	/* from f32 */
+#if defined (HAVE_SSE2)
+	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_U8, 0, SPA_CPU_FLAG_SSE2, conv_f32_to_u8_sse2 },
+#endif
 	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_U8, 0, 0, conv_f32_to_u8_c },
+#if defined (HAVE_SSE2)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_U8P, 0, SPA_CPU_FLAG_SSE2, conv_f32d_to_u8d_sse2 },
+#endif
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_U8P, 0, 0, conv_f32d_to_u8d_c },
 	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_U8P, 0, 0, conv_f32_to_u8d_c },
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_U8, 0, 0, conv_f32d_to_u8_c },
@@ -130,6 +186,9 @@ static struct conv_info conv_table[] =
 #if defined (HAVE_NEON)
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16, 0, SPA_CPU_FLAG_NEON, conv_f32d_to_s16_neon },
 #endif
+#if defined (HAVE_AVX512)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16, 0, SPA_CPU_FLAG_AVX512, conv_f32d_to_s16_avx512 },
+#endif
 #if defined (HAVE_AVX2)
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16, 4, SPA_CPU_FLAG_AVX2, conv_f32d_to_s16_4_avx2 },
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S16, 2, SPA_CPU_FLAG_AVX2, conv_f32d_to_s16_2_avx2 },
@@ -144,6 +203,12 @@ static struct conv_info conv_table[] =
 	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_S32, 0, 0, conv_f32_to_s32_c },
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S32P, 0, 0, conv_f32d_to_s32d_c },
 	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_S32P, 0, 0, conv_f32_to_s32d_c },
+#if defined (HAVE_NEON)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S32, 0, SPA_CPU_FLAG_NEON, conv_f32d_to_s32_neon },
+#endif
+#if defined (HAVE_AVX512)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S32, 0, SPA_CPU_FLAG_AVX512, conv_f32d_to_s32_avx512 },
+#endif
 #if defined (HAVE_AVX2)
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S32, 0, SPA_CPU_FLAG_AVX2, conv_f32d_to_s32_avx2 },
 #endif
@@ -162,6 +227,18 @@ static struct conv_info conv_table[] =
 	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_S24_32, 0, 0, conv_f32_to_s24_32_c },
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S24_32P, 0, 0, conv_f32d_to_s24_32d_c },
 	{ SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_S24_32P, 0, 0, conv_f32_to_s24_32d_c },
+#if defined (HAVE_NEON)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S24_32, 0, SPA_CPU_FLAG_NEON, conv_f32d_to_s24_32_neon },
+#endif
+#if defined (HAVE_AVX512)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S24_32, 0, SPA_CPU_FLAG_AVX512, conv_f32d_to_s24_32_avx512 },
+#endif
+#if defined (HAVE_AVX2)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S24_32, 0, SPA_CPU_FLAG_AVX2, conv_f32d_to_s24_32_avx2 },
+#endif
+#if defined (HAVE_SSE2)
+	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S24_32, 0, SPA_CPU_FLAG_SSE2, conv_f32d_to_s24_32_sse2 },
+#endif
 	{ SPA_AUDIO_FORMAT_F32P, SPA_AUDIO_FORMAT_S24_32, 0, 0, conv_f32d_to_s24_32_c },
 
 	/* u8 */
@@ -179,7 +256,31 @@ static struct conv_info conv_table[] =
 	/* s32 */
 	{ SPA_AUDIO_FORMAT_S32, SPA_AUDIO_FORMAT_S32, 0, 0, conv_copy32_c },
 	{ SPA_AUDIO_FORMAT_S32P, SPA_AUDIO_FORMAT_S32P, 0, 0, conv_copy32d_c },
+#if defined (HAVE_NEON)
+	{ SPA_AUDIO_FORMAT_S32, SPA_AUDIO_FORMAT_S32P, 0, SPA_CPU_FLAG_NEON, conv_deinterleave_32_neon },
+#endif
+#if defined (HAVE_AVX512)
+	{ SPA_AUDIO_FORMAT_S32, SPA_AUDIO_FORMAT_S32P, 0, SPA_CPU_FLAG_AVX512, conv_deinterleave_32_avx512 },
+#endif
+#if defined (HAVE_AVX2)
+	{ SPA_AUDIO_FORMAT_S32, SPA_AUDIO_FORMAT_S32P, 0, SPA_CPU_FLAG_AVX2, conv_deinterleave_32_avx2 },
+#endif
+#if defined (HAVE_SSE2)
+	{ SPA_AUDIO_FORMAT_S32, SPA_AUDIO_FORMAT_S32P, 0, SPA_CPU_FLAG_SSE2, conv_deinterleave_32_sse2 },
+#endif
 	{ SPA_AUDIO_FORMAT_S32, SPA_AUDIO_FORMAT_S32P, 0, 0, conv_deinterleave_32_c },
+#if defined (HAVE_NEON)
+	{ SPA_AUDIO_FORMAT_S32P, SPA_AUDIO_FORMAT_S32, 0, SPA_CPU_FLAG_NEON, conv_interleave_32_neon },
+#endif
+#if defined (HAVE_AVX512)
+	{ SPA_AUDIO_FORMAT_S32P, SPA_AUDIO_FORMAT_S32, 0, SPA_CPU_FLAG_AVX512, conv_interleave_32_avx512 },
+#endif
+#if defined (HAVE_AVX2)
+	{ SPA_AUDIO_FORMAT_S32P, SPA_AUDIO_FORMAT_S32, 0, SPA_CPU_FLAG_AVX2, conv_interleave_32_avx2 },
+#endif
+#if defined (HAVE_SSE2)
+	{ SPA_AUDIO_FORMAT_S32P, SPA_AUDIO_FORMAT_S32, 0, SPA_CPU_FLAG_SSE2, conv_interleave_32_sse2 },
+#endif
 	{ SPA_AUDIO_FORMAT_S32P, SPA_AUDIO_FORMAT_S32, 0, 0, conv_interleave_32_c },
 
 	/* s24 */
@@ -191,7 +292,31 @@ static struct conv_info conv_table[] =
 	/* s24_32 */
 	{ SPA_AUDIO_FORMAT_S24_32, SPA_AUDIO_FORMAT_S24_32, 0, 0, conv_copy32_c },
 	{ SPA_AUDIO_FORMAT_S24_32P, SPA_AUDIO_FORMAT_S24_32P, 0, 0, conv_copy32d_c },
+#if defined (HAVE_NEON)
+	{ SPA_AUDIO_FORMAT_S24_32, SPA_AUDIO_FORMAT_S24_32P, 0, SPA_CPU_FLAG_NEON, conv_deinterleave_32_neon },
+#endif
+#if defined (HAVE_AVX512)
+	{ SPA_AUDIO_FORMAT_S24_32, SPA_AUDIO_FORMAT_S24_32P, 0, SPA_CPU_FLAG_AVX512, conv_deinterleave_32_avx512 },
+#endif
+#if defined (HAVE_AVX2)
+	{ SPA_AUDIO_FORMAT_S24_32, SPA_AUDIO_FORMAT_S24_32P, 0, SPA_CPU_FLAG_AVX2, conv_deinterleave_32_avx2 },
+#endif
+#if defined (HAVE_SSE2)
+	{ SPA_AUDIO_FORMAT_S24_32, SPA_AUDIO_FORMAT_S24_32P, 0, SPA_CPU_FLAG_SSE2, conv_deinterleave_32_sse2 },
+#endif
 	{ SPA_AUDIO_FORMAT_S24_32, SPA_AUDIO_FORMAT_S24_32P, 0, 0, conv_deinterleave_32_c },
+#if defined (HAVE_NEON)
+	{ SPA_AUDIO_FORMAT_S24_32P, SPA_AUDIO_FORMAT_S24_32, 0, SPA_CPU_FLAG_NEON, conv_interleave_32_neon },
+#endif
+#if defined (HAVE_AVX512)
+	{ SPA_AUDIO_FORMAT_S24_32P, SPA_AUDIO_FORMAT_S24_32, 0, SPA_CPU_FLAG_AVX512, conv_interleave_32_avx512 },
+#endif
+#if defined (HAVE_AVX2)
+	{ SPA_AUDIO_FORMAT_S24_32P, SPA_AUDIO_FORMAT_S24_32, 0, SPA_CPU_FLAG_AVX2, conv_interleave_32_avx2 },
+#endif
+#if defined (HAVE_SSE2)
+	{ SPA_AUDIO_FORMAT_S24_32P, SPA_AUDIO_FORMAT_S24_32, 0, SPA_CPU_FLAG_SSE2, conv_interleave_32_sse2 },
+#endif
 	{ SPA_AUDIO_FORMAT_S24_32P, SPA_AUDIO_FORMAT_S24_32, 0, 0, conv_interleave_32_c },
 };
 
@@ -25,6 +25,7 @@
 #include <math.h>
 
 #include <spa/utils/defs.h>
+#include <spa/param/audio/raw.h>
 
 #define U8_MIN		0
 #define U8_MAX		255
@@ -101,6 +102,26 @@ static inline void write_s24s(void *dst, int32_t val)
 #endif
 }
 
+/* the size of one sample of one channel */
+static inline int convert_sample_width(uint32_t format)
+{
+	switch (format) {
+	case SPA_AUDIO_FORMAT_U8P:
+	case SPA_AUDIO_FORMAT_U8:
+		return 1;
+	case SPA_AUDIO_FORMAT_S16P:
+	case SPA_AUDIO_FORMAT_S16:
+	case SPA_AUDIO_FORMAT_S16_OE:
+		return 2;
+	case SPA_AUDIO_FORMAT_S24P:
+	case SPA_AUDIO_FORMAT_S24:
+	case SPA_AUDIO_FORMAT_S24_OE:
+		return 3;
+	default:
+		return 4;
+	}
+}
+
 #define MAX_NS	64
 
 struct convert {
@@ -190,6 +211,12 @@ DEFINE_FUNCTION(interleave_32, c);
 #if defined(HAVE_NEON)
 DEFINE_FUNCTION(s16_to_f32d, neon);
 DEFINE_FUNCTION(f32d_to_s16, neon);
+DEFINE_FUNCTION(s24_32_to_f32d, neon);
+DEFINE_FUNCTION(s32_to_f32d, neon);
+DEFINE_FUNCTION(f32d_to_s24_32, neon);
+DEFINE_FUNCTION(f32d_to_s32, neon);
+DEFINE_FUNCTION(deinterleave_32, neon);
+DEFINE_FUNCTION(interleave_32, neon);
 #endif
 #if defined(HAVE_SSE2)
 DEFINE_FUNCTION(s16_to_f32d_2, sse2);
@@ -201,6 +228,14 @@ DEFINE_FUNCTION(f32_to_s16, sse2);
 DEFINE_FUNCTION(f32d_to_s16_2, sse2);
 DEFINE_FUNCTION(f32d_to_s16, sse2);
 DEFINE_FUNCTION(f32d_to_s16d, sse2);
+DEFINE_FUNCTION(s24_32_to_f32d, sse2);
+DEFINE_FUNCTION(f32d_to_s24_32, sse2);
+DEFINE_FUNCTION(deinterleave_32, sse2);
+DEFINE_FUNCTION(interleave_32, sse2);
+DEFINE_FUNCTION(u8_to_f32, sse2);
+DEFINE_FUNCTION(u8d_to_f32d, sse2);
+DEFINE_FUNCTION(f32_to_u8, sse2);
+DEFINE_FUNCTION(f32d_to_u8d, sse2);
 #endif
 #if defined(HAVE_SSSE3)
 DEFINE_FUNCTION(s24_to_f32d, ssse3);
@@ -217,6 +252,20 @@ DEFINE_FUNCTION(f32d_to_s32, avx2);
 DEFINE_FUNCTION(f32d_to_s16_4, avx2);
 DEFINE_FUNCTION(f32d_to_s16_2, avx2);
 DEFINE_FUNCTION(f32d_to_s16, avx2);
+DEFINE_FUNCTION(s24_32_to_f32d, avx2);
+DEFINE_FUNCTION(f32d_to_s24_32, avx2);
+DEFINE_FUNCTION(deinterleave_32, avx2);
+DEFINE_FUNCTION(interleave_32, avx2);
+#endif
+#if defined(HAVE_AVX512)
+DEFINE_FUNCTION(s16_to_f32d, avx512);
+DEFINE_FUNCTION(s24_32_to_f32d, avx512);
+DEFINE_FUNCTION(s32_to_f32d, avx512);
+DEFINE_FUNCTION(f32d_to_s16, avx512);
+DEFINE_FUNCTION(f32d_to_s24_32, avx512);
+DEFINE_FUNCTION(f32d_to_s32, avx512);
+DEFINE_FUNCTION(deinterleave_32, avx512);
+DEFINE_FUNCTION(interleave_32, avx512);
 #endif
 
 #undef DEFINE_FUNCTION
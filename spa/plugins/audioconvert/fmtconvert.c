@@ -344,6 +344,22 @@ static int int32_cmp(const void *v1, const void *v2)
 	return a1 - a2;
 }
 
+/* interleaved passthrough can't reorder the channels, check if the
+ * positions are already in the order we announce them */
+static bool is_sorted(struct spa_audio_info *info)
+{
+	uint32_t i;
+
+	if (SPA_FLAG_IS_SET(info->info.raw.flags, SPA_AUDIO_FLAG_UNPOSITIONED))
+		return true;
+	for (i = 1; i < info->info.raw.channels; i++) {
+		if (int32_cmp(&info->info.raw.position[i - 1],
+				&info->info.raw.position[i]) > 0)
+			return false;
+	}
+	return true;
+}
+
 static int port_enum_formats(void *object,
 			     enum spa_direction direction, uint32_t port_id,
 			     uint32_t index,
@@ -366,6 +382,7 @@ static int port_enum_formats(void *object,
 		else {
 			struct spa_pod_frame f;
 			struct spa_audio_info info;
+			uint32_t format;
 
 			spa_pod_builder_push_object(builder, &f,
 				SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat);
@@ -380,12 +397,17 @@ static int port_enum_formats(void *object,
 			else
 				info.info.raw.format = SPA_AUDIO_FORMAT_F32P;
 
+			format = info.info.raw.format;
+			if (other->have_format && SPA_AUDIO_FORMAT_IS_INTERLEAVED(format) &&
+			    !is_sorted(&info))
+				format = SPA_AUDIO_FORMAT_F32P;
+
 			if (!other->have_format ||
 			    info.info.raw.format == SPA_AUDIO_FORMAT_F32P ||
 			    info.info.raw.format == SPA_AUDIO_FORMAT_F32) {
 				spa_pod_builder_add(builder,
 					SPA_FORMAT_AUDIO_format,   SPA_POD_CHOICE_ENUM_Id(14,
-								info.info.raw.format,
+								format,
 								SPA_AUDIO_FORMAT_F32P,
 								SPA_AUDIO_FORMAT_F32,
 								SPA_AUDIO_FORMAT_S32P,
@@ -403,7 +425,7 @@ static int port_enum_formats(void *object,
 			} else {
 				spa_pod_builder_add(builder,
 					SPA_FORMAT_AUDIO_format,   SPA_POD_CHOICE_ENUM_Id(4,
-								info.info.raw.format,
+								format,
 								info.info.raw.format,
 								SPA_AUDIO_FORMAT_F32,
 								SPA_AUDIO_FORMAT_F32P),
@@ -562,25 +584,6 @@ impl_node_port_enum_params(void *object, int seq,
 	return 0;
 }
 
-static int calc_width(struct spa_audio_info *info)
-{
-	switch (info->info.raw.format) {
-	case SPA_AUDIO_FORMAT_U8P:
-	case SPA_AUDIO_FORMAT_U8:
-		return 1;
-	case SPA_AUDIO_FORMAT_S16P:
-	case SPA_AUDIO_FORMAT_S16:
-	case SPA_AUDIO_FORMAT_S16_OE:
-		return 2;
-	case SPA_AUDIO_FORMAT_S24P:
-	case SPA_AUDIO_FORMAT_S24:
-	case SPA_AUDIO_FORMAT_S24_OE:
-		return 3;
-	default:
-		return 4;
-	}
-}
-
 static int clear_buffers(struct impl *this, struct port *port)
 {
 	if (port->n_buffers > 0) {
@@ -632,7 +635,7 @@ static int port_set_format(void *object,
 				return -ENOTSUP;
 		}
 
-		port->stride = calc_width(&info);
+		port->stride = convert_sample_width(info.info.raw.format);
 
 		if (SPA_AUDIO_FORMAT_IS_PLANAR(info.info.raw.format)) {
 			port->blocks = info.info.raw.channels;
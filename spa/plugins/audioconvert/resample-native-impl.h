@@ -57,6 +57,7 @@ struct native_data {
 	float *filter;
 	float *hist_mem;
 	const struct resample_info *info;
+	struct native_filter *shared;
 };
 
 #define DEFINE_RESAMPLER(type,arch)						\
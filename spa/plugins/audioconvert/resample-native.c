@@ -23,8 +23,10 @@
  */
 
 #include <errno.h>
+#include <pthread.h>
 
 #include <spa/param/audio/format.h>
+#include <spa/utils/list.h>
 
 #include "resample-native-impl.h"
 
@@ -51,6 +53,31 @@ static const struct quality blackman_qualities[] = {
 	{ 1024, 0.998, },
 };
 
+/* filters only depend on the rates, quality and cutoff and are shared
+ * read-only between all resamplers in the process */
+struct native_filter {
+	struct spa_list link;
+	int ref;
+	uint32_t in_rate;
+	uint32_t out_rate;
+	int quality;
+	double cutoff;
+	uint32_t n_taps;
+	uint32_t n_phases;
+	uint32_t stride;
+	float *taps;
+};
+
+static struct {
+	pthread_mutex_t lock;
+	struct spa_list filters;
+	uint32_t hits;
+	uint32_t misses;
+} filter_cache = {
+	.lock = PTHREAD_MUTEX_INITIALIZER,
+	.filters = { &filter_cache.filters, &filter_cache.filters },
+};
+
 static inline double sinc(double x)
 {
 	if (x < 1e-6) return 1.0;
@@ -144,10 +171,66 @@ static const struct resample_info *find_resample_info(uint32_t format, uint32_t
 	return NULL;
 }
 
+static struct native_filter *acquire_filter(struct resample *r, uint32_t in_rate,
+		uint32_t out_rate, double cutoff, uint32_t n_taps, uint32_t n_phases,
+		uint32_t stride)
+{
+	struct native_filter *f;
+
+	pthread_mutex_lock(&filter_cache.lock);
+	spa_list_for_each(f, &filter_cache.filters, link) {
+		if (f->in_rate == in_rate && f->out_rate == out_rate &&
+		    f->quality == r->quality && f->cutoff == cutoff) {
+			f->ref++;
+			filter_cache.hits++;
+			goto done;
+		}
+	}
+
+	f = calloc(1, sizeof(struct native_filter) + stride * (n_phases + 1) + 64);
+	if (f == NULL)
+		goto done;
+
+	f->ref = 1;
+	f->in_rate = in_rate;
+	f->out_rate = out_rate;
+	f->quality = r->quality;
+	f->cutoff = cutoff;
+	f->n_taps = n_taps;
+	f->n_phases = n_phases;
+	f->stride = stride;
+	f->taps = SPA_MEMBER_ALIGN(f, sizeof(struct native_filter), 64, float);
+
+	build_filter(f->taps, stride / sizeof(float), n_taps, n_phases, cutoff);
+
+	spa_list_append(&filter_cache.filters, &f->link);
+	filter_cache.misses++;
+done:
+	spa_log_debug(r->log, "native %p: filter %p in:%d out:%d q:%d hits:%u misses:%u",
+			r, f, in_rate, out_rate, r->quality,
+			filter_cache.hits, filter_cache.misses);
+	pthread_mutex_unlock(&filter_cache.lock);
+	return f;
+}
+
+static void release_filter(struct native_filter *f)
+{
+	pthread_mutex_lock(&filter_cache.lock);
+	if (--f->ref == 0) {
+		spa_list_remove(&f->link);
+		free(f);
+	}
+	pthread_mutex_unlock(&filter_cache.lock);
+}
+
 static void impl_native_free(struct resample *r)
 {
+	struct native_data *d = r->data;
+
 	spa_log_debug(r->log, "native %p: free", r);
-	free(r->data);
+	if (d && d->shared)
+		release_filter(d->shared);
+	free(d);
 	r->data = NULL;
 }
 
@@ -323,7 +406,7 @@ int resample_native_init(struct resample *r)
 	struct native_data *d;
 	const struct quality *q;
 	double scale;
-	uint32_t c, n_taps, n_phases, filter_size, in_rate, out_rate, gcd, filter_stride;
+	uint32_t c, n_taps, n_phases, in_rate, out_rate, gcd, filter_stride;
 	uint32_t history_stride, history_size, oversample;
 
 	r->quality = SPA_CLAMP(r->quality, 0, (int) SPA_N_ELEMENTS(blackman_qualities) - 1);
@@ -352,12 +435,10 @@ int resample_native_init(struct resample *r)
 	n_phases *= oversample;
 
 	filter_stride = SPA_ROUND_UP_N(n_taps * sizeof(float), 64);
-	filter_size = filter_stride * (n_phases + 1);
 	history_stride = SPA_ROUND_UP_N(2 * n_taps * sizeof(float), 64);
 	history_size = r->channels * history_stride;
 
 	d = calloc(1, sizeof(struct native_data) +
-			filter_size +
 			history_size +
 			(r->channels * sizeof(float*)) +
 			64);
@@ -365,21 +446,26 @@ int resample_native_init(struct resample *r)
 	if (d == NULL)
 		return -errno;
 
+	d->shared = acquire_filter(r, in_rate, out_rate, scale,
+			n_taps, n_phases, filter_stride);
+	if (d->shared == NULL) {
+		free(d);
+		return -ENOMEM;
+	}
+
 	r->data = d;
 	d->n_taps = n_taps;
 	d->n_phases = n_phases;
 	d->in_rate = in_rate;
 	d->out_rate = out_rate;
-	d->filter = SPA_MEMBER_ALIGN(d, sizeof(struct native_data), 64, float);
-	d->hist_mem = SPA_MEMBER_ALIGN(d->filter, filter_size, 64, float);
+	d->filter = d->shared->taps;
+	d->hist_mem = SPA_MEMBER_ALIGN(d, sizeof(struct native_data), 64, float);
 	d->history = SPA_MEMBER(d->hist_mem, history_size, float*);
 	d->filter_stride = filter_stride / sizeof(float);
 	d->filter_stride_os = d->filter_stride * oversample;
 	for (c = 0; c < r->channels; c++)
 		d->history[c] = SPA_MEMBER(d->hist_mem, c * history_stride, float);
 
-	build_filter(d->filter, d->filter_stride, n_taps, n_phases, scale);
-
 	d->info = find_resample_info(SPA_AUDIO_FORMAT_F32, r->cpu_flags);
 
 	spa_log_debug(r->log, "native %p: q:%d in:%d out:%d n_taps:%d n_phases:%d features:%08x:%08x",
@@ -28,6 +28,7 @@
 #include <unistd.h>
 #include <errno.h>
 #include <time.h>
+#include <math.h>
 
 #include <spa/utils/names.h>
 #include <spa/support/plugin.h>
@@ -35,9 +36,14 @@
 #include <spa/param/audio/format.h>
 #include <spa/param/audio/format-utils.h>
 #include <spa/node/node.h>
+#include <spa/node/io.h>
+#include <spa/param/props.h>
+#include <spa/control/control.h>
 #include <spa/debug/mem.h>
 #include <spa/support/log-impl.h>
 
+#include "fmt-ops.h"
+
 SPA_LOG_IMPL(logger);
 
 extern const struct spa_handle_factory test_source_factory;
@@ -509,6 +515,234 @@ static int test_set_in_format2(struct context *ctx)
 	return 0;
 }
 
+#define FUSE_SAMPLES	4000
+#define FUSE_CHANNELS	6
+
+struct fuse_port {
+	struct spa_buffer buffer;
+	struct spa_data datas[FUSE_CHANNELS];
+	struct spa_chunk chunks[FUSE_CHANNELS];
+	struct spa_buffer *buffers[1];
+	struct spa_io_buffers io;
+};
+
+struct fuse_node {
+	struct spa_handle *handle;
+	struct spa_node *node;
+};
+
+static uint8_t fuse_in[FUSE_SAMPLES * FUSE_CHANNELS * sizeof(float)] SPA_ALIGNED(16);
+static float fuse_link[FUSE_CHANNELS][FUSE_SAMPLES] SPA_ALIGNED(16);
+static float fuse_out[2][FUSE_CHANNELS][FUSE_SAMPLES] SPA_ALIGNED(16);
+static uint8_t fuse_ctrl[1024] SPA_ALIGNED(16);
+
+static const uint32_t fuse_positions[FUSE_CHANNELS] = {
+	SPA_AUDIO_CHANNEL_FL, SPA_AUDIO_CHANNEL_FR,
+	SPA_AUDIO_CHANNEL_FC, SPA_AUDIO_CHANNEL_LFE,
+	SPA_AUDIO_CHANNEL_SL, SPA_AUDIO_CHANNEL_SR,
+};
+
+static void fuse_node_init(struct fuse_node *n, const char *name)
+{
+	const struct spa_handle_factory *factory;
+	void *iface;
+
+	factory = find_factory(name);
+	spa_assert(factory != NULL);
+	n->handle = calloc(1, spa_handle_factory_get_size(factory, NULL));
+	spa_assert(n->handle != NULL);
+	spa_assert(spa_handle_factory_init(factory, n->handle, NULL, NULL, 0) >= 0);
+	spa_assert(spa_handle_get_interface(n->handle, SPA_TYPE_INTERFACE_Node, &iface) >= 0);
+	n->node = iface;
+}
+
+static void fuse_node_clear(struct fuse_node *n)
+{
+	spa_handle_clear(n->handle);
+	free(n->handle);
+}
+
+static void fuse_set_format(struct spa_node *node, enum spa_direction direction,
+		uint32_t format, uint32_t channels)
+{
+	uint8_t buffer[1024];
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+	struct spa_audio_info_raw info;
+
+	spa_zero(info);
+	info.format = format;
+	info.rate = 48000;
+	info.channels = channels;
+	memcpy(info.position, fuse_positions, channels * sizeof(uint32_t));
+
+	spa_assert(spa_node_port_set_param(node, direction, 0, SPA_PARAM_Format, 0,
+			spa_format_audio_raw_build(&b, SPA_PARAM_Format, &info)) == 0);
+}
+
+static void fuse_use_buffer(struct spa_node *node, enum spa_direction direction,
+		uint32_t port_id, struct fuse_port *p)
+{
+	spa_assert(spa_node_port_use_buffers(node, direction, port_id, 0, p->buffers, 1) == 0);
+	p->io = SPA_IO_BUFFERS_INIT;
+	spa_assert(spa_node_port_set_io(node, direction, port_id,
+			SPA_IO_Buffers, &p->io, sizeof(p->io)) == 0);
+}
+
+static void fuse_port_init(struct fuse_port *p, uint32_t n_datas, void *data, uint32_t maxsize)
+{
+	uint32_t i;
+
+	spa_zero(*p);
+	for (i = 0; i < n_datas; i++) {
+		p->datas[i].type = SPA_DATA_MemPtr;
+		p->datas[i].flags = SPA_DATA_FLAG_DYNAMIC;
+		p->datas[i].maxsize = maxsize;
+		p->datas[i].data = SPA_MEMBER(data, i * maxsize, void);
+		p->datas[i].chunk = &p->chunks[i];
+	}
+	p->buffer.n_datas = n_datas;
+	p->buffer.datas = p->datas;
+	p->buffers[0] = &p->buffer;
+}
+
+/* the channelmix node with a control port taking the shared volume changes */
+static void fuse_mix_init(struct fuse_node *mix, uint32_t src_fmt, uint32_t src_chan,
+		uint32_t dst_chan, struct fuse_port *in, struct fuse_port *out,
+		struct fuse_port *ctrl, bool use_ctrl)
+{
+	uint8_t buffer[256];
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+
+	fuse_node_init(mix, SPA_NAME_AUDIO_PROCESS_CHANNELMIX);
+	fuse_set_format(mix->node, SPA_DIRECTION_INPUT, src_fmt, src_chan);
+	fuse_set_format(mix->node, SPA_DIRECTION_OUTPUT, SPA_AUDIO_FORMAT_F32P, dst_chan);
+	fuse_use_buffer(mix->node, SPA_DIRECTION_INPUT, 0, in);
+	fuse_use_buffer(mix->node, SPA_DIRECTION_OUTPUT, 0, out);
+
+	if (use_ctrl) {
+		spa_assert(spa_node_port_set_param(mix->node, SPA_DIRECTION_INPUT, 1,
+				SPA_PARAM_Format, 0,
+				spa_pod_builder_add_object(&b,
+					SPA_TYPE_OBJECT_Format, SPA_PARAM_Format,
+					SPA_FORMAT_mediaType,	 SPA_POD_Id(SPA_MEDIA_TYPE_application),
+					SPA_FORMAT_mediaSubtype, SPA_POD_Id(SPA_MEDIA_SUBTYPE_control))) >= 0);
+		fuse_use_buffer(mix->node, SPA_DIRECTION_INPUT, 1, ctrl);
+		ctrl->io.status = SPA_STATUS_HAVE_DATA;
+		ctrl->io.buffer_id = 0;
+	}
+	spa_node_send_command(mix->node, &SPA_NODE_COMMAND_INIT(SPA_NODE_COMMAND_Start));
+}
+
+static void fuse_build_ctrl(struct fuse_port *ctrl)
+{
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(fuse_ctrl, sizeof(fuse_ctrl));
+	struct spa_pod_frame f;
+	static const struct {
+		uint32_t offset;
+		float volume;
+	} points[] = { { 0, 0.5f }, { 1001, 0.25f }, { 2500, 1.0f }, { 3999, 0.75f } };
+	uint32_t i;
+
+	spa_pod_builder_push_sequence(&b, &f, 0);
+	for (i = 0; i < SPA_N_ELEMENTS(points); i++) {
+		spa_pod_builder_control(&b, points[i].offset, SPA_CONTROL_Properties);
+		spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_Props, 0,
+			SPA_PROP_volume, SPA_POD_Float(points[i].volume));
+	}
+	spa_pod_builder_pop(&b, &f);
+
+	fuse_port_init(ctrl, 1, fuse_ctrl, sizeof(fuse_ctrl));
+	ctrl->chunks[0].size = b.state.offset;
+}
+
+/* the channelmix node unpacking interleaved input itself must produce the
+ * same output as the format converter followed by the channelmix node */
+static void run_fuse(uint32_t src_fmt, uint32_t src_chan, uint32_t dst_chan,
+		bool use_ctrl)
+{
+	struct fuse_node convert, mix[2];
+	struct fuse_port in, link, out[2], ctrl[2];
+	uint32_t i, j, in_size;
+
+	in_size = FUSE_SAMPLES * convert_sample_width(src_fmt) * src_chan;
+
+	for (i = 0; i < in_size; i++)
+		fuse_in[i] = rand();
+	if (src_fmt == SPA_AUDIO_FORMAT_F32) {
+		float *f = (float *)fuse_in;
+		for (i = 0; i < FUSE_SAMPLES * src_chan; i++)
+			f[i] = drand48() * 2.0 - 1.0;
+	}
+	memset(fuse_out, 0, sizeof(fuse_out));
+
+	fuse_port_init(&in, 1, fuse_in, sizeof(fuse_in));
+	in.chunks[0].size = in_size;
+	fuse_port_init(&link, src_chan, fuse_link, sizeof(fuse_link[0]));
+	for (i = 0; i < 2; i++) {
+		fuse_port_init(&out[i], dst_chan, fuse_out[i], sizeof(fuse_out[i][0]));
+		fuse_build_ctrl(&ctrl[i]);
+	}
+
+	/* chained */
+	fuse_node_init(&convert, SPA_NAME_AUDIO_PROCESS_FORMAT);
+	fuse_set_format(convert.node, SPA_DIRECTION_INPUT, src_fmt, src_chan);
+	fuse_set_format(convert.node, SPA_DIRECTION_OUTPUT, SPA_AUDIO_FORMAT_F32P, src_chan);
+	fuse_use_buffer(convert.node, SPA_DIRECTION_INPUT, 0, &in);
+	fuse_use_buffer(convert.node, SPA_DIRECTION_OUTPUT, 0, &link);
+	spa_node_send_command(convert.node, &SPA_NODE_COMMAND_INIT(SPA_NODE_COMMAND_Start));
+	fuse_mix_init(&mix[0], SPA_AUDIO_FORMAT_F32P, src_chan, dst_chan,
+			&link, &out[0], &ctrl[0], use_ctrl);
+
+	in.io.status = SPA_STATUS_HAVE_DATA;
+	in.io.buffer_id = 0;
+	spa_node_process(convert.node);
+	spa_assert(link.io.status == SPA_STATUS_HAVE_DATA);
+	spa_node_process(mix[0].node);
+	spa_assert(out[0].io.status == SPA_STATUS_HAVE_DATA);
+
+	/* fused, the same input buffer is given to the channelmix node */
+	fuse_mix_init(&mix[1], src_fmt, src_chan, dst_chan,
+			&in, &out[1], &ctrl[1], use_ctrl);
+
+	in.io.status = SPA_STATUS_HAVE_DATA;
+	in.io.buffer_id = 0;
+	spa_node_process(mix[1].node);
+	spa_assert(out[1].io.status == SPA_STATUS_HAVE_DATA);
+
+	for (i = 0; i < dst_chan; i++) {
+		const float *c = out[0].datas[i].data, *f = out[1].datas[i].data;
+
+		spa_assert(out[0].chunks[i].size == FUSE_SAMPLES * sizeof(float));
+		spa_assert(out[1].chunks[i].size == FUSE_SAMPLES * sizeof(float));
+		for (j = 0; j < FUSE_SAMPLES; j++) {
+			if (fabsf(c[j] - f[j]) > 1e-6f) {
+				fprintf(stderr, "fuse %d %d->%d ctrl:%d: %d.%d %f != %f\n",
+						src_fmt, src_chan, dst_chan, use_ctrl,
+						i, j, c[j], f[j]);
+				spa_assert_not_reached();
+			}
+		}
+	}
+
+	fuse_node_clear(&mix[1]);
+	fuse_node_clear(&mix[0]);
+	fuse_node_clear(&convert);
+}
+
+static void test_fuse(void)
+{
+	/* identity, the input is unpacked straight into the output */
+	run_fuse(SPA_AUDIO_FORMAT_S16, 2, 2, false);
+	run_fuse(SPA_AUDIO_FORMAT_F32, 6, 6, false);
+	/* blocks of 1360 samples for 6 channels, the last one is short */
+	run_fuse(SPA_AUDIO_FORMAT_S16, 6, 2, false);
+	run_fuse(SPA_AUDIO_FORMAT_S32, 6, 2, false);
+	/* control points split the input at odd offsets */
+	run_fuse(SPA_AUDIO_FORMAT_S24, 2, 2, true);
+	run_fuse(SPA_AUDIO_FORMAT_F32, 6, 2, true);
+}
+
 int main(int argc, char *argv[])
 {
 	struct context ctx;
@@ -532,5 +766,7 @@ int main(int argc, char *argv[])
 
 	clean_context(&ctx);
 
+	test_fuse();
+
 	return 0;
 }
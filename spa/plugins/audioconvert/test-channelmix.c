@@ -22,6 +22,8 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include "config.h"
+
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -32,8 +34,14 @@
 #include <spa/support/log-impl.h>
 #include <spa/debug/mem.h>
 
+#include "test-helper.h"
+
 SPA_LOG_IMPL(logger);
 
+#define N_SAMPLES	253
+
+static uint32_t cpu_flags;
+
 #define MATRIX(...) (float[]) { __VA_ARGS__ }
 
 #include "channelmix-ops.c"
@@ -199,10 +207,136 @@ static void test_7p1_N(void)
 			       0.0, 1.0, 0.707107, 0.0, 0.0, 0.707107, 0.0, 0.707107));
 }
 
+enum {
+	MATRIX_RANDOM,
+	MATRIX_SPARSE,
+	MATRIX_EQUAL,
+	MATRIX_COPY,
+	MATRIX_ZERO,
+	MATRIX_LAST,
+};
+
+static void check_process(const struct channelmix_info *info, const struct channelmix_info *ref,
+		uint32_t src_chan, uint32_t dst_chan, uint32_t type)
+{
+	struct channelmix mix, mix_ref;
+	float src[src_chan][N_SAMPLES];
+	float out[dst_chan][N_SAMPLES], out_ref[dst_chan][N_SAMPLES];
+	const void *sp[src_chan];
+	void *op[dst_chan], *op_ref[dst_chan];
+	uint32_t i, j, n;
+
+	spa_zero(mix);
+	mix.src_chan = src_chan;
+	mix.dst_chan = dst_chan;
+	mix.log = &logger.log;
+
+	for (i = 0; i < dst_chan; i++) {
+		for (j = 0; j < src_chan; j++) {
+			float v;
+			switch (type) {
+			case MATRIX_RANDOM:
+				v = drand48() * 2.0f - 0.5f;
+				break;
+			case MATRIX_SPARSE:
+				v = (random() & 1) ? drand48() : 0.0f;
+				break;
+			case MATRIX_EQUAL:
+				v = 0.5f;
+				break;
+			case MATRIX_COPY:
+				v = i == j ? 1.0f : 0.0f;
+				break;
+			default:
+				v = 0.0f;
+				break;
+			}
+			mix.matrix[i][j] = v;
+		}
+		lr4_set(&mix.lr4[i], BQ_LOWPASS, 0.01f);
+	}
+	/* no channel volumes, this just updates the flags */
+	impl_channelmix_set_volume(&mix, 1.0f, false, 0, NULL);
+	mix_ref = mix;
+
+	for (j = 0; j < src_chan; j++) {
+		for (n = 0; n < N_SAMPLES; n++)
+			src[j][n] = drand48() * 2.0f - 1.0f;
+		sp[j] = src[j];
+	}
+	for (i = 0; i < dst_chan; i++) {
+		for (n = 0; n < N_SAMPLES; n++)
+			out[i][n] = out_ref[i][n] = 1.0f;
+		op[i] = out[i];
+		op_ref[i] = out_ref[i];
+	}
+
+	info->process(&mix, dst_chan, op, src_chan, sp, N_SAMPLES);
+	ref->process(&mix_ref, dst_chan, op_ref, src_chan, sp, N_SAMPLES);
+
+	for (i = 0; i < dst_chan; i++) {
+		for (n = 0; n < N_SAMPLES; n++) {
+			float a = out[i][n], b = out_ref[i][n];
+			if (fabsf(a - b) > 1e-5f * (1.0f + fabsf(b))) {
+				fprintf(stderr, "%d->%d type %d: %d %d: %f != %f\n",
+						src_chan, dst_chan, type, i, n, a, b);
+				spa_assert_not_reached();
+			}
+		}
+	}
+}
+
+static const struct channelmix_info *find_ref(const struct channelmix_info *info)
+{
+	size_t i;
+	for (i = 0; i < SPA_N_ELEMENTS(channelmix_table); i++) {
+		const struct channelmix_info *t = &channelmix_table[i];
+		if (t->cpu_flags == 0 &&
+		    t->src_chan == info->src_chan && t->src_mask == info->src_mask &&
+		    t->dst_chan == info->dst_chan && t->dst_mask == info->dst_mask)
+			return t;
+	}
+	return NULL;
+}
+
+static void test_process(void)
+{
+	static const uint32_t n_m[][2] = { { 16, 8 }, { 12, 2 }, { 3, 5 }, { 1, 1 } };
+	static const uint32_t eq[] = { 1, 2, 5, 16 };
+	size_t i, k;
+	uint32_t type;
+
+	for (i = 0; i < SPA_N_ELEMENTS(channelmix_table); i++) {
+		const struct channelmix_info *info = &channelmix_table[i], *ref;
+
+		if (info->cpu_flags == 0 ||
+		    !MATCH_CPU_FLAGS(info->cpu_flags, cpu_flags))
+			continue;
+
+		ref = find_ref(info);
+		spa_assert(ref != NULL);
+
+		for (type = 0; type < MATRIX_LAST; type++) {
+			if (info->src_chan == ANY) {
+				for (k = 0; k < SPA_N_ELEMENTS(n_m); k++)
+					check_process(info, ref, n_m[k][0], n_m[k][1], type);
+			} else if (info->src_chan == EQ) {
+				for (k = 0; k < SPA_N_ELEMENTS(eq); k++)
+					check_process(info, ref, eq[k], eq[k], type);
+			} else {
+				check_process(info, ref, info->src_chan, info->dst_chan, type);
+			}
+		}
+	}
+}
+
 int main(int argc, char *argv[])
 {
 	logger.log.level = SPA_LOG_LEVEL_TRACE;
 
+	cpu_flags = get_cpu_flags();
+	printf("got get CPU flags %d\n", cpu_flags);
+
 	test_1_N();
 	test_N_1();
 	test_3p1_N();
@@ -210,5 +344,8 @@ int main(int argc, char *argv[])
 	test_5p1_N();
 	test_7p1_N();
 
+	logger.log.level = SPA_LOG_LEVEL_WARN;
+	test_process();
+
 	return 0;
 }
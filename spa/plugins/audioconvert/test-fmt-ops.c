@@ -135,6 +135,18 @@ static void test_f32_u8(void)
 			true, false, conv_f32_to_u8d_c);
 	run_test("test_f32d_u8d", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
 			false, false, conv_f32d_to_u8d_c);
+#if defined(HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2) {
+		run_test("test_f32_u8_sse2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, true, conv_f32_to_u8_sse2);
+	}
+#endif
+#if defined(HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2) {
+		run_test("test_f32d_u8d_sse2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, false, conv_f32d_to_u8d_sse2);
+	}
+#endif
 }
 
 static void test_u8_f32(void)
@@ -150,6 +162,18 @@ static void test_u8_f32(void)
 			true, false, conv_u8_to_f32d_c);
 	run_test("test_u8d_f32d", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
 			false, false, conv_u8d_to_f32d_c);
+#if defined(HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2) {
+		run_test("test_u8_f32_sse2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, true, conv_u8_to_f32_sse2);
+	}
+#endif
+#if defined(HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2) {
+		run_test("test_u8d_f32d_sse2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, false, conv_u8d_to_f32d_sse2);
+	}
+#endif
 }
 
 static void test_f32_s16(void)
@@ -171,6 +195,18 @@ static void test_f32_s16(void)
 			false, true, conv_f32d_to_s16_sse2);
 	}
 #endif
+#if defined(HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_f32d_s16_avx2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, true, conv_f32d_to_s16_avx2);
+	}
+#endif
+#if defined(HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_f32d_s16_avx512", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, true, conv_f32d_to_s16_avx512);
+	}
+#endif
 }
 
 static void test_s16_f32(void)
@@ -192,6 +228,18 @@ static void test_s16_f32(void)
 			true, false, conv_s16_to_f32d_sse2);
 	}
 #endif
+#if defined(HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_s16_f32d_avx2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_s16_to_f32d_avx2);
+	}
+#endif
+#if defined(HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_s16_f32d_avx512", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_s16_to_f32d_avx512);
+	}
+#endif
 }
 
 static void test_f32_s32(void)
@@ -214,6 +262,24 @@ static void test_f32_s32(void)
 			false, true, conv_f32d_to_s32_sse2);
 	}
 #endif
+#if defined(HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_f32d_s32_avx2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, true, conv_f32d_to_s32_avx2);
+	}
+#endif
+#if defined(HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_f32d_s32_avx512", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, true, conv_f32d_to_s32_avx512);
+	}
+#endif
+#if defined(HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON) {
+		run_test("test_f32d_s32_neon", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, true, conv_f32d_to_s32_neon);
+	}
+#endif
 }
 
 static void test_s32_f32(void)
@@ -235,6 +301,24 @@ static void test_s32_f32(void)
 			true, false, conv_s32_to_f32d_sse2);
 	}
 #endif
+#if defined(HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_s32_f32d_avx2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_s32_to_f32d_avx2);
+	}
+#endif
+#if defined(HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_s32_f32d_avx512", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_s32_to_f32d_avx512);
+	}
+#endif
+#if defined(HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON) {
+		run_test("test_s32_f32d_neon", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_s32_to_f32d_neon);
+	}
+#endif
 }
 
 static void test_f32_s24(void)
@@ -311,6 +395,30 @@ static void test_f32_s24_32(void)
 			true, false, conv_f32_to_s24_32d_c);
 	run_test("test_f32d_s24_32d", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
 			false, false, conv_f32d_to_s24_32d_c);
+#if defined(HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2) {
+		run_test("test_f32d_s24_32_sse2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, true, conv_f32d_to_s24_32_sse2);
+	}
+#endif
+#if defined(HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_f32d_s24_32_avx2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, true, conv_f32d_to_s24_32_avx2);
+	}
+#endif
+#if defined(HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_f32d_s24_32_avx512", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, true, conv_f32d_to_s24_32_avx512);
+	}
+#endif
+#if defined(HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON) {
+		run_test("test_f32d_s24_32_neon", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			false, true, conv_f32d_to_s24_32_neon);
+	}
+#endif
 }
 
 static void test_s24_32_f32(void)
@@ -326,6 +434,30 @@ static void test_s24_32_f32(void)
 			true, true, conv_s24_32_to_f32_c);
 	run_test("test_s24_32d_f32d", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
 			false, false, conv_s24_32d_to_f32d_c);
+#if defined(HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2) {
+		run_test("test_s24_32_f32d_sse2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_s24_32_to_f32d_sse2);
+	}
+#endif
+#if defined(HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_s24_32_f32d_avx2", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_s24_32_to_f32d_avx2);
+	}
+#endif
+#if defined(HAVE_AVX512)
+	if (cpu_flags & SPA_CPU_FLAG_AVX512) {
+		run_test("test_s24_32_f32d_avx512", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_s24_32_to_f32d_avx512);
+	}
+#endif
+#if defined(HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON) {
+		run_test("test_s24_32_f32d_neon", in, sizeof(in[0]), out, sizeof(out[0]), SPA_N_ELEMENTS(out),
+			true, false, conv_s24_32_to_f32d_neon);
+	}
+#endif
 }
 
 int main(int argc, char *argv[])
@@ -35,6 +35,7 @@
 SPA_LOG_IMPL(logger);
 
 #include "resample.h"
+#include "resample-native-impl.h"
 
 #define N_SAMPLES	253
 #define N_CHANNELS	11
@@ -166,12 +167,49 @@ static void test_in_len(void)
 	resample_free(&r);
 }
 
+static void init_native(struct resample *r, uint32_t i_rate, uint32_t o_rate, int quality)
+{
+	spa_zero(*r);
+	r->log = &logger.log;
+	r->channels = 1;
+	r->i_rate = i_rate;
+	r->o_rate = o_rate;
+	r->quality = quality;
+	spa_assert(resample_native_init(r) == 0);
+}
+
+static void test_shared_filter(void)
+{
+	struct resample r1, r2, r3;
+	struct native_data *d1, *d2, *d3;
+
+	init_native(&r1, 44100, 48000, RESAMPLE_DEFAULT_QUALITY);
+	init_native(&r2, 88200, 96000, RESAMPLE_DEFAULT_QUALITY);
+	init_native(&r3, 44100, 48000, RESAMPLE_DEFAULT_QUALITY + 1);
+	d1 = r1.data;
+	d2 = r2.data;
+	d3 = r3.data;
+
+	/* same reduced rates and quality share the filter */
+	spa_assert(d1->filter == d2->filter);
+	spa_assert(d1->filter != d3->filter);
+	spa_assert(SPA_IS_ALIGNED(d1->filter, 64));
+	spa_assert(SPA_IS_ALIGNED(d3->filter, 64));
+	spa_assert(d1->hist_mem != d2->hist_mem);
+
+	resample_free(&r1);
+	pull_blocks(&r2, 1024, 1024);
+	resample_free(&r2);
+	resample_free(&r3);
+}
+
 int main(int argc, char *argv[])
 {
 	logger.log.level = SPA_LOG_LEVEL_TRACE;
 
 	test_native();
 	test_in_len();
+	test_shared_filter();
 
 	return 0;
 }
@@ -322,10 +322,14 @@ static int port_enum_formats(void *object,
 				SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat,
 				SPA_FORMAT_mediaType,      SPA_POD_Id(SPA_MEDIA_TYPE_audio),
 				SPA_FORMAT_mediaSubtype,   SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw),
-				SPA_FORMAT_AUDIO_format,   SPA_POD_CHOICE_ENUM_Int(3,
+				SPA_FORMAT_AUDIO_format,   SPA_POD_CHOICE_ENUM_Id(7,
+								SPA_AUDIO_FORMAT_F32,
+								SPA_AUDIO_FORMAT_F32,
+								SPA_AUDIO_FORMAT_F64,
+								SPA_AUDIO_FORMAT_S32,
+								SPA_AUDIO_FORMAT_S24_32,
 								SPA_AUDIO_FORMAT_S16,
-								SPA_AUDIO_FORMAT_S16,
-								SPA_AUDIO_FORMAT_F32),
+								SPA_AUDIO_FORMAT_U8),
 				SPA_FORMAT_AUDIO_rate,     SPA_POD_CHOICE_RANGE_Int(44100, 1, INT32_MAX),
 				SPA_FORMAT_AUDIO_channels, SPA_POD_CHOICE_RANGE_Int(2, 1, INT32_MAX));
 		}
@@ -487,6 +491,7 @@ static int port_set_format(void *object,
 			if ((res = mix_ops_init(&this->ops)) < 0)
 				return res;
 
+			this->bpf = this->ops.stride * info.info.raw.channels;
 			this->have_format = true;
 			this->format = info;
 		}
@@ -626,75 +631,57 @@ static int impl_node_port_reuse_buffer(void *object, uint32_t port_id, uint32_t
 	return -ENOTSUP;
 }
 
-static inline void
-add_port_data(struct impl *this, void *out, size_t outsize, struct port *port, int layer)
+/* Get the data of an input port that can be read without wrapping around
+ * in its buffer, at most size bytes. */
+static inline uint32_t
+get_port_data(struct port *port, uint32_t size, const void **data)
 {
-	size_t insize;
 	struct buffer *b;
-	uint32_t index, offset, len1, len2, maxsize;
 	struct spa_data *d;
-	void *data;
-	double volume = *port->io_volume;
-	bool mute = *port->io_mute;
-	const void *s0[2], *s1[2];
-	uint32_t n_src;
+	uint32_t index, offset, insize, maxsize;
 
 	b = spa_list_first(&port->queue, struct buffer, link);
-
 	d = b->outbuf->datas;
 
 	maxsize = d[0].maxsize;
-	data = d[0].data;
-
 	insize = SPA_MIN(d[0].chunk->size, maxsize);
-	outsize = SPA_MIN(outsize, insize);
 
 	index = d[0].chunk->offset + (insize - port->queued_bytes);
 	offset = index % maxsize;
 
-	len1 = SPA_MIN(outsize, maxsize - offset);
-	len2 = outsize - len1;
+	*data = SPA_MEMBER(d[0].data, offset, void);
+	return SPA_MIN(size, maxsize - offset);
+}
 
-	n_src = 0;
-	if (layer > 0) {
-		s0[n_src] = out;
-		s1[n_src] = SPA_MEMBER(out, len1, void);
-		n_src++;
-	}
-	s0[n_src] = SPA_MEMBER(data, offset, void);
-	s1[n_src] = data;
-	n_src++;
+static inline void
+consume_port_data(struct impl *this, struct port *port, uint32_t size)
+{
+	struct buffer *b;
 
-	if (volume < 0.001 || mute) {
-		/* silence, do nothing */
-	}
-	else {
-		mix_ops_process(&this->ops, out, s0, n_src, len1);
-		if (len2 > 0)
-			mix_ops_process(&this->ops, SPA_MEMBER(out, len1, void), s1, n_src, len2);
-	}
-	port->queued_bytes -= outsize;
+	b = spa_list_first(&port->queue, struct buffer, link);
+
+	port->queued_bytes -= size;
 
 	if (port->queued_bytes == 0) {
-		spa_log_trace(this->log, NAME " %p: return buffer %d on port %d %zd",
-			      this, b->id, port->id, outsize);
+		spa_log_trace(this->log, NAME " %p: return buffer %d on port %d %u",
+			      this, b->id, port->id, size);
 		port->io->buffer_id = b->id;
 		spa_list_remove(&b->link);
 		b->outstanding = true;
 	} else {
-		spa_log_trace(this->log, NAME " %p: keeping buffer %d on port %d %zd %zd",
-			      this, b->id, port->id, port->queued_bytes, outsize);
+		spa_log_trace(this->log, NAME " %p: keeping buffer %d on port %d %zd %u",
+			      this, b->id, port->id, port->queued_bytes, size);
 	}
 }
 
 static int mix_output(struct impl *this, size_t n_bytes)
 {
 	struct buffer *outbuf;
-	uint32_t i, layer;
-	struct port *outport;
+	uint32_t i, n_ports, n_src, done, size;
+	struct port *outport, *ports[MAX_PORTS];
 	struct spa_io_buffers *outio;
 	struct spa_data *od;
-	uint32_t avail, index, maxsize, len1, len2, offset;
+	const void *src[MAX_PORTS], *data;
 
 	outport = GET_OUT_PORT(this, 0);
 	outio = outport->io;
@@ -709,37 +696,47 @@ static int mix_output(struct impl *this, size_t n_bytes)
 	outbuf->outstanding = true;
 
 	od = outbuf->outbuf->datas;
-	maxsize = od[0].maxsize;
-
-	avail = maxsize;
-	index = 0;
-	n_bytes = SPA_MIN(n_bytes, avail);
+	n_bytes = SPA_MIN(n_bytes, od[0].maxsize);
 
-	offset = index % maxsize;
-	len1 = SPA_MIN(n_bytes, maxsize - offset);
-	len2 = n_bytes - len1;
-
-	spa_log_trace(this->log, NAME " %p: dequeue output buffer %d %zd %d %d %d",
-		      this, outbuf->id, n_bytes, offset, len1, len2);
+	spa_log_trace(this->log, NAME " %p: dequeue output buffer %d %zd",
+		      this, outbuf->id, n_bytes);
 
-	for (layer = 0, i = 0; i < this->last_port; i++) {
+	for (n_ports = 0, i = 0; i < this->last_port; i++) {
 		struct port *in_port = GET_IN_PORT(this, i);
 
 		if (in_port->io == NULL || in_port->n_buffers == 0)
 			continue;
 
-		if (in_port->queued_bytes == 0) {
+		if (in_port->queued_bytes < n_bytes) {
 			spa_log_warn(this->log, NAME " %p: underrun stream %d", this, i);
 			continue;
 		}
+		ports[n_ports++] = in_port;
+	}
+
+	/* mix all the inputs at once so that the integer mixers clamp the
+	 * sum only once, split where the buffer of an input wraps around */
+	for (done = 0; done < n_bytes; done += size) {
+		size = n_bytes - done;
+		for (i = 0; i < n_ports; i++)
+			size = get_port_data(ports[i], size, &data);
+
+		for (i = 0, n_src = 0; i < n_ports; i++) {
+			struct port *in_port = ports[i];
+
+			if (*in_port->io_volume < 0.001 || *in_port->io_mute)
+				continue;
+			get_port_data(in_port, size, &src[n_src++]);
+		}
+
+		mix_ops_process(&this->ops, SPA_MEMBER(od[0].data, done, void),
+				src, n_src, size / this->ops.stride);
 
-		add_port_data(this, SPA_MEMBER(od[0].data, offset, void), len1, in_port, layer);
-		if (len2 > 0)
-			add_port_data(this, od[0].data, len2, in_port, layer);
-		layer++;
+		for (i = 0; i < n_ports; i++)
+			consume_port_data(this, ports[i], size);
 	}
 
-	od[0].chunk->offset = index;
+	od[0].chunk->offset = 0;
 	od[0].chunk->size = n_bytes;
 	od[0].chunk->stride = 0;
 
@@ -0,0 +1,190 @@
+/* Spa
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include <spa/support/cpu.h>
+#include <spa/utils/defs.h>
+#include <spa/param/audio/raw.h>
+
+#include "../audioconvert/test-helper.h"
+#include "mix-ops.h"
+
+static uint32_t cpu_flags;
+
+typedef void (*mix_func_t) (struct mix_ops *ops, void * SPA_RESTRICT dst,
+		const void * SPA_RESTRICT src[], uint32_t n_src, uint32_t n_samples);
+
+struct stats {
+	uint32_t n_samples;
+	uint32_t n_src;
+	uint64_t perf;
+	const char *name;
+	const char *impl;
+};
+
+#define MAX_SAMPLES	4096
+#define MAX_SRC		32
+
+#define MAX_COUNT 1000
+
+static float samp_in[MAX_SRC][MAX_SAMPLES] SPA_ALIGNED(32);
+static float samp_out[MAX_SAMPLES] SPA_ALIGNED(32);
+
+static const int sample_sizes[] = { 128, 256, 1024, 4096 };
+static const int src_counts[] = { 2, 4, 8, 16, 32 };
+
+#define MAX_RESULTS	SPA_N_ELEMENTS(sample_sizes) * SPA_N_ELEMENTS(src_counts) * 10
+
+static uint32_t n_results = 0;
+static struct stats results[MAX_RESULTS];
+
+/* mix the way it is done with a function that can only add 2 sources,
+ * the output is read and written again for each source */
+static void mix_pairwise(mix_func_t func, struct mix_ops *ops, void *dst,
+		const void *src[], uint32_t n_src, uint32_t n_samples)
+{
+	const void *s[2];
+	uint32_t i;
+
+	s[0] = src[0];
+	for (i = 1; i < n_src; i++) {
+		s[1] = src[i];
+		func(ops, dst, s, 2, n_samples);
+		s[0] = dst;
+	}
+}
+
+static void run_test1(const char *name, const char *impl, mix_func_t func,
+		bool pairwise, int n_src, int n_samples)
+{
+	int i, j;
+	const void *ip[n_src];
+	struct timespec ts;
+	uint64_t count, t1, t2;
+	struct mix_ops mix;
+
+	spa_zero(mix);
+	mix.fmt = SPA_AUDIO_FORMAT_F32;
+	mix.n_channels = 1;
+
+	for (j = 0; j < n_src; j++)
+		ip[j] = samp_in[j];
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	count = 0;
+	for (i = 0; i < MAX_COUNT; i++) {
+		if (pairwise)
+			mix_pairwise(func, &mix, samp_out, ip, n_src, n_samples);
+		else
+			func(&mix, samp_out, ip, n_src, n_samples);
+		count++;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	spa_assert(n_results < MAX_RESULTS);
+
+	results[n_results++] = (struct stats) {
+		.n_samples = n_samples,
+		.n_src = n_src,
+		.perf = count * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1),
+		.name = name,
+		.impl = impl
+	};
+}
+
+static void run_test(const char *impl, mix_func_t func)
+{
+	size_t i, j;
+
+	for (i = 0; i < SPA_N_ELEMENTS(sample_sizes); i++) {
+		for (j = 0; j < SPA_N_ELEMENTS(src_counts); j++) {
+			run_test1("mix_f32_pairwise", impl, func, true,
+					src_counts[j], sample_sizes[i]);
+			run_test1("mix_f32", impl, func, false,
+					src_counts[j], sample_sizes[i]);
+		}
+	}
+}
+
+static void test_f32(void)
+{
+	run_test("c", mix_f32_c);
+#if defined (HAVE_SSE)
+	if (cpu_flags & SPA_CPU_FLAG_SSE)
+		run_test("sse", mix_f32_sse);
+#endif
+#if defined (HAVE_AVX)
+	if (cpu_flags & SPA_CPU_FLAG_AVX)
+		run_test("avx", mix_f32_avx);
+#endif
+#if defined (HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON)
+		run_test("neon", mix_f32_neon);
+#endif
+}
+
+static int compare_func(const void *_a, const void *_b)
+{
+	const struct stats *a = _a, *b = _b;
+	int diff;
+	if ((diff = strcmp(a->name, b->name)) != 0) return diff;
+	if ((diff = a->n_samples - b->n_samples) != 0) return diff;
+	if ((diff = a->n_src - b->n_src) != 0) return diff;
+	if ((diff = b->perf - a->perf) != 0) return diff;
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t i, j;
+
+	cpu_flags = get_cpu_flags();
+	printf("got get CPU flags %d\n", cpu_flags);
+
+	for (i = 0; i < MAX_SRC; i++)
+		for (j = 0; j < MAX_SAMPLES; j++)
+			samp_in[i][j] = drand48() - 0.5f;
+
+	test_f32();
+
+	qsort(results, n_results, sizeof(struct stats), compare_func);
+
+	for (i = 0; i < n_results; i++) {
+		struct stats *s = &results[i];
+		fprintf(stderr, "%-12."PRIu64" \t%-32.32s %s \t samples %d, sources %d\n",
+				s->perf, s->name, s->impl, s->n_samples, s->n_src);
+	}
+	return 0;
+}
@@ -32,104 +32,53 @@
 
 #include <immintrin.h>
 
-static inline void mix_4(float * dst,
-		const float * SPA_RESTRICT src0,
-		const float * SPA_RESTRICT src1,
-		const float * SPA_RESTRICT src2,
-		uint32_t n_samples)
-{
-	uint32_t n, unrolled;
-
-	if (SPA_IS_ALIGNED(src0, 32) &&
-	    SPA_IS_ALIGNED(src1, 32) &&
-	    SPA_IS_ALIGNED(src2, 32) &&
-	    SPA_IS_ALIGNED(dst, 32))
-		unrolled = n_samples & ~15;
-	else
-		unrolled = 0;
-
-	for (n = 0; n < unrolled; n += 16) {
-		__m256 in1[4], in2[4];
-
-		in1[0] = _mm256_load_ps(&dst[n + 0]);
-		in2[0] = _mm256_load_ps(&dst[n + 8]);
-		in1[1] = _mm256_load_ps(&src0[n + 0]);
-		in2[1] = _mm256_load_ps(&src0[n + 8]);
-		in1[2] = _mm256_load_ps(&src1[n + 0]);
-		in2[2] = _mm256_load_ps(&src1[n + 8]);
-		in1[3] = _mm256_load_ps(&src2[n + 0]);
-		in2[3] = _mm256_load_ps(&src2[n + 8]);
-
-		in1[0] = _mm256_add_ps(in1[0], in1[1]);
-		in2[0] = _mm256_add_ps(in2[0], in2[1]);
-		in1[2] = _mm256_add_ps(in1[2], in1[3]);
-		in2[2] = _mm256_add_ps(in2[2], in2[3]);
-		in1[0] = _mm256_add_ps(in1[0], in1[2]);
-		in2[0] = _mm256_add_ps(in2[0], in2[2]);
-
-		_mm256_store_ps(&dst[n + 0], in1[0]);
-		_mm256_store_ps(&dst[n + 8], in2[0]);
-	}
-	for (; n < n_samples; n++) {
-		__m128 in[4];
-		in[0] = _mm_load_ss(&dst[n]),
-		in[1] = _mm_load_ss(&src0[n]),
-		in[2] = _mm_load_ss(&src1[n]),
-		in[3] = _mm_load_ss(&src2[n]),
-		in[0] = _mm_add_ss(in[0], in[1]);
-		in[2] = _mm_add_ss(in[2], in[3]);
-		in[0] = _mm_add_ss(in[0], in[2]);
-		_mm_store_ss(&dst[n], in[0]);
-	}
-}
-
-
-static inline void mix_2(float * dst, const float * SPA_RESTRICT src, uint32_t n_samples)
-{
-	uint32_t n, unrolled;
-
-	if (SPA_IS_ALIGNED(src, 32) &&
-	    SPA_IS_ALIGNED(dst, 32))
-		unrolled = n_samples & ~15;
-	else
-		unrolled = 0;
-
-	for (n = 0; n < unrolled; n += 16) {
-		__m256 in1[2], in2[2];
-
-		in1[0] = _mm256_load_ps(&dst[n + 0]);
-		in1[1] = _mm256_load_ps(&dst[n + 8]);
-		in2[0] = _mm256_load_ps(&src[n + 0]);
-		in2[1] = _mm256_load_ps(&src[n + 8]);
-
-		in1[0] = _mm256_add_ps(in1[0], in2[0]);
-		in1[1] = _mm256_add_ps(in1[1], in2[1]);
-
-		_mm256_store_ps(&dst[n + 0], in1[0]);
-		_mm256_store_ps(&dst[n + 8], in1[1]);
-	}
-	for (; n < n_samples; n++) {
-		__m128 in1[1], in2[1];
-		in1[0] = _mm_load_ss(&dst[n]),
-		in2[0] = _mm_load_ss(&src[n]),
-		in1[0] = _mm_add_ss(in1[0], in2[0]);
-		_mm_store_ss(&dst[n], in1[0]);
-	}
-}
-
+/* accumulate all sources in registers so that every output sample is
+ * loaded and stored only once. Unaligned loads are used because the
+ * buffers are often only 16 byte aligned and they cost the same as
+ * aligned loads on aligned data. */
 void
 mix_f32_avx(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
 		uint32_t n_src, uint32_t n_samples)
 {
-	uint32_t i;
+	const float **s = (const float **)src;
+	float *d = dst;
+	uint32_t i, n, unrolled;
 
-	if (n_src == 0)
+	if (n_src == 0) {
 		memset(dst, 0, n_samples * sizeof(float));
-	else if (dst != src[0])
-		memcpy(dst, src[0], n_samples * sizeof(float));
+		return;
+	} else if (n_src == 1) {
+		if (dst != src[0])
+			memcpy(dst, src[0], n_samples * sizeof(float));
+		return;
+	}
 
-	for (i = 1; i + 2 < n_src; i += 3)
-		mix_4(dst, src[i], src[i + 1], src[i + 2], n_samples);
-	for (; i < n_src; i++)
-		mix_2(dst, src[i], n_samples);
+	unrolled = n_samples & ~31;
+
+	for (n = 0; n < unrolled; n += 32) {
+		__m256 in[4];
+
+		in[0] = _mm256_loadu_ps(&s[0][n+ 0]);
+		in[1] = _mm256_loadu_ps(&s[0][n+ 8]);
+		in[2] = _mm256_loadu_ps(&s[0][n+16]);
+		in[3] = _mm256_loadu_ps(&s[0][n+24]);
+
+		for (i = 1; i < n_src; i++) {
+			in[0] = _mm256_add_ps(in[0], _mm256_loadu_ps(&s[i][n+ 0]));
+			in[1] = _mm256_add_ps(in[1], _mm256_loadu_ps(&s[i][n+ 8]));
+			in[2] = _mm256_add_ps(in[2], _mm256_loadu_ps(&s[i][n+16]));
+			in[3] = _mm256_add_ps(in[3], _mm256_loadu_ps(&s[i][n+24]));
+		}
+		_mm256_storeu_ps(&d[n+ 0], in[0]);
+		_mm256_storeu_ps(&d[n+ 8], in[1]);
+		_mm256_storeu_ps(&d[n+16], in[2]);
+		_mm256_storeu_ps(&d[n+24], in[3]);
+	}
+	for (; n < n_samples; n++) {
+		__m128 in;
+		in = _mm_load_ss(&s[0][n]);
+		for (i = 1; i < n_src; i++)
+			in = _mm_add_ss(in, _mm_load_ss(&s[i][n]));
+		_mm_store_ss(&d[n], in);
+	}
 }
@@ -0,0 +1,169 @@
+/* Spa
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <spa/utils/defs.h>
+
+#include "mix-ops.h"
+
+#include <immintrin.h>
+
+void
+mix_s16_avx2(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	const int16_t **s = (const int16_t **)src;
+	int16_t *d = dst;
+	uint32_t i, n, unrolled;
+
+	if (n_src < 2) {
+		mix_s16_c(ops, dst, src, n_src, n_samples);
+		return;
+	}
+
+	unrolled = n_samples & ~15;
+
+	for (n = 0; n < unrolled; n += 16) {
+		__m256i acc[2], out;
+
+		acc[0] = acc[1] = _mm256_setzero_si256();
+		for (i = 0; i < n_src; i++) {
+			acc[0] = _mm256_add_epi32(acc[0], _mm256_cvtepi16_epi32(
+					_mm_loadu_si128((__m128i*)&s[i][n + 0])));
+			acc[1] = _mm256_add_epi32(acc[1], _mm256_cvtepi16_epi32(
+					_mm_loadu_si128((__m128i*)&s[i][n + 8])));
+		}
+		/* packs works per 128 bit lane, put the quadwords back in order */
+		out = _mm256_packs_epi32(acc[0], acc[1]);
+		out = _mm256_permute4x64_epi64(out, _MM_SHUFFLE(3, 1, 2, 0));
+		_mm256_storeu_si256((__m256i*)&d[n], out);
+	}
+	for (; n < n_samples; n++) {
+		int32_t t = 0;
+		for (i = 0; i < n_src; i++)
+			t += s[i][n];
+		d[n] = SPA_CLAMP(t, S16_MIN, S16_MAX);
+	}
+}
+
+static inline void
+mix_s32_clamp_avx2(int32_t * SPA_RESTRICT d, const int32_t **s,
+		uint32_t n_src, uint32_t n_samples, bool s24)
+{
+	uint32_t i, n, unrolled;
+	const __m256d min = _mm256_set1_pd(s24 ? S24_MIN : S32_MIN);
+	const __m256d max = _mm256_set1_pd(s24 ? S24_MAX : S32_MAX);
+
+	unrolled = n_samples & ~7;
+
+	for (n = 0; n < unrolled; n += 8) {
+		__m128i in[2];
+		__m256d acc[2];
+
+		acc[0] = acc[1] = _mm256_setzero_pd();
+		for (i = 0; i < n_src; i++) {
+			in[0] = _mm_loadu_si128((__m128i*)&s[i][n + 0]);
+			in[1] = _mm_loadu_si128((__m128i*)&s[i][n + 4]);
+			if (s24) {
+				in[0] = _mm_srai_epi32(_mm_slli_epi32(in[0], 8), 8);
+				in[1] = _mm_srai_epi32(_mm_slli_epi32(in[1], 8), 8);
+			}
+			acc[0] = _mm256_add_pd(acc[0], _mm256_cvtepi32_pd(in[0]));
+			acc[1] = _mm256_add_pd(acc[1], _mm256_cvtepi32_pd(in[1]));
+		}
+		acc[0] = _mm256_min_pd(_mm256_max_pd(acc[0], min), max);
+		acc[1] = _mm256_min_pd(_mm256_max_pd(acc[1], min), max);
+		_mm_storeu_si128((__m128i*)&d[n + 0], _mm256_cvtpd_epi32(acc[0]));
+		_mm_storeu_si128((__m128i*)&d[n + 4], _mm256_cvtpd_epi32(acc[1]));
+	}
+	for (; n < n_samples; n++) {
+		int64_t t = 0;
+		for (i = 0; i < n_src; i++)
+			t += s24 ? S24_32_SIGN_EXTEND(s[i][n]) : s[i][n];
+		d[n] = s24 ? SPA_CLAMP(t, S24_MIN, S24_MAX) : SPA_CLAMP(t, S32_MIN, S32_MAX);
+	}
+}
+
+void
+mix_s24_32_avx2(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	if (n_src < 2)
+		mix_s24_32_c(ops, dst, src, n_src, n_samples);
+	else
+		mix_s32_clamp_avx2(dst, (const int32_t **)src, n_src, n_samples, true);
+}
+
+void
+mix_s32_avx2(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	if (n_src < 2)
+		mix_s32_c(ops, dst, src, n_src, n_samples);
+	else
+		mix_s32_clamp_avx2(dst, (const int32_t **)src, n_src, n_samples, false);
+}
+
+void
+mix_u8_avx2(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	const uint8_t **s = (const uint8_t **)src;
+	uint8_t *d = dst;
+	uint32_t i, n, unrolled;
+	const __m128i offs = _mm_set1_epi8(-128);
+
+	if (n_src < 2) {
+		mix_u8_c(ops, dst, src, n_src, n_samples);
+		return;
+	}
+
+	unrolled = n_samples & ~31;
+
+	for (n = 0; n < unrolled; n += 32) {
+		__m128i in[2];
+		__m256i acc[2], out;
+
+		acc[0] = acc[1] = _mm256_setzero_si256();
+		for (i = 0; i < n_src; i++) {
+			in[0] = _mm_xor_si128(_mm_loadu_si128((__m128i*)&s[i][n +  0]), offs);
+			in[1] = _mm_xor_si128(_mm_loadu_si128((__m128i*)&s[i][n + 16]), offs);
+			acc[0] = _mm256_adds_epi16(acc[0], _mm256_cvtepi8_epi16(in[0]));
+			acc[1] = _mm256_adds_epi16(acc[1], _mm256_cvtepi8_epi16(in[1]));
+		}
+		out = _mm256_packs_epi16(acc[0], acc[1]);
+		out = _mm256_permute4x64_epi64(out, _MM_SHUFFLE(3, 1, 2, 0));
+		out = _mm256_xor_si256(out, _mm256_set1_epi8(-128));
+		_mm256_storeu_si256((__m256i*)&d[n], out);
+	}
+	for (; n < n_samples; n++) {
+		int32_t t = 0;
+		for (i = 0; i < n_src; i++)
+			t += s[i][n] - U8_OFFS;
+		d[n] = SPA_CLAMP(t, S8_MIN, S8_MAX) + U8_OFFS;
+	}
+}
@@ -67,3 +67,94 @@ mix_f64_c(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRIC
 			d[n] += s[n];
 	}
 }
+
+/* the integer mixers add all the samples in a wider type and clamp the
+ * result once so that the output is the same whatever the order of the
+ * sources */
+void
+mix_s16_c(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i, n;
+	int16_t *d = dst;
+
+	if (n_src == 0) {
+		memset(dst, 0, n_samples * sizeof(int16_t));
+	} else if (n_src == 1) {
+		if (dst != src[0])
+			memcpy(dst, src[0], n_samples * sizeof(int16_t));
+	} else {
+		for (n = 0; n < n_samples; n++) {
+			int32_t t = 0;
+			for (i = 0; i < n_src; i++)
+				t += ((const int16_t *)src[i])[n];
+			d[n] = SPA_CLAMP(t, S16_MIN, S16_MAX);
+		}
+	}
+}
+
+void
+mix_s24_32_c(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i, n;
+	int32_t *d = dst;
+
+	if (n_src == 0) {
+		memset(dst, 0, n_samples * sizeof(int32_t));
+	} else if (n_src == 1) {
+		if (dst != src[0])
+			memcpy(dst, src[0], n_samples * sizeof(int32_t));
+	} else {
+		for (n = 0; n < n_samples; n++) {
+			int64_t t = 0;
+			for (i = 0; i < n_src; i++)
+				t += S24_32_SIGN_EXTEND(((const int32_t *)src[i])[n]);
+			d[n] = SPA_CLAMP(t, S24_MIN, S24_MAX);
+		}
+	}
+}
+
+void
+mix_s32_c(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i, n;
+	int32_t *d = dst;
+
+	if (n_src == 0) {
+		memset(dst, 0, n_samples * sizeof(int32_t));
+	} else if (n_src == 1) {
+		if (dst != src[0])
+			memcpy(dst, src[0], n_samples * sizeof(int32_t));
+	} else {
+		for (n = 0; n < n_samples; n++) {
+			int64_t t = 0;
+			for (i = 0; i < n_src; i++)
+				t += ((const int32_t *)src[i])[n];
+			d[n] = SPA_CLAMP(t, S32_MIN, S32_MAX);
+		}
+	}
+}
+
+void
+mix_u8_c(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	uint32_t i, n;
+	uint8_t *d = dst;
+
+	if (n_src == 0) {
+		memset(dst, U8_OFFS, n_samples * sizeof(uint8_t));
+	} else if (n_src == 1) {
+		if (dst != src[0])
+			memcpy(dst, src[0], n_samples * sizeof(uint8_t));
+	} else {
+		for (n = 0; n < n_samples; n++) {
+			int32_t t = 0;
+			for (i = 0; i < n_src; i++)
+				t += ((const uint8_t *)src[i])[n] - U8_OFFS;
+			d[n] = SPA_CLAMP(t, S8_MIN, S8_MAX) + U8_OFFS;
+		}
+	}
+}
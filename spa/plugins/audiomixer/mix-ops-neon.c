@@ -0,0 +1,204 @@
+/* Spa
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#include <spa/utils/defs.h>
+
+#include "mix-ops.h"
+
+#include <arm_neon.h>
+
+void
+mix_f32_neon(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	const float **s = (const float **)src;
+	float *d = dst;
+	uint32_t i, n, unrolled;
+
+	if (n_src == 0) {
+		memset(dst, 0, n_samples * sizeof(float));
+		return;
+	} else if (n_src == 1) {
+		if (dst != src[0])
+			memcpy(dst, src[0], n_samples * sizeof(float));
+		return;
+	}
+
+	unrolled = n_samples & ~15;
+
+	for (n = 0; n < unrolled; n += 16) {
+		float32x4_t in[4];
+
+		in[0] = vld1q_f32(&s[0][n+ 0]);
+		in[1] = vld1q_f32(&s[0][n+ 4]);
+		in[2] = vld1q_f32(&s[0][n+ 8]);
+		in[3] = vld1q_f32(&s[0][n+12]);
+
+		for (i = 1; i < n_src; i++) {
+			in[0] = vaddq_f32(in[0], vld1q_f32(&s[i][n+ 0]));
+			in[1] = vaddq_f32(in[1], vld1q_f32(&s[i][n+ 4]));
+			in[2] = vaddq_f32(in[2], vld1q_f32(&s[i][n+ 8]));
+			in[3] = vaddq_f32(in[3], vld1q_f32(&s[i][n+12]));
+		}
+		vst1q_f32(&d[n+ 0], in[0]);
+		vst1q_f32(&d[n+ 4], in[1]);
+		vst1q_f32(&d[n+ 8], in[2]);
+		vst1q_f32(&d[n+12], in[3]);
+	}
+	for (; n < n_samples; n++) {
+		float sum = s[0][n];
+		for (i = 1; i < n_src; i++)
+			sum += s[i][n];
+		d[n] = sum;
+	}
+}
+
+void
+mix_s16_neon(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	const int16_t **s = (const int16_t **)src;
+	int16_t *d = dst;
+	uint32_t i, n, unrolled;
+
+	if (n_src < 2) {
+		mix_s16_c(ops, dst, src, n_src, n_samples);
+		return;
+	}
+
+	unrolled = n_samples & ~7;
+
+	for (n = 0; n < unrolled; n += 8) {
+		int16x8_t in;
+		int32x4_t acc[2];
+
+		acc[0] = acc[1] = vdupq_n_s32(0);
+		for (i = 0; i < n_src; i++) {
+			in = vld1q_s16(&s[i][n]);
+			acc[0] = vaddw_s16(acc[0], vget_low_s16(in));
+			acc[1] = vaddw_s16(acc[1], vget_high_s16(in));
+		}
+		vst1q_s16(&d[n], vcombine_s16(vqmovn_s32(acc[0]), vqmovn_s32(acc[1])));
+	}
+	for (; n < n_samples; n++) {
+		int32_t t = 0;
+		for (i = 0; i < n_src; i++)
+			t += s[i][n];
+		d[n] = SPA_CLAMP(t, S16_MIN, S16_MAX);
+	}
+}
+
+static inline void
+mix_s32_clamp_neon(int32_t * SPA_RESTRICT d, const int32_t **s,
+		uint32_t n_src, uint32_t n_samples, bool s24)
+{
+	uint32_t i, n, unrolled;
+
+	unrolled = n_samples & ~3;
+
+	for (n = 0; n < unrolled; n += 4) {
+		int32x4_t in, out;
+		int64x2_t acc[2];
+
+		acc[0] = acc[1] = vdupq_n_s64(0);
+		for (i = 0; i < n_src; i++) {
+			in = vld1q_s32(&s[i][n]);
+			if (s24)
+				in = vshrq_n_s32(vshlq_n_s32(in, 8), 8);
+			acc[0] = vaddw_s32(acc[0], vget_low_s32(in));
+			acc[1] = vaddw_s32(acc[1], vget_high_s32(in));
+		}
+		out = vcombine_s32(vqmovn_s64(acc[0]), vqmovn_s64(acc[1]));
+		if (s24)
+			out = vminq_s32(vmaxq_s32(out, vdupq_n_s32(S24_MIN)), vdupq_n_s32(S24_MAX));
+		vst1q_s32(&d[n], out);
+	}
+	for (; n < n_samples; n++) {
+		int64_t t = 0;
+		for (i = 0; i < n_src; i++)
+			t += s24 ? S24_32_SIGN_EXTEND(s[i][n]) : s[i][n];
+		d[n] = s24 ? SPA_CLAMP(t, S24_MIN, S24_MAX) : SPA_CLAMP(t, S32_MIN, S32_MAX);
+	}
+}
+
+void
+mix_s24_32_neon(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	if (n_src < 2)
+		mix_s24_32_c(ops, dst, src, n_src, n_samples);
+	else
+		mix_s32_clamp_neon(dst, (const int32_t **)src, n_src, n_samples, true);
+}
+
+void
+mix_s32_neon(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	if (n_src < 2)
+		mix_s32_c(ops, dst, src, n_src, n_samples);
+	else
+		mix_s32_clamp_neon(dst, (const int32_t **)src, n_src, n_samples, false);
+}
+
+void
+mix_u8_neon(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	const uint8_t **s = (const uint8_t **)src;
+	uint8_t *d = dst;
+	uint32_t i, n, unrolled;
+	const uint8x16_t offs = vdupq_n_u8(U8_OFFS);
+
+	if (n_src < 2) {
+		mix_u8_c(ops, dst, src, n_src, n_samples);
+		return;
+	}
+
+	unrolled = n_samples & ~15;
+
+	for (n = 0; n < unrolled; n += 16) {
+		int8x16_t in;
+		int16x8_t acc[2];
+
+		acc[0] = acc[1] = vdupq_n_s16(0);
+		for (i = 0; i < n_src; i++) {
+			in = vreinterpretq_s8_u8(veorq_u8(vld1q_u8(&s[i][n]), offs));
+			acc[0] = vqaddq_s16(acc[0], vmovl_s8(vget_low_s8(in)));
+			acc[1] = vqaddq_s16(acc[1], vmovl_s8(vget_high_s8(in)));
+		}
+		in = vcombine_s8(vqmovn_s16(acc[0]), vqmovn_s16(acc[1]));
+		vst1q_u8(&d[n], veorq_u8(vreinterpretq_u8_s8(in), offs));
+	}
+	for (; n < n_samples; n++) {
+		int32_t t = 0;
+		for (i = 0; i < n_src; i++)
+			t += s[i][n] - U8_OFFS;
+		d[n] = SPA_CLAMP(t, S8_MIN, S8_MAX) + U8_OFFS;
+	}
+}
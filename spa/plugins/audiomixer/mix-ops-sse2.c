@@ -87,3 +87,136 @@ mix_f64_sse2(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_REST
 		mix_2(dst, src[i], n_samples);
 	}
 }
+
+void
+mix_s16_sse2(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	const int16_t **s = (const int16_t **)src;
+	int16_t *d = dst;
+	uint32_t i, n, unrolled;
+
+	if (n_src < 2) {
+		mix_s16_c(ops, dst, src, n_src, n_samples);
+		return;
+	}
+
+	unrolled = n_samples & ~15;
+
+	for (n = 0; n < unrolled; n += 16) {
+		__m128i in[2], acc[4];
+
+		acc[0] = acc[1] = acc[2] = acc[3] = _mm_setzero_si128();
+		for (i = 0; i < n_src; i++) {
+			in[0] = _mm_loadu_si128((__m128i*)&s[i][n + 0]);
+			in[1] = _mm_loadu_si128((__m128i*)&s[i][n + 8]);
+			/* sign extend to 32 bits */
+			acc[0] = _mm_add_epi32(acc[0], _mm_srai_epi32(_mm_unpacklo_epi16(in[0], in[0]), 16));
+			acc[1] = _mm_add_epi32(acc[1], _mm_srai_epi32(_mm_unpackhi_epi16(in[0], in[0]), 16));
+			acc[2] = _mm_add_epi32(acc[2], _mm_srai_epi32(_mm_unpacklo_epi16(in[1], in[1]), 16));
+			acc[3] = _mm_add_epi32(acc[3], _mm_srai_epi32(_mm_unpackhi_epi16(in[1], in[1]), 16));
+		}
+		_mm_storeu_si128((__m128i*)&d[n + 0], _mm_packs_epi32(acc[0], acc[1]));
+		_mm_storeu_si128((__m128i*)&d[n + 8], _mm_packs_epi32(acc[2], acc[3]));
+	}
+	for (; n < n_samples; n++) {
+		int32_t t = 0;
+		for (i = 0; i < n_src; i++)
+			t += s[i][n];
+		d[n] = SPA_CLAMP(t, S16_MIN, S16_MAX);
+	}
+}
+
+/* 32 bit samples are added as doubles, which is exact and avoids 64 bit
+ * integer compares that SSE2 does not have */
+static inline void
+mix_s32_clamp_sse2(int32_t * SPA_RESTRICT d, const int32_t **s,
+		uint32_t n_src, uint32_t n_samples, bool s24)
+{
+	uint32_t i, n, unrolled;
+	const __m128d min = _mm_set1_pd(s24 ? S24_MIN : S32_MIN);
+	const __m128d max = _mm_set1_pd(s24 ? S24_MAX : S32_MAX);
+
+	unrolled = n_samples & ~3;
+
+	for (n = 0; n < unrolled; n += 4) {
+		__m128i in;
+		__m128d acc[2];
+
+		acc[0] = acc[1] = _mm_setzero_pd();
+		for (i = 0; i < n_src; i++) {
+			in = _mm_loadu_si128((__m128i*)&s[i][n]);
+			if (s24)
+				in = _mm_srai_epi32(_mm_slli_epi32(in, 8), 8);
+			acc[0] = _mm_add_pd(acc[0], _mm_cvtepi32_pd(in));
+			acc[1] = _mm_add_pd(acc[1], _mm_cvtepi32_pd(_mm_srli_si128(in, 8)));
+		}
+		acc[0] = _mm_min_pd(_mm_max_pd(acc[0], min), max);
+		acc[1] = _mm_min_pd(_mm_max_pd(acc[1], min), max);
+		in = _mm_unpacklo_epi64(_mm_cvtpd_epi32(acc[0]), _mm_cvtpd_epi32(acc[1]));
+		_mm_storeu_si128((__m128i*)&d[n], in);
+	}
+	for (; n < n_samples; n++) {
+		int64_t t = 0;
+		for (i = 0; i < n_src; i++)
+			t += s24 ? S24_32_SIGN_EXTEND(s[i][n]) : s[i][n];
+		d[n] = s24 ? SPA_CLAMP(t, S24_MIN, S24_MAX) : SPA_CLAMP(t, S32_MIN, S32_MAX);
+	}
+}
+
+void
+mix_s24_32_sse2(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	if (n_src < 2)
+		mix_s24_32_c(ops, dst, src, n_src, n_samples);
+	else
+		mix_s32_clamp_sse2(dst, (const int32_t **)src, n_src, n_samples, true);
+}
+
+void
+mix_s32_sse2(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	if (n_src < 2)
+		mix_s32_c(ops, dst, src, n_src, n_samples);
+	else
+		mix_s32_clamp_sse2(dst, (const int32_t **)src, n_src, n_samples, false);
+}
+
+void
+mix_u8_sse2(struct mix_ops *ops, void * SPA_RESTRICT dst, const void * SPA_RESTRICT src[],
+		uint32_t n_src, uint32_t n_samples)
+{
+	const uint8_t **s = (const uint8_t **)src;
+	uint8_t *d = dst;
+	uint32_t i, n, unrolled;
+	const __m128i offs = _mm_set1_epi8(-128);
+
+	if (n_src < 2) {
+		mix_u8_c(ops, dst, src, n_src, n_samples);
+		return;
+	}
+
+	unrolled = n_samples & ~15;
+
+	for (n = 0; n < unrolled; n += 16) {
+		__m128i in, acc[2];
+
+		acc[0] = acc[1] = _mm_setzero_si128();
+		for (i = 0; i < n_src; i++) {
+			/* make signed and extend to 16 bits */
+			in = _mm_xor_si128(_mm_loadu_si128((__m128i*)&s[i][n]), offs);
+			acc[0] = _mm_adds_epi16(acc[0], _mm_srai_epi16(_mm_unpacklo_epi8(in, in), 8));
+			acc[1] = _mm_adds_epi16(acc[1], _mm_srai_epi16(_mm_unpackhi_epi8(in, in), 8));
+		}
+		in = _mm_xor_si128(_mm_packs_epi16(acc[0], acc[1]), offs);
+		_mm_storeu_si128((__m128i*)&d[n], in);
+	}
+	for (; n < n_samples; n++) {
+		int32_t t = 0;
+		for (i = 0; i < n_src; i++)
+			t += s[i][n] - U8_OFFS;
+		d[n] = SPA_CLAMP(t, S8_MIN, S8_MAX) + U8_OFFS;
+	}
+}
@@ -43,27 +43,81 @@ struct mix_info {
 	mix_func_t process;
 };
 
+#define MAKE(fmt,fmtp,flags,stride,func) \
+	{ SPA_AUDIO_FORMAT_ ##fmt, 0, flags, stride, func }, \
+	{ SPA_AUDIO_FORMAT_ ##fmtp, 0, flags, stride, func }
+
+/* samples are mixed independently so the functions work for any number of
+ * channels */
 static struct mix_info mix_table[] =
 {
 	/* f32 */
 #if defined(HAVE_AVX)
-	{ SPA_AUDIO_FORMAT_F32, 1, SPA_CPU_FLAG_AVX, 4, mix_f32_avx },
-	{ SPA_AUDIO_FORMAT_F32P, 1, SPA_CPU_FLAG_AVX, 4, mix_f32_avx },
+	MAKE(F32, F32P, SPA_CPU_FLAG_AVX, 4, mix_f32_avx),
+#endif
+#if defined (HAVE_NEON)
+	MAKE(F32, F32P, SPA_CPU_FLAG_NEON, 4, mix_f32_neon),
 #endif
 #if defined (HAVE_SSE)
-	{ SPA_AUDIO_FORMAT_F32, 1, SPA_CPU_FLAG_SSE, 4, mix_f32_sse },
-	{ SPA_AUDIO_FORMAT_F32P, 1, SPA_CPU_FLAG_SSE, 4, mix_f32_sse },
+	MAKE(F32, F32P, SPA_CPU_FLAG_SSE, 4, mix_f32_sse),
+#endif
+	MAKE(F32, F32P, 0, 4, mix_f32_c),
+
+	/* f64 */
+#if defined (HAVE_SSE2)
+	MAKE(F64, F64P, SPA_CPU_FLAG_SSE2, 8, mix_f64_sse2),
+#endif
+	MAKE(F64, F64P, 0, 8, mix_f64_c),
+
+	/* s32 */
+#if defined (HAVE_AVX2)
+	MAKE(S32, S32P, SPA_CPU_FLAG_AVX2, 4, mix_s32_avx2),
+#endif
+#if defined (HAVE_NEON)
+	MAKE(S32, S32P, SPA_CPU_FLAG_NEON, 4, mix_s32_neon),
+#endif
+#if defined (HAVE_SSE2)
+	MAKE(S32, S32P, SPA_CPU_FLAG_SSE2, 4, mix_s32_sse2),
+#endif
+	MAKE(S32, S32P, 0, 4, mix_s32_c),
+
+	/* s24_32 */
+#if defined (HAVE_AVX2)
+	MAKE(S24_32, S24_32P, SPA_CPU_FLAG_AVX2, 4, mix_s24_32_avx2),
+#endif
+#if defined (HAVE_NEON)
+	MAKE(S24_32, S24_32P, SPA_CPU_FLAG_NEON, 4, mix_s24_32_neon),
+#endif
+#if defined (HAVE_SSE2)
+	MAKE(S24_32, S24_32P, SPA_CPU_FLAG_SSE2, 4, mix_s24_32_sse2),
 #endif
-	{ SPA_AUDIO_FORMAT_F32, 1, 0, 4, mix_f32_c },
-	{ SPA_AUDIO_FORMAT_F32P, 1, 0, 4, mix_f32_c },
+	MAKE(S24_32, S24_32P, 0, 4, mix_s24_32_c),
 
+	/* s16 */
+#if defined (HAVE_AVX2)
+	MAKE(S16, S16P, SPA_CPU_FLAG_AVX2, 2, mix_s16_avx2),
+#endif
+#if defined (HAVE_NEON)
+	MAKE(S16, S16P, SPA_CPU_FLAG_NEON, 2, mix_s16_neon),
+#endif
+#if defined (HAVE_SSE2)
+	MAKE(S16, S16P, SPA_CPU_FLAG_SSE2, 2, mix_s16_sse2),
+#endif
+	MAKE(S16, S16P, 0, 2, mix_s16_c),
+
+	/* u8 */
+#if defined (HAVE_AVX2)
+	MAKE(U8, U8P, SPA_CPU_FLAG_AVX2, 1, mix_u8_avx2),
+#endif
+#if defined (HAVE_NEON)
+	MAKE(U8, U8P, SPA_CPU_FLAG_NEON, 1, mix_u8_neon),
+#endif
 #if defined (HAVE_SSE2)
-	{ SPA_AUDIO_FORMAT_F64, 1, SPA_CPU_FLAG_SSE2, 8, mix_f64_sse2 },
-	{ SPA_AUDIO_FORMAT_F64P, 1, SPA_CPU_FLAG_SSE2, 8, mix_f64_sse2 },
+	MAKE(U8, U8P, SPA_CPU_FLAG_SSE2, 1, mix_u8_sse2),
 #endif
-	{ SPA_AUDIO_FORMAT_F64, 1, 0, 8, mix_f64_c },
-	{ SPA_AUDIO_FORMAT_F64P, 1, 0, 8, mix_f64_c },
+	MAKE(U8, U8P, 0, 1, mix_u8_c),
 };
+#undef MAKE
 
 #define MATCH_CHAN(a,b)		((a) == 0 || (a) == (b))
 #define MATCH_CPU_FLAGS(a,b)	((a) == 0 || ((a) & (b)) == a)
@@ -85,7 +139,8 @@ static const struct mix_info *find_mix_info(uint32_t fmt,
 static void impl_mix_ops_clear(struct mix_ops *ops, void * SPA_RESTRICT dst, uint32_t n_samples)
 {
 	const struct mix_info *info = ops->priv;
-	memset(dst, 0, n_samples * info->stride);
+	bool u8 = info->fmt == SPA_AUDIO_FORMAT_U8 || info->fmt == SPA_AUDIO_FORMAT_U8P;
+	memset(dst, u8 ? U8_OFFS : 0, n_samples * info->stride);
 }
 
 static void impl_mix_ops_free(struct mix_ops *ops)
@@ -103,6 +158,7 @@ int mix_ops_init(struct mix_ops *ops)
 
 	ops->priv = info;
 	ops->cpu_flags = info->cpu_flags;
+	ops->stride = info->stride;
 	ops->clear = impl_mix_ops_clear;
 	ops->process = info->process;
 	ops->free = impl_mix_ops_free;
@@ -24,10 +24,23 @@
 
 #include <spa/utils/defs.h>
 
+#define U8_OFFS		128
+#define S8_MIN		-128
+#define S8_MAX		127
+#define S16_MIN		-32768
+#define S16_MAX		32767
+#define S24_MIN		-8388608
+#define S24_MAX		8388607
+#define S32_MIN		INT32_MIN
+#define S32_MAX		INT32_MAX
+
+#define S24_32_SIGN_EXTEND(v)	(((int32_t)((uint32_t)(v) << 8)) >> 8)
+
 struct mix_ops {
 	uint32_t fmt;
 	uint32_t n_channels;
 	uint32_t cpu_flags;
+	uint32_t stride;		/**< size of one sample, set by mix_ops_init */
 
 	void (*clear) (struct mix_ops *ops, void * SPA_RESTRICT dst, uint32_t n_samples);
 	void (*process) (struct mix_ops *ops,
@@ -52,13 +65,34 @@ void mix_##name##_##arch(struct mix_ops *ops, void * SPA_RESTRICT dst,	\
 
 DEFINE_FUNCTION(f32, c);
 DEFINE_FUNCTION(f64, c);
+DEFINE_FUNCTION(s16, c);
+DEFINE_FUNCTION(s24_32, c);
+DEFINE_FUNCTION(s32, c);
+DEFINE_FUNCTION(u8, c);
 
 #if defined(HAVE_SSE)
 DEFINE_FUNCTION(f32, sse);
 #endif
 #if defined(HAVE_SSE2)
 DEFINE_FUNCTION(f64, sse2);
+DEFINE_FUNCTION(s16, sse2);
+DEFINE_FUNCTION(s24_32, sse2);
+DEFINE_FUNCTION(s32, sse2);
+DEFINE_FUNCTION(u8, sse2);
 #endif
 #if defined(HAVE_AVX)
 DEFINE_FUNCTION(f32, avx);
 #endif
+#if defined(HAVE_AVX2)
+DEFINE_FUNCTION(s16, avx2);
+DEFINE_FUNCTION(s24_32, avx2);
+DEFINE_FUNCTION(s32, avx2);
+DEFINE_FUNCTION(u8, avx2);
+#endif
+#if defined(HAVE_NEON)
+DEFINE_FUNCTION(f32, neon);
+DEFINE_FUNCTION(s16, neon);
+DEFINE_FUNCTION(s24_32, neon);
+DEFINE_FUNCTION(s32, neon);
+DEFINE_FUNCTION(u8, neon);
+#endif
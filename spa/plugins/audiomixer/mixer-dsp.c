@@ -586,6 +586,7 @@ impl_node_port_use_buffers(void *object,
 
 		b = &port->buffers[i];
 		b->buffer = buffers[i];
+		b->buf = *buffers[i];
 		b->flags = 0;
 		b->id = i;
 		b->h = spa_buffer_find_meta_data(buffers[i], SPA_META_Header, sizeof(*b->h));
@@ -723,9 +724,12 @@ static int impl_node_process(void *object)
 	n_samples = maxsize / sizeof(float);
 
 	if (n_buffers == 1) {
+		/* a single input is passed on by reference, the output
+		 * buffer is restored when there is something to mix again */
 		*outb->buffer = *buffers[0]->buffer;
 	}
 	else {
+		*outb->buffer = outb->buf;
 		outb->buffer->n_datas = 1;
 		outb->buffer->datas = outb->datas;
 		outb->datas[0].data = SPA_PTR_ALIGN(this->empty, MAX_ALIGN, void);
@@ -0,0 +1,229 @@
+/* Spa
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <spa/param/audio/raw.h>
+#include <spa/debug/mem.h>
+
+#include "../audioconvert/test-helper.h"
+#include "mix-ops.h"
+
+#define N_SAMPLES	253
+#define N_SRC		24
+
+static uint32_t cpu_flags;
+
+typedef void (*mix_func_t) (struct mix_ops *ops, void * SPA_RESTRICT dst,
+		const void * SPA_RESTRICT src[], uint32_t n_src, uint32_t n_samples);
+
+static uint8_t samp_in[N_SRC][N_SAMPLES * 4];
+static uint8_t samp_out[N_SAMPLES * 4];
+static uint8_t samp_ref[N_SAMPLES * 4];
+
+static void compare_mem(const char *name, uint32_t n_src, const void *m1, const void *m2, size_t size)
+{
+	int res = memcmp(m1, m2, size);
+	if (res != 0) {
+		fprintf(stderr, "%s %d:\n", name, n_src);
+		spa_debug_mem(0, m1, size);
+		spa_debug_mem(0, m2, size);
+	}
+	spa_assert(res == 0);
+}
+
+static void run_test(const char *name, const void *in[], uint32_t n_src,
+		const void *out, uint32_t n_samples, uint32_t stride, mix_func_t func)
+{
+	struct mix_ops mix;
+
+	spa_zero(mix);
+	fprintf(stderr, "test %s:\n", name);
+	func(&mix, samp_out, in, n_src, n_samples);
+	compare_mem(name, n_src, samp_out, out, n_samples * stride);
+}
+
+/* compare the optimized function against the C version with random data
+ * and all source counts */
+static void run_test_random(const char *name, uint32_t stride, mix_func_t func, mix_func_t ref)
+{
+	const void *ip[N_SRC];
+	struct mix_ops mix;
+	uint32_t i, j;
+
+	spa_zero(mix);
+	for (i = 0; i < N_SRC; i++) {
+		for (j = 0; j < sizeof(samp_in[i]); j++)
+			samp_in[i][j] = rand();
+		ip[i] = samp_in[i];
+	}
+	fprintf(stderr, "test %s:\n", name);
+	for (i = 0; i <= N_SRC; i++) {
+		ref(&mix, samp_ref, ip, i, N_SAMPLES);
+		func(&mix, samp_out, ip, i, N_SAMPLES);
+		compare_mem(name, i, samp_out, samp_ref, N_SAMPLES * stride);
+	}
+}
+
+static void test_s16(void)
+{
+	static const int16_t in1[] = { 0, 1000, 30000, -30000, -1, 32767, -32768 };
+	static const int16_t in2[] = { 0, -500, 30000, -30000, 1, 32767, -32768 };
+	static const int16_t out[] = { 0, 500, 32767, -32768, 0, 32767, -32768 };
+	const void *ip[] = { in1, in2 };
+
+	run_test("test_s16", ip, 2, out, SPA_N_ELEMENTS(out), 2, mix_s16_c);
+	run_test("test_s16_1", ip, 1, in1, SPA_N_ELEMENTS(in1), 2, mix_s16_c);
+
+	run_test_random("test_s16_random", 2, mix_s16_c, mix_s16_c);
+#if defined(HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2)
+		run_test_random("test_s16_random_sse2", 2, mix_s16_sse2, mix_s16_c);
+#endif
+#if defined(HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2)
+		run_test_random("test_s16_random_avx2", 2, mix_s16_avx2, mix_s16_c);
+#endif
+#if defined(HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON)
+		run_test_random("test_s16_random_neon", 2, mix_s16_neon, mix_s16_c);
+#endif
+}
+
+static void test_s24_32(void)
+{
+	static const int32_t in1[] = { 0, 1000, 8000000, -8000000, 0x7fffff, 0x0f800000 };
+	static const int32_t in2[] = { 0, -500, 8000000, -8000000, 0x000001, 0x7f000001 };
+	static const int32_t out[] = { 0, 500, 8388607, -8388608, 8388607, -8388607 };
+	const void *ip[] = { in1, in2 };
+
+	run_test("test_s24_32", ip, 2, out, SPA_N_ELEMENTS(out), 4, mix_s24_32_c);
+
+	run_test_random("test_s24_32_random", 4, mix_s24_32_c, mix_s24_32_c);
+#if defined(HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2)
+		run_test_random("test_s24_32_random_sse2", 4, mix_s24_32_sse2, mix_s24_32_c);
+#endif
+#if defined(HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2)
+		run_test_random("test_s24_32_random_avx2", 4, mix_s24_32_avx2, mix_s24_32_c);
+#endif
+#if defined(HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON)
+		run_test_random("test_s24_32_random_neon", 4, mix_s24_32_neon, mix_s24_32_c);
+#endif
+}
+
+static void test_s32(void)
+{
+	static const int32_t in1[] = { 0, 1000, 2000000000, -2000000000, INT32_MAX, INT32_MIN };
+	static const int32_t in2[] = { 0, -500, 2000000000, -2000000000, INT32_MAX, INT32_MIN };
+	static const int32_t out[] = { 0, 500, INT32_MAX, INT32_MIN, INT32_MAX, INT32_MIN };
+	const void *ip[] = { in1, in2 };
+
+	run_test("test_s32", ip, 2, out, SPA_N_ELEMENTS(out), 4, mix_s32_c);
+
+	run_test_random("test_s32_random", 4, mix_s32_c, mix_s32_c);
+#if defined(HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2)
+		run_test_random("test_s32_random_sse2", 4, mix_s32_sse2, mix_s32_c);
+#endif
+#if defined(HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2)
+		run_test_random("test_s32_random_avx2", 4, mix_s32_avx2, mix_s32_c);
+#endif
+#if defined(HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON)
+		run_test_random("test_s32_random_neon", 4, mix_s32_neon, mix_s32_c);
+#endif
+}
+
+static void test_u8(void)
+{
+	static const uint8_t in1[] = { 128, 138, 250, 10, 255, 0 };
+	static const uint8_t in2[] = { 128, 123, 250, 10, 128, 128 };
+	static const uint8_t out[] = { 128, 133, 255, 0, 255, 0 };
+	const void *ip[] = { in1, in2 };
+
+	run_test("test_u8", ip, 2, out, SPA_N_ELEMENTS(out), 1, mix_u8_c);
+	run_test("test_u8_0", ip, 0, (uint8_t[]) { 128, 128, 128, 128 }, 4, 1, mix_u8_c);
+
+	run_test_random("test_u8_random", 1, mix_u8_c, mix_u8_c);
+#if defined(HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2)
+		run_test_random("test_u8_random_sse2", 1, mix_u8_sse2, mix_u8_c);
+#endif
+#if defined(HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2)
+		run_test_random("test_u8_random_avx2", 1, mix_u8_avx2, mix_u8_c);
+#endif
+#if defined(HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON)
+		run_test_random("test_u8_random_neon", 1, mix_u8_neon, mix_u8_c);
+#endif
+}
+
+static void test_init(void)
+{
+	static const uint32_t formats[] = {
+		SPA_AUDIO_FORMAT_F32, SPA_AUDIO_FORMAT_F64, SPA_AUDIO_FORMAT_S32,
+		SPA_AUDIO_FORMAT_S24_32, SPA_AUDIO_FORMAT_S16, SPA_AUDIO_FORMAT_U8,
+	};
+	static const uint32_t strides[] = { 4, 8, 4, 4, 2, 1 };
+	struct mix_ops mix;
+	uint32_t i;
+
+	for (i = 0; i < SPA_N_ELEMENTS(formats); i++) {
+		spa_zero(mix);
+		mix.fmt = formats[i];
+		mix.n_channels = 2;
+		mix.cpu_flags = cpu_flags;
+		spa_assert(mix_ops_init(&mix) == 0);
+		spa_assert(mix.stride == strides[i]);
+		mix_ops_free(&mix);
+	}
+	spa_zero(mix);
+	mix.fmt = SPA_AUDIO_FORMAT_S24;
+	spa_assert(mix_ops_init(&mix) == -ENOTSUP);
+}
+
+int main(int argc, char *argv[])
+{
+	cpu_flags = get_cpu_flags();
+	printf("got get CPU flags %d\n", cpu_flags);
+
+	test_init();
+	test_s16();
+	test_s24_32();
+	test_s32();
+	test_u8();
+
+	return 0;
+}
@@ -52,6 +52,7 @@
 #include "defs.h"
 #include "rtp.h"
 #include "a2dp-codecs.h"
+#include "rate-control.h"
 
 struct codec;
 
@@ -127,6 +128,9 @@ struct impl {
 	uint64_t next_time;
 	uint64_t last_error;
 
+	struct rate_control rate_control;
+	unsigned int use_rate_control:1;
+
 	const struct a2dp_codec *codec;
 	bool codec_props_changed;
 	void *codec_props;
@@ -406,13 +410,35 @@ static int get_transport_unused_size(struct impl *this)
 	return value;
 }
 
+static void update_rate(struct impl *this, int queued, uint64_t now_time)
+{
+	int res;
+
+	res = rate_control_update(&this->rate_control, queued,
+			this->fd_buffer_size, now_time);
+	if (res < 0) {
+		spa_log_debug(this->log, NAME " %p: queue %d/%d, lower quality",
+				this, queued, this->fd_buffer_size);
+		this->codec->reduce_bitpool(this->codec_data);
+	} else if (res > 0) {
+		spa_log_debug(this->log, NAME " %p: queue %d/%d, raise quality",
+				this, queued, this->fd_buffer_size);
+		this->codec->increase_bitpool(this->codec_data);
+	}
+}
+
 static int send_buffer(struct impl *this)
 {
-	int written, unsent;
-	unsent = get_transport_unused_size(this);
-	if (unsent >= 0) {
-		unsent = this->fd_buffer_size - unsent;
-		this->codec->abr_process(this->codec_data, unsent);
+	int written, unsent, unused;
+	unused = get_transport_unused_size(this);
+	if (unused >= 0) {
+		/* TIOCOUTQ on a BT socket is the free space in the send queue */
+		unsent = this->fd_buffer_size - unused;
+		/* codecs without their own ABR follow the send queue */
+		this->use_rate_control = this->codec->abr_process(this->codec_data,
+				unsent) == -ENOTSUP;
+		if (this->use_rate_control)
+			update_rate(this, unsent, this->current_time);
 	}
 
 	spa_log_trace(this->log, NAME " %p: send %d %u %u %u %u",
@@ -598,7 +624,9 @@ again:
 	written = flush_buffer(this);
 	if (written == -EAGAIN) {
 		spa_log_trace(this->log, NAME" %p: delay flush", this);
-		if (now_time - this->last_error > SPA_NSEC_PER_SEC / 2) {
+		if (this->use_rate_control)
+			update_rate(this, this->fd_buffer_size, now_time);
+		else if (now_time - this->last_error > SPA_NSEC_PER_SEC / 2) {
 			this->codec->reduce_bitpool(this->codec_data);
 			this->last_error = now_time;
 		}
@@ -610,7 +638,8 @@ again:
 		return written;
 	}
 	else if (written > 0) {
-		if (now_time - this->last_error > SPA_NSEC_PER_SEC) {
+		if (!this->use_rate_control &&
+		    now_time - this->last_error > SPA_NSEC_PER_SEC) {
 			this->codec->increase_bitpool(this->codec_data);
 			this->last_error = now_time;
 		}
@@ -732,6 +761,8 @@ static int do_start(struct impl *this)
                      (int64_t)(spa_bt_transport_get_delay_nsec(this->transport) / SPA_NSEC_PER_MSEC));
 
 	this->seqnum = 0;
+	this->use_rate_control = false;
+	rate_control_init(&this->rate_control, this->current_time);
 
 	this->block_size = this->codec->get_block_size(this->codec_data);
 	if (this->block_size > sizeof(this->tmp_buffer)) {
@@ -828,6 +859,10 @@ static int do_stop(struct impl *this)
 	if (this->transport)
 		res = spa_bt_transport_release(this->transport);
 
+	if (this->use_rate_control)
+		spa_log_debug(this->log, NAME " %p: quality lowered %u times, raised %u times",
+				this, this->rate_control.n_reduce, this->rate_control.n_increase);
+
 	if (this->codec_data)
 		this->codec->deinit(this->codec_data);
 	this->codec_data = NULL;
@@ -0,0 +1,350 @@
+/* Spa A2DP codec benchmark
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <math.h>
+#include <pthread.h>
+
+#include <spa/utils/defs.h>
+#include <spa/utils/result.h>
+#include <spa/param/audio/format-utils.h>
+
+#include "a2dp-codecs.h"
+
+#define SECONDS		10
+#define MTU		1024
+#define MAX_THREADS	16
+
+#define M_PI_M2 ( M_PI + M_PI )
+
+enum signal {
+	SIGNAL_SINE,
+	SIGNAL_NOISE,
+	SIGNAL_SILENCE,
+	N_SIGNALS,
+};
+
+static const char *signal_names[] = { "sine", "noise", "silence" };
+
+/* the test signals are rendered once per format and shared between all
+ * encoders and threads so that only the encoder is measured */
+struct signal_cache {
+	uint32_t format;
+	uint32_t rate;
+	uint32_t channels;
+	uint32_t stride;
+	uint32_t n_frames;
+	void *data[N_SIGNALS];
+};
+
+struct run {
+	pthread_t thread;
+	const struct a2dp_codec *codec;
+	uint8_t *config;
+	size_t config_size;
+	const struct spa_audio_info *info;
+	const struct signal_cache *cache;
+	enum signal signal;
+
+	uint64_t nsec;
+	uint64_t n_blocks;
+	uint64_t n_bytes;
+	int res;
+};
+
+static uint64_t get_time_ns(clockid_t clock)
+{
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+static int format_stride(uint32_t format)
+{
+	switch (format) {
+	case SPA_AUDIO_FORMAT_S16:
+		return 2;
+	case SPA_AUDIO_FORMAT_S24:
+		return 3;
+	case SPA_AUDIO_FORMAT_S24_32:
+	case SPA_AUDIO_FORMAT_S32:
+	case SPA_AUDIO_FORMAT_F32:
+		return 4;
+	default:
+		return -ENOTSUP;
+	}
+}
+
+static void write_sample(uint8_t *d, uint32_t format, float v)
+{
+	int32_t s = (int32_t) (SPA_CLAMP(v, -1.0f, 1.0f) * 8388607.0f);
+
+	switch (format) {
+	case SPA_AUDIO_FORMAT_S16:
+		*(int16_t*)d = s >> 8;
+		break;
+	case SPA_AUDIO_FORMAT_S24:
+		d[0] = s;
+		d[1] = s >> 8;
+		d[2] = s >> 16;
+		break;
+	case SPA_AUDIO_FORMAT_S24_32:
+		*(int32_t*)d = s;
+		break;
+	case SPA_AUDIO_FORMAT_S32:
+		*(int32_t*)d = s << 8;
+		break;
+	case SPA_AUDIO_FORMAT_F32:
+		*(float*)d = v;
+		break;
+	}
+}
+
+static int signal_cache_init(struct signal_cache *cache, const struct spa_audio_info_raw *raw)
+{
+	uint32_t i, j, k;
+	int stride;
+
+	if ((stride = format_stride(raw->format)) < 0)
+		return stride;
+
+	cache->format = raw->format;
+	cache->rate = raw->rate;
+	cache->channels = raw->channels;
+	cache->stride = stride * raw->channels;
+	cache->n_frames = raw->rate * SECONDS;
+
+	srand(0);
+	for (k = 0; k < N_SIGNALS; k++) {
+		uint8_t *d = calloc(cache->n_frames, cache->stride);
+		if (d == NULL)
+			return -errno;
+		cache->data[k] = d;
+
+		for (i = 0; i < cache->n_frames; i++) {
+			for (j = 0; j < cache->channels; j++) {
+				float v;
+				switch (k) {
+				case SIGNAL_SINE:
+					v = 0.5f * sinf(M_PI_M2 * 1000.0f * (j + 1) * i / raw->rate);
+					break;
+				case SIGNAL_NOISE:
+					v = (float) rand() / RAND_MAX - 0.5f;
+					break;
+				default:
+					v = 0.0f;
+					break;
+				}
+				write_sample(d, cache->format, v);
+				d += stride;
+			}
+		}
+	}
+	return 0;
+}
+
+static void signal_cache_clear(struct signal_cache *cache)
+{
+	uint32_t k;
+	for (k = 0; k < N_SIGNALS; k++)
+		free(cache->data[k]);
+	spa_zero(*cache);
+}
+
+static void *run_encoder(void *data)
+{
+	struct run *r = data;
+	const struct a2dp_codec *codec = r->codec;
+	const uint8_t *src = r->cache->data[r->signal];
+	size_t src_size = (size_t)r->cache->n_frames * r->cache->stride;
+	uint8_t packet[MTU];
+	void *props = NULL, *codec_data;
+	size_t offset = 0, block_size, out, header;
+	uint16_t seqnum = 0;
+	uint64_t t1, t2;
+	int res, need_flush;
+
+	if (codec->init_props)
+		props = codec->init_props(codec, NULL);
+
+	errno = 0;
+	codec_data = codec->init(codec, 0, r->config, r->config_size,
+			r->info, props, MTU);
+	if (codec_data == NULL) {
+		r->res = errno ? -errno : -EIO;
+		goto done;
+	}
+	block_size = codec->get_block_size(codec_data);
+
+	t1 = get_time_ns(CLOCK_THREAD_CPUTIME_ID);
+	while (offset + block_size <= src_size) {
+		size_t used;
+
+		if ((res = codec->start_encode(codec_data, packet, sizeof(packet),
+						seqnum++, offset / r->cache->stride)) < 0)
+			break;
+		used = header = res;
+		need_flush = 0;
+
+		while (!need_flush && offset + block_size <= src_size) {
+			res = codec->encode(codec_data, src + offset, block_size,
+					packet + used, sizeof(packet) - used,
+					&out, &need_flush);
+			if (res <= 0)
+				break;
+			offset += res;
+			used += out;
+			r->n_blocks++;
+		}
+		r->n_bytes += used;
+		if (res < 0 || used == header)
+			break;
+	}
+	t2 = get_time_ns(CLOCK_THREAD_CPUTIME_ID);
+
+	r->nsec = t2 - t1;
+	r->res = 0;
+
+	codec->deinit(codec_data);
+done:
+	if (props)
+		codec->clear_props(props);
+	return NULL;
+}
+
+static int get_config(const struct a2dp_codec *codec, uint8_t config[A2DP_MAX_CAPS_SIZE],
+		size_t *config_size, struct spa_audio_info *info)
+{
+	uint8_t caps[A2DP_MAX_CAPS_SIZE];
+	uint8_t buffer[1024];
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+	struct spa_pod *param;
+	int res, caps_size;
+
+	if ((res = codec->fill_caps(codec, 0, caps)) < 0)
+		return res;
+	caps_size = res;
+
+	if ((res = codec->select_config(codec, 0, caps, caps_size, NULL, config)) < 0)
+		return res;
+	*config_size = res;
+
+	spa_zero(*info);
+	if (codec->validate_config)
+		return codec->validate_config(codec, 0, config, *config_size, info);
+
+	if ((res = codec->enum_config(codec, config, *config_size,
+					SPA_PARAM_EnumFormat, 0, &b, &param)) <= 0)
+		return res < 0 ? res : -ENOTSUP;
+
+	info->media_type = SPA_MEDIA_TYPE_audio;
+	info->media_subtype = SPA_MEDIA_SUBTYPE_raw;
+	return spa_format_audio_raw_parse(param, &info->info.raw);
+}
+
+static void run_codec(const struct a2dp_codec *codec, uint32_t n_threads)
+{
+	uint8_t config[A2DP_MAX_CAPS_SIZE];
+	struct spa_audio_info info;
+	struct signal_cache cache;
+	struct run runs[MAX_THREADS];
+	size_t config_size;
+	uint32_t i, k, n;
+	int res;
+
+	spa_zero(cache);
+
+	if ((res = get_config(codec, config, &config_size, &info)) < 0) {
+		fprintf(stderr, "%s: can't configure: %s\n", codec->name, spa_strerror(res));
+		return;
+	}
+	if ((res = signal_cache_init(&cache, &info.info.raw)) < 0) {
+		fprintf(stderr, "%s: unsupported format %d: %s\n", codec->name,
+				info.info.raw.format, spa_strerror(res));
+		goto done;
+	}
+
+	for (k = 0; k < N_SIGNALS; k++) {
+		for (n = 1; n <= n_threads; n *= 2) {
+			uint64_t nsec = 0, n_blocks = 0, n_bytes = 0;
+
+			for (i = 0; i < n; i++) {
+				runs[i] = (struct run) {
+					.codec = codec,
+					.config = config,
+					.config_size = config_size,
+					.info = &info,
+					.cache = &cache,
+					.signal = k,
+					.res = -EIO,
+				};
+				pthread_create(&runs[i].thread, NULL, run_encoder, &runs[i]);
+			}
+			for (i = 0; i < n; i++) {
+				pthread_join(runs[i].thread, NULL);
+				if (runs[i].res < 0) {
+					fprintf(stderr, "%s: encode failed: %s\n", codec->name,
+							spa_strerror(runs[i].res));
+					goto done;
+				}
+				nsec += runs[i].nsec;
+				n_blocks += runs[i].n_blocks;
+				n_bytes += runs[i].n_bytes;
+			}
+			nsec /= n;
+			n_blocks /= n;
+			n_bytes /= n;
+
+			fprintf(stderr, "%-10s %-8s %6d %3d: %8.0f ns/block %6.2f%% cpu %7.1f kbps\n",
+					codec->name, signal_names[k], info.info.raw.rate, n,
+					n_blocks ? (double)nsec / n_blocks : 0.0,
+					nsec * 100.0 / (SECONDS * SPA_NSEC_PER_SEC),
+					n_bytes * 8.0 / SECONDS / 1000.0);
+		}
+	}
+done:
+	signal_cache_clear(&cache);
+}
+
+int main(int argc, char *argv[])
+{
+	const struct a2dp_codec * const *c;
+	long n_threads = sysconf(_SC_NPROCESSORS_ONLN);
+
+	n_threads = SPA_CLAMP(n_threads, 1, MAX_THREADS);
+
+	for (c = a2dp_codecs; *c; c++) {
+		if (argc > 1 && strcmp(argv[1], (*c)->name) != 0)
+			continue;
+		run_codec(*c, n_threads);
+	}
+	return 0;
+}
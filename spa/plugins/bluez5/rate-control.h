@@ -0,0 +1,106 @@
+/* Spa A2DP rate control
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef SPA_BLUEZ5_RATE_CONTROL_H
+#define SPA_BLUEZ5_RATE_CONTROL_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <spa/utils/defs.h>
+
+/* Adaptive bitrate control driven by the fill level of the socket send
+ * queue. The quality is lowered as soon as the queue keeps growing, well
+ * before it is full and writes fail, and is raised again when the queue
+ * stayed nearly empty for a while. When raising the quality made the queue
+ * grow again, it waits twice as long before the next try. */
+
+#define RATE_CONTROL_SCALE	1024				/* fill level of a full queue */
+#define RATE_CONTROL_HIGH	(RATE_CONTROL_SCALE / 2)	/* lower when not draining */
+#define RATE_CONTROL_BUILDUP	(RATE_CONTROL_SCALE / 8)	/* lower when growing */
+#define RATE_CONTROL_LOW	(RATE_CONTROL_SCALE / 16)	/* raise the quality */
+
+#define RATE_CONTROL_REDUCE_HOLD	((uint64_t) (100 * SPA_NSEC_PER_MSEC))
+#define RATE_CONTROL_MIN_HOLD		((uint64_t) SPA_NSEC_PER_SEC)
+#define RATE_CONTROL_MAX_HOLD		((uint64_t) (16 * SPA_NSEC_PER_SEC))
+
+struct rate_control {
+	uint64_t last_change;	/* time of the last quality change */
+	uint64_t last_increase;
+	uint64_t hold;		/* time before the quality is raised again */
+	uint32_t avg;		/* smoothed fill level */
+	uint32_t fill;		/* last fill level */
+	uint32_t n_reduce;
+	uint32_t n_increase;
+	unsigned int backoff:1;	/* lowered since the last increase */
+};
+
+static inline void rate_control_init(struct rate_control *rc, uint64_t now)
+{
+	spa_zero(*rc);
+	rc->last_change = now;
+	rc->hold = RATE_CONTROL_MIN_HOLD;
+}
+
+/* Update with the number of bytes queued in a send buffer of size bytes.
+ * Returns < 0 when the quality should be lowered, > 0 when it can be
+ * raised and 0 otherwise. */
+static inline int rate_control_update(struct rate_control *rc, size_t queued,
+		size_t size, uint64_t now)
+{
+	uint32_t fill, avg = rc->avg;
+	uint64_t elapsed = now - rc->last_change;
+
+	if (size == 0)
+		return 0;
+
+	fill = (uint32_t) (SPA_MIN(queued, size) * RATE_CONTROL_SCALE / size);
+	rc->avg = (avg * 3 + fill) / 4;
+	rc->fill = fill;
+
+	if (elapsed >= RATE_CONTROL_REDUCE_HOLD &&
+	    ((fill >= RATE_CONTROL_HIGH && fill >= avg) ||
+	     (fill >= RATE_CONTROL_BUILDUP && fill > avg + RATE_CONTROL_SCALE / 64))) {
+		/* the last increase was too much, try less often */
+		if (!rc->backoff && rc->n_increase > 0 &&
+		    now - rc->last_increase < rc->hold * 2)
+			rc->hold = SPA_MIN(rc->hold * 2, RATE_CONTROL_MAX_HOLD);
+		rc->backoff = true;
+		rc->last_change = now;
+		rc->n_reduce++;
+		return -1;
+	}
+	if (rc->avg < RATE_CONTROL_LOW && elapsed >= rc->hold) {
+		/* the last increase was fine, try sooner */
+		if (!rc->backoff)
+			rc->hold = SPA_MAX(rc->hold / 2, RATE_CONTROL_MIN_HOLD);
+		rc->backoff = false;
+		rc->last_change = rc->last_increase = now;
+		rc->n_increase++;
+		return 1;
+	}
+	return 0;
+}
+
+#endif /* SPA_BLUEZ5_RATE_CONTROL_H */
@@ -0,0 +1,183 @@
+/* Spa
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <spa/utils/defs.h>
+
+#include "rate-control.h"
+
+/* A sender and a link in one process: the sender writes a stream at the
+ * bitrate picked by the rate control into a model of the L2CAP socket,
+ * like a2dp-sink does, and the link drains the socket at a capacity that
+ * changes over time. Like a BT socket, and unlike other sockets, TIOCOUTQ
+ * on the model reports the free space in the send queue. */
+
+#define TICK		(10 * SPA_NSEC_PER_MSEC)
+#define MTU		672
+#define SNDBUF		16384
+
+#define MIN_BITRATE	128000
+#define MAX_BITRATE	328000
+#define STEP		16000
+
+struct sim {
+	int sndbuf;
+	int queued;		/* bytes in the send queue of the socket */
+	uint64_t now;
+	struct rate_control rc;
+
+	uint32_t bitrate;
+	uint32_t capacity;
+	uint32_t send_credit;
+	uint32_t recv_credit;
+
+	uint32_t n_eagain;
+	uint32_t min_bitrate;
+};
+
+static void sim_init(struct sim *s)
+{
+	spa_zero(*s);
+	s->sndbuf = SNDBUF;
+	s->bitrate = s->min_bitrate = MAX_BITRATE;
+	rate_control_init(&s->rc, 0);
+}
+
+/* TIOCOUTQ on an L2CAP socket */
+static int sim_outq(struct sim *s)
+{
+	return s->sndbuf - s->queued;
+}
+
+static int sim_send(struct sim *s, int size)
+{
+	if (s->queued + size > s->sndbuf)
+		return -EAGAIN;
+	s->queued += size;
+	return size;
+}
+
+/* the same steps as SBC: lower by two, raise by one */
+static void sim_rate(struct sim *s, int res)
+{
+	if (res < 0)
+		s->bitrate = SPA_MAX(s->bitrate - 2 * STEP, (uint32_t)MIN_BITRATE);
+	else if (res > 0)
+		s->bitrate = SPA_MIN(s->bitrate + STEP, (uint32_t)MAX_BITRATE);
+	s->min_bitrate = SPA_MIN(s->min_bitrate, s->bitrate);
+}
+
+static void sim_tick(struct sim *s)
+{
+	int unsent, size;
+
+	/* send what the codec produces in one tick, in packets of at most MTU */
+	s->send_credit += s->bitrate / 8 * TICK / SPA_NSEC_PER_SEC;
+	while (s->send_credit > 0) {
+		size = SPA_MIN(s->send_credit, (uint32_t)MTU);
+
+		/* the same as a2dp-sink send_buffer() */
+		unsent = s->sndbuf - sim_outq(s);
+		sim_rate(s, rate_control_update(&s->rc, unsent, s->sndbuf, s->now));
+
+		if (sim_send(s, size) < 0) {
+			s->n_eagain++;
+			sim_rate(s, rate_control_update(&s->rc, s->sndbuf, s->sndbuf, s->now));
+			break;
+		}
+		s->send_credit -= size;
+	}
+	s->send_credit = 0;
+
+	/* the link drains at its capacity, a packet at a time */
+	s->recv_credit += s->capacity / 8 * TICK / SPA_NSEC_PER_SEC;
+	while (s->recv_credit >= MTU && s->queued > 0) {
+		size = SPA_MIN(s->queued, MTU);
+		s->queued -= size;
+		s->recv_credit -= size;
+	}
+	if (s->queued == 0)
+		s->recv_credit = 0;
+
+	s->now += TICK;
+}
+
+static void sim_run(struct sim *s, uint32_t capacity, uint64_t duration)
+{
+	uint64_t end = s->now + duration;
+
+	s->capacity = capacity;
+	while (s->now < end)
+		sim_tick(s);
+}
+
+static void test_steady(void)
+{
+	struct sim s;
+
+	sim_init(&s);
+	/* a link with room to spare never lowers the quality */
+	sim_run(&s, 2 * MAX_BITRATE, 10 * SPA_NSEC_PER_SEC);
+	spa_assert(s.n_eagain == 0);
+	spa_assert(s.rc.n_reduce == 0);
+	spa_assert(s.bitrate == MAX_BITRATE);
+}
+
+static void test_degrade(void)
+{
+	struct sim s;
+	uint32_t capacity = 208000;
+
+	sim_init(&s);
+	sim_run(&s, 2 * MAX_BITRATE, 2 * SPA_NSEC_PER_SEC);
+
+	/* when the link gets slower, the quality is lowered before the
+	 * queue is full and writes fail */
+	sim_run(&s, capacity, 10 * SPA_NSEC_PER_SEC);
+	fprintf(stderr, "degrade: bitrate %u capacity %u reduce %u increase %u eagain %u\n",
+			s.bitrate, capacity, s.rc.n_reduce, s.rc.n_increase, s.n_eagain);
+	spa_assert(s.n_eagain == 0);
+	spa_assert(s.rc.n_reduce > 0);
+	spa_assert(s.bitrate <= capacity);
+	spa_assert(s.min_bitrate >= MIN_BITRATE);
+
+	/* when it recovers, the quality goes up again */
+	sim_run(&s, 2 * MAX_BITRATE, 60 * SPA_NSEC_PER_SEC);
+	fprintf(stderr, "recover: bitrate %u reduce %u increase %u eagain %u\n",
+			s.bitrate, s.rc.n_reduce, s.rc.n_increase, s.n_eagain);
+	spa_assert(s.n_eagain == 0);
+	spa_assert(s.bitrate == MAX_BITRATE);
+}
+
+int main(int argc, char *argv[])
+{
+	test_steady();
+	test_degrade();
+	return 0;
+}
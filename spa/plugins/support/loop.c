@@ -28,7 +28,18 @@
 #include <signal.h>
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
+#include <inttypes.h>
+#include <time.h>
 #include <pthread.h>
+#include <sched.h>
+#if defined(__linux__)
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#elif defined(__FreeBSD__)
+#include <sys/types.h>
+#include <sys/umtx.h>
+#endif
 
 #include <spa/support/loop.h>
 #include <spa/support/system.h>
@@ -44,19 +55,37 @@
 
 #define DATAS_SIZE (4096 * 8)
 
+#define ATOMIC_CAS(v,ov,nv)	__atomic_compare_exchange_n(&(v), &(ov), (nv), 0, __ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)
+#define ATOMIC_INC(s)		__atomic_add_fetch(&(s), 1, __ATOMIC_SEQ_CST)
+#define ATOMIC_DEC(s)		__atomic_sub_fetch(&(s), 1, __ATOMIC_SEQ_CST)
+#define ATOMIC_LOAD(s)		__atomic_load_n(&(s), __ATOMIC_SEQ_CST)
+#define ATOMIC_STORE(s,v)	__atomic_store_n(&(s), (v), __ATOMIC_SEQ_CST)
+#define ATOMIC_XCHG(s,v)	__atomic_exchange_n(&(s), (v), __ATOMIC_SEQ_CST)
+#define ATOMIC_MAX(s,v)						\
+({								\
+	__typeof__(s) __o = ATOMIC_LOAD(s);			\
+	while ((v) > __o && !ATOMIC_CAS(s, __o, (v)));		\
+})
+
 /** \cond */
 
+struct invoke_result {
+	int res;
+	uint32_t done;			/* futex word, set when the item ran */
+};
+
 struct invoke_item {
 	size_t item_size;
 	spa_invoke_func_t func;
 	uint32_t seq;
+	uint32_t committed;		/* set when the producer is done with the item,
+					 * unused ring memory is all zero */
 	void *data;
 	size_t size;
-	bool block;
+	struct invoke_result *result;	/* for blocking invokes */
 	void *user_data;
-	int res;
+	struct invoke_item *next;	/* in the spill list */
 };
-
 static int loop_signal_event(void *object, struct spa_source *source);
 
 struct impl {
@@ -76,12 +105,32 @@ struct impl {
 	pthread_t thread;
 
 	struct spa_source *wakeup;
-	int ack_fd;
 
-	struct spa_ringbuffer buffer;
+	struct spa_ringbuffer buffer;	/* written by many threads, see ring_reserve() */
 	uint8_t *buffer_data;
 	uint8_t buffer_mem[DATAS_SIZE + 8];
 
+	struct invoke_item *spill;	/* overflow items, newest first */
+	uint32_t n_spill;		/* number of spilled items not yet flushed */
+
+	uint32_t n_queued;
+	uint32_t max_queued;		/* high-water mark of queued items */
+	uint64_t n_spilled;
+	uint64_t n_block;
+	uint64_t block_time;		/* total and max time waiting in blocking invoke */
+	uint64_t block_max;
+
+	struct source_impl *timer_source;	/* timerfd armed for the first timer */
+	uint64_t timer_armed;			/* expiration the timerfd is armed for */
+	struct source_impl **timers;		/* min-heap of armed timers */
+	uint32_t n_timers;			/* armed timers */
+	uint32_t n_timer_sources;		/* timer sources, the size of the heap */
+	uint32_t max_timer_sources;
+	uint32_t max_timers;			/* high-water mark of armed timers */
+	uint64_t n_timer_dispatch;
+	uint64_t timer_slip;			/* total and max delay of timer dispatch */
+	uint64_t timer_slip_max;
+
 	unsigned int flushing:1;
 };
 
@@ -101,6 +150,11 @@ struct source_impl {
 	} func;
 	bool enabled;
 	struct spa_source *fallback;
+
+	bool timer;			/* a timer in the timer heap */
+	uint32_t heap_index;		/* index in the timer heap or SPA_ID_INVALID */
+	uint64_t expire;		/* next expiration in nsec, 0 when disarmed */
+	uint64_t interval;		/* interval in nsec */
 };
 /** \endcond */
 
@@ -124,35 +178,187 @@ static int loop_remove_source(void *object, struct spa_source *source)
 	return spa_system_pollfd_del(impl->system, impl->poll_fd, source->fd);
 }
 
-static void flush_items(struct impl *impl)
+static inline uint64_t get_time_ns(struct impl *impl)
+{
+	struct timespec ts;
+	spa_system_clock_gettime(impl->system, CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+/* Blocking invokes wait on the done flag of their own result. The loop
+ * thread only sets the flag and wakes up the waiter, it never takes a lock
+ * that the waiter holds. */
+static void result_wait(struct invoke_result *result)
+{
+	while (__atomic_load_n(&result->done, __ATOMIC_ACQUIRE) == 0) {
+#if defined(__linux__)
+		syscall(SYS_futex, &result->done, FUTEX_WAIT_PRIVATE, 0, NULL, NULL, 0);
+#elif defined(__FreeBSD__)
+		_umtx_op(&result->done, UMTX_OP_WAIT_UINT_PRIVATE, 0, NULL, NULL);
+#else
+		sched_yield();
+#endif
+	}
+}
+
+static void result_done(struct invoke_result *result, int res)
+{
+	result->res = res;
+	__atomic_store_n(&result->done, 1, __ATOMIC_RELEASE);
+	/* the waiter can return as soon as done is set, waking up the
+	 * address of its finished stack frame is harmless */
+#if defined(__linux__)
+	syscall(SYS_futex, &result->done, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+#elif defined(__FreeBSD__)
+	_umtx_op(&result->done, UMTX_OP_WAKE_PRIVATE, 1, NULL, NULL);
+#endif
+}
+
+static void invoke_item(struct impl *impl, struct invoke_item *item)
 {
-	uint32_t index;
 	int res;
 
-	impl->flushing = true;
-	while (spa_ringbuffer_get_read_index(&impl->buffer, &index) > 0) {
+	spa_log_trace(impl->log, NAME " %p: flush item %p", impl, item);
+	res = item->func ? item->func(&impl->loop,
+			true, item->seq, item->data, item->size,
+		   item->user_data) : 0;
+
+	if (item->result)
+		result_done(item->result, res);
+
+	ATOMIC_DEC(impl->n_queued);
+}
+
+/* flush the items in the ring, stops at the first item that is still being
+ * written. Returns true when the ring is empty. */
+static bool flush_ring(struct impl *impl)
+{
+	uint32_t index, offset, l0;
+	int32_t avail;
+
+	while ((avail = spa_ringbuffer_get_read_index(&impl->buffer, &index)) > 0) {
 		struct invoke_item *item;
-		bool block;
+		size_t item_size;
 
-		item = SPA_MEMBER(impl->buffer_data, index & (DATAS_SIZE - 1), struct invoke_item);
-		block = item->block;
+		offset = index & (DATAS_SIZE - 1);
+		item = SPA_MEMBER(impl->buffer_data, offset, struct invoke_item);
+		if (!__atomic_load_n(&item->committed, __ATOMIC_ACQUIRE))
+			return false;
 
-		spa_log_trace(impl->log, NAME " %p: flush item %p", impl, item);
-		item->res = item->func ? item->func(&impl->loop,
-				true, item->seq, item->data, item->size,
-			   item->user_data) : 0;
+		invoke_item(impl, item);
 
-		spa_ringbuffer_read_update(&impl->buffer, index + item->item_size);
+		/* clear the memory again so that the committed flag of items at
+		 * any offset starts out as 0 */
+		item_size = item->item_size;
+		l0 = SPA_MIN(item_size, DATAS_SIZE - offset);
+		memset(item, 0, l0);
+		if (item_size > l0)
+			memset(impl->buffer_data, 0, item_size - l0);
 
-		if (block) {
-			if ((res = spa_system_eventfd_write(impl->system, impl->ack_fd, 1)) < 0)
-				spa_log_warn(impl->log, NAME " %p: failed to write event fd: %s",
-						impl, spa_strerror(res));
-		}
+		spa_ringbuffer_read_update(&impl->buffer, index + item_size);
+	}
+	return true;
+}
+
+static void flush_spill(struct impl *impl)
+{
+	struct invoke_item *item, *list = NULL, *next;
+
+	/* take all items and reverse them to get them in the order of
+	 * the invoke calls */
+	item = ATOMIC_XCHG(impl->spill, NULL);
+	for (; item; item = next) {
+		next = item->next;
+		item->next = list;
+		list = item;
+	}
+	for (item = list; item; item = next) {
+		next = item->next;
+		invoke_item(impl, item);
+		free(item);
+		ATOMIC_DEC(impl->n_spill);
+	}
+}
+
+static void spill_free(struct impl *impl)
+{
+	struct invoke_item *item, *next;
+
+	for (item = ATOMIC_XCHG(impl->spill, NULL); item; item = next) {
+		next = item->next;
+		free(item);
 	}
+	impl->n_spill = 0;
+}
+
+static void flush_items(struct impl *impl)
+{
+	impl->flushing = true;
+	/* spilled items were added after the ring items, only run them when
+	 * all ring items are done so that the order is preserved */
+	while (flush_ring(impl) && ATOMIC_LOAD(impl->spill) != NULL)
+		flush_spill(impl);
 	impl->flushing = false;
 }
 
+/* reserve space for an item in the ring, many threads can do this
+ * concurrently, they each get their own part of the ring. The item becomes
+ * visible to the loop when the committed flag is set. */
+static struct invoke_item *ring_reserve(struct impl *impl, size_t size)
+{
+	struct invoke_item *item;
+	uint32_t idx, offset, l0, item_size;
+	int32_t filled;
+	bool split;
+
+	idx = ATOMIC_LOAD(impl->buffer.writeindex);
+	do {
+		filled = idx - ATOMIC_LOAD(impl->buffer.readindex);
+		if (filled < 0 || filled > DATAS_SIZE) {
+			spa_log_warn(impl->log, NAME " %p: queue xrun %d", impl, filled);
+			return NULL;
+		}
+		offset = idx & (DATAS_SIZE - 1);
+		l0 = DATAS_SIZE - offset;
+
+		if (l0 > sizeof(struct invoke_item) + size) {
+			split = false;
+			item_size = SPA_ROUND_UP_N(sizeof(struct invoke_item) + size, 8);
+			if (l0 < sizeof(struct invoke_item) + item_size)
+				item_size = l0;
+		} else {
+			split = true;
+			item_size = SPA_ROUND_UP_N(l0 + size, 8);
+		}
+		if (item_size > (uint32_t)(DATAS_SIZE - filled))
+			return NULL;
+	} while (!ATOMIC_CAS(impl->buffer.writeindex, idx, idx + item_size));
+
+	item = SPA_MEMBER(impl->buffer_data, offset, struct invoke_item);
+	item->item_size = item_size;
+	item->data = split ? impl->buffer_data : SPA_MEMBER(item, sizeof(struct invoke_item), void);
+	return item;
+}
+
+static struct invoke_item *spill_alloc(struct impl *impl, size_t size)
+{
+	struct invoke_item *item;
+
+	if ((item = calloc(1, sizeof(struct invoke_item) + size)) == NULL)
+		return NULL;
+	item->item_size = sizeof(struct invoke_item) + size;
+	item->data = SPA_MEMBER(item, sizeof(struct invoke_item), void);
+	return item;
+}
+
+static void spill_push(struct impl *impl, struct invoke_item *item)
+{
+	struct invoke_item *head = ATOMIC_LOAD(impl->spill);
+	do {
+		item->next = head;
+	} while (!ATOMIC_CAS(impl->spill, head, item));
+}
+
 static int
 loop_invoke(void *object,
 	    spa_invoke_func_t func,
@@ -164,67 +370,79 @@ loop_invoke(void *object,
 {
 	struct impl *impl = object;
 	bool in_thread = pthread_equal(impl->thread, pthread_self());
-	struct invoke_item *item;
+	struct invoke_result result = { 0, 0 };
+	struct invoke_item *item = NULL;
+	bool spilled = false;
+	uint32_t queued;
 	int res;
-	int32_t filled;
-	uint32_t avail, idx, offset, l0;
 
-	filled = spa_ringbuffer_get_write_index(&impl->buffer, &idx);
-	if (filled < 0 || filled > DATAS_SIZE) {
-		spa_log_warn(impl->log, NAME " %p: queue xrun %d", impl, filled);
-		return -EPIPE;
+	if (in_thread && !impl->flushing) {
+		/* from the loop thread, run the items that are queued and then
+		 * the function itself. Items that other threads are still
+		 * writing were not queued before this call and run later, we
+		 * never wait for another thread here. */
+		flush_items(impl);
+		res = func ? func(&impl->loop, true, seq, data, size, user_data) : 0;
+		if (!block)
+			res = seq != SPA_ID_INVALID ? SPA_RESULT_RETURN_ASYNC(seq) : 0;
+		return res;
 	}
-	avail = DATAS_SIZE - filled;
-	if (avail < sizeof(struct invoke_item)) {
-		spa_log_warn(impl->log, NAME " %p: queue full %d", impl, avail);
-		return -EPIPE;
+	/* from an item that is being run, the item runs after it */
+	if (in_thread)
+		block = false;
+
+	/* while there are spilled items, new items also need to be spilled
+	 * to keep them in order */
+	if (ATOMIC_LOAD(impl->n_spill) == 0)
+		item = ring_reserve(impl, size);
+
+	if (item == NULL) {
+		if ((item = spill_alloc(impl, size)) == NULL)
+			return -errno;
+		spilled = true;
+		if (ATOMIC_INC(impl->n_spill) == 1)
+			spa_log_debug(impl->log, NAME " %p: queue full, spilling", impl);
+		ATOMIC_INC(impl->n_spilled);
 	}
-	offset = idx & (DATAS_SIZE - 1);
 
-	l0 = DATAS_SIZE - offset;
-
-	item = SPA_MEMBER(impl->buffer_data, offset, struct invoke_item);
 	item->func = func;
 	item->seq = seq;
 	item->size = size;
-	item->block = block && !in_thread;
+	item->result = block ? &result : NULL;
 	item->user_data = user_data;
 
-	spa_log_trace(impl->log, NAME " %p: add item %p filled:%d", impl, item, filled);
-
-	if (l0 > sizeof(struct invoke_item) + size) {
-		item->data = SPA_MEMBER(item, sizeof(struct invoke_item), void);
-		item->item_size = SPA_ROUND_UP_N(sizeof(struct invoke_item) + size, 8);
-		if (l0 < sizeof(struct invoke_item) + item->item_size)
-			item->item_size = l0;
-	} else {
-		item->data = impl->buffer_data;
-		item->item_size = SPA_ROUND_UP_N(l0 + size, 8);
-	}
 	if (data && size > 0)
 		memcpy(item->data, data, size);
 
-	spa_ringbuffer_write_update(&impl->buffer, idx + item->item_size);
+	queued = ATOMIC_INC(impl->n_queued);
+	ATOMIC_MAX(impl->max_queued, queued);
+
+	spa_log_trace(impl->log, NAME " %p: add item %p queued:%d spilled:%d",
+			impl, item, queued, spilled);
+
+	if (spilled)
+		spill_push(impl, item);
+	else
+		__atomic_store_n(&item->committed, 1, __ATOMIC_RELEASE);
 
-	if (in_thread) {
-		if (!impl->flushing)
-			flush_items(impl);
-	} else {
+	if (!in_thread)
 		loop_signal_event(impl, impl->wakeup);
-	}
 
-	if (block && !in_thread) {
-		uint64_t count = 1;
+	if (block) {
+		uint64_t start = get_time_ns(impl), elapsed;
 
 		spa_loop_control_hook_before(&impl->hooks_list);
 
-		if ((res = spa_system_eventfd_read(impl->system, impl->ack_fd, &count)) < 0)
-			spa_log_warn(impl->log, NAME " %p: failed to read event fd: %s",
-					impl, spa_strerror(res));
+		result_wait(&result);
 
 		spa_loop_control_hook_after(&impl->hooks_list);
 
-		res = item->res;
+		elapsed = get_time_ns(impl) - start;
+		ATOMIC_INC(impl->n_block);
+		__atomic_add_fetch(&impl->block_time, elapsed, __ATOMIC_SEQ_CST);
+		ATOMIC_MAX(impl->block_max, elapsed);
+
+		res = result.res;
 	}
 	else {
 		if (seq != SPA_ID_INVALID)
@@ -527,10 +745,9 @@ static void source_timer_func(struct spa_source *source)
 	impl->func.timer(source->data, expirations);
 }
 
-static struct spa_source *loop_add_timer(void *object,
+static struct source_impl *add_timerfd(struct impl *impl,
 					 spa_source_timer_func_t func, void *data)
 {
-	struct impl *impl = object;
 	struct source_impl *source;
 	int res;
 
@@ -556,7 +773,7 @@ static struct spa_source *loop_add_timer(void *object,
 
 	spa_list_insert(&impl->source_list, &source->link);
 
-	return &source->source;
+	return source;
 
 error_exit_close:
 	spa_system_close(impl->system, source->source.fd);
@@ -567,28 +784,193 @@ error_exit:
 	return NULL;
 }
 
+/* the timers of the loop are kept in a min-heap on their expiration time
+ * and share one timerfd that is armed for the first one. */
+static inline void heap_set(struct impl *impl, uint32_t i, struct source_impl *s)
+{
+	impl->timers[i] = s;
+	s->heap_index = i;
+}
+
+static void heap_up(struct impl *impl, uint32_t i)
+{
+	struct source_impl *s = impl->timers[i];
+
+	while (i > 0) {
+		uint32_t parent = (i - 1) / 2;
+		if (impl->timers[parent]->expire <= s->expire)
+			break;
+		heap_set(impl, i, impl->timers[parent]);
+		i = parent;
+	}
+	heap_set(impl, i, s);
+}
+
+static void heap_down(struct impl *impl, uint32_t i)
+{
+	struct source_impl *s = impl->timers[i];
+
+	while (true) {
+		uint32_t child = 2 * i + 1;
+		if (child >= impl->n_timers)
+			break;
+		if (child + 1 < impl->n_timers &&
+		    impl->timers[child + 1]->expire < impl->timers[child]->expire)
+			child++;
+		if (s->expire <= impl->timers[child]->expire)
+			break;
+		heap_set(impl, i, impl->timers[child]);
+		i = child;
+	}
+	heap_set(impl, i, s);
+}
+
+static void timer_remove(struct impl *impl, struct source_impl *s)
+{
+	uint32_t i = s->heap_index;
+
+	if (i == SPA_ID_INVALID)
+		return;
+
+	s->heap_index = SPA_ID_INVALID;
+	if (i != --impl->n_timers) {
+		heap_set(impl, i, impl->timers[impl->n_timers]);
+		heap_up(impl, i);
+		heap_down(impl, impl->timers[i]->heap_index);
+	}
+}
+
+static void timer_insert(struct impl *impl, struct source_impl *s)
+{
+	/* the heap has room for all timer sources */
+	heap_set(impl, impl->n_timers++, s);
+	heap_up(impl, s->heap_index);
+	if (impl->n_timers > impl->max_timers)
+		impl->max_timers = impl->n_timers;
+}
+
+static void timers_rearm(struct impl *impl)
+{
+	struct itimerspec its;
+	uint64_t next;
+	int res;
+
+	if (impl->timer_source == NULL)
+		return;
+
+	next = impl->n_timers > 0 ? impl->timers[0]->expire : 0;
+	if (next == impl->timer_armed)
+		return;
+
+	/* a value of 0 disarms the timerfd */
+	spa_zero(its);
+	its.it_value.tv_sec = next / SPA_NSEC_PER_SEC;
+	its.it_value.tv_nsec = next % SPA_NSEC_PER_SEC;
+	if (SPA_UNLIKELY((res = spa_system_timerfd_settime(impl->system,
+				impl->timer_source->source.fd,
+				SPA_FD_TIMER_ABSTIME, &its, NULL)) < 0)) {
+		spa_log_warn(impl->log, NAME " %p: failed to arm timer: %s",
+				impl, spa_strerror(res));
+		return;
+	}
+	impl->timer_armed = next;
+}
+
+static void on_timers(void *data, uint64_t count)
+{
+	struct impl *impl = data;
+	uint64_t now = get_time_ns(impl);
+
+	/* the timerfd has expired */
+	impl->timer_armed = 0;
+
+	while (impl->n_timers > 0 && impl->timers[0]->expire <= now) {
+		struct source_impl *s = impl->timers[0];
+		uint64_t slip = now - s->expire, expirations = 1;
+
+		impl->n_timer_dispatch++;
+		impl->timer_slip += slip;
+		if (slip > impl->timer_slip_max)
+			impl->timer_slip_max = slip;
+
+		if (s->interval > 0) {
+			expirations += slip / s->interval;
+			s->expire += expirations * s->interval;
+			heap_down(impl, 0);
+		} else {
+			s->expire = 0;
+			timer_remove(impl, s);
+		}
+		s->func.timer(s->source.data, expirations);
+	}
+	timers_rearm(impl);
+}
+
+static struct spa_source *loop_add_timer(void *object,
+					 spa_source_timer_func_t func, void *data)
+{
+	struct impl *impl = object;
+	struct source_impl *source;
+
+	if (impl->n_timer_sources == impl->max_timer_sources) {
+		uint32_t max = SPA_MAX(impl->max_timer_sources * 2, 16u);
+		struct source_impl **timers;
+
+		timers = realloc(impl->timers, max * sizeof(struct source_impl *));
+		if (timers == NULL)
+			return NULL;
+		impl->timers = timers;
+		impl->max_timer_sources = max;
+	}
+
+	source = calloc(1, sizeof(struct source_impl));
+	if (source == NULL)
+		return NULL;
+
+	source->source.loop = &impl->loop;
+	source->source.data = data;
+	source->source.fd = -1;
+	source->impl = impl;
+	source->func.timer = func;
+	source->timer = true;
+	source->heap_index = SPA_ID_INVALID;
+
+	impl->n_timer_sources++;
+	spa_list_insert(&impl->source_list, &source->link);
+
+	return &source->source;
+}
+
 static int
 loop_update_timer(void *object, struct spa_source *source,
 		  struct timespec *value, struct timespec *interval, bool absolute)
 {
 	struct impl *impl = object;
-	struct itimerspec its;
-	int flags = 0, res;
+	struct source_impl *s = SPA_CONTAINER_OF(source, struct source_impl, source);
+	uint64_t expire = 0;
 
-	spa_zero(its);
 	if (SPA_LIKELY(value)) {
-		its.it_value = *value;
+		expire = SPA_TIMESPEC_TO_NSEC(value);
 	} else if (interval) {
-		its.it_value = *interval;
+		expire = SPA_TIMESPEC_TO_NSEC(interval);
 		absolute = true;
 	}
-	if (SPA_UNLIKELY(interval))
-		its.it_interval = *interval;
-	if (SPA_LIKELY(absolute))
-		flags |= SPA_FD_TIMER_ABSTIME;
+	/* like timerfd, a value of 0 disarms the timer */
+	if (expire > 0 && !absolute)
+		expire += get_time_ns(impl);
 
-	if (SPA_UNLIKELY((res = spa_system_timerfd_settime(impl->system, source->fd, flags, &its, NULL)) < 0))
-		return res;
+	s->expire = expire;
+	s->interval = interval ? SPA_TIMESPEC_TO_NSEC(interval) : 0;
+
+	if (expire == 0)
+		timer_remove(impl, s);
+	else if (s->heap_index == SPA_ID_INVALID)
+		timer_insert(impl, s);
+	else {
+		heap_up(impl, s->heap_index);
+		heap_down(impl, s->heap_index);
+	}
+	timers_rearm(impl);
 
 	return 0;
 }
@@ -654,11 +1036,19 @@ static void loop_destroy_source(void *object, struct spa_source *source)
 
 	spa_list_remove(&impl->link);
 
-	if (impl->fallback)
+	if (impl->timer) {
+		timer_remove(impl->impl, impl);
+		timers_rearm(impl->impl);
+		impl->impl->n_timer_sources--;
+	}
+	else if (impl->fallback)
 		loop_destroy_source(impl->impl, impl->fallback);
 	else if (source->loop)
 		loop_remove_source(impl->impl, source);
 
+	if (impl == impl->impl->timer_source)
+		impl->impl->timer_source = NULL;
+
 	if (source->fd != -1 && impl->close) {
 		spa_system_close(impl->impl->system, source->fd);
 		source->fd = -1;
@@ -732,7 +1122,20 @@ static int impl_clear(struct spa_handle *handle)
 
 	process_destroy(impl);
 
-	spa_system_close(impl->system, impl->ack_fd);
+	spa_log_debug(impl->log, NAME " %p: invoke max-queued:%u spilled:%"PRIu64
+			" blocking:%"PRIu64" avg:%"PRIu64"ns max:%"PRIu64"ns", impl,
+			impl->max_queued, impl->n_spilled, impl->n_block,
+			impl->n_block ? impl->block_time / impl->n_block : 0,
+			impl->block_max);
+
+	spa_log_debug(impl->log, NAME " %p: timers max-armed:%u dispatched:%"PRIu64
+			" slip avg:%"PRIu64"ns max:%"PRIu64"ns", impl,
+			impl->max_timers, impl->n_timer_dispatch,
+			impl->n_timer_dispatch ? impl->timer_slip / impl->n_timer_dispatch : 0,
+			impl->timer_slip_max);
+
+	free(impl->timers);
+	spill_free(impl);
 	spa_system_close(impl->system, impl->poll_fd);
 
 	return 0;
@@ -796,7 +1199,12 @@ impl_init(const struct spa_handle_factory *factory,
 	spa_hook_list_init(&impl->hooks_list);
 
 	impl->buffer_data = SPA_PTR_ALIGN(impl->buffer_mem, 8, uint8_t);
+	memset(impl->buffer_data, 0, DATAS_SIZE);
 	spa_ringbuffer_init(&impl->buffer);
+	impl->spill = NULL;
+	impl->n_spill = 0;
+	impl->n_queued = impl->max_queued = 0;
+	impl->n_spilled = impl->n_block = impl->block_time = impl->block_max = 0;
 
 	impl->wakeup = loop_add_event(impl, wakeup_func, impl);
 	if (impl->wakeup == NULL) {
@@ -804,13 +1212,17 @@ impl_init(const struct spa_handle_factory *factory,
 		spa_log_error(impl->log, NAME " %p: can't create wakeup event: %m", impl);
 		goto error_exit_free_poll;
 	}
-	if ((res = spa_system_eventfd_create(impl->system,
-			SPA_FD_EVENT_SEMAPHORE | SPA_FD_CLOEXEC)) < 0) {
-		spa_log_error(impl->log, NAME " %p: can't create ack event: %s",
-				impl, spa_strerror(res));
+	impl->timers = NULL;
+	impl->n_timers = impl->n_timer_sources = impl->max_timer_sources = 0;
+	impl->max_timers = 0;
+	impl->n_timer_dispatch = impl->timer_slip = impl->timer_slip_max = 0;
+	impl->timer_armed = 0;
+	impl->timer_source = add_timerfd(impl, on_timers, impl);
+	if (impl->timer_source == NULL) {
+		res = -errno;
+		spa_log_error(impl->log, NAME " %p: can't create timer: %m", impl);
 		goto error_exit_free_wakeup;
 	}
-	impl->ack_fd = res;
 
 	spa_log_debug(impl->log, NAME " %p: initialized", impl);
 
@@ -818,6 +1230,7 @@ impl_init(const struct spa_handle_factory *factory,
 
 error_exit_free_wakeup:
 	loop_destroy_source(impl, impl->wakeup);
+	process_destroy(impl);
 error_exit_free_poll:
 	spa_system_close(impl->system, impl->poll_fd);
 error_exit:
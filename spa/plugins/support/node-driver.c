@@ -121,6 +121,10 @@ static void on_timeout(struct spa_source *source)
 				this->timer_source.fd, &expirations) < 0)
 		perror("read timerfd");
 
+	/* the timer was stopped after this timeout was dispatched */
+	if (!this->started)
+		return;
+
 	nsec = this->next_time;
 
 	if (SPA_LIKELY(this->position)) {
@@ -148,6 +152,15 @@ static void on_timeout(struct spa_source *source)
 	set_timer(this, this->next_time);
 }
 
+/* the timeout rearms the timer, stop it from the data loop */
+static int do_stop_timer(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	struct impl *this = user_data;
+	set_timer(this, 0);
+	return 0;
+}
+
 static int impl_node_send_command(void *object, const struct spa_command *command)
 {
 	struct impl *this = object;
@@ -175,7 +188,7 @@ static int impl_node_send_command(void *object, const struct spa_command *comman
 		if (!this->started)
 			return 0;
 		this->started = false;
-		set_timer(this, 0);
+		spa_loop_invoke(this->data_loop, do_stop_timer, 0, NULL, 0, true, this);
 		break;
 	default:
 		return -ENOTSUP;
@@ -223,6 +223,10 @@ static void on_timeout(struct spa_source *source)
 				this->timer_source.fd, &expirations) < 0)
 		perror("read timerfd");
 
+	/* the timer was stopped after this timeout was dispatched */
+	if (!this->started)
+		return;
+
 	nsec = this->next_time;
 
 	if (SPA_LIKELY(this->position)) {
@@ -249,6 +253,15 @@ static void on_timeout(struct spa_source *source)
 	set_timer(this, this->next_time);
 }
 
+/* the timeout rearms the timer, stop it from the data loop */
+static int do_stop_timer(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	struct impl *this = user_data;
+	set_timer(this, 0);
+	return 0;
+}
+
 static int impl_node_send_command(void *object, const struct spa_command *command)
 {
 	struct impl *this = object;
@@ -274,8 +287,8 @@ static int impl_node_send_command(void *object, const struct spa_command *comman
 
 		clock_gettime(CLOCK_MONOTONIC, &now);
 		this->next_time = SPA_TIMESPEC_TO_NSEC(&now);
-		set_timer(this, this->next_time);
 		this->started = true;
+		set_timer(this, this->next_time);
 		break;
 	}
 	case SPA_NODE_COMMAND_Suspend:
@@ -283,7 +296,7 @@ static int impl_node_send_command(void *object, const struct spa_command *comman
 		if (!this->started)
 			return 0;
 		this->started = false;
-		set_timer(this, 0);
+		spa_loop_invoke(this->data_loop, do_stop_timer, 0, NULL, 0, true, this);
 		break;
 
 	default:
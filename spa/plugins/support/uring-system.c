@@ -0,0 +1,765 @@
+/* Spa
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <unistd.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <signal.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include <spa/support/log.h>
+#include <spa/support/system.h>
+#include <spa/support/plugin.h>
+#include <spa/utils/type.h>
+#include <spa/utils/names.h>
+#include <spa/utils/result.h>
+
+#define NAME "uring-system"
+
+#define DEFAULT_ENTRIES	256
+
+#ifndef TFD_TIMER_CANCEL_ON_SET
+#  define TFD_TIMER_CANCEL_ON_SET (1 << 1)
+#endif
+
+struct ring {
+	int fd;
+	unsigned int entries;
+
+	void *sq_ptr;
+	size_t sq_size;
+	unsigned int *sq_head;
+	unsigned int *sq_tail;
+	unsigned int *sq_mask;
+	unsigned int *sq_flags;
+	unsigned int *sq_array;
+	struct io_uring_sqe *sqes;
+	size_t sqes_size;
+
+	void *cq_ptr;
+	size_t cq_size;
+	unsigned int *cq_head;
+	unsigned int *cq_tail;
+	unsigned int *cq_mask;
+	struct io_uring_cqe *cqes;
+};
+
+/* eventfd writes are queued on the ring by the thread that polls the
+ * loop and submitted together before it waits for the next events */
+struct impl {
+	struct spa_handle handle;
+	struct spa_system system;
+        struct spa_log *log;
+
+	struct ring ring;
+	unsigned int sqpoll:1;
+
+	pthread_mutex_t lock;		/* taken by the polling thread to queue and
+					 * submit and by a closing thread to drain */
+
+	unsigned int tail;		/* local copy of the sq tail */
+	unsigned int n_pending;		/* queued but not yet submitted */
+
+	uint64_t *values;		/* the counts of the queued writes */
+	int *fds;			/* the fds of the queued writes */
+	uint32_t *free_values;
+	uint32_t n_free;
+	uint32_t n_values;
+
+	uint64_t n_queued;
+	uint64_t n_submit;
+	uint32_t max_batch;
+};
+
+static __thread struct impl *current_ring;
+
+static inline int ring_setup(unsigned int entries, struct io_uring_params *p)
+{
+	return syscall(__NR_io_uring_setup, entries, p);
+}
+
+static inline int ring_enter(struct ring *r, unsigned int to_submit,
+		unsigned int min_complete, unsigned int flags)
+{
+	return syscall(__NR_io_uring_enter, r->fd, to_submit, min_complete,
+			flags, NULL, 0);
+}
+
+static inline int ring_register(struct ring *r, unsigned int opcode,
+		void *arg, unsigned int nr_args)
+{
+	return syscall(__NR_io_uring_register, r->fd, opcode, arg, nr_args);
+}
+
+static bool ring_has_write(struct ring *r)
+{
+	struct io_uring_probe *probe;
+	size_t len = sizeof(*probe) + 256 * sizeof(struct io_uring_probe_op);
+	bool res = false;
+
+	/* kernels before 5.6 have neither the probe nor the write opcode */
+	if ((probe = calloc(1, len)) == NULL)
+		return false;
+	if (ring_register(r, IORING_REGISTER_PROBE, probe, 256) >= 0 &&
+	    probe->last_op >= IORING_OP_WRITE &&
+	    (probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED))
+		res = true;
+	free(probe);
+	return res;
+}
+
+static void ring_free(struct ring *r)
+{
+	if (r->sqes)
+		munmap(r->sqes, r->sqes_size);
+	if (r->cq_ptr && r->cq_ptr != r->sq_ptr)
+		munmap(r->cq_ptr, r->cq_size);
+	if (r->sq_ptr)
+		munmap(r->sq_ptr, r->sq_size);
+	if (r->fd >= 0)
+		close(r->fd);
+	spa_zero(*r);
+	r->fd = -1;
+}
+
+static int ring_init(struct ring *r, unsigned int entries, bool sqpoll)
+{
+	struct io_uring_params p;
+	int res;
+
+	spa_zero(*r);
+	spa_zero(p);
+	if (sqpoll)
+		p.flags |= IORING_SETUP_SQPOLL;
+
+	if ((r->fd = ring_setup(entries, &p)) < 0)
+		return -errno;
+
+	r->entries = p.sq_entries;
+	r->sq_size = p.sq_off.array + p.sq_entries * sizeof(unsigned int);
+	r->cq_size = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if (p.features & IORING_FEAT_SINGLE_MMAP)
+		r->sq_size = r->cq_size = SPA_MAX(r->sq_size, r->cq_size);
+
+	r->sq_ptr = mmap(NULL, r->sq_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQ_RING);
+	if (r->sq_ptr == MAP_FAILED) {
+		r->sq_ptr = NULL;
+		goto error;
+	}
+	if (p.features & IORING_FEAT_SINGLE_MMAP) {
+		r->cq_ptr = r->sq_ptr;
+	} else {
+		r->cq_ptr = mmap(NULL, r->cq_size, PROT_READ | PROT_WRITE,
+				MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_CQ_RING);
+		if (r->cq_ptr == MAP_FAILED) {
+			r->cq_ptr = NULL;
+			goto error;
+		}
+	}
+	r->sqes_size = p.sq_entries * sizeof(struct io_uring_sqe);
+	r->sqes = mmap(NULL, r->sqes_size, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, r->fd, IORING_OFF_SQES);
+	if (r->sqes == MAP_FAILED) {
+		r->sqes = NULL;
+		goto error;
+	}
+
+	r->sq_head = SPA_MEMBER(r->sq_ptr, p.sq_off.head, unsigned int);
+	r->sq_tail = SPA_MEMBER(r->sq_ptr, p.sq_off.tail, unsigned int);
+	r->sq_mask = SPA_MEMBER(r->sq_ptr, p.sq_off.ring_mask, unsigned int);
+	r->sq_flags = SPA_MEMBER(r->sq_ptr, p.sq_off.flags, unsigned int);
+	r->sq_array = SPA_MEMBER(r->sq_ptr, p.sq_off.array, unsigned int);
+	r->cq_head = SPA_MEMBER(r->cq_ptr, p.cq_off.head, unsigned int);
+	r->cq_tail = SPA_MEMBER(r->cq_ptr, p.cq_off.tail, unsigned int);
+	r->cq_mask = SPA_MEMBER(r->cq_ptr, p.cq_off.ring_mask, unsigned int);
+	r->cqes = SPA_MEMBER(r->cq_ptr, p.cq_off.cqes, struct io_uring_cqe);
+
+	return 0;
+error:
+	res = -errno;
+	ring_free(r);
+	return res;
+}
+
+static void ring_reap(struct impl *impl)
+{
+	struct ring *r = &impl->ring;
+	unsigned int head = *r->cq_head, tail;
+
+	tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+	for (; head != tail; head++) {
+		struct io_uring_cqe *cqe = &r->cqes[head & *r->cq_mask];
+
+		uint32_t value = cqe->user_data;
+
+		if (SPA_UNLIKELY(cqe->res < 0))
+			spa_log_warn(impl->log, NAME " %p: eventfd write to fd:%d failed: %s",
+					impl, impl->fds[value], spa_strerror(cqe->res));
+		impl->free_values[impl->n_free++] = value;
+	}
+	__atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+}
+
+static int ring_flush(struct impl *impl, bool wait)
+{
+	struct ring *r = &impl->ring;
+	unsigned int flags = 0;
+	int res = 0;
+
+	if (impl->sqpoll) {
+		__atomic_thread_fence(__ATOMIC_SEQ_CST);
+		if (__atomic_load_n(r->sq_flags, __ATOMIC_RELAXED) & IORING_SQ_NEED_WAKEUP)
+			flags |= IORING_ENTER_SQ_WAKEUP;
+	}
+	if (wait)
+		flags |= IORING_ENTER_GETEVENTS;
+
+	if (impl->sqpoll)
+		impl->n_pending = 0;
+
+	if (impl->n_pending > 0 || flags != 0) {
+		unsigned int to_submit = impl->n_pending;
+
+		if (to_submit > impl->max_batch)
+			impl->max_batch = to_submit;
+		impl->n_submit++;
+
+		res = ring_enter(r, to_submit, wait ? 1 : 0, flags);
+		if (SPA_UNLIKELY(res < 0)) {
+			res = -errno;
+			spa_log_warn(impl->log, NAME " %p: submit failed: %s",
+					impl, spa_strerror(res));
+		} else {
+			impl->n_pending -= SPA_MIN((unsigned int)res, impl->n_pending);
+		}
+	}
+	ring_reap(impl);
+	return res;
+}
+
+static void ring_drain(struct impl *impl)
+{
+	/* submit everything and wait until all writes completed */
+	while (impl->n_free < impl->n_values)
+		if (ring_flush(impl, true) < 0)
+			break;
+}
+
+static int ring_queue_write(struct impl *impl, int fd, uint64_t count)
+{
+	struct ring *r = &impl->ring;
+	struct io_uring_sqe *sqe;
+	unsigned int idx;
+	uint32_t value;
+
+	if (SPA_UNLIKELY(impl->n_free == 0)) {
+		/* all values are in flight, wait for one to complete */
+		ring_flush(impl, true);
+		if (impl->n_free == 0)
+			return -EAGAIN;
+	}
+	if (SPA_UNLIKELY(impl->tail - __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE) >= r->entries))
+		return -EAGAIN;
+
+	value = impl->free_values[--impl->n_free];
+	impl->values[value] = count;
+	impl->fds[value] = fd;
+
+	idx = impl->tail & *r->sq_mask;
+	sqe = &r->sqes[idx];
+	memset(sqe, 0, sizeof(*sqe));
+	sqe->opcode = IORING_OP_WRITE;
+	sqe->fd = fd;
+	sqe->off = (uint64_t) -1;
+	sqe->addr = (uintptr_t) &impl->values[value];
+	sqe->len = sizeof(uint64_t);
+	sqe->user_data = value;
+	r->sq_array[idx] = idx;
+
+	__atomic_store_n(r->sq_tail, ++impl->tail, __ATOMIC_RELEASE);
+	impl->n_pending++;
+	impl->n_queued++;
+
+	/* with a full queue or a sleeping poll thread, submit now */
+	if (impl->n_pending == r->entries || impl->sqpoll)
+		ring_flush(impl, false);
+
+	return 0;
+}
+
+static ssize_t impl_read(void *object, int fd, void *buf, size_t count)
+{
+	ssize_t res = read(fd, buf, count);
+	return res < 0 ? -errno : res;
+}
+
+static ssize_t impl_write(void *object, int fd, const void *buf, size_t count)
+{
+	ssize_t res = write(fd, buf, count);
+	return res < 0 ? -errno : res;
+}
+
+static int impl_ioctl(void *object, int fd, unsigned long request, ...)
+{
+	int res;
+	va_list ap;
+	long arg;
+
+	va_start(ap, request);
+	arg = va_arg(ap, long);
+	res = ioctl(fd, request, arg);
+	va_end(ap);
+
+	return res < 0 ? -errno : res;
+}
+
+static int impl_close(void *object, int fd)
+{
+	struct impl *impl = object;
+	int res;
+
+	if (impl->ring.fd >= 0) {
+		/* queued writes refer to the fd by number, they need to
+		 * complete before the number can be reused. Any thread can
+		 * close, submit and wait for them under the lock. */
+		pthread_mutex_lock(&impl->lock);
+		if (impl->n_free < impl->n_values)
+			ring_drain(impl);
+		res = close(fd);
+		pthread_mutex_unlock(&impl->lock);
+	} else {
+		res = close(fd);
+	}
+	spa_log_debug(impl->log, NAME " %p: close fd:%d", impl, fd);
+	return res < 0 ? -errno : res;
+}
+
+/* clock */
+static int impl_clock_gettime(void *object,
+			int clockid, struct timespec *value)
+{
+	int res = clock_gettime(clockid, value);
+	return res < 0 ? -errno : res;
+}
+
+static int impl_clock_getres(void *object,
+			int clockid, struct timespec *res)
+{
+	int r = clock_getres(clockid, res);
+	return r < 0 ? -errno : r;
+}
+
+/* poll */
+static int impl_pollfd_create(void *object, int flags)
+{
+	struct impl *impl = object;
+	int fl = 0, res;
+	if (flags & SPA_FD_CLOEXEC)
+		fl |= EPOLL_CLOEXEC;
+	res = epoll_create1(fl);
+	spa_log_debug(impl->log, NAME " %p: new fd:%d", impl, res);
+	return res < 0 ? -errno : res;
+}
+
+static int impl_pollfd_add(void *object, int pfd, int fd, uint32_t events, void *data)
+{
+	struct epoll_event ep;
+	int res;
+
+	spa_zero(ep);
+	ep.events = events;
+	ep.data.ptr = data;
+
+	res = epoll_ctl(pfd, EPOLL_CTL_ADD, fd, &ep);
+	return res < 0 ? -errno : res;
+}
+
+static int impl_pollfd_mod(void *object, int pfd, int fd, uint32_t events, void *data)
+{
+	struct epoll_event ep;
+	int res;
+
+	spa_zero(ep);
+	ep.events = events;
+	ep.data.ptr = data;
+
+	res = epoll_ctl(pfd, EPOLL_CTL_MOD, fd, &ep);
+	return res < 0 ? -errno : res;
+}
+
+static int impl_pollfd_del(void *object, int pfd, int fd)
+{
+	int res = epoll_ctl(pfd, EPOLL_CTL_DEL, fd, NULL);
+	return res < 0 ? -errno : res;
+}
+
+static int impl_pollfd_wait(void *object, int pfd,
+		struct spa_poll_event *ev, int n_ev, int timeout)
+{
+	struct impl *impl = object;
+	struct epoll_event ep[n_ev];
+	int i, nfds;
+
+	if (impl->ring.fd >= 0) {
+		/* the writes of a nested loop's dispatch are not held back
+		 * while this loop waits */
+		if (current_ring != NULL && current_ring != impl) {
+			pthread_mutex_lock(&current_ring->lock);
+			ring_flush(current_ring, false);
+			pthread_mutex_unlock(&current_ring->lock);
+		}
+		current_ring = impl;
+		pthread_mutex_lock(&impl->lock);
+		ring_flush(impl, false);
+		pthread_mutex_unlock(&impl->lock);
+	}
+
+	if (SPA_UNLIKELY((nfds = epoll_wait(pfd, ep, n_ev, timeout)) < 0))
+		return -errno;
+
+        for (i = 0; i < nfds; i++) {
+                ev[i].events = ep[i].events;
+                ev[i].data = ep[i].data.ptr;
+        }
+	return nfds;
+}
+
+/* timers */
+static int impl_timerfd_create(void *object, int clockid, int flags)
+{
+	struct impl *impl = object;
+	int fl = 0, res;
+	if (flags & SPA_FD_CLOEXEC)
+		fl |= TFD_CLOEXEC;
+	if (flags & SPA_FD_NONBLOCK)
+		fl |= TFD_NONBLOCK;
+	res = timerfd_create(clockid, fl);
+	spa_log_debug(impl->log, NAME " %p: new fd:%d", impl, res);
+	return res < 0 ? -errno : res;
+}
+
+static int impl_timerfd_settime(void *object,
+			int fd, int flags,
+			const struct itimerspec *new_value,
+			struct itimerspec *old_value)
+{
+	int fl = 0, res;
+	if (flags & SPA_FD_TIMER_ABSTIME)
+		fl |= TFD_TIMER_ABSTIME;
+	if (flags & SPA_FD_TIMER_CANCEL_ON_SET)
+		fl |= TFD_TIMER_CANCEL_ON_SET;
+	res = timerfd_settime(fd, fl, new_value, old_value);
+	return res < 0 ? -errno : res;
+}
+
+static int impl_timerfd_gettime(void *object,
+			int fd, struct itimerspec *curr_value)
+{
+	int res = timerfd_gettime(fd, curr_value);
+	return res < 0 ? -errno : res;
+
+}
+static int impl_timerfd_read(void *object, int fd, uint64_t *expirations)
+{
+	if (read(fd, expirations, sizeof(uint64_t)) != sizeof(uint64_t))
+		return -errno;
+	return 0;
+}
+
+/* events */
+static int impl_eventfd_create(void *object, int flags)
+{
+	struct impl *impl = object;
+	int fl = 0, res;
+	if (flags & SPA_FD_CLOEXEC)
+		fl |= EFD_CLOEXEC;
+	if (flags & SPA_FD_NONBLOCK)
+		fl |= EFD_NONBLOCK;
+	if (flags & SPA_FD_EVENT_SEMAPHORE)
+		fl |= EFD_SEMAPHORE;
+	res = eventfd(0, fl);
+	spa_log_debug(impl->log, NAME " %p: new fd:%d", impl, res);
+	return res < 0 ? -errno : res;
+}
+
+static int impl_eventfd_write(void *object, int fd, uint64_t count)
+{
+	struct impl *impl = object;
+	int res;
+
+	/* only the polling thread queues on the submission queue */
+	if (current_ring == impl) {
+		pthread_mutex_lock(&impl->lock);
+		res = ring_queue_write(impl, fd, count);
+		pthread_mutex_unlock(&impl->lock);
+		if (res == 0)
+			return 0;
+	}
+
+	if (write(fd, &count, sizeof(uint64_t)) != sizeof(uint64_t))
+		return -errno;
+	return 0;
+}
+
+static int impl_eventfd_read(void *object, int fd, uint64_t *count)
+{
+	if (read(fd, count, sizeof(uint64_t)) != sizeof(uint64_t))
+		return -errno;
+	return 0;
+}
+
+/* signals */
+static int impl_signalfd_create(void *object, int signal, int flags)
+{
+	struct impl *impl = object;
+	sigset_t mask;
+	int res, fl = 0;
+
+	if (flags & SPA_FD_CLOEXEC)
+		fl |= SFD_CLOEXEC;
+	if (flags & SPA_FD_NONBLOCK)
+		fl |= SFD_NONBLOCK;
+
+	sigemptyset(&mask);
+	sigaddset(&mask, signal);
+	res = signalfd(-1, &mask, fl);
+	sigprocmask(SIG_BLOCK, &mask, NULL);
+	spa_log_debug(impl->log, NAME " %p: new fd:%d", impl, res);
+
+	return res < 0 ? -errno : res;
+}
+
+static int impl_signalfd_read(void *object, int fd, int *signal)
+{
+	struct signalfd_siginfo signal_info;
+	int len;
+
+	len = read(fd, &signal_info, sizeof signal_info);
+	if (!(len == -1 && errno == EAGAIN) && len != sizeof signal_info)
+		return -errno;
+
+	*signal = signal_info.ssi_signo;
+
+	return 0;
+}
+
+static const struct spa_system_methods impl_system = {
+	SPA_VERSION_SYSTEM_METHODS,
+	.read = impl_read,
+	.write = impl_write,
+	.ioctl = impl_ioctl,
+	.close = impl_close,
+	.clock_gettime = impl_clock_gettime,
+	.clock_getres = impl_clock_getres,
+	.pollfd_create = impl_pollfd_create,
+	.pollfd_add = impl_pollfd_add,
+	.pollfd_mod = impl_pollfd_mod,
+	.pollfd_del = impl_pollfd_del,
+	.pollfd_wait = impl_pollfd_wait,
+	.timerfd_create = impl_timerfd_create,
+	.timerfd_settime = impl_timerfd_settime,
+	.timerfd_gettime = impl_timerfd_gettime,
+	.timerfd_read = impl_timerfd_read,
+	.eventfd_create = impl_eventfd_create,
+	.eventfd_write = impl_eventfd_write,
+	.eventfd_read = impl_eventfd_read,
+	.signalfd_create = impl_signalfd_create,
+	.signalfd_read = impl_signalfd_read,
+};
+
+static int impl_get_interface(struct spa_handle *handle, const char *type, void **interface)
+{
+	struct impl *impl;
+
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+	spa_return_val_if_fail(interface != NULL, -EINVAL);
+
+	impl = (struct impl *) handle;
+
+	if (strcmp(type, SPA_TYPE_INTERFACE_System) == 0)
+		*interface = &impl->system;
+	else
+		return -ENOENT;
+
+	return 0;
+}
+
+static int impl_clear(struct spa_handle *handle)
+{
+	struct impl *impl;
+
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+
+	impl = (struct impl *) handle;
+
+	if (impl->ring.fd >= 0) {
+		ring_drain(impl);
+
+		spa_log_debug(impl->log, NAME " %p: queued:%"PRIu64" submits:%"PRIu64
+				" max-batch:%u", impl, impl->n_queued, impl->n_submit,
+				impl->max_batch);
+		ring_free(&impl->ring);
+	}
+	if (current_ring == impl)
+		current_ring = NULL;
+
+	free(impl->values);
+	free(impl->fds);
+	free(impl->free_values);
+	pthread_mutex_destroy(&impl->lock);
+
+	return 0;
+}
+
+static size_t
+impl_get_size(const struct spa_handle_factory *factory,
+	      const struct spa_dict *params)
+{
+	return sizeof(struct impl);
+}
+
+static int
+impl_init(const struct spa_handle_factory *factory,
+	  struct spa_handle *handle,
+	  const struct spa_dict *info,
+	  const struct spa_support *support,
+	  uint32_t n_support)
+{
+	struct impl *impl;
+	const char *str;
+	uint32_t i, entries = DEFAULT_ENTRIES;
+	pthread_mutexattr_t attr;
+	int res;
+
+	spa_return_val_if_fail(factory != NULL, -EINVAL);
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+
+	handle->get_interface = impl_get_interface;
+	handle->clear = impl_clear;
+
+	impl = (struct impl *) handle;
+	impl->system.iface = SPA_INTERFACE_INIT(
+			SPA_TYPE_INTERFACE_System,
+			SPA_VERSION_SYSTEM,
+			&impl_system, impl);
+
+	impl->log = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Log);
+
+	/* the polling thread can be realtime, a closing thread that holds
+	 * the lock inherits its priority */
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_setprotocol(&attr, PTHREAD_PRIO_INHERIT);
+	pthread_mutex_init(&impl->lock, &attr);
+	pthread_mutexattr_destroy(&attr);
+
+	if (info && (str = spa_dict_lookup(info, "system.io-uring.entries")) != NULL)
+		entries = SPA_CLAMP(atoi(str), 8, 4096);
+	if (info && (str = spa_dict_lookup(info, "system.io-uring.sqpoll")) != NULL)
+		impl->sqpoll = strcmp(str, "true") == 0 || atoi(str) == 1;
+
+	res = ring_init(&impl->ring, entries, impl->sqpoll);
+	if (res < 0 && impl->sqpoll) {
+		/* SQPOLL needs privileges on older kernels */
+		spa_log_info(impl->log, NAME " %p: can't set up io_uring with sqpoll: %s",
+				impl, spa_strerror(res));
+		impl->sqpoll = false;
+		res = ring_init(&impl->ring, entries, false);
+	}
+	if (res >= 0 && !ring_has_write(&impl->ring)) {
+		ring_free(&impl->ring);
+		res = -ENOTSUP;
+	}
+	if (res < 0) {
+		/* without io_uring, all writes are done directly */
+		spa_log_warn(impl->log, NAME " %p: can't set up io_uring: %s",
+				impl, spa_strerror(res));
+		impl->ring.fd = -1;
+		impl->sqpoll = false;
+	} else {
+		/* the cq is twice the size of the sq, keep that many
+		 * writes in flight */
+		entries = impl->ring.entries * 2;
+		impl->values = calloc(entries, sizeof(uint64_t));
+		impl->fds = calloc(entries, sizeof(int));
+		impl->free_values = calloc(entries, sizeof(uint32_t));
+		if (impl->values == NULL || impl->fds == NULL ||
+		    impl->free_values == NULL) {
+			res = -errno;
+			free(impl->values);
+			free(impl->fds);
+			free(impl->free_values);
+			ring_free(&impl->ring);
+			pthread_mutex_destroy(&impl->lock);
+			return res;
+		}
+		for (i = 0; i < entries; i++)
+			impl->free_values[impl->n_free++] = entries - 1 - i;
+		impl->n_values = entries;
+	}
+
+	spa_log_debug(impl->log, NAME " %p: initialized entries:%u sqpoll:%d", impl,
+			impl->ring.entries, impl->sqpoll);
+
+	return 0;
+}
+
+static const struct spa_interface_info impl_interfaces[] = {
+	{SPA_TYPE_INTERFACE_System,},
+};
+
+static int
+impl_enum_interface_info(const struct spa_handle_factory *factory,
+			 const struct spa_interface_info **info,
+			 uint32_t *index)
+{
+	spa_return_val_if_fail(factory != NULL, -EINVAL);
+	spa_return_val_if_fail(info != NULL, -EINVAL);
+	spa_return_val_if_fail(index != NULL, -EINVAL);
+
+	if (*index >= SPA_N_ELEMENTS(impl_interfaces))
+		return 0;
+
+	*info = &impl_interfaces[(*index)++];
+	return 1;
+}
+
+const struct spa_handle_factory spa_support_uring_system_factory = {
+	SPA_VERSION_HANDLE_FACTORY,
+	SPA_NAME_SUPPORT_SYSTEM,
+	NULL,
+	impl_get_size,
+	impl_init,
+	impl_enum_interface_info
+};
@@ -0,0 +1,309 @@
+/* Spa
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+
+#include "../audioconvert/test-helper.h"
+#include "video-ops.h"
+
+static uint32_t cpu_flags;
+
+typedef void (*video_func_t) (struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width);
+
+struct stats {
+	uint32_t width;
+	uint32_t height;
+	uint64_t perf;
+	const char *name;
+	const char *impl;
+};
+
+#define MAX_WIDTH	1920
+#define MAX_HEIGHT	1080
+
+#define MAX_COUNT 100
+
+static uint8_t line_in[4][MAX_WIDTH * 4];
+static uint8_t line_out[4][MAX_WIDTH * 4];
+
+static uint8_t frame_in[MAX_WIDTH * MAX_HEIGHT * 4];
+static uint8_t frame_out[MAX_WIDTH * MAX_HEIGHT * 4];
+
+static const int line_widths[] = { 64, 640, 1280, 1920 };
+static const struct spa_rectangle frame_sizes[] = {
+	{ 640, 480 },
+	{ 1280, 720 },
+	{ 1920, 1080 },
+};
+
+#define MAX_RESULTS	SPA_N_ELEMENTS(line_widths) * 40 + SPA_N_ELEMENTS(frame_sizes) * 40
+
+static uint32_t n_results = 0;
+static struct stats results[MAX_RESULTS];
+
+static void run_test1(const char *name, const char *impl, video_func_t func, int width)
+{
+	int i, j;
+	const void *ip[4];
+	void *op[4];
+	struct timespec ts;
+	uint64_t count, t1, t2;
+	struct video_convert conv;
+
+	static const int32_t yuv_rgb[5] = { 298, 409, -100, -208, 516 };
+	static const int32_t rgb_yuv[9] = { 66, 129, 25, -38, -74, 112, 112, -94, -18 };
+
+	spa_zero(conv);
+	memcpy(conv.yuv_rgb, yuv_rgb, sizeof(yuv_rgb));
+	memcpy(conv.rgb_yuv, rgb_yuv, sizeof(rgb_yuv));
+	/* the scaler downscales by a factor of 2 */
+	conv.src_width = width * 2;
+
+	for (j = 0; j < 4; j++) {
+		ip[j] = line_in[j];
+		op[j] = line_out[j];
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	count = 0;
+	for (i = 0; i < MAX_COUNT * 10; i++) {
+		func(&conv, op, ip, width);
+		count++;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	spa_assert(n_results < MAX_RESULTS);
+
+	results[n_results++] = (struct stats) {
+		.width = width,
+		.height = 1,
+		.perf = count * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1),
+		.name = name,
+		.impl = impl
+	};
+}
+
+static void run_test(const char *name, const char *impl, video_func_t func)
+{
+	size_t i;
+
+	for (i = 0; i < SPA_N_ELEMENTS(line_widths); i++)
+		run_test1(name, impl, func, line_widths[i]);
+}
+
+static void init_frame(struct video_frame *frame, uint8_t *data, uint32_t format,
+		uint32_t width, uint32_t height)
+{
+	struct video_layout layout;
+	uint32_t i;
+
+	spa_assert(video_layout_init(&layout, format, width, height, 0) == 0);
+	for (i = 0; i < layout.n_planes; i++) {
+		frame->data[i] = data + layout.offset[i];
+		frame->stride[i] = layout.stride[i];
+	}
+}
+
+static void run_frame1(const char *name, const char *impl, uint32_t flags,
+		uint32_t src_fmt, uint32_t dst_fmt, uint32_t width, uint32_t height,
+		uint32_t dst_width, uint32_t dst_height)
+{
+	int i;
+	struct timespec ts;
+	uint64_t count, t1, t2;
+	struct video_convert conv;
+	struct video_frame src, dst;
+
+	spa_zero(conv);
+	conv.src_fmt = src_fmt;
+	conv.dst_fmt = dst_fmt;
+	conv.src_width = width;
+	conv.src_height = height;
+	conv.dst_width = dst_width;
+	conv.dst_height = dst_height;
+	conv.cpu_flags = flags;
+	spa_assert(video_convert_init(&conv) == 0);
+
+	init_frame(&src, frame_in, src_fmt, width, height);
+	init_frame(&dst, frame_out, dst_fmt, dst_width, dst_height);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	count = 0;
+	for (i = 0; i < MAX_COUNT; i++) {
+		video_convert_process(&conv, &dst, &src);
+		count++;
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	video_convert_free(&conv);
+
+	spa_assert(n_results < MAX_RESULTS);
+
+	results[n_results++] = (struct stats) {
+		.width = width,
+		.height = height,
+		.perf = count * (uint64_t)SPA_NSEC_PER_SEC / (t2 - t1),
+		.name = name,
+		.impl = impl
+	};
+}
+
+static void run_frame(const char *name, uint32_t src_fmt, uint32_t dst_fmt, bool scale)
+{
+	size_t i;
+
+	for (i = 0; i < SPA_N_ELEMENTS(frame_sizes); i++) {
+		uint32_t w = frame_sizes[i].width, h = frame_sizes[i].height;
+		uint32_t dw = scale ? w / 2 : w, dh = scale ? h / 2 : h;
+
+		run_frame1(name, "c", 0, src_fmt, dst_fmt, w, h, dw, dh);
+		if (cpu_flags != 0)
+			run_frame1(name, "simd", cpu_flags, src_fmt, dst_fmt, w, h, dw, dh);
+	}
+}
+
+static void test_yuv_rgb(void)
+{
+	run_test("test_yuv_rgba", "c", video_yuv_to_rgba_c);
+	run_test("test_yuv_bgra", "c", video_yuv_to_bgra_c);
+#if defined (HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2) {
+		run_test("test_yuv_rgba", "sse2", video_yuv_to_rgba_sse2);
+		run_test("test_yuv_bgra", "sse2", video_yuv_to_bgra_sse2);
+	}
+#endif
+#if defined (HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_yuv_rgba", "avx2", video_yuv_to_rgba_avx2);
+		run_test("test_yuv_bgra", "avx2", video_yuv_to_bgra_avx2);
+	}
+#endif
+#if defined (HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON) {
+		run_test("test_yuv_rgba", "neon", video_yuv_to_rgba_neon);
+		run_test("test_yuv_bgra", "neon", video_yuv_to_bgra_neon);
+	}
+#endif
+	run_test("test_rgb_yuv", "c", video_rgb_to_yuv_c);
+}
+
+static void test_422_420(void)
+{
+	run_test("test_yuy2_i420", "c", video_yuy2_to_i420_c);
+	run_test("test_uyvy_i420", "c", video_uyvy_to_i420_c);
+	run_test("test_yuy2_nv12", "c", video_yuy2_to_nv12_c);
+	run_test("test_uyvy_nv12", "c", video_uyvy_to_nv12_c);
+#if defined (HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2) {
+		run_test("test_yuy2_i420", "sse2", video_yuy2_to_i420_sse2);
+		run_test("test_uyvy_i420", "sse2", video_uyvy_to_i420_sse2);
+		run_test("test_yuy2_nv12", "sse2", video_yuy2_to_nv12_sse2);
+		run_test("test_uyvy_nv12", "sse2", video_uyvy_to_nv12_sse2);
+	}
+#endif
+#if defined (HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		run_test("test_yuy2_i420", "avx2", video_yuy2_to_i420_avx2);
+		run_test("test_uyvy_i420", "avx2", video_uyvy_to_i420_avx2);
+		run_test("test_yuy2_nv12", "avx2", video_yuy2_to_nv12_avx2);
+		run_test("test_uyvy_nv12", "avx2", video_uyvy_to_nv12_avx2);
+	}
+#endif
+#if defined (HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON) {
+		run_test("test_yuy2_i420", "neon", video_yuy2_to_i420_neon);
+		run_test("test_uyvy_i420", "neon", video_uyvy_to_i420_neon);
+		run_test("test_yuy2_nv12", "neon", video_yuy2_to_nv12_neon);
+		run_test("test_uyvy_nv12", "neon", video_uyvy_to_nv12_neon);
+	}
+#endif
+}
+
+static void test_scale(void)
+{
+	run_test("test_scale_bilinear", "c", video_scale_bilinear_c);
+}
+
+static void test_frames(void)
+{
+	run_frame("frame_yuy2_i420", SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_I420, false);
+	run_frame("frame_yuy2_nv12", SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_NV12, false);
+	run_frame("frame_yuy2_bgrx", SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_BGRx, false);
+	run_frame("frame_nv12_rgba", SPA_VIDEO_FORMAT_NV12, SPA_VIDEO_FORMAT_RGBA, false);
+	run_frame("frame_i420_bgra", SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_BGRA, false);
+	run_frame("frame_rgba_i420", SPA_VIDEO_FORMAT_RGBA, SPA_VIDEO_FORMAT_I420, false);
+	run_frame("frame_yuy2_bgrx_half", SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_BGRx, true);
+	run_frame("frame_rgba_rgba_half", SPA_VIDEO_FORMAT_RGBA, SPA_VIDEO_FORMAT_RGBA, true);
+}
+
+static int compare_func(const void *_a, const void *_b)
+{
+	const struct stats *a = _a, *b = _b;
+	int diff;
+	if ((diff = strcmp(a->name, b->name)) != 0) return diff;
+	if ((diff = a->width - b->width) != 0) return diff;
+	if ((diff = a->height - b->height) != 0) return diff;
+	if ((diff = b->perf - a->perf) != 0) return diff;
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	uint32_t i;
+
+	cpu_flags = get_cpu_flags();
+	printf("got get CPU flags %d\n", cpu_flags);
+
+	for (i = 0; i < sizeof(frame_in); i++)
+		frame_in[i] = rand();
+	memcpy(line_in, frame_in, sizeof(line_in));
+
+	test_yuv_rgb();
+	test_422_420();
+	test_scale();
+	test_frames();
+
+	qsort(results, n_results, sizeof(struct stats), compare_func);
+
+	for (i = 0; i < n_results; i++) {
+		struct stats *s = &results[i];
+		fprintf(stderr, "%-12."PRIu64" \t%-32.32s %s \t width %d, height %d\n",
+				s->perf, s->name, s->impl, s->width, s->height);
+	}
+	return 0;
+}
@@ -27,6 +27,7 @@
 #include <spa/support/plugin.h>
 
 extern const struct spa_handle_factory spa_videoadapter_factory;
+extern const struct spa_handle_factory spa_videoconvert_factory;
 
 SPA_EXPORT
 int spa_handle_factory_enum(const struct spa_handle_factory **factory, uint32_t *index)
@@ -38,6 +39,9 @@ int spa_handle_factory_enum(const struct spa_handle_factory **factory, uint32_t
 	case 0:
 		*factory = &spa_videoadapter_factory;
 		break;
+	case 1:
+		*factory = &spa_videoconvert_factory;
+		break;
 	default:
 		return 0;
 	}
@@ -0,0 +1,359 @@
+/* Spa
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "config.h"
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include <spa/debug/mem.h>
+
+#include "../audioconvert/test-helper.h"
+#include "video-ops.c"
+
+#define MAX_WIDTH	333
+#define WIDTH		64
+#define HEIGHT		48
+
+static uint32_t cpu_flags;
+
+static uint8_t line_in[4][MAX_WIDTH * 4];
+#if defined (HAVE_SSE2) || defined (HAVE_AVX2) || defined (HAVE_NEON)
+static uint8_t line_c[4][MAX_WIDTH * 4];
+static uint8_t line_simd[4][MAX_WIDTH * 4];
+#endif
+
+static void compare_mem(const char *name, uint32_t width, const void *m1, const void *m2, size_t size)
+{
+	int res = memcmp(m1, m2, size);
+	if (res != 0) {
+		fprintf(stderr, "%s %d:\n", name, width);
+		spa_debug_mem(0, m1, size);
+		spa_debug_mem(0, m2, size);
+	}
+	spa_assert(res == 0);
+}
+
+#if defined (HAVE_SSE2) || defined (HAVE_AVX2) || defined (HAVE_NEON)
+static void init_conv(struct video_convert *conv, uint32_t color_matrix)
+{
+	spa_zero(*conv);
+	conv->color_matrix = color_matrix;
+	init_matrix(conv);
+}
+
+/* compare a kernel against the C version for all widths up to MAX_WIDTH,
+ * the SIMD versions fall back to C for the tail */
+static void run_compare(const char *name, video_func_t func_c, video_func_t func,
+		const size_t dst_size[4], bool chroma)
+{
+	struct video_convert conv;
+	uint32_t i, width;
+	const void *s[4];
+	void *dc[4], *ds[4];
+
+	init_conv(&conv, SPA_VIDEO_COLOR_MATRIX_BT601);
+
+	for (i = 0; i < 4; i++)
+		s[i] = line_in[i];
+
+	for (width = 1; width <= MAX_WIDTH; width++) {
+		for (i = 0; i < 4; i++) {
+			memset(line_c[i], 0, sizeof(line_c[i]));
+			memset(line_simd[i], 0, sizeof(line_simd[i]));
+			dc[i] = dst_size[i] ? line_c[i] : NULL;
+			ds[i] = dst_size[i] ? line_simd[i] : NULL;
+			if (i > 0 && !chroma)
+				dc[i] = ds[i] = NULL;
+		}
+		func_c(&conv, dc, s, width);
+		func(&conv, ds, s, width);
+
+		for (i = 0; i < 4; i++) {
+			if (dst_size[i] > 0)
+				compare_mem(name, width, line_c[i], line_simd[i],
+						dst_size[i] * MAX_WIDTH);
+		}
+	}
+}
+#endif
+
+static void test_simd(void)
+{
+	uint32_t i, j;
+
+	for (i = 0; i < 4; i++)
+		for (j = 0; j < sizeof(line_in[i]); j++)
+			line_in[i][j] = rand();
+
+#if defined (HAVE_SSE2)
+	if (cpu_flags & SPA_CPU_FLAG_SSE2) {
+		static const size_t rgba[4] = { 4, 0, 0, 0 };
+		static const size_t i420[4] = { 1, 1, 1, 0 };
+		static const size_t nv12[4] = { 1, 2, 0, 0 };
+		run_compare("yuv_to_rgba_sse2", video_yuv_to_rgba_c, video_yuv_to_rgba_sse2, rgba, false);
+		run_compare("yuv_to_bgra_sse2", video_yuv_to_bgra_c, video_yuv_to_bgra_sse2, rgba, false);
+		run_compare("yuy2_to_i420_sse2", video_yuy2_to_i420_c, video_yuy2_to_i420_sse2, i420, true);
+		run_compare("yuy2_to_i420_sse2 odd", video_yuy2_to_i420_c, video_yuy2_to_i420_sse2, i420, false);
+		run_compare("uyvy_to_i420_sse2", video_uyvy_to_i420_c, video_uyvy_to_i420_sse2, i420, true);
+		run_compare("yuy2_to_nv12_sse2", video_yuy2_to_nv12_c, video_yuy2_to_nv12_sse2, nv12, true);
+		run_compare("uyvy_to_nv12_sse2", video_uyvy_to_nv12_c, video_uyvy_to_nv12_sse2, nv12, true);
+	}
+#endif
+#if defined (HAVE_AVX2)
+	if (cpu_flags & SPA_CPU_FLAG_AVX2) {
+		static const size_t rgba[4] = { 4, 0, 0, 0 };
+		static const size_t i420[4] = { 1, 1, 1, 0 };
+		static const size_t nv12[4] = { 1, 2, 0, 0 };
+		run_compare("yuv_to_rgba_avx2", video_yuv_to_rgba_c, video_yuv_to_rgba_avx2, rgba, false);
+		run_compare("yuv_to_bgra_avx2", video_yuv_to_bgra_c, video_yuv_to_bgra_avx2, rgba, false);
+		run_compare("yuy2_to_i420_avx2", video_yuy2_to_i420_c, video_yuy2_to_i420_avx2, i420, true);
+		run_compare("yuy2_to_i420_avx2 odd", video_yuy2_to_i420_c, video_yuy2_to_i420_avx2, i420, false);
+		run_compare("uyvy_to_i420_avx2", video_uyvy_to_i420_c, video_uyvy_to_i420_avx2, i420, true);
+		run_compare("yuy2_to_nv12_avx2", video_yuy2_to_nv12_c, video_yuy2_to_nv12_avx2, nv12, true);
+		run_compare("uyvy_to_nv12_avx2", video_uyvy_to_nv12_c, video_uyvy_to_nv12_avx2, nv12, true);
+	}
+#endif
+#if defined (HAVE_NEON)
+	if (cpu_flags & SPA_CPU_FLAG_NEON) {
+		static const size_t rgba[4] = { 4, 0, 0, 0 };
+		static const size_t i420[4] = { 1, 1, 1, 0 };
+		static const size_t nv12[4] = { 1, 2, 0, 0 };
+		run_compare("yuv_to_rgba_neon", video_yuv_to_rgba_c, video_yuv_to_rgba_neon, rgba, false);
+		run_compare("yuv_to_bgra_neon", video_yuv_to_bgra_c, video_yuv_to_bgra_neon, rgba, false);
+		run_compare("yuy2_to_i420_neon", video_yuy2_to_i420_c, video_yuy2_to_i420_neon, i420, true);
+		run_compare("yuy2_to_i420_neon odd", video_yuy2_to_i420_c, video_yuy2_to_i420_neon, i420, false);
+		run_compare("uyvy_to_i420_neon", video_uyvy_to_i420_c, video_uyvy_to_i420_neon, i420, true);
+		run_compare("yuy2_to_nv12_neon", video_yuy2_to_nv12_c, video_yuy2_to_nv12_neon, nv12, true);
+		run_compare("uyvy_to_nv12_neon", video_uyvy_to_nv12_c, video_uyvy_to_nv12_neon, nv12, true);
+	}
+#endif
+}
+
+struct frame {
+	struct video_layout layout;
+	struct video_frame frame;
+	uint8_t *data;
+};
+
+static void frame_init(struct frame *f, uint32_t format, uint32_t width, uint32_t height)
+{
+	uint32_t i;
+
+	spa_assert(video_layout_init(&f->layout, format, width, height, 0) == 0);
+	f->data = calloc(1, f->layout.size);
+	spa_assert(f->data != NULL);
+	for (i = 0; i < f->layout.n_planes; i++) {
+		f->frame.data[i] = f->data + f->layout.offset[i];
+		f->frame.stride[i] = f->layout.stride[i];
+	}
+}
+
+static void frame_clear(struct frame *f)
+{
+	free(f->data);
+}
+
+static void fill_yuy2(struct frame *f, uint32_t width, uint32_t height,
+		uint8_t y, uint8_t u, uint8_t v)
+{
+	uint32_t i, j;
+
+	for (i = 0; i < height; i++) {
+		uint8_t *d = SPA_MEMBER(f->frame.data[0], f->frame.stride[0] * i, uint8_t);
+		for (j = 0; j < width / 2; j++) {
+			d[4*j + 0] = y;
+			d[4*j + 1] = u;
+			d[4*j + 2] = y;
+			d[4*j + 3] = v;
+		}
+	}
+}
+
+static void run_convert(uint32_t src_fmt, uint32_t src_width, uint32_t src_height,
+		uint32_t dst_fmt, uint32_t dst_width, uint32_t dst_height,
+		struct frame *src, struct frame *dst, uint32_t flags)
+{
+	struct video_convert conv;
+
+	spa_zero(conv);
+	conv.src_fmt = src_fmt;
+	conv.dst_fmt = dst_fmt;
+	conv.src_width = src_width;
+	conv.src_height = src_height;
+	conv.dst_width = dst_width;
+	conv.dst_height = dst_height;
+	conv.cpu_flags = flags;
+	spa_assert(video_convert_init(&conv) == 0);
+
+	frame_init(dst, dst_fmt, dst_width, dst_height);
+	video_convert_process(&conv, &dst->frame, &src->frame);
+	video_convert_free(&conv);
+}
+
+static void check_rgba(struct frame *f, uint32_t width, uint32_t height,
+		uint8_t r, uint8_t g, uint8_t b)
+{
+	uint32_t i, j;
+
+	for (i = 0; i < height; i++) {
+		uint8_t *d = SPA_MEMBER(f->frame.data[0], f->frame.stride[0] * i, uint8_t);
+		for (j = 0; j < width; j++) {
+			spa_assert(d[4*j + 0] == r);
+			spa_assert(d[4*j + 1] == g);
+			spa_assert(d[4*j + 2] == b);
+			spa_assert(d[4*j + 3] == 0xff);
+		}
+	}
+}
+
+static void test_white_black(void)
+{
+	struct frame src, dst;
+
+	frame_init(&src, SPA_VIDEO_FORMAT_YUY2, WIDTH, HEIGHT);
+
+	fill_yuy2(&src, WIDTH, HEIGHT, 235, 128, 128);
+	run_convert(SPA_VIDEO_FORMAT_YUY2, WIDTH, HEIGHT,
+			SPA_VIDEO_FORMAT_RGBA, WIDTH, HEIGHT, &src, &dst, cpu_flags);
+	check_rgba(&dst, WIDTH, HEIGHT, 255, 255, 255);
+	frame_clear(&dst);
+
+	fill_yuy2(&src, WIDTH, HEIGHT, 16, 128, 128);
+	run_convert(SPA_VIDEO_FORMAT_YUY2, WIDTH, HEIGHT,
+			SPA_VIDEO_FORMAT_RGBA, WIDTH / 2, HEIGHT * 2, &src, &dst, cpu_flags);
+	check_rgba(&dst, WIDTH / 2, HEIGHT * 2, 0, 0, 0);
+	frame_clear(&dst);
+
+	frame_clear(&src);
+}
+
+/* the direct kernels must give the same result as the generic path */
+static void test_direct(void)
+{
+	static const uint32_t formats[] = { SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_NV12 };
+	struct frame src, d1, d2;
+	uint32_t i, j, w = WIDTH + 3;
+
+	frame_init(&src, SPA_VIDEO_FORMAT_YUY2, w, HEIGHT);
+	for (i = 0; i < src.layout.size; i++)
+		src.data[i] = rand();
+
+	for (i = 0; i < SPA_N_ELEMENTS(formats); i++) {
+		struct video_convert conv;
+
+		run_convert(SPA_VIDEO_FORMAT_YUY2, w, HEIGHT, formats[i], w, HEIGHT,
+				&src, &d1, cpu_flags);
+
+		/* force the generic path */
+		spa_zero(conv);
+		conv.src_fmt = SPA_VIDEO_FORMAT_YUY2;
+		conv.dst_fmt = formats[i];
+		conv.src_width = conv.dst_width = w;
+		conv.src_height = conv.dst_height = HEIGHT;
+		spa_assert(video_convert_init(&conv) == 0);
+		spa_assert(conv.direct != NULL);
+		video_convert_free(&conv);
+		conv.direct = NULL;
+		conv.unpack = video_unpack_yuy2_c;
+		conv.pack = formats[i] == SPA_VIDEO_FORMAT_I420 ?
+			video_pack_i420_c : video_pack_nv12_c;
+		conv.scale = conv.matrix = NULL;
+		conv.tmp = malloc(3 * VIDEO_MAX_PLANES * w);
+		for (j = 0; j < VIDEO_MAX_PLANES; j++)
+			conv.lines[0][j] = conv.tmp + j * w;
+		conv.free = impl_video_convert_free;
+
+		frame_init(&d2, formats[i], w, HEIGHT);
+		impl_video_process(&conv, &d2.frame, &src.frame);
+		video_convert_free(&conv);
+
+		compare_mem("direct", w, d1.data, d2.data, d1.layout.size);
+
+		frame_clear(&d1);
+		frame_clear(&d2);
+	}
+	frame_clear(&src);
+}
+
+static void test_roundtrip(void)
+{
+	static const uint32_t formats[] = {
+		SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_UYVY,
+		SPA_VIDEO_FORMAT_I420, SPA_VIDEO_FORMAT_NV12,
+		SPA_VIDEO_FORMAT_BGRx,
+	};
+	struct frame src, tmp, dst;
+	uint32_t i, x, y;
+
+	/* a smooth gradient survives chroma subsampling well */
+	frame_init(&src, SPA_VIDEO_FORMAT_RGBA, WIDTH, HEIGHT);
+	for (y = 0; y < HEIGHT; y++) {
+		for (x = 0; x < WIDTH; x++) {
+			uint8_t *p = &src.data[y * src.layout.stride[0] + 4 * x];
+			p[0] = 32 + x * 2;
+			p[1] = 64 + y * 2;
+			p[2] = 160;
+			p[3] = 0xff;
+		}
+	}
+
+	for (i = 0; i < SPA_N_ELEMENTS(formats); i++) {
+		run_convert(SPA_VIDEO_FORMAT_RGBA, WIDTH, HEIGHT, formats[i], WIDTH, HEIGHT,
+				&src, &tmp, cpu_flags);
+		run_convert(formats[i], WIDTH, HEIGHT, SPA_VIDEO_FORMAT_RGBA, WIDTH, HEIGHT,
+				&tmp, &dst, cpu_flags);
+
+		for (y = 0; y < HEIGHT; y++) {
+			for (x = 0; x < 4 * WIDTH; x++) {
+				int a = src.data[y * src.layout.stride[0] + x];
+				int b = dst.data[y * dst.layout.stride[0] + x];
+				if (abs(a - b) > 6) {
+					fprintf(stderr, "format %d: %d,%d: %d != %d\n",
+							formats[i], x / 4, y, a, b);
+					spa_assert_not_reached();
+				}
+			}
+		}
+		frame_clear(&tmp);
+		frame_clear(&dst);
+	}
+	frame_clear(&src);
+}
+
+int main(int argc, char *argv[])
+{
+	cpu_flags = get_cpu_flags();
+	printf("got get CPU flags %d\n", cpu_flags);
+
+	test_simd();
+	test_white_black();
+	test_direct();
+	test_roundtrip();
+
+	return 0;
+}
@@ -0,0 +1,213 @@
+/* Spa
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "video-ops.h"
+
+#include <immintrin.h>
+
+static inline void
+yuv_to_rgb_avx2(struct video_convert *conv, uint8_t *d, const uint8_t *sy,
+		const uint8_t *su, const uint8_t *sv, uint32_t width, bool swap)
+{
+	const int32_t *c = conv->yuv_rgb;
+	uint32_t n, unrolled = width & ~15;
+	__m256i zero = _mm256_setzero_si256();
+	__m256i off_y = _mm256_set1_epi16(16), off_c = _mm256_set1_epi16(128);
+	__m256i round = _mm256_set1_epi32(128), alpha = _mm256_set1_epi16(0xff);
+	__m256i c_yv = _mm256_set1_epi32((c[1] << 16) | (c[0] & 0xffff));
+	__m256i c_yu = _mm256_set1_epi32((c[2] << 16) | (c[0] & 0xffff));
+	__m256i c_yb = _mm256_set1_epi32((c[4] << 16) | (c[0] & 0xffff));
+	__m256i c_v = _mm256_set1_epi32(c[3] & 0xffff);
+	__m256i y, u, v, t0, t1, r, g, b, rb, ga, lo, hi;
+
+	for (n = 0; n < unrolled; n += 16) {
+		y = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*)&sy[n]));
+		u = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*)&su[n]));
+		v = _mm256_cvtepu8_epi16(_mm_loadu_si128((__m128i*)&sv[n]));
+		y = _mm256_sub_epi16(y, off_y);
+		u = _mm256_sub_epi16(u, off_c);
+		v = _mm256_sub_epi16(v, off_c);
+
+		/* the unpacks work per 128 bit lane, packs restores the order */
+		t0 = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(y, v), c_yv), round);
+		t1 = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(y, v), c_yv), round);
+		r = _mm256_packs_epi32(_mm256_srai_epi32(t0, 8), _mm256_srai_epi32(t1, 8));
+
+		t0 = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(y, u), c_yu), round);
+		t0 = _mm256_add_epi32(t0, _mm256_madd_epi16(_mm256_unpacklo_epi16(v, zero), c_v));
+		t1 = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(y, u), c_yu), round);
+		t1 = _mm256_add_epi32(t1, _mm256_madd_epi16(_mm256_unpackhi_epi16(v, zero), c_v));
+		g = _mm256_packs_epi32(_mm256_srai_epi32(t0, 8), _mm256_srai_epi32(t1, 8));
+
+		t0 = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpacklo_epi16(y, u), c_yb), round);
+		t1 = _mm256_add_epi32(_mm256_madd_epi16(_mm256_unpackhi_epi16(y, u), c_yb), round);
+		b = _mm256_packs_epi32(_mm256_srai_epi32(t0, 8), _mm256_srai_epi32(t1, 8));
+
+		if (swap) {
+			t0 = r;
+			r = b;
+			b = t0;
+		}
+		/* lane 0: r0-7 b0-7, lane 1: r8-15 b8-15 */
+		rb = _mm256_packus_epi16(r, b);
+		ga = _mm256_packus_epi16(g, alpha);
+		/* lane 0: r0 g0 .. r7 g7, lane 1: r8 g8 .. */
+		lo = _mm256_unpacklo_epi8(rb, ga);
+		/* lane 0: b0 a0 .. b7 a7, lane 1: b8 a8 .. */
+		hi = _mm256_unpackhi_epi8(rb, ga);
+		/* lane 0: pixels 0-3, lane 1: pixels 8-11 */
+		t0 = _mm256_unpacklo_epi16(lo, hi);
+		/* lane 0: pixels 4-7, lane 1: pixels 12-15 */
+		t1 = _mm256_unpackhi_epi16(lo, hi);
+		_mm256_storeu_si256((__m256i*)&d[4*n + 0], _mm256_permute2x128_si256(t0, t1, 0x20));
+		_mm256_storeu_si256((__m256i*)&d[4*n + 32], _mm256_permute2x128_si256(t0, t1, 0x31));
+	}
+	for (; n < width; n++) {
+		uint8_t *p = &d[4*n];
+		if (swap)
+			yuv_to_rgb(c, sy[n], su[n], sv[n], &p[2], &p[1], &p[0]);
+		else
+			yuv_to_rgb(c, sy[n], su[n], sv[n], &p[0], &p[1], &p[2]);
+		p[3] = 0xff;
+	}
+}
+
+void
+video_yuv_to_rgba_avx2(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	yuv_to_rgb_avx2(conv, dst[0], src[0], src[1], src[2], width, false);
+}
+
+void
+video_yuv_to_bgra_avx2(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	yuv_to_rgb_avx2(conv, dst[0], src[0], src[1], src[2], width, true);
+}
+
+/* splits 32 pixels of packed 4:2:2 into 32 luma and 32 interleaved chroma bytes */
+static inline void
+split_packed422_avx2(const uint8_t *s, __m256i *y, __m256i *c, bool uyvy)
+{
+	__m256i mask = _mm256_set1_epi16(0xff);
+	__m256i s0 = _mm256_loadu_si256((__m256i*)&s[0]);
+	__m256i s1 = _mm256_loadu_si256((__m256i*)&s[32]);
+	__m256i l0, l1, h0, h1;
+
+	l0 = _mm256_and_si256(s0, mask);
+	l1 = _mm256_and_si256(s1, mask);
+	h0 = _mm256_srli_epi16(s0, 8);
+	h1 = _mm256_srli_epi16(s1, 8);
+
+	if (uyvy) {
+		*y = _mm256_packus_epi16(h0, h1);
+		*c = _mm256_packus_epi16(l0, l1);
+	} else {
+		*y = _mm256_packus_epi16(l0, l1);
+		*c = _mm256_packus_epi16(h0, h1);
+	}
+	/* packus interleaves the lanes of both inputs */
+	*y = _mm256_permute4x64_epi64(*y, 0xd8);
+	*c = _mm256_permute4x64_epi64(*c, 0xd8);
+}
+
+static inline void
+packed422_to_i420_avx2(void * SPA_RESTRICT dst[], const uint8_t *s, uint32_t width, bool uyvy)
+{
+	uint8_t *dy = dst[0], *du = dst[1], *dv = dst[2];
+	uint32_t n, unrolled = width & ~31;
+	__m256i mask = _mm256_set1_epi16(0xff), y, c, uv;
+
+	for (n = 0; n < unrolled; n += 32) {
+		split_packed422_avx2(&s[2*n], &y, &c, uyvy);
+		_mm256_storeu_si256((__m256i*)&dy[n], y);
+		if (du) {
+			/* lane 0: u0-7 v0-7, lane 1: u8-15 v8-15 */
+			uv = _mm256_packus_epi16(_mm256_and_si256(c, mask), _mm256_srli_epi16(c, 8));
+			uv = _mm256_permute4x64_epi64(uv, 0xd8);
+			_mm_storeu_si128((__m128i*)&du[n >> 1], _mm256_castsi256_si128(uv));
+			_mm_storeu_si128((__m128i*)&dv[n >> 1], _mm256_extracti128_si256(uv, 1));
+		}
+	}
+	if (n < width) {
+		void *d[3] = { &dy[n], du ? &du[n >> 1] : NULL, dv ? &dv[n >> 1] : NULL };
+		const void *sp[1] = { &s[2*n] };
+		if (uyvy)
+			video_uyvy_to_i420_c(NULL, d, sp, width - n);
+		else
+			video_yuy2_to_i420_c(NULL, d, sp, width - n);
+	}
+}
+
+static inline void
+packed422_to_nv12_avx2(void * SPA_RESTRICT dst[], const uint8_t *s, uint32_t width, bool uyvy)
+{
+	uint8_t *dy = dst[0], *duv = dst[1];
+	uint32_t n, unrolled = width & ~31;
+	__m256i y, c;
+
+	for (n = 0; n < unrolled; n += 32) {
+		split_packed422_avx2(&s[2*n], &y, &c, uyvy);
+		_mm256_storeu_si256((__m256i*)&dy[n], y);
+		if (duv)
+			_mm256_storeu_si256((__m256i*)&duv[n], c);
+	}
+	if (n < width) {
+		void *d[2] = { &dy[n], duv ? &duv[n] : NULL };
+		const void *sp[1] = { &s[2*n] };
+		if (uyvy)
+			video_uyvy_to_nv12_c(NULL, d, sp, width - n);
+		else
+			video_yuy2_to_nv12_c(NULL, d, sp, width - n);
+	}
+}
+
+void
+video_yuy2_to_i420_avx2(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	packed422_to_i420_avx2(dst, src[0], width, false);
+}
+
+void
+video_uyvy_to_i420_avx2(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	packed422_to_i420_avx2(dst, src[0], width, true);
+}
+
+void
+video_yuy2_to_nv12_avx2(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	packed422_to_nv12_avx2(dst, src[0], width, false);
+}
+
+void
+video_uyvy_to_nv12_avx2(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	packed422_to_nv12_avx2(dst, src[0], width, true);
+}
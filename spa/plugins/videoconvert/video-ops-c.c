@@ -0,0 +1,419 @@
+/* Spa
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "video-ops.h"
+
+static inline void
+unpack_packed422(void * SPA_RESTRICT dst[], const uint8_t *s, uint32_t width,
+		int y0, int u, int y1, int v)
+{
+	uint8_t *dy = dst[0], *du = dst[1], *dv = dst[2], *da = dst[3];
+	uint32_t n;
+
+	for (n = 0; n + 1 < width; n += 2) {
+		dy[n] = s[y0];
+		dy[n+1] = s[y1];
+		du[n] = du[n+1] = s[u];
+		dv[n] = dv[n+1] = s[v];
+		s += 4;
+	}
+	if (n < width) {
+		dy[n] = s[y0];
+		du[n] = s[u];
+		dv[n] = s[v];
+	}
+	memset(da, 0xff, width);
+}
+
+void
+video_unpack_yuy2_c(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	unpack_packed422(dst, src[0], width, 0, 1, 2, 3);
+}
+
+void
+video_unpack_uyvy_c(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	unpack_packed422(dst, src[0], width, 1, 0, 3, 2);
+}
+
+void
+video_unpack_i420_c(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	const uint8_t *su = src[1], *sv = src[2];
+	uint8_t *du = dst[1], *dv = dst[2];
+	uint32_t n;
+
+	memcpy(dst[0], src[0], width);
+	for (n = 0; n < width; n++) {
+		du[n] = su[n >> 1];
+		dv[n] = sv[n >> 1];
+	}
+	memset(dst[3], 0xff, width);
+}
+
+void
+video_unpack_nv12_c(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	const uint8_t *suv = src[1];
+	uint8_t *du = dst[1], *dv = dst[2];
+	uint32_t n;
+
+	memcpy(dst[0], src[0], width);
+	for (n = 0; n < width; n++) {
+		du[n] = suv[(n & ~1)];
+		dv[n] = suv[(n & ~1) + 1];
+	}
+	memset(dst[3], 0xff, width);
+}
+
+static inline void
+unpack_packed32(void * SPA_RESTRICT dst[], const uint8_t *s, uint32_t width,
+		int r, int g, int b, int a)
+{
+	uint8_t *dr = dst[0], *dg = dst[1], *db = dst[2], *da = dst[3];
+	uint32_t n;
+
+	for (n = 0; n < width; n++) {
+		dr[n] = s[r];
+		dg[n] = s[g];
+		db[n] = s[b];
+		da[n] = a < 0 ? 0xff : s[a];
+		s += 4;
+	}
+}
+
+void
+video_unpack_rgba_c(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	unpack_packed32(dst, src[0], width, 0, 1, 2, 3);
+}
+
+void
+video_unpack_rgbx_c(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	unpack_packed32(dst, src[0], width, 0, 1, 2, -1);
+}
+
+void
+video_unpack_bgra_c(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	unpack_packed32(dst, src[0], width, 2, 1, 0, 3);
+}
+
+void
+video_unpack_bgrx_c(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	unpack_packed32(dst, src[0], width, 2, 1, 0, -1);
+}
+
+static inline void
+pack_packed422(uint8_t *d, const void * SPA_RESTRICT src[], uint32_t width,
+		int y0, int u, int y1, int v)
+{
+	const uint8_t *sy = src[0], *su = src[1], *sv = src[2];
+	uint32_t n;
+
+	for (n = 0; n + 1 < width; n += 2) {
+		d[y0] = sy[n];
+		d[y1] = sy[n+1];
+		d[u] = (su[n] + su[n+1] + 1) >> 1;
+		d[v] = (sv[n] + sv[n+1] + 1) >> 1;
+		d += 4;
+	}
+	if (n < width) {
+		d[y0] = d[y1] = sy[n];
+		d[u] = su[n];
+		d[v] = sv[n];
+	}
+}
+
+void
+video_pack_yuy2_c(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	pack_packed422(dst[0], src, width, 0, 1, 2, 3);
+}
+
+void
+video_pack_uyvy_c(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	pack_packed422(dst[0], src, width, 1, 0, 3, 2);
+}
+
+static inline uint8_t avg_pair(const uint8_t *s, uint32_t n, uint32_t width)
+{
+	return n + 1 < width ? (s[n] + s[n+1] + 1) >> 1 : s[n];
+}
+
+void
+video_pack_i420_c(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	const uint8_t *su = src[1], *sv = src[2];
+	uint8_t *du = dst[1], *dv = dst[2];
+	uint32_t n;
+
+	memcpy(dst[0], src[0], width);
+	if (du == NULL)
+		return;
+	for (n = 0; n < width; n += 2) {
+		du[n >> 1] = avg_pair(su, n, width);
+		dv[n >> 1] = avg_pair(sv, n, width);
+	}
+}
+
+void
+video_pack_nv12_c(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	const uint8_t *su = src[1], *sv = src[2];
+	uint8_t *duv = dst[1];
+	uint32_t n;
+
+	memcpy(dst[0], src[0], width);
+	if (duv == NULL)
+		return;
+	for (n = 0; n < width; n += 2) {
+		duv[n] = avg_pair(su, n, width);
+		duv[n+1] = avg_pair(sv, n, width);
+	}
+}
+
+static inline void
+pack_packed32(uint8_t *d, const void * SPA_RESTRICT src[], uint32_t width,
+		int r, int g, int b, int a, bool alpha)
+{
+	const uint8_t *sr = src[0], *sg = src[1], *sb = src[2], *sa = src[3];
+	uint32_t n;
+
+	for (n = 0; n < width; n++) {
+		d[r] = sr[n];
+		d[g] = sg[n];
+		d[b] = sb[n];
+		d[a] = alpha ? sa[n] : 0xff;
+		d += 4;
+	}
+}
+
+void
+video_pack_rgba_c(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	pack_packed32(dst[0], src, width, 0, 1, 2, 3, true);
+}
+
+void
+video_pack_rgbx_c(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	pack_packed32(dst[0], src, width, 0, 1, 2, 3, false);
+}
+
+void
+video_pack_bgra_c(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	pack_packed32(dst[0], src, width, 2, 1, 0, 3, true);
+}
+
+void
+video_pack_bgrx_c(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	pack_packed32(dst[0], src, width, 2, 1, 0, 3, false);
+}
+
+void
+video_scale_bilinear_c(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	uint32_t i, n, src_width = conv->src_width;
+	uint64_t step = ((uint64_t)src_width << 16) / width;
+	int64_t pos;
+
+	for (i = 0; i < VIDEO_MAX_PLANES; i++) {
+		const uint8_t *s = src[i];
+		uint8_t *d = dst[i];
+
+		/* sample at the center of each destination pixel */
+		pos = (int64_t)(step >> 1) - 0x8000;
+		for (n = 0; n < width; n++, pos += step) {
+			uint32_t p = SPA_MAX(pos, 0);
+			uint32_t x = p >> 16, f = (p >> 8) & 0xff;
+			uint32_t x1 = SPA_MIN(x + 1, src_width - 1);
+			d[n] = (s[x] * (256 - f) + s[x1] * f + 128) >> 8;
+		}
+	}
+}
+
+void
+video_yuv_to_rgb_c(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	const uint8_t *sy = src[0], *su = src[1], *sv = src[2];
+	uint8_t *dr = dst[0], *dg = dst[1], *db = dst[2];
+	uint32_t n;
+
+	for (n = 0; n < width; n++)
+		yuv_to_rgb(conv->yuv_rgb, sy[n], su[n], sv[n], &dr[n], &dg[n], &db[n]);
+	memcpy(dst[3], src[3], width);
+}
+
+void
+video_rgb_to_yuv_c(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	const uint8_t *sr = src[0], *sg = src[1], *sb = src[2];
+	uint8_t *dy = dst[0], *du = dst[1], *dv = dst[2];
+	const int32_t *c = conv->rgb_yuv;
+	uint32_t n;
+
+	for (n = 0; n < width; n++) {
+		int32_t r = sr[n], g = sg[n], b = sb[n];
+		dy[n] = SPA_CLAMP(((c[0] * r + c[1] * g + c[2] * b + 128) >> 8) + 16, 0, 255);
+		du[n] = SPA_CLAMP(((c[3] * r + c[4] * g + c[5] * b + 128) >> 8) + 128, 0, 255);
+		dv[n] = SPA_CLAMP(((c[6] * r + c[7] * g + c[8] * b + 128) >> 8) + 128, 0, 255);
+	}
+	memcpy(dst[3], src[3], width);
+}
+
+void
+video_yuv_to_rgba_c(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	const uint8_t *sy = src[0], *su = src[1], *sv = src[2];
+	uint8_t *d = dst[0];
+	uint32_t n;
+
+	for (n = 0; n < width; n++) {
+		yuv_to_rgb(conv->yuv_rgb, sy[n], su[n], sv[n], &d[0], &d[1], &d[2]);
+		d[3] = 0xff;
+		d += 4;
+	}
+}
+
+void
+video_yuv_to_bgra_c(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	const uint8_t *sy = src[0], *su = src[1], *sv = src[2];
+	uint8_t *d = dst[0];
+	uint32_t n;
+
+	for (n = 0; n < width; n++) {
+		yuv_to_rgb(conv->yuv_rgb, sy[n], su[n], sv[n], &d[2], &d[1], &d[0]);
+		d[3] = 0xff;
+		d += 4;
+	}
+}
+
+static inline void
+packed422_to_i420(void * SPA_RESTRICT dst[], const uint8_t *s, uint32_t width,
+		int y0, int u, int y1, int v)
+{
+	uint8_t *dy = dst[0], *du = dst[1], *dv = dst[2];
+	uint32_t n;
+
+	for (n = 0; n + 1 < width; n += 2) {
+		dy[n] = s[y0];
+		dy[n+1] = s[y1];
+		if (du) {
+			du[n >> 1] = s[u];
+			dv[n >> 1] = s[v];
+		}
+		s += 4;
+	}
+	if (n < width) {
+		dy[n] = s[y0];
+		if (du) {
+			du[n >> 1] = s[u];
+			dv[n >> 1] = s[v];
+		}
+	}
+}
+
+static inline void
+packed422_to_nv12(void * SPA_RESTRICT dst[], const uint8_t *s, uint32_t width,
+		int y0, int u, int y1, int v)
+{
+	uint8_t *dy = dst[0], *duv = dst[1];
+	uint32_t n;
+
+	for (n = 0; n + 1 < width; n += 2) {
+		dy[n] = s[y0];
+		dy[n+1] = s[y1];
+		if (duv) {
+			duv[n] = s[u];
+			duv[n+1] = s[v];
+		}
+		s += 4;
+	}
+	if (n < width) {
+		dy[n] = s[y0];
+		if (duv) {
+			duv[n] = s[u];
+			duv[n+1] = s[v];
+		}
+	}
+}
+
+void
+video_yuy2_to_i420_c(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	packed422_to_i420(dst, src[0], width, 0, 1, 2, 3);
+}
+
+void
+video_uyvy_to_i420_c(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	packed422_to_i420(dst, src[0], width, 1, 0, 3, 2);
+}
+
+void
+video_yuy2_to_nv12_c(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	packed422_to_nv12(dst, src[0], width, 0, 1, 2, 3);
+}
+
+void
+video_uyvy_to_nv12_c(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	packed422_to_nv12(dst, src[0], width, 1, 0, 3, 2);
+}
@@ -0,0 +1,169 @@
+/* Spa
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "video-ops.h"
+
+#include <arm_neon.h>
+
+static inline uint8x8_t
+matrix_neon(int16x8_t a, int16_t ca, int16x8_t b, int16_t cb, int16x8_t c, int16_t cc)
+{
+	int32x4_t round = vdupq_n_s32(128), lo, hi;
+
+	lo = vmlal_n_s16(round, vget_low_s16(a), ca);
+	lo = vmlal_n_s16(lo, vget_low_s16(b), cb);
+	lo = vmlal_n_s16(lo, vget_low_s16(c), cc);
+	hi = vmlal_n_s16(round, vget_high_s16(a), ca);
+	hi = vmlal_n_s16(hi, vget_high_s16(b), cb);
+	hi = vmlal_n_s16(hi, vget_high_s16(c), cc);
+
+	return vqmovun_s16(vcombine_s16(vqmovn_s32(vshrq_n_s32(lo, 8)),
+				vqmovn_s32(vshrq_n_s32(hi, 8))));
+}
+
+static inline void
+yuv_to_rgb_neon(struct video_convert *conv, uint8_t *d, const uint8_t *sy,
+		const uint8_t *su, const uint8_t *sv, uint32_t width, bool swap)
+{
+	const int32_t *c = conv->yuv_rgb;
+	uint32_t n, unrolled = width & ~7;
+	int16x8_t y, u, v;
+	uint8x8x4_t out;
+
+	out.val[3] = vdup_n_u8(0xff);
+
+	for (n = 0; n < unrolled; n += 8) {
+		y = vreinterpretq_s16_u16(vsubl_u8(vld1_u8(&sy[n]), vdup_n_u8(16)));
+		u = vreinterpretq_s16_u16(vsubl_u8(vld1_u8(&su[n]), vdup_n_u8(128)));
+		v = vreinterpretq_s16_u16(vsubl_u8(vld1_u8(&sv[n]), vdup_n_u8(128)));
+
+		out.val[swap ? 2 : 0] = matrix_neon(y, c[0], v, c[1], u, 0);
+		out.val[1] = matrix_neon(y, c[0], u, c[2], v, c[3]);
+		out.val[swap ? 0 : 2] = matrix_neon(y, c[0], u, c[4], v, 0);
+
+		vst4_u8(&d[4*n], out);
+	}
+	for (; n < width; n++) {
+		uint8_t *p = &d[4*n];
+		if (swap)
+			yuv_to_rgb(c, sy[n], su[n], sv[n], &p[2], &p[1], &p[0]);
+		else
+			yuv_to_rgb(c, sy[n], su[n], sv[n], &p[0], &p[1], &p[2]);
+		p[3] = 0xff;
+	}
+}
+
+void
+video_yuv_to_rgba_neon(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	yuv_to_rgb_neon(conv, dst[0], src[0], src[1], src[2], width, false);
+}
+
+void
+video_yuv_to_bgra_neon(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	yuv_to_rgb_neon(conv, dst[0], src[0], src[1], src[2], width, true);
+}
+
+static inline void
+packed422_to_i420_neon(void * SPA_RESTRICT dst[], const uint8_t *s, uint32_t width, bool uyvy)
+{
+	uint8_t *dy = dst[0], *du = dst[1], *dv = dst[2];
+	uint32_t n, unrolled = width & ~31;
+	uint8x16x4_t in;
+	uint8x16x2_t y;
+
+	for (n = 0; n < unrolled; n += 32) {
+		/* yuy2: y0 u y1 v, uyvy: u y0 v y1 */
+		in = vld4q_u8(&s[2*n]);
+		y.val[0] = in.val[uyvy ? 1 : 0];
+		y.val[1] = in.val[uyvy ? 3 : 2];
+		vst2q_u8(&dy[n], y);
+		if (du) {
+			vst1q_u8(&du[n >> 1], in.val[uyvy ? 0 : 1]);
+			vst1q_u8(&dv[n >> 1], in.val[uyvy ? 2 : 3]);
+		}
+	}
+	if (n < width) {
+		void *d[3] = { &dy[n], du ? &du[n >> 1] : NULL, dv ? &dv[n >> 1] : NULL };
+		const void *sp[1] = { &s[2*n] };
+		if (uyvy)
+			video_uyvy_to_i420_c(NULL, d, sp, width - n);
+		else
+			video_yuy2_to_i420_c(NULL, d, sp, width - n);
+	}
+}
+
+static inline void
+packed422_to_nv12_neon(void * SPA_RESTRICT dst[], const uint8_t *s, uint32_t width, bool uyvy)
+{
+	uint8_t *dy = dst[0], *duv = dst[1];
+	uint32_t n, unrolled = width & ~15;
+	uint8x16x2_t in;
+
+	for (n = 0; n < unrolled; n += 16) {
+		in = vld2q_u8(&s[2*n]);
+		vst1q_u8(&dy[n], in.val[uyvy ? 1 : 0]);
+		if (duv)
+			vst1q_u8(&duv[n], in.val[uyvy ? 0 : 1]);
+	}
+	if (n < width) {
+		void *d[2] = { &dy[n], duv ? &duv[n] : NULL };
+		const void *sp[1] = { &s[2*n] };
+		if (uyvy)
+			video_uyvy_to_nv12_c(NULL, d, sp, width - n);
+		else
+			video_yuy2_to_nv12_c(NULL, d, sp, width - n);
+	}
+}
+
+void
+video_yuy2_to_i420_neon(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	packed422_to_i420_neon(dst, src[0], width, false);
+}
+
+void
+video_uyvy_to_i420_neon(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	packed422_to_i420_neon(dst, src[0], width, true);
+}
+
+void
+video_yuy2_to_nv12_neon(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	packed422_to_nv12_neon(dst, src[0], width, false);
+}
+
+void
+video_uyvy_to_nv12_neon(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	packed422_to_nv12_neon(dst, src[0], width, true);
+}
@@ -0,0 +1,204 @@
+/* Spa
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include "video-ops.h"
+
+#include <emmintrin.h>
+
+static inline void
+yuv_to_rgb_sse2(struct video_convert *conv, uint8_t *d, const uint8_t *sy,
+		const uint8_t *su, const uint8_t *sv, uint32_t width, bool swap)
+{
+	const int32_t *c = conv->yuv_rgb;
+	uint32_t n, unrolled = width & ~7;
+	__m128i zero = _mm_setzero_si128();
+	__m128i off_y = _mm_set1_epi16(16), off_c = _mm_set1_epi16(128);
+	__m128i round = _mm_set1_epi32(128), alpha = _mm_set1_epi8(-1);
+	__m128i c_yv = _mm_set_epi16(c[1], c[0], c[1], c[0], c[1], c[0], c[1], c[0]);
+	__m128i c_yu = _mm_set_epi16(c[2], c[0], c[2], c[0], c[2], c[0], c[2], c[0]);
+	__m128i c_yb = _mm_set_epi16(c[4], c[0], c[4], c[0], c[4], c[0], c[4], c[0]);
+	__m128i c_v = _mm_set_epi16(0, c[3], 0, c[3], 0, c[3], 0, c[3]);
+	__m128i y, u, v, yv, yu, t0, t1, r, g, b, rg, ba, lo, hi;
+
+	for (n = 0; n < unrolled; n += 8) {
+		y = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)&sy[n]), zero);
+		u = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)&su[n]), zero);
+		v = _mm_unpacklo_epi8(_mm_loadl_epi64((__m128i*)&sv[n]), zero);
+		y = _mm_sub_epi16(y, off_y);
+		u = _mm_sub_epi16(u, off_c);
+		v = _mm_sub_epi16(v, off_c);
+
+		/* R = cy * y + crv * v */
+		yv = _mm_unpacklo_epi16(y, v);
+		t0 = _mm_add_epi32(_mm_madd_epi16(yv, c_yv), round);
+		yv = _mm_unpackhi_epi16(y, v);
+		t1 = _mm_add_epi32(_mm_madd_epi16(yv, c_yv), round);
+		r = _mm_packs_epi32(_mm_srai_epi32(t0, 8), _mm_srai_epi32(t1, 8));
+
+		/* G = cy * y + cgu * u + cgv * v */
+		yu = _mm_unpacklo_epi16(y, u);
+		t0 = _mm_add_epi32(_mm_madd_epi16(yu, c_yu), round);
+		t0 = _mm_add_epi32(t0, _mm_madd_epi16(_mm_unpacklo_epi16(v, zero), c_v));
+		yu = _mm_unpackhi_epi16(y, u);
+		t1 = _mm_add_epi32(_mm_madd_epi16(yu, c_yu), round);
+		t1 = _mm_add_epi32(t1, _mm_madd_epi16(_mm_unpackhi_epi16(v, zero), c_v));
+		g = _mm_packs_epi32(_mm_srai_epi32(t0, 8), _mm_srai_epi32(t1, 8));
+
+		/* B = cy * y + cbu * u */
+		yu = _mm_unpacklo_epi16(y, u);
+		t0 = _mm_add_epi32(_mm_madd_epi16(yu, c_yb), round);
+		yu = _mm_unpackhi_epi16(y, u);
+		t1 = _mm_add_epi32(_mm_madd_epi16(yu, c_yb), round);
+		b = _mm_packs_epi32(_mm_srai_epi32(t0, 8), _mm_srai_epi32(t1, 8));
+
+		if (swap) {
+			t0 = r;
+			r = b;
+			b = t0;
+		}
+		rg = _mm_unpacklo_epi8(_mm_packus_epi16(r, r), _mm_packus_epi16(g, g));
+		ba = _mm_unpacklo_epi8(_mm_packus_epi16(b, b), alpha);
+		lo = _mm_unpacklo_epi16(rg, ba);
+		hi = _mm_unpackhi_epi16(rg, ba);
+		_mm_storeu_si128((__m128i*)&d[4*n + 0], lo);
+		_mm_storeu_si128((__m128i*)&d[4*n + 16], hi);
+	}
+	for (; n < width; n++) {
+		uint8_t *p = &d[4*n];
+		if (swap)
+			yuv_to_rgb(c, sy[n], su[n], sv[n], &p[2], &p[1], &p[0]);
+		else
+			yuv_to_rgb(c, sy[n], su[n], sv[n], &p[0], &p[1], &p[2]);
+		p[3] = 0xff;
+	}
+}
+
+void
+video_yuv_to_rgba_sse2(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	yuv_to_rgb_sse2(conv, dst[0], src[0], src[1], src[2], width, false);
+}
+
+void
+video_yuv_to_bgra_sse2(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	yuv_to_rgb_sse2(conv, dst[0], src[0], src[1], src[2], width, true);
+}
+
+/* splits 16 pixels of packed 4:2:2 into 16 luma and 16 interleaved chroma bytes */
+static inline void
+split_packed422_sse2(const uint8_t *s, __m128i *y, __m128i *c, bool uyvy)
+{
+	__m128i mask = _mm_set1_epi16(0xff);
+	__m128i s0 = _mm_loadu_si128((__m128i*)&s[0]);
+	__m128i s1 = _mm_loadu_si128((__m128i*)&s[16]);
+
+	if (uyvy) {
+		*y = _mm_packus_epi16(_mm_srli_epi16(s0, 8), _mm_srli_epi16(s1, 8));
+		*c = _mm_packus_epi16(_mm_and_si128(s0, mask), _mm_and_si128(s1, mask));
+	} else {
+		*y = _mm_packus_epi16(_mm_and_si128(s0, mask), _mm_and_si128(s1, mask));
+		*c = _mm_packus_epi16(_mm_srli_epi16(s0, 8), _mm_srli_epi16(s1, 8));
+	}
+}
+
+static inline void
+packed422_to_i420_sse2(void * SPA_RESTRICT dst[], const uint8_t *s, uint32_t width, bool uyvy)
+{
+	uint8_t *dy = dst[0], *du = dst[1], *dv = dst[2];
+	uint32_t n, unrolled = width & ~15;
+	__m128i mask = _mm_set1_epi16(0xff), y, c, u, v;
+
+	for (n = 0; n < unrolled; n += 16) {
+		split_packed422_sse2(&s[2*n], &y, &c, uyvy);
+		_mm_storeu_si128((__m128i*)&dy[n], y);
+		if (du) {
+			u = _mm_and_si128(c, mask);
+			v = _mm_srli_epi16(c, 8);
+			_mm_storel_epi64((__m128i*)&du[n >> 1], _mm_packus_epi16(u, u));
+			_mm_storel_epi64((__m128i*)&dv[n >> 1], _mm_packus_epi16(v, v));
+		}
+	}
+	if (n < width) {
+		void *d[3] = { &dy[n], du ? &du[n >> 1] : NULL, dv ? &dv[n >> 1] : NULL };
+		const void *sp[1] = { &s[2*n] };
+		if (uyvy)
+			video_uyvy_to_i420_c(NULL, d, sp, width - n);
+		else
+			video_yuy2_to_i420_c(NULL, d, sp, width - n);
+	}
+}
+
+static inline void
+packed422_to_nv12_sse2(void * SPA_RESTRICT dst[], const uint8_t *s, uint32_t width, bool uyvy)
+{
+	uint8_t *dy = dst[0], *duv = dst[1];
+	uint32_t n, unrolled = width & ~15;
+	__m128i y, c;
+
+	for (n = 0; n < unrolled; n += 16) {
+		split_packed422_sse2(&s[2*n], &y, &c, uyvy);
+		_mm_storeu_si128((__m128i*)&dy[n], y);
+		if (duv)
+			_mm_storeu_si128((__m128i*)&duv[n], c);
+	}
+	if (n < width) {
+		void *d[2] = { &dy[n], duv ? &duv[n] : NULL };
+		const void *sp[1] = { &s[2*n] };
+		if (uyvy)
+			video_uyvy_to_nv12_c(NULL, d, sp, width - n);
+		else
+			video_yuy2_to_nv12_c(NULL, d, sp, width - n);
+	}
+}
+
+void
+video_yuy2_to_i420_sse2(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	packed422_to_i420_sse2(dst, src[0], width, false);
+}
+
+void
+video_uyvy_to_i420_sse2(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	packed422_to_i420_sse2(dst, src[0], width, true);
+}
+
+void
+video_yuy2_to_nv12_sse2(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	packed422_to_nv12_sse2(dst, src[0], width, false);
+}
+
+void
+video_uyvy_to_nv12_sse2(struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width)
+{
+	packed422_to_nv12_sse2(dst, src[0], width, true);
+}
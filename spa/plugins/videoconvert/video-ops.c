@@ -0,0 +1,389 @@
+/* Spa
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include <spa/support/cpu.h>
+#include <spa/utils/defs.h>
+
+#include "video-ops.h"
+
+typedef void (*video_func_t) (struct video_convert *conv, void * SPA_RESTRICT dst[],
+		const void * SPA_RESTRICT src[], uint32_t width);
+
+#define FAMILY_YUV	0
+#define FAMILY_RGB	1
+
+struct format_info {
+	uint32_t format;
+	uint32_t family;
+	/* chroma subsampling as a shift of the line number */
+	uint32_t v_shift;
+	video_func_t unpack;
+	video_func_t pack;
+};
+
+static const struct format_info format_table[] =
+{
+	{ SPA_VIDEO_FORMAT_YUY2, FAMILY_YUV, 0, video_unpack_yuy2_c, video_pack_yuy2_c },
+	{ SPA_VIDEO_FORMAT_UYVY, FAMILY_YUV, 0, video_unpack_uyvy_c, video_pack_uyvy_c },
+	{ SPA_VIDEO_FORMAT_I420, FAMILY_YUV, 1, video_unpack_i420_c, video_pack_i420_c },
+	{ SPA_VIDEO_FORMAT_NV12, FAMILY_YUV, 1, video_unpack_nv12_c, video_pack_nv12_c },
+	{ SPA_VIDEO_FORMAT_RGBA, FAMILY_RGB, 0, video_unpack_rgba_c, video_pack_rgba_c },
+	{ SPA_VIDEO_FORMAT_RGBx, FAMILY_RGB, 0, video_unpack_rgbx_c, video_pack_rgbx_c },
+	{ SPA_VIDEO_FORMAT_BGRA, FAMILY_RGB, 0, video_unpack_bgra_c, video_pack_bgra_c },
+	{ SPA_VIDEO_FORMAT_BGRx, FAMILY_RGB, 0, video_unpack_bgrx_c, video_pack_bgrx_c },
+};
+
+/* kernels that do a complete conversion of a line without scaling */
+struct direct_info {
+	uint32_t src_fmt;
+	uint32_t dst_fmt;
+	uint32_t cpu_flags;
+	video_func_t process;
+};
+
+static const struct direct_info direct_table[] =
+{
+#if defined (HAVE_AVX2)
+	{ SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_I420, SPA_CPU_FLAG_AVX2, video_yuy2_to_i420_avx2 },
+	{ SPA_VIDEO_FORMAT_UYVY, SPA_VIDEO_FORMAT_I420, SPA_CPU_FLAG_AVX2, video_uyvy_to_i420_avx2 },
+	{ SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_NV12, SPA_CPU_FLAG_AVX2, video_yuy2_to_nv12_avx2 },
+	{ SPA_VIDEO_FORMAT_UYVY, SPA_VIDEO_FORMAT_NV12, SPA_CPU_FLAG_AVX2, video_uyvy_to_nv12_avx2 },
+#endif
+#if defined (HAVE_SSE2)
+	{ SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_I420, SPA_CPU_FLAG_SSE2, video_yuy2_to_i420_sse2 },
+	{ SPA_VIDEO_FORMAT_UYVY, SPA_VIDEO_FORMAT_I420, SPA_CPU_FLAG_SSE2, video_uyvy_to_i420_sse2 },
+	{ SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_NV12, SPA_CPU_FLAG_SSE2, video_yuy2_to_nv12_sse2 },
+	{ SPA_VIDEO_FORMAT_UYVY, SPA_VIDEO_FORMAT_NV12, SPA_CPU_FLAG_SSE2, video_uyvy_to_nv12_sse2 },
+#endif
+#if defined (HAVE_NEON)
+	{ SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_I420, SPA_CPU_FLAG_NEON, video_yuy2_to_i420_neon },
+	{ SPA_VIDEO_FORMAT_UYVY, SPA_VIDEO_FORMAT_I420, SPA_CPU_FLAG_NEON, video_uyvy_to_i420_neon },
+	{ SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_NV12, SPA_CPU_FLAG_NEON, video_yuy2_to_nv12_neon },
+	{ SPA_VIDEO_FORMAT_UYVY, SPA_VIDEO_FORMAT_NV12, SPA_CPU_FLAG_NEON, video_uyvy_to_nv12_neon },
+#endif
+	{ SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_I420, 0, video_yuy2_to_i420_c },
+	{ SPA_VIDEO_FORMAT_UYVY, SPA_VIDEO_FORMAT_I420, 0, video_uyvy_to_i420_c },
+	{ SPA_VIDEO_FORMAT_YUY2, SPA_VIDEO_FORMAT_NV12, 0, video_yuy2_to_nv12_c },
+	{ SPA_VIDEO_FORMAT_UYVY, SPA_VIDEO_FORMAT_NV12, 0, video_uyvy_to_nv12_c },
+};
+
+/* kernels that convert unpacked yuv to a packed rgb format */
+static const struct direct_info matrix_table[] =
+{
+#if defined (HAVE_AVX2)
+	{ 0, SPA_VIDEO_FORMAT_RGBA, SPA_CPU_FLAG_AVX2, video_yuv_to_rgba_avx2 },
+	{ 0, SPA_VIDEO_FORMAT_RGBx, SPA_CPU_FLAG_AVX2, video_yuv_to_rgba_avx2 },
+	{ 0, SPA_VIDEO_FORMAT_BGRA, SPA_CPU_FLAG_AVX2, video_yuv_to_bgra_avx2 },
+	{ 0, SPA_VIDEO_FORMAT_BGRx, SPA_CPU_FLAG_AVX2, video_yuv_to_bgra_avx2 },
+#endif
+#if defined (HAVE_SSE2)
+	{ 0, SPA_VIDEO_FORMAT_RGBA, SPA_CPU_FLAG_SSE2, video_yuv_to_rgba_sse2 },
+	{ 0, SPA_VIDEO_FORMAT_RGBx, SPA_CPU_FLAG_SSE2, video_yuv_to_rgba_sse2 },
+	{ 0, SPA_VIDEO_FORMAT_BGRA, SPA_CPU_FLAG_SSE2, video_yuv_to_bgra_sse2 },
+	{ 0, SPA_VIDEO_FORMAT_BGRx, SPA_CPU_FLAG_SSE2, video_yuv_to_bgra_sse2 },
+#endif
+#if defined (HAVE_NEON)
+	{ 0, SPA_VIDEO_FORMAT_RGBA, SPA_CPU_FLAG_NEON, video_yuv_to_rgba_neon },
+	{ 0, SPA_VIDEO_FORMAT_RGBx, SPA_CPU_FLAG_NEON, video_yuv_to_rgba_neon },
+	{ 0, SPA_VIDEO_FORMAT_BGRA, SPA_CPU_FLAG_NEON, video_yuv_to_bgra_neon },
+	{ 0, SPA_VIDEO_FORMAT_BGRx, SPA_CPU_FLAG_NEON, video_yuv_to_bgra_neon },
+#endif
+	{ 0, SPA_VIDEO_FORMAT_RGBA, 0, video_yuv_to_rgba_c },
+	{ 0, SPA_VIDEO_FORMAT_RGBx, 0, video_yuv_to_rgba_c },
+	{ 0, SPA_VIDEO_FORMAT_BGRA, 0, video_yuv_to_bgra_c },
+	{ 0, SPA_VIDEO_FORMAT_BGRx, 0, video_yuv_to_bgra_c },
+};
+
+#define MATCH_CPU_FLAGS(a,b)	((a) == 0 || ((a) & (b)) == a)
+
+static const struct format_info *find_format_info(uint32_t format)
+{
+	size_t i;
+
+	for (i = 0; i < SPA_N_ELEMENTS(format_table); i++) {
+		if (format_table[i].format == format)
+			return &format_table[i];
+	}
+	return NULL;
+}
+
+static const struct direct_info *find_direct_info(const struct direct_info *table, size_t n_table,
+		uint32_t src_fmt, uint32_t dst_fmt, uint32_t cpu_flags)
+{
+	size_t i;
+
+	for (i = 0; i < n_table; i++) {
+		if (table[i].src_fmt == src_fmt &&
+		    table[i].dst_fmt == dst_fmt &&
+		    MATCH_CPU_FLAGS(table[i].cpu_flags, cpu_flags))
+			return &table[i];
+	}
+	return NULL;
+}
+
+int video_layout_init(struct video_layout *layout, uint32_t format,
+		uint32_t width, uint32_t height, uint32_t stride)
+{
+	uint32_t cstride;
+
+	spa_zero(*layout);
+
+	switch (format) {
+	case SPA_VIDEO_FORMAT_YUY2:
+	case SPA_VIDEO_FORMAT_UYVY:
+		layout->n_planes = 1;
+		layout->stride[0] = stride ? stride : SPA_ROUND_UP_N(width, 2) * 2;
+		break;
+	case SPA_VIDEO_FORMAT_RGBA:
+	case SPA_VIDEO_FORMAT_RGBx:
+	case SPA_VIDEO_FORMAT_BGRA:
+	case SPA_VIDEO_FORMAT_BGRx:
+		layout->n_planes = 1;
+		layout->stride[0] = stride ? stride : width * 4;
+		break;
+	case SPA_VIDEO_FORMAT_I420:
+		layout->n_planes = 3;
+		layout->stride[0] = stride ? stride : SPA_ROUND_UP_N(width, 4);
+		cstride = stride ? stride / 2 : SPA_ROUND_UP_N((width + 1) / 2, 4);
+		layout->stride[1] = layout->stride[2] = cstride;
+		layout->offset[1] = layout->stride[0] * height;
+		layout->offset[2] = layout->offset[1] + cstride * ((height + 1) / 2);
+		layout->size = layout->offset[2] + cstride * ((height + 1) / 2);
+		return 0;
+	case SPA_VIDEO_FORMAT_NV12:
+		layout->n_planes = 2;
+		layout->stride[0] = layout->stride[1] = stride ? stride : SPA_ROUND_UP_N(width, 4);
+		layout->offset[1] = layout->stride[0] * height;
+		layout->size = layout->offset[1] + layout->stride[1] * ((height + 1) / 2);
+		return 0;
+	default:
+		return -ENOTSUP;
+	}
+	layout->size = layout->stride[0] * height;
+	return 0;
+}
+
+static inline void get_lines(const struct video_frame *frame, uint32_t n_planes,
+		uint32_t v_shift, uint32_t line, void *lines[VIDEO_MAX_PLANES])
+{
+	uint32_t i;
+
+	lines[0] = SPA_MEMBER(frame->data[0], frame->stride[0] * line, void);
+	for (i = 1; i < n_planes; i++)
+		lines[i] = SPA_MEMBER(frame->data[i], frame->stride[i] * (line >> v_shift), void);
+}
+
+static void impl_video_copy(struct video_convert *conv, const struct video_frame *dst,
+		const struct video_frame *src)
+{
+	const struct format_info *info = find_format_info(conv->src_fmt);
+	struct video_layout layout;
+	uint32_t i, y, height, size;
+
+	video_layout_init(&layout, conv->src_fmt, conv->src_width, conv->src_height, 0);
+
+	for (i = 0; i < layout.n_planes; i++) {
+		height = i == 0 ? conv->src_height :
+			(conv->src_height + (1 << info->v_shift) - 1) >> info->v_shift;
+		size = SPA_MIN(src->stride[i], dst->stride[i]);
+
+		if (src->stride[i] == dst->stride[i]) {
+			memcpy(dst->data[i], src->data[i], size * height);
+			continue;
+		}
+		for (y = 0; y < height; y++)
+			memcpy(SPA_MEMBER(dst->data[i], dst->stride[i] * y, void),
+				SPA_MEMBER(src->data[i], src->stride[i] * y, void), size);
+	}
+}
+
+static void impl_video_direct(struct video_convert *conv, const struct video_frame *dst,
+		const struct video_frame *src)
+{
+	const struct format_info *dinfo = find_format_info(conv->dst_fmt);
+	struct video_layout layout;
+	void *s[VIDEO_MAX_PLANES];
+	void *d[VIDEO_MAX_PLANES];
+	uint32_t i, y;
+
+	video_layout_init(&layout, conv->dst_fmt, 0, 0, 0);
+
+	for (y = 0; y < conv->dst_height; y++) {
+		get_lines(src, 1, 0, y, s);
+		get_lines(dst, layout.n_planes, dinfo->v_shift, y, d);
+		if (y & ((1 << dinfo->v_shift) - 1)) {
+			for (i = 1; i < layout.n_planes; i++)
+				d[i] = NULL;
+		}
+		conv->direct(conv, d, (const void **)s, conv->dst_width);
+	}
+}
+
+static void impl_video_process(struct video_convert *conv, const struct video_frame *dst,
+		const struct video_frame *src)
+{
+	const struct format_info *sinfo = find_format_info(conv->src_fmt);
+	const struct format_info *dinfo = find_format_info(conv->dst_fmt);
+	struct video_layout slayout, dlayout;
+	void *s[VIDEO_MAX_PLANES];
+	void *d[VIDEO_MAX_PLANES];
+	void **line;
+	uint32_t i, y, sy;
+
+	video_layout_init(&slayout, conv->src_fmt, 0, 0, 0);
+	video_layout_init(&dlayout, conv->dst_fmt, 0, 0, 0);
+
+	for (y = 0; y < conv->dst_height; y++) {
+		sy = (uint32_t)(((uint64_t)y * conv->src_height) / conv->dst_height);
+
+		get_lines(src, slayout.n_planes, sinfo->v_shift, sy, s);
+		line = conv->lines[0];
+		conv->unpack(conv, line, (const void **)s, conv->src_width);
+
+		if (conv->scale) {
+			conv->scale(conv, conv->lines[1], (const void **)line, conv->dst_width);
+			line = conv->lines[1];
+		}
+
+		get_lines(dst, dlayout.n_planes, dinfo->v_shift, y, d);
+		if (y & ((1 << dinfo->v_shift) - 1)) {
+			for (i = 1; i < dlayout.n_planes; i++)
+				d[i] = NULL;
+		}
+		if (conv->matrix) {
+			if (conv->pack == NULL) {
+				/* fused conversion to packed rgb */
+				conv->matrix(conv, d, (const void **)line, conv->dst_width);
+				continue;
+			}
+			conv->matrix(conv, conv->lines[2], (const void **)line, conv->dst_width);
+			line = conv->lines[2];
+		}
+		conv->pack(conv, d, (const void **)line, conv->dst_width);
+	}
+}
+
+static void impl_video_convert_free(struct video_convert *conv)
+{
+	free(conv->tmp);
+	conv->tmp = NULL;
+	conv->process = NULL;
+}
+
+static void init_matrix(struct video_convert *conv)
+{
+	/* 8 bit fixed point, limited range */
+	static const int32_t bt601_yuv_rgb[5] = { 298, 409, -100, -208, 516 };
+	static const int32_t bt601_rgb_yuv[9] = { 66, 129, 25, -38, -74, 112, 112, -94, -18 };
+	static const int32_t bt709_yuv_rgb[5] = { 298, 459, -55, -136, 541 };
+	static const int32_t bt709_rgb_yuv[9] = { 47, 157, 16, -26, -87, 112, 112, -102, -10 };
+
+	if (conv->color_matrix == SPA_VIDEO_COLOR_MATRIX_BT709) {
+		memcpy(conv->yuv_rgb, bt709_yuv_rgb, sizeof(conv->yuv_rgb));
+		memcpy(conv->rgb_yuv, bt709_rgb_yuv, sizeof(conv->rgb_yuv));
+	} else {
+		memcpy(conv->yuv_rgb, bt601_yuv_rgb, sizeof(conv->yuv_rgb));
+		memcpy(conv->rgb_yuv, bt601_rgb_yuv, sizeof(conv->rgb_yuv));
+	}
+}
+
+int video_convert_init(struct video_convert *conv)
+{
+	const struct format_info *sinfo, *dinfo;
+	const struct direct_info *info;
+	uint32_t i, j, max_width, cpu_flags = 0;
+
+	sinfo = find_format_info(conv->src_fmt);
+	dinfo = find_format_info(conv->dst_fmt);
+	if (sinfo == NULL || dinfo == NULL)
+		return -ENOTSUP;
+
+	if (conv->src_width == 0 || conv->src_height == 0 ||
+	    conv->dst_width == 0 || conv->dst_height == 0 ||
+	    conv->src_width > VIDEO_MAX_WIDTH || conv->src_height > VIDEO_MAX_HEIGHT ||
+	    conv->dst_width > VIDEO_MAX_WIDTH || conv->dst_height > VIDEO_MAX_HEIGHT)
+		return -EINVAL;
+
+	init_matrix(conv);
+
+	conv->direct = NULL;
+	conv->unpack = sinfo->unpack;
+	conv->pack = dinfo->pack;
+	conv->scale = NULL;
+	conv->matrix = NULL;
+	conv->tmp = NULL;
+	conv->free = impl_video_convert_free;
+
+	conv->is_passthrough = conv->src_fmt == conv->dst_fmt &&
+		conv->src_width == conv->dst_width &&
+		conv->src_height == conv->dst_height;
+
+	if (conv->is_passthrough) {
+		conv->process = impl_video_copy;
+		conv->cpu_flags = 0;
+		return 0;
+	}
+
+	if (conv->src_width == conv->dst_width &&
+	    conv->src_height == conv->dst_height &&
+	    (info = find_direct_info(direct_table, SPA_N_ELEMENTS(direct_table),
+				conv->src_fmt, conv->dst_fmt, conv->cpu_flags)) != NULL) {
+		conv->direct = info->process;
+		conv->process = impl_video_direct;
+		conv->cpu_flags = info->cpu_flags;
+		return 0;
+	}
+
+	if (conv->src_width != conv->dst_width)
+		conv->scale = video_scale_bilinear_c;
+
+	if (sinfo->family == FAMILY_YUV && dinfo->family == FAMILY_RGB) {
+		info = find_direct_info(matrix_table, SPA_N_ELEMENTS(matrix_table),
+				0, conv->dst_fmt, conv->cpu_flags);
+		conv->matrix = info->process;
+		conv->pack = NULL;
+		cpu_flags = info->cpu_flags;
+	} else if (sinfo->family == FAMILY_RGB && dinfo->family == FAMILY_YUV) {
+		conv->matrix = video_rgb_to_yuv_c;
+	}
+	conv->cpu_flags = cpu_flags;
+
+	max_width = SPA_ROUND_UP_N(SPA_MAX(conv->src_width, conv->dst_width), 64);
+	conv->tmp = malloc(3 * VIDEO_MAX_PLANES * max_width + 63);
+	if (conv->tmp == NULL)
+		return -errno;
+
+	for (i = 0; i < 3; i++)
+		for (j = 0; j < VIDEO_MAX_PLANES; j++)
+			conv->lines[i][j] = SPA_PTR_ALIGN(conv->tmp, 64, uint8_t) +
+				(i * VIDEO_MAX_PLANES + j) * max_width;
+
+	conv->process = impl_video_process;
+
+	return 0;
+}
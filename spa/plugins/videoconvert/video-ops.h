@@ -0,0 +1,160 @@
+/* Spa
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <spa/utils/defs.h>
+#include <spa/param/video/raw.h>
+
+#define VIDEO_MAX_PLANES	4
+#define VIDEO_MAX_WIDTH		8192
+#define VIDEO_MAX_HEIGHT	8192
+
+/* The generic path converts one line at a time. A line is unpacked to
+ * 4 planar 4:4:4 components (Y,U,V,A or R,G,B,A), optionally scaled and
+ * converted between YUV and RGB and then packed into the target format.
+ *
+ * Chroma of 4:2:0 formats is taken from the even lines only, chroma of
+ * 4:2:2 and 4:2:0 formats is averaged horizontally when packing. The
+ * optimized kernels produce the same output as the generic path. */
+
+static inline void yuv_to_rgb(const int32_t *c, uint8_t y, uint8_t u, uint8_t v,
+		uint8_t *r, uint8_t *g, uint8_t *b)
+{
+	int32_t cy = c[0] * ((int32_t)y - 16), cu = (int32_t)u - 128, cv = (int32_t)v - 128;
+	*r = SPA_CLAMP((cy + c[1] * cv + 128) >> 8, 0, 255);
+	*g = SPA_CLAMP((cy + c[2] * cu + c[3] * cv + 128) >> 8, 0, 255);
+	*b = SPA_CLAMP((cy + c[4] * cu + 128) >> 8, 0, 255);
+}
+
+struct video_frame {
+	void *data[VIDEO_MAX_PLANES];
+	uint32_t stride[VIDEO_MAX_PLANES];
+};
+
+struct video_layout {
+	uint32_t n_planes;
+	uint32_t offset[VIDEO_MAX_PLANES];
+	uint32_t stride[VIDEO_MAX_PLANES];
+	uint32_t size;
+};
+
+struct video_convert {
+	uint32_t src_fmt;
+	uint32_t dst_fmt;
+	uint32_t src_width;
+	uint32_t src_height;
+	uint32_t dst_width;
+	uint32_t dst_height;
+	uint32_t color_matrix;
+	uint32_t cpu_flags;
+
+	unsigned int is_passthrough:1;
+
+	/* yuv -> rgb: cy, crv, cgu, cgv, cbu */
+	int32_t yuv_rgb[5];
+	/* rgb -> yuv: yr, yg, yb, ur, ug, ub, vr, vg, vb */
+	int32_t rgb_yuv[9];
+
+	void (*direct) (struct video_convert *conv, void * SPA_RESTRICT dst[],
+			const void * SPA_RESTRICT src[], uint32_t width);
+	void (*unpack) (struct video_convert *conv, void * SPA_RESTRICT dst[],
+			const void * SPA_RESTRICT src[], uint32_t width);
+	void (*scale) (struct video_convert *conv, void * SPA_RESTRICT dst[],
+			const void * SPA_RESTRICT src[], uint32_t width);
+	void (*matrix) (struct video_convert *conv, void * SPA_RESTRICT dst[],
+			const void * SPA_RESTRICT src[], uint32_t width);
+	void (*pack) (struct video_convert *conv, void * SPA_RESTRICT dst[],
+			const void * SPA_RESTRICT src[], uint32_t width);
+
+	uint8_t *tmp;
+	void *lines[3][VIDEO_MAX_PLANES];
+
+	void (*process) (struct video_convert *conv, const struct video_frame *dst,
+			const struct video_frame *src);
+	void (*free) (struct video_convert *conv);
+};
+
+int video_layout_init(struct video_layout *layout, uint32_t format,
+		uint32_t width, uint32_t height, uint32_t stride);
+
+int video_convert_init(struct video_convert *conv);
+
+#define video_convert_process(conv,...)	(conv)->process(conv, __VA_ARGS__)
+#define video_convert_free(conv)	(conv)->free(conv)
+
+#define DEFINE_FUNCTION(name,arch) \
+void video_##name##_##arch(struct video_convert *conv, void * SPA_RESTRICT dst[],	\
+		const void * SPA_RESTRICT src[], uint32_t width)
+
+DEFINE_FUNCTION(unpack_yuy2, c);
+DEFINE_FUNCTION(unpack_uyvy, c);
+DEFINE_FUNCTION(unpack_i420, c);
+DEFINE_FUNCTION(unpack_nv12, c);
+DEFINE_FUNCTION(unpack_rgba, c);
+DEFINE_FUNCTION(unpack_rgbx, c);
+DEFINE_FUNCTION(unpack_bgra, c);
+DEFINE_FUNCTION(unpack_bgrx, c);
+DEFINE_FUNCTION(pack_yuy2, c);
+DEFINE_FUNCTION(pack_uyvy, c);
+DEFINE_FUNCTION(pack_i420, c);
+DEFINE_FUNCTION(pack_nv12, c);
+DEFINE_FUNCTION(pack_rgba, c);
+DEFINE_FUNCTION(pack_rgbx, c);
+DEFINE_FUNCTION(pack_bgra, c);
+DEFINE_FUNCTION(pack_bgrx, c);
+DEFINE_FUNCTION(scale_bilinear, c);
+DEFINE_FUNCTION(yuv_to_rgb, c);
+DEFINE_FUNCTION(rgb_to_yuv, c);
+DEFINE_FUNCTION(yuv_to_rgba, c);
+DEFINE_FUNCTION(yuv_to_bgra, c);
+DEFINE_FUNCTION(yuy2_to_i420, c);
+DEFINE_FUNCTION(uyvy_to_i420, c);
+DEFINE_FUNCTION(yuy2_to_nv12, c);
+DEFINE_FUNCTION(uyvy_to_nv12, c);
+
+#if defined(HAVE_SSE2)
+DEFINE_FUNCTION(yuv_to_rgba, sse2);
+DEFINE_FUNCTION(yuv_to_bgra, sse2);
+DEFINE_FUNCTION(yuy2_to_i420, sse2);
+DEFINE_FUNCTION(uyvy_to_i420, sse2);
+DEFINE_FUNCTION(yuy2_to_nv12, sse2);
+DEFINE_FUNCTION(uyvy_to_nv12, sse2);
+#endif
+#if defined(HAVE_AVX2)
+DEFINE_FUNCTION(yuv_to_rgba, avx2);
+DEFINE_FUNCTION(yuv_to_bgra, avx2);
+DEFINE_FUNCTION(yuy2_to_i420, avx2);
+DEFINE_FUNCTION(uyvy_to_i420, avx2);
+DEFINE_FUNCTION(yuy2_to_nv12, avx2);
+DEFINE_FUNCTION(uyvy_to_nv12, avx2);
+#endif
+#if defined(HAVE_NEON)
+DEFINE_FUNCTION(yuv_to_rgba, neon);
+DEFINE_FUNCTION(yuv_to_bgra, neon);
+DEFINE_FUNCTION(yuy2_to_i420, neon);
+DEFINE_FUNCTION(uyvy_to_i420, neon);
+DEFINE_FUNCTION(yuy2_to_nv12, neon);
+DEFINE_FUNCTION(uyvy_to_nv12, neon);
+#endif
+
+#undef DEFINE_FUNCTION
@@ -65,7 +65,6 @@ struct impl {
 	struct spa_buffer **buffers;
 
 	struct spa_io_buffers io_buffers;
-	struct spa_io_rate_match io_rate_match;
 
 	uint64_t info_all;
 	struct spa_node_info info;
@@ -109,7 +108,7 @@ next:
 	switch (id) {
 	case SPA_PARAM_PropInfo:
 	case SPA_PARAM_Props:
-		if ((res = spa_node_enum_params_sync(this->target,
+		if ((res = spa_node_enum_params_sync(this->follower,
 				id, &start, filter, &param, &b)) != 1)
 			return res;
 		break;
@@ -137,7 +136,6 @@ next:
 	return 0;
 }
 
-#if 0
 static int link_io(struct impl *this)
 {
 	int res;
@@ -145,26 +143,9 @@ static int link_io(struct impl *this)
 	if (!this->use_converter)
 		return 0;
 
-	spa_log_warn(this->log, NAME " %p: controls", this);
-
-	spa_zero(this->io_rate_match);
-	this->io_rate_match.rate = 1.0;
-
-	if ((res = spa_node_port_set_io(this->follower,
-			this->direction, 0,
-			SPA_IO_RateMatch,
-			&this->io_rate_match, sizeof(this->io_rate_match))) < 0) {
-		spa_log_warn(this->log, NAME " %p: set RateMatch on follower failed %d %s", this,
-			res, spa_strerror(res));
-	}
-	else if ((res = spa_node_port_set_io(this->convert,
-			SPA_DIRECTION_REVERSE(this->direction), 0,
-			SPA_IO_RateMatch,
-			&this->io_rate_match, sizeof(this->io_rate_match))) < 0) {
-		spa_log_warn(this->log, NAME " %p: set RateMatch on convert failed %d %s", this,
-			res, spa_strerror(res));
-	}
+	spa_log_debug(this->log, NAME " %p: controls", this);
 
+	/* there is no rate matching for video, only link the buffers */
 	this->io_buffers = SPA_IO_BUFFERS_INIT;
 
 	if ((res = spa_node_port_set_io(this->follower,
@@ -185,7 +166,6 @@ static int link_io(struct impl *this)
 	}
 	return 0;
 }
-#endif
 
 static void emit_node_info(struct impl *this, bool full)
 {
@@ -222,8 +202,9 @@ static int impl_node_set_param(void *object, uint32_t id, uint32_t flags,
 		}
 		break;
 	case SPA_PARAM_Props:
+		/* the converter has no properties, they all live on the follower */
 		if (this->target != this->follower) {
-			if ((res = spa_node_set_param(this->target, id, flags, param)) < 0)
+			if ((res = spa_node_set_param(this->follower, id, flags, param)) < 0)
 				return res;
 
 			this->info.change_mask = SPA_NODE_CHANGE_MASK_PARAMS;
@@ -513,7 +494,7 @@ static int debug_params(struct impl *this, struct spa_node *node,
 
 static int negotiate_format(struct impl *this)
 {
-	uint32_t state;
+	uint32_t state, cstate;
 	struct spa_pod *format;
 	uint8_t buffer[4096];
 	struct spa_pod_builder b = { 0 };
@@ -523,26 +504,33 @@ static int negotiate_format(struct impl *this)
 
 	spa_log_debug(this->log, NAME "%p: negiotiate", this);
 
+	/* take the first follower format the converter can handle, the
+	 * follower can also offer encoded formats we can't convert */
 	state = 0;
-	format = NULL;
-	if ((res = spa_node_port_enum_params_sync(this->follower,
-				this->direction, 0,
-				SPA_PARAM_EnumFormat, &state,
-				format, &format, &b)) < 0) {
-		debug_params(this, this->follower, this->direction, 0,
-				SPA_PARAM_EnumFormat, format, "follower format", res);
-		return -ENOTSUP;
-	}
+	while (true) {
+		struct spa_pod *filter;
 
-	state = 0;
-	if ((res = spa_node_port_enum_params_sync(this->convert,
-				SPA_DIRECTION_REVERSE(this->direction), 0,
-				SPA_PARAM_EnumFormat, &state,
-				format, &format, &b)) != 1) {
-		debug_params(this, this->convert,
-				SPA_DIRECTION_REVERSE(this->direction), 0,
-				SPA_PARAM_EnumFormat, format, "convert format", res);
-		return -ENOTSUP;
+		spa_pod_builder_init(&b, buffer, sizeof(buffer));
+
+		filter = NULL;
+		if ((res = spa_node_port_enum_params_sync(this->follower,
+					this->direction, 0,
+					SPA_PARAM_EnumFormat, &state,
+					NULL, &filter, &b)) != 1) {
+			debug_params(this, this->follower, this->direction, 0,
+					SPA_PARAM_EnumFormat, filter, "follower format", res);
+			return -ENOTSUP;
+		}
+
+		cstate = 0;
+		if ((res = spa_node_port_enum_params_sync(this->convert,
+					SPA_DIRECTION_REVERSE(this->direction), 0,
+					SPA_PARAM_EnumFormat, &cstate,
+					filter, &format, &b)) == 1)
+			break;
+
+		spa_log_debug(this->log, NAME " %p: convert can't handle follower format %d",
+				this, state - 1);
 	}
 
 	spa_pod_fixate(format);
@@ -829,6 +817,11 @@ static int impl_clear(struct spa_handle *handle)
 	spa_hook_remove(&this->follower_listener);
 	spa_node_set_callbacks(this->follower, NULL, NULL);
 
+	if (this->use_converter) {
+		spa_hook_remove(&this->target_listener);
+		spa_handle_clear(this->hnd_convert);
+	}
+
 	if (this->buffers)
 		free(this->buffers);
 	this->buffers = NULL;
@@ -842,11 +835,9 @@ static size_t
 impl_get_size(const struct spa_handle_factory *factory,
 	      const struct spa_dict *params)
 {
-	size_t size = 0;
+	size_t size;
 
-#if 0
-	size += spa_handle_factory_get_size(&spa_videoconvert_factory, params);
-#endif
+	size = spa_handle_factory_get_size(&spa_videoconvert_factory, params);
 	size += sizeof(struct impl);
 
 	return size;
@@ -860,10 +851,9 @@ impl_init(const struct spa_handle_factory *factory,
 	  uint32_t n_support)
 {
 	struct impl *this;
-#if 0
 	void *iface;
-#endif
 	const char *str;
+	int res;
 
 	spa_return_val_if_fail(factory != NULL, -EINVAL);
 	spa_return_val_if_fail(handle != NULL, -EINVAL);
@@ -892,27 +882,30 @@ impl_init(const struct spa_handle_factory *factory,
 			&impl_node, this);
 	spa_hook_list_init(&this->hooks);
 
-#if 0
-	this->hnd_convert = SPA_MEMBER(this, sizeof(struct impl), struct spa_handle);
-	spa_handle_factory_init(&spa_videooconvert_factory,
-				this->hnd_convert,
-				info, support, n_support);
-
-	spa_handle_get_interface(this->hnd_convert, SPA_TYPE_INTERFACE_Node, &iface);
-	this->convert = iface;
-	this->target = this->convert;
-	spa_node_add_listener(this->convert,
-			&this->convert_listener, &target_node_events, this);
-
-	this->use_converter = true;
-	link_io(this);
+	/* the converter only handles raw video, leave it to the session
+	 * to enable it for followers that produce or consume raw formats */
+	if ((str = spa_dict_lookup(info, "video.adapt.converter")) != NULL &&
+	    (strcmp(str, "true") == 0 || atoi(str) == 1)) {
+		this->hnd_convert = SPA_MEMBER(this, sizeof(struct impl), struct spa_handle);
+		if ((res = spa_handle_factory_init(&spa_videoconvert_factory,
+					this->hnd_convert,
+					info, support, n_support)) < 0) {
+			spa_hook_remove(&this->follower_listener);
+			spa_node_set_callbacks(this->follower, NULL, NULL);
+			return res;
+		}
 
-#else
-	this->target = this->follower;
+		spa_handle_get_interface(this->hnd_convert, SPA_TYPE_INTERFACE_Node, &iface);
+		this->convert = iface;
+		this->target = this->convert;
+		this->use_converter = true;
+	} else {
+		this->target = this->follower;
+	}
 	spa_node_add_listener(this->target,
 			&this->target_listener, &target_node_events, this);
 
-#endif
+	link_io(this);
 
 	this->info_all = SPA_NODE_CHANGE_MASK_PARAMS;
 	this->info = SPA_NODE_INFO_INIT();
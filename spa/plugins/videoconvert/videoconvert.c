@@ -0,0 +1,965 @@
+/* Spa
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <stdio.h>
+#include <limits.h>
+
+#include <spa/support/plugin.h>
+#include <spa/support/log.h>
+#include <spa/support/cpu.h>
+#include <spa/utils/list.h>
+#include <spa/utils/names.h>
+#include <spa/node/node.h>
+#include <spa/node/io.h>
+#include <spa/node/utils.h>
+#include <spa/param/video/format-utils.h>
+#include <spa/param/param.h>
+#include <spa/pod/filter.h>
+#include <spa/debug/types.h>
+
+#include "video-ops.h"
+
+#define NAME "videoconvert"
+
+#define DEFAULT_WIDTH		320
+#define DEFAULT_HEIGHT		240
+#define DEFAULT_FORMAT		SPA_VIDEO_FORMAT_RGBA
+
+#define MAX_BUFFERS	32
+#define MAX_ALIGN	16
+
+struct buffer {
+	uint32_t id;
+#define BUFFER_FLAG_OUT		(1 << 0)
+	uint32_t flags;
+	struct spa_list link;
+	struct spa_buffer *outbuf;
+	struct spa_meta_header *h;
+};
+
+struct port {
+	uint32_t direction;
+	uint32_t id;
+
+	struct spa_io_buffers *io;
+
+	uint64_t info_all;
+	struct spa_port_info info;
+	struct spa_param_info params[8];
+
+	struct spa_video_info format;
+	struct video_layout layout;
+	unsigned int have_format:1;
+
+	struct buffer buffers[MAX_BUFFERS];
+	uint32_t n_buffers;
+
+	struct spa_list queue;
+};
+
+struct impl {
+	struct spa_handle handle;
+	struct spa_node node;
+
+	struct spa_log *log;
+	struct spa_cpu *cpu;
+
+	struct spa_io_position *io_position;
+
+	uint64_t info_all;
+	struct spa_node_info info;
+	struct spa_param_info params[8];
+
+	struct spa_hook_list hooks;
+
+	struct port ports[2][1];
+
+	uint32_t cpu_flags;
+	struct video_convert conv;
+	unsigned int started:1;
+	unsigned int is_passthrough:1;
+};
+
+#define CHECK_PORT(this,d,id)		(id == 0)
+#define GET_PORT(this,d,id)		(&this->ports[d][id])
+#define GET_IN_PORT(this,id)		GET_PORT(this,SPA_DIRECTION_INPUT,id)
+#define GET_OUT_PORT(this,id)		GET_PORT(this,SPA_DIRECTION_OUTPUT,id)
+
+static int setup_convert(struct impl *this)
+{
+	struct spa_video_info_raw *informat, *outformat;
+	struct port *inport, *outport;
+	int res;
+
+	inport = GET_IN_PORT(this, 0);
+	outport = GET_OUT_PORT(this, 0);
+
+	if (!inport->have_format || !outport->have_format)
+		return -EIO;
+
+	informat = &inport->format.info.raw;
+	outformat = &outport->format.info.raw;
+
+	spa_log_info(this->log, NAME " %p: %s/%dx%d->%s/%dx%d", this,
+			spa_debug_type_find_name(spa_type_video_format, informat->format),
+			informat->size.width, informat->size.height,
+			spa_debug_type_find_name(spa_type_video_format, outformat->format),
+			outformat->size.width, outformat->size.height);
+
+	if (this->conv.process)
+		video_convert_free(&this->conv);
+
+	this->conv.src_fmt = informat->format;
+	this->conv.dst_fmt = outformat->format;
+	this->conv.src_width = informat->size.width;
+	this->conv.src_height = informat->size.height;
+	this->conv.dst_width = outformat->size.width;
+	this->conv.dst_height = outformat->size.height;
+	this->conv.color_matrix = informat->color_matrix ?
+		informat->color_matrix : outformat->color_matrix;
+	this->conv.cpu_flags = this->cpu_flags;
+
+	if ((res = video_convert_init(&this->conv)) < 0)
+		return res;
+
+	this->is_passthrough = this->conv.is_passthrough;
+
+	spa_log_debug(this->log, NAME " %p: got converter features %08x:%08x passthrough:%d", this,
+			this->cpu_flags, this->conv.cpu_flags, this->is_passthrough);
+
+	return 0;
+}
+
+static int impl_node_enum_params(void *object, int seq,
+				 uint32_t id, uint32_t start, uint32_t num,
+				 const struct spa_pod *filter)
+{
+	return -ENOTSUP;
+}
+
+static int impl_node_set_param(void *object, uint32_t id, uint32_t flags,
+			       const struct spa_pod *param)
+{
+	return -ENOTSUP;
+}
+
+static int impl_node_set_io(void *object, uint32_t id, void *data, size_t size)
+{
+	struct impl *this = object;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+
+	spa_log_debug(this->log, NAME " %p: io %d %p/%zd", this, id, data, size);
+
+	switch (id) {
+	case SPA_IO_Position:
+		this->io_position = data;
+		break;
+	default:
+		return -ENOENT;
+	}
+	return 0;
+}
+
+static int impl_node_send_command(void *object, const struct spa_command *command)
+{
+	struct impl *this = object;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(command != NULL, -EINVAL);
+
+	switch (SPA_NODE_COMMAND_ID(command)) {
+	case SPA_NODE_COMMAND_Start:
+		this->started = true;
+		break;
+	case SPA_NODE_COMMAND_Suspend:
+	case SPA_NODE_COMMAND_Flush:
+	case SPA_NODE_COMMAND_Pause:
+		this->started = false;
+		break;
+	default:
+		return -ENOTSUP;
+	}
+	return 0;
+}
+
+static void emit_info(struct impl *this, bool full)
+{
+	if (full)
+		this->info.change_mask = this->info_all;
+	if (this->info.change_mask) {
+		spa_node_emit_info(&this->hooks, &this->info);
+		this->info.change_mask = 0;
+	}
+}
+
+static void emit_port_info(struct impl *this, struct port *port, bool full)
+{
+	if (full)
+		port->info.change_mask = port->info_all;
+	if (port->info.change_mask) {
+		spa_node_emit_port_info(&this->hooks,
+				port->direction, port->id, &port->info);
+		port->info.change_mask = 0;
+	}
+}
+
+static int
+impl_node_add_listener(void *object,
+		struct spa_hook *listener,
+		const struct spa_node_events *events,
+		void *data)
+{
+	struct impl *this = object;
+	struct spa_hook_list save;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+
+	spa_hook_list_isolate(&this->hooks, &save, listener, events, data);
+
+	emit_info(this, true);
+	emit_port_info(this, GET_IN_PORT(this, 0), true);
+	emit_port_info(this, GET_OUT_PORT(this, 0), true);
+
+	spa_hook_list_join(&this->hooks, &save);
+
+	return 0;
+}
+
+static int
+impl_node_set_callbacks(void *object,
+			const struct spa_node_callbacks *callbacks,
+			void *user_data)
+{
+	return 0;
+}
+
+static int impl_node_add_port(void *object, enum spa_direction direction, uint32_t port_id,
+		const struct spa_dict *props)
+{
+	return -ENOTSUP;
+}
+
+static int
+impl_node_remove_port(void *object, enum spa_direction direction, uint32_t port_id)
+{
+	return -ENOTSUP;
+}
+
+static int port_enum_formats(void *object,
+			     enum spa_direction direction, uint32_t port_id,
+			     uint32_t index,
+			     struct spa_pod **param,
+			     struct spa_pod_builder *builder)
+{
+	struct impl *this = object;
+	struct port *port, *other;
+
+	port = GET_PORT(this, direction, port_id);
+	other = GET_PORT(this, SPA_DIRECTION_REVERSE(direction), 0);
+
+	spa_log_debug(this->log, NAME " %p: enum %p %d %d", this, other, port->have_format, other->have_format);
+	switch (index) {
+	case 0:
+		if (port->have_format) {
+			*param = spa_format_video_raw_build(builder,
+					SPA_PARAM_EnumFormat, &port->format.info.raw);
+		}
+		else {
+			struct spa_pod_frame f;
+			struct spa_video_info_raw info;
+
+			if (other->have_format) {
+				info = other->format.info.raw;
+			} else {
+				spa_zero(info);
+				info.format = DEFAULT_FORMAT;
+				info.size = SPA_RECTANGLE(DEFAULT_WIDTH, DEFAULT_HEIGHT);
+				info.framerate = SPA_FRACTION(25, 1);
+			}
+
+			spa_pod_builder_push_object(builder, &f,
+				SPA_TYPE_OBJECT_Format, SPA_PARAM_EnumFormat);
+
+			/* prefer the format of the other port so that we can
+			 * pass the buffers through unmodified */
+			spa_pod_builder_add(builder,
+				SPA_FORMAT_mediaType,      SPA_POD_Id(SPA_MEDIA_TYPE_video),
+				SPA_FORMAT_mediaSubtype,   SPA_POD_Id(SPA_MEDIA_SUBTYPE_raw),
+				SPA_FORMAT_VIDEO_format,   SPA_POD_CHOICE_ENUM_Id(9,
+							info.format,
+							SPA_VIDEO_FORMAT_YUY2,
+							SPA_VIDEO_FORMAT_UYVY,
+							SPA_VIDEO_FORMAT_I420,
+							SPA_VIDEO_FORMAT_NV12,
+							SPA_VIDEO_FORMAT_RGBA,
+							SPA_VIDEO_FORMAT_RGBx,
+							SPA_VIDEO_FORMAT_BGRA,
+							SPA_VIDEO_FORMAT_BGRx),
+				SPA_FORMAT_VIDEO_size,     SPA_POD_CHOICE_RANGE_Rectangle(
+							&info.size,
+							&SPA_RECTANGLE(1, 1),
+							&SPA_RECTANGLE(VIDEO_MAX_WIDTH, VIDEO_MAX_HEIGHT)),
+				SPA_FORMAT_VIDEO_framerate, SPA_POD_CHOICE_RANGE_Fraction(
+							&info.framerate,
+							&SPA_FRACTION(0, 1),
+							&SPA_FRACTION(INT32_MAX, 1)),
+				0);
+			*param = spa_pod_builder_pop(builder, &f);
+		}
+		break;
+	default:
+		return 0;
+	}
+
+	return 1;
+}
+
+static int
+impl_node_port_enum_params(void *object, int seq,
+			   enum spa_direction direction, uint32_t port_id,
+			   uint32_t id, uint32_t start, uint32_t num,
+			   const struct spa_pod *filter)
+{
+	struct impl *this = object;
+	struct port *port;
+	struct spa_pod *param;
+	struct spa_pod_builder b = { 0 };
+	uint8_t buffer[1024];
+	struct spa_result_node_params result;
+	uint32_t count = 0;
+	int res;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(num != 0, -EINVAL);
+
+	spa_return_val_if_fail(CHECK_PORT(this, direction, port_id), -EINVAL);
+
+	port = GET_PORT(this, direction, port_id);
+
+	spa_log_debug(this->log, "%p: enum params port %d.%d %d %u",
+			this, direction, port_id, seq, id);
+
+	result.id = id;
+	result.next = start;
+      next:
+	result.index = result.next++;
+
+	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+
+	switch (id) {
+	case SPA_PARAM_EnumFormat:
+		if ((res = port_enum_formats(this, direction, port_id,
+						result.index, &param, &b)) <= 0)
+			return res;
+		break;
+
+	case SPA_PARAM_Format:
+		if (!port->have_format)
+			return -EIO;
+		if (result.index > 0)
+			return 0;
+
+		param = spa_format_video_raw_build(&b, id, &port->format.info.raw);
+		break;
+
+	case SPA_PARAM_Buffers:
+		if (!port->have_format)
+			return -EIO;
+		if (result.index > 0)
+			return 0;
+
+		/* all planes are in one block, following the default layout */
+		param = spa_pod_builder_add_object(&b,
+			SPA_TYPE_OBJECT_ParamBuffers, id,
+			SPA_PARAM_BUFFERS_buffers, SPA_POD_CHOICE_RANGE_Int(4, 1, MAX_BUFFERS),
+			SPA_PARAM_BUFFERS_blocks,  SPA_POD_Int(1),
+			SPA_PARAM_BUFFERS_size,    SPA_POD_Int(port->layout.size),
+			SPA_PARAM_BUFFERS_stride,  SPA_POD_Int(port->layout.stride[0]),
+			SPA_PARAM_BUFFERS_align,   SPA_POD_Int(MAX_ALIGN));
+		break;
+
+	case SPA_PARAM_Meta:
+		switch (result.index) {
+		case 0:
+			param = spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_ParamMeta, id,
+				SPA_PARAM_META_type, SPA_POD_Id(SPA_META_Header),
+				SPA_PARAM_META_size, SPA_POD_Int(sizeof(struct spa_meta_header)));
+			break;
+		default:
+			return 0;
+		}
+		break;
+
+	case SPA_PARAM_IO:
+		switch (result.index) {
+		case 0:
+			param = spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_ParamIO, id,
+				SPA_PARAM_IO_id,   SPA_POD_Id(SPA_IO_Buffers),
+				SPA_PARAM_IO_size, SPA_POD_Int(sizeof(struct spa_io_buffers)));
+			break;
+		default:
+			return 0;
+		}
+		break;
+
+	default:
+		return -ENOENT;
+	}
+
+	if (spa_pod_filter(&b, &result.param, param, filter) < 0)
+		goto next;
+
+	spa_node_emit_result(&this->hooks, seq, 0, SPA_RESULT_TYPE_NODE_PARAMS, &result);
+
+	if (++count != num)
+		goto next;
+
+	return 0;
+}
+
+static int clear_buffers(struct impl *this, struct port *port)
+{
+	if (port->n_buffers > 0) {
+		spa_log_debug(this->log, NAME " %p: clear buffers %p", this, port);
+		port->n_buffers = 0;
+		spa_list_init(&port->queue);
+	}
+	return 0;
+}
+
+static int port_set_format(void *object,
+			   enum spa_direction direction,
+			   uint32_t port_id,
+			   uint32_t flags,
+			   const struct spa_pod *format)
+{
+	struct impl *this = object;
+	struct port *port, *other;
+	int res = 0;
+
+	port = GET_PORT(this, direction, port_id);
+	other = GET_PORT(this, SPA_DIRECTION_REVERSE(direction), port_id);
+
+	if (format == NULL) {
+		if (port->have_format) {
+			port->have_format = false;
+			clear_buffers(this, port);
+			if (this->conv.process)
+				video_convert_free(&this->conv);
+		}
+	} else {
+		struct spa_video_info info = { 0 };
+		struct spa_video_info_raw *raw = &info.info.raw;
+
+		if ((res = spa_format_parse(format, &info.media_type, &info.media_subtype)) < 0)
+			return res;
+
+		if (info.media_type != SPA_MEDIA_TYPE_video ||
+		    info.media_subtype != SPA_MEDIA_SUBTYPE_raw)
+			return -EINVAL;
+
+		if (spa_format_video_raw_parse(format, raw) < 0)
+			return -EINVAL;
+
+		if (raw->size.width == 0 || raw->size.height == 0 ||
+		    raw->size.width > VIDEO_MAX_WIDTH ||
+		    raw->size.height > VIDEO_MAX_HEIGHT)
+			return -EINVAL;
+
+		if ((res = video_layout_init(&port->layout, raw->format,
+				raw->size.width, raw->size.height, 0)) < 0)
+			return res;
+
+		port->have_format = true;
+		port->format = info;
+
+		if (other->have_format && port->have_format)
+			if ((res = setup_convert(this)) < 0)
+				return res;
+
+		spa_log_debug(this->log, NAME " %p: set format on port %d:%d res:%d size:%d",
+				this, direction, port_id, res, port->layout.size);
+	}
+	if (port->have_format) {
+		port->params[3] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_READWRITE);
+		port->params[4] = SPA_PARAM_INFO(SPA_PARAM_Buffers, SPA_PARAM_INFO_READ);
+	} else {
+		port->params[3] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_WRITE);
+		port->params[4] = SPA_PARAM_INFO(SPA_PARAM_Buffers, 0);
+	}
+	return 0;
+}
+
+static int
+impl_node_port_set_param(void *object,
+			 enum spa_direction direction, uint32_t port_id,
+			 uint32_t id, uint32_t flags,
+			 const struct spa_pod *param)
+{
+	struct impl *this = object;
+
+	spa_return_val_if_fail(object != NULL, -EINVAL);
+	spa_return_val_if_fail(CHECK_PORT(object, direction, port_id), -EINVAL);
+
+	spa_log_debug(this->log, NAME " %p: set param %u on port %d:%d %p",
+				this, id, direction, port_id, param);
+
+	switch (id) {
+	case SPA_PARAM_Format:
+		return port_set_format(object, direction, port_id, flags, param);
+	default:
+		return -ENOENT;
+	}
+}
+
+static int
+impl_node_port_use_buffers(void *object,
+			   enum spa_direction direction,
+			   uint32_t port_id,
+			   uint32_t flags,
+			   struct spa_buffer **buffers,
+			   uint32_t n_buffers)
+{
+	struct impl *this = object;
+	struct port *port;
+	uint32_t i, j;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+
+	spa_return_val_if_fail(CHECK_PORT(this, direction, port_id), -EINVAL);
+
+	port = GET_PORT(this, direction, port_id);
+
+	spa_return_val_if_fail(port->have_format, -EIO);
+
+	spa_log_debug(this->log, NAME " %p: use buffers %d on port %d", this, n_buffers, port_id);
+
+	clear_buffers(this, port);
+
+	if (n_buffers > MAX_BUFFERS)
+		return -ENOSPC;
+
+	for (i = 0; i < n_buffers; i++) {
+		struct buffer *b;
+		uint32_t n_datas = buffers[i]->n_datas;
+		struct spa_data *d = buffers[i]->datas;
+
+		b = &port->buffers[i];
+		b->id = i;
+		b->flags = 0;
+		b->outbuf = buffers[i];
+		b->h = spa_buffer_find_meta_data(buffers[i], SPA_META_Header, sizeof(*b->h));
+
+		if (n_datas != 1 && n_datas != port->layout.n_planes) {
+			spa_log_error(this->log, NAME " %p: expected 1 or %d blocks on buffer %d",
+					this, port->layout.n_planes, i);
+			return -EINVAL;
+		}
+
+		for (j = 0; j < n_datas; j++) {
+			if (d[j].data == NULL) {
+				spa_log_error(this->log, NAME " %p: invalid memory %d on buffer %d",
+						this, j, i);
+				return -EINVAL;
+			}
+			if (!SPA_IS_ALIGNED(d[j].data, MAX_ALIGN)) {
+				spa_log_warn(this->log, NAME " %p: memory %d on buffer %d not aligned",
+						this, j, i);
+			}
+			if (direction == SPA_DIRECTION_OUTPUT &&
+			    !SPA_FLAG_IS_SET(d[j].flags, SPA_DATA_FLAG_DYNAMIC))
+				this->is_passthrough = false;
+		}
+		if (n_datas == 1 && d[0].maxsize < port->layout.size) {
+			spa_log_error(this->log, NAME " %p: buffer %d too small %d < %d",
+					this, i, d[0].maxsize, port->layout.size);
+			return -EINVAL;
+		}
+
+		if (direction == SPA_DIRECTION_OUTPUT)
+			spa_list_append(&port->queue, &b->link);
+		else
+			SPA_FLAG_SET(b->flags, BUFFER_FLAG_OUT);
+	}
+	port->n_buffers = n_buffers;
+
+	return 0;
+}
+
+static int
+impl_node_port_set_io(void *object,
+		      enum spa_direction direction, uint32_t port_id,
+		      uint32_t id, void *data, size_t size)
+{
+	struct impl *this = object;
+	struct port *port;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(CHECK_PORT(this, direction, port_id), -EINVAL);
+
+	port = GET_PORT(this, direction, port_id);
+
+	spa_log_debug(this->log, NAME " %p: port %d:%d update io %d %p",
+			this, direction, port_id, id, data);
+
+	switch (id) {
+	case SPA_IO_Buffers:
+		port->io = data;
+		break;
+	default:
+		return -ENOENT;
+	}
+	return 0;
+}
+
+static void recycle_buffer(struct impl *this, struct port *port, uint32_t id)
+{
+	struct buffer *b = &port->buffers[id];
+
+	if (SPA_FLAG_IS_SET(b->flags, BUFFER_FLAG_OUT)) {
+		spa_list_append(&port->queue, &b->link);
+		SPA_FLAG_CLEAR(b->flags, BUFFER_FLAG_OUT);
+		spa_log_trace_fp(this->log, NAME " %p: recycle buffer %d", this, id);
+	}
+}
+
+static inline struct buffer *dequeue_buffer(struct impl *this, struct port *port)
+{
+	struct buffer *b;
+
+	if (spa_list_is_empty(&port->queue))
+		return NULL;
+	b = spa_list_first(&port->queue, struct buffer, link);
+	spa_list_remove(&b->link);
+	SPA_FLAG_SET(b->flags, BUFFER_FLAG_OUT);
+	return b;
+}
+
+static int impl_node_port_reuse_buffer(void *object, uint32_t port_id, uint32_t buffer_id)
+{
+	struct impl *this = object;
+	struct port *port;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+	spa_return_val_if_fail(CHECK_PORT(this, SPA_DIRECTION_OUTPUT, port_id), -EINVAL);
+
+	port = GET_OUT_PORT(this, port_id);
+
+	recycle_buffer(this, port, buffer_id);
+
+	return 0;
+}
+
+/* map the planes of an input buffer, the planes are either in separate
+ * blocks or in one block with the layout of the chunk stride */
+static int get_input_frame(struct impl *this, struct port *port,
+		struct spa_buffer *buf, struct video_frame *frame)
+{
+	const struct spa_video_info_raw *raw = &port->format.info.raw;
+	struct video_layout layout;
+	struct spa_data *d = buf->datas;
+	uint32_t i, offs;
+
+	if (buf->n_datas == 1) {
+		offs = SPA_MIN(d[0].chunk->offset, d[0].maxsize);
+		video_layout_init(&layout, raw->format, raw->size.width, raw->size.height,
+				d[0].chunk->stride > 0 ? (uint32_t)d[0].chunk->stride : 0);
+		if (d[0].maxsize - offs < layout.size)
+			return -EINVAL;
+		for (i = 0; i < layout.n_planes; i++) {
+			frame->data[i] = SPA_MEMBER(d[0].data, offs + layout.offset[i], void);
+			frame->stride[i] = layout.stride[i];
+		}
+	} else {
+		for (i = 0; i < port->layout.n_planes; i++) {
+			offs = SPA_MIN(d[i].chunk->offset, d[i].maxsize);
+			frame->data[i] = SPA_MEMBER(d[i].data, offs, void);
+			frame->stride[i] = d[i].chunk->stride > 0 ?
+				(uint32_t)d[i].chunk->stride : port->layout.stride[i];
+		}
+	}
+	return 0;
+}
+
+static void get_output_frame(struct impl *this, struct port *port,
+		struct spa_buffer *buf, struct video_frame *frame)
+{
+	struct spa_data *d = buf->datas;
+	uint32_t i;
+
+	for (i = 0; i < port->layout.n_planes; i++) {
+		if (buf->n_datas == 1) {
+			frame->data[i] = SPA_MEMBER(d[0].data, port->layout.offset[i], void);
+		} else {
+			frame->data[i] = d[i].data;
+			d[i].chunk->offset = 0;
+			d[i].chunk->size = port->layout.stride[i] *
+				(i == 0 ? port->format.info.raw.size.height :
+				 (port->format.info.raw.size.height + 1) / 2);
+			d[i].chunk->stride = port->layout.stride[i];
+		}
+		frame->stride[i] = port->layout.stride[i];
+	}
+	if (buf->n_datas == 1) {
+		d[0].chunk->offset = 0;
+		d[0].chunk->size = port->layout.size;
+		d[0].chunk->stride = port->layout.stride[0];
+	}
+}
+
+static int impl_node_process(void *object)
+{
+	struct impl *this = object;
+	struct port *inport, *outport;
+	struct spa_io_buffers *inio, *outio;
+	struct buffer *inbuf, *outbuf;
+	struct spa_buffer *inb, *outb;
+	struct video_frame src, dst;
+	uint32_t i;
+
+	spa_return_val_if_fail(this != NULL, -EINVAL);
+
+	outport = GET_OUT_PORT(this, 0);
+	inport = GET_IN_PORT(this, 0);
+
+	outio = outport->io;
+	inio = inport->io;
+
+	spa_log_trace_fp(this->log, NAME " %p: io %p %p", this, inio, outio);
+
+	spa_return_val_if_fail(outio != NULL, -EIO);
+	spa_return_val_if_fail(inio != NULL, -EIO);
+
+	spa_log_trace_fp(this->log, NAME " %p: status %p %d %d -> %p %d %d", this,
+			inio, inio->status, inio->buffer_id,
+			outio, outio->status, outio->buffer_id);
+
+	if (SPA_UNLIKELY(outio->status == SPA_STATUS_HAVE_DATA))
+		return inio->status | outio->status;
+
+	if (SPA_LIKELY(outio->buffer_id < outport->n_buffers)) {
+		recycle_buffer(this, outport, outio->buffer_id);
+		outio->buffer_id = SPA_ID_INVALID;
+	}
+	if (SPA_UNLIKELY(inio->status != SPA_STATUS_HAVE_DATA))
+		return outio->status = inio->status;
+
+	if (SPA_UNLIKELY(inio->buffer_id >= inport->n_buffers))
+		return inio->status = -EINVAL;
+
+	if (SPA_UNLIKELY(this->conv.process == NULL))
+		return inio->status = -EIO;
+
+	if (SPA_UNLIKELY((outbuf = dequeue_buffer(this, outport)) == NULL))
+		return outio->status = -EPIPE;
+
+	inbuf = &inport->buffers[inio->buffer_id];
+	inb = inbuf->outbuf;
+	outb = outbuf->outbuf;
+
+	if (this->is_passthrough && inb->n_datas == outb->n_datas) {
+		for (i = 0; i < outb->n_datas; i++) {
+			outb->datas[i].data = inb->datas[i].data;
+			*outb->datas[i].chunk = *inb->datas[i].chunk;
+		}
+	} else if (get_input_frame(this, inport, inb, &src) < 0) {
+		spa_log_warn(this->log, NAME " %p: input buffer %d too small",
+				this, inio->buffer_id);
+		recycle_buffer(this, outport, outbuf->id);
+		return inio->status = -EINVAL;
+	} else {
+		get_output_frame(this, outport, outb, &dst);
+		video_convert_process(&this->conv, &dst, &src);
+	}
+
+	if (inbuf->h && outbuf->h)
+		*outbuf->h = *inbuf->h;
+
+	inio->status = SPA_STATUS_NEED_DATA;
+
+	outio->status = SPA_STATUS_HAVE_DATA;
+	outio->buffer_id = outbuf->id;
+
+	return SPA_STATUS_NEED_DATA | SPA_STATUS_HAVE_DATA;
+}
+
+static const struct spa_node_methods impl_node = {
+	SPA_VERSION_NODE_METHODS,
+	.add_listener = impl_node_add_listener,
+	.set_callbacks = impl_node_set_callbacks,
+	.enum_params = impl_node_enum_params,
+	.set_param = impl_node_set_param,
+	.set_io = impl_node_set_io,
+	.send_command = impl_node_send_command,
+	.add_port = impl_node_add_port,
+	.remove_port = impl_node_remove_port,
+	.port_enum_params = impl_node_port_enum_params,
+	.port_set_param = impl_node_port_set_param,
+	.port_use_buffers = impl_node_port_use_buffers,
+	.port_set_io = impl_node_port_set_io,
+	.port_reuse_buffer = impl_node_port_reuse_buffer,
+	.process = impl_node_process,
+};
+
+static int impl_get_interface(struct spa_handle *handle, const char *type, void **interface)
+{
+	struct impl *this;
+
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+	spa_return_val_if_fail(interface != NULL, -EINVAL);
+
+	this = (struct impl *) handle;
+
+	if (strcmp(type, SPA_TYPE_INTERFACE_Node) == 0)
+		*interface = &this->node;
+	else
+		return -ENOENT;
+
+	return 0;
+}
+
+static int impl_clear(struct spa_handle *handle)
+{
+	struct impl *this;
+
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+
+	this = (struct impl *) handle;
+
+	if (this->conv.process)
+		video_convert_free(&this->conv);
+
+	return 0;
+}
+
+static int init_port(struct impl *this, enum spa_direction direction, uint32_t port_id)
+{
+	struct port *port;
+
+	port = GET_PORT(this, direction, port_id);
+	port->direction = direction;
+	port->id = port_id;
+
+	spa_list_init(&port->queue);
+	port->info_all = SPA_PORT_CHANGE_MASK_FLAGS;
+	port->info = SPA_PORT_INFO_INIT();
+	port->info.flags = SPA_PORT_FLAG_NO_REF |
+		SPA_PORT_FLAG_DYNAMIC_DATA;
+	port->params[0] = SPA_PARAM_INFO(SPA_PARAM_EnumFormat, SPA_PARAM_INFO_READ);
+	port->params[1] = SPA_PARAM_INFO(SPA_PARAM_Meta, SPA_PARAM_INFO_READ);
+	port->params[2] = SPA_PARAM_INFO(SPA_PARAM_IO, SPA_PARAM_INFO_READ);
+	port->params[3] = SPA_PARAM_INFO(SPA_PARAM_Format, SPA_PARAM_INFO_WRITE);
+	port->params[4] = SPA_PARAM_INFO(SPA_PARAM_Buffers, 0);
+	port->info.params = port->params;
+	port->info.n_params = 5;
+	port->have_format = false;
+
+	return 0;
+}
+
+static size_t
+impl_get_size(const struct spa_handle_factory *factory,
+	      const struct spa_dict *params)
+{
+	return sizeof(struct impl);
+}
+
+static int
+impl_init(const struct spa_handle_factory *factory,
+	  struct spa_handle *handle,
+	  const struct spa_dict *info,
+	  const struct spa_support *support,
+	  uint32_t n_support)
+{
+	struct impl *this;
+
+	spa_return_val_if_fail(factory != NULL, -EINVAL);
+	spa_return_val_if_fail(handle != NULL, -EINVAL);
+
+	handle->get_interface = impl_get_interface;
+	handle->clear = impl_clear;
+
+	this = (struct impl *) handle;
+
+	this->log = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_Log);
+	this->cpu = spa_support_find(support, n_support, SPA_TYPE_INTERFACE_CPU);
+
+	if (this->cpu)
+		this->cpu_flags = spa_cpu_get_flags(this->cpu);
+
+	this->node.iface = SPA_INTERFACE_INIT(
+			SPA_TYPE_INTERFACE_Node,
+			SPA_VERSION_NODE,
+			&impl_node, this);
+	spa_hook_list_init(&this->hooks);
+
+	this->info_all = SPA_NODE_CHANGE_MASK_FLAGS;
+	this->info = SPA_NODE_INFO_INIT();
+	this->info.flags = SPA_NODE_FLAG_RT;
+	this->info.params = this->params;
+	this->info.n_params = 0;
+
+	init_port(this, SPA_DIRECTION_OUTPUT, 0);
+	init_port(this, SPA_DIRECTION_INPUT, 0);
+
+	return 0;
+}
+
+static const struct spa_interface_info impl_interfaces[] = {
+	{SPA_TYPE_INTERFACE_Node,},
+};
+
+static int
+impl_enum_interface_info(const struct spa_handle_factory *factory,
+			 const struct spa_interface_info **info,
+			 uint32_t *index)
+{
+	spa_return_val_if_fail(factory != NULL, -EINVAL);
+	spa_return_val_if_fail(info != NULL, -EINVAL);
+	spa_return_val_if_fail(index != NULL, -EINVAL);
+
+	switch (*index) {
+	case 0:
+		*info = &impl_interfaces[*index];
+		break;
+	default:
+		return 0;
+	}
+	(*index)++;
+	return 1;
+}
+
+const struct spa_handle_factory spa_videoconvert_factory = {
+	SPA_VERSION_HANDLE_FACTORY,
+	SPA_NAME_VIDEO_CONVERT,
+	NULL,
+	impl_get_size,
+	impl_init,
+	impl_enum_interface_info,
+};
@@ -29,6 +29,9 @@
 extern "C" {
 #endif
 
+#include <errno.h>
+#include <string.h>
+
 #include <spa/utils/defs.h>
 
 #define PW_TYPE_INTERFACE_Profiler		PW_TYPE_INFO_INTERFACE_BASE "Profiler"
@@ -75,6 +78,183 @@ struct pw_profiler_methods {
 #define pw_profiler_add_listener(c,...)		pw_profiler_method(c,add_listener,0,__VA_ARGS__)
 
 #define PW_KEY_PROFILER_NAME		"profiler.name"
+#define PW_KEY_PROFILER_SHM		"profiler.shm"		/**< write records to shared memory */
+#define PW_KEY_PROFILER_SHM_PATH	"profiler.shm.path"	/**< path of the shared memory feed */
+
+/** Number of buckets in a \ref pw_profiler_histogram */
+#define PW_PROFILER_HISTOGRAM_BUCKETS	256
+#define PW_PROFILER_HISTOGRAM_SUB_BITS	3
+
+/** A log-linear histogram of nanosecond values. Each power of 2 is split
+ * in 8 buckets so that a value is known to about 12%, enough for
+ * percentiles. Values above 2^34 ns end up in the last bucket. */
+struct pw_profiler_histogram {
+	uint64_t count;					/**< total number of values */
+	uint32_t buckets[PW_PROFILER_HISTOGRAM_BUCKETS];
+};
+
+static inline uint32_t pw_profiler_histogram_bucket(uint64_t val)
+{
+	uint32_t e, idx;
+
+	if (val < (1u << PW_PROFILER_HISTOGRAM_SUB_BITS))
+		return val;
+	e = 63 - __builtin_clzll(val);
+	idx = ((e - PW_PROFILER_HISTOGRAM_SUB_BITS + 1) << PW_PROFILER_HISTOGRAM_SUB_BITS) |
+		((val >> (e - PW_PROFILER_HISTOGRAM_SUB_BITS)) &
+		 ((1u << PW_PROFILER_HISTOGRAM_SUB_BITS) - 1));
+	return SPA_MIN(idx, PW_PROFILER_HISTOGRAM_BUCKETS - 1u);
+}
+
+/** the lowest value that ends up in \a bucket */
+static inline uint64_t pw_profiler_histogram_value(uint32_t bucket)
+{
+	uint32_t e, sub = (1u << PW_PROFILER_HISTOGRAM_SUB_BITS);
+
+	if (bucket < sub)
+		return bucket;
+	e = (bucket >> PW_PROFILER_HISTOGRAM_SUB_BITS) + PW_PROFILER_HISTOGRAM_SUB_BITS - 1;
+	return (uint64_t)(sub | (bucket & (sub - 1))) << (e - PW_PROFILER_HISTOGRAM_SUB_BITS);
+}
+
+static inline void pw_profiler_histogram_add(struct pw_profiler_histogram *h, uint64_t val)
+{
+	h->buckets[pw_profiler_histogram_bucket(val)]++;
+	h->count++;
+}
+
+/** get the value below which \a perc (0.0 - 1.0) of the values fall */
+static inline uint64_t pw_profiler_histogram_percentile(const struct pw_profiler_histogram *h,
+		double perc)
+{
+	uint64_t target, sum = 0;
+	uint32_t i;
+
+	if (h->count == 0)
+		return 0;
+	target = (uint64_t)(perc * h->count);
+	for (i = 0; i < PW_PROFILER_HISTOGRAM_BUCKETS; i++) {
+		sum += h->buckets[i];
+		if (sum > target)
+			break;
+	}
+	return pw_profiler_histogram_value(SPA_MIN(i, PW_PROFILER_HISTOGRAM_BUCKETS - 1u));
+}
+
+/** A fixed size record in the shared memory feed, written for the driver and
+ * each follower every cycle. Node names are in the node table. */
+struct pw_profiler_record {
+	uint32_t seq;					/**< index + 1 of the record, 0 while
+							  *  it is being written */
+#define PW_PROFILER_RECORD_DRIVER	0
+#define PW_PROFILER_RECORD_FOLLOWER	1
+	uint32_t type;
+	uint32_t id;					/**< node id */
+	int32_t status;					/**< activation status */
+	int64_t count;					/**< driver cycle */
+	struct spa_fraction latency;
+	uint64_t prev_signal_time;
+	uint64_t signal_time;
+	uint64_t awake_time;
+	uint64_t finish_time;
+	/* driver info, copied in the follower records */
+	uint32_t driver_id;
+	uint32_t xrun_count;
+	float cpu_load[3];
+	uint32_t clock_flags;
+	uint32_t clock_id;
+	struct spa_fraction clock_rate;
+	uint64_t clock_nsec;
+	uint64_t clock_position;
+	uint64_t clock_duration;
+	int64_t clock_delay;
+	double clock_rate_diff;
+	uint64_t clock_next_nsec;
+	uint32_t padding[6];
+};
+
+/** A node in the node table of the shared memory feed */
+struct pw_profiler_node {
+	uint32_t id;
+	uint32_t padding;
+	char name[64];
+	struct pw_profiler_histogram wait;		/**< signal to awake time */
+	struct pw_profiler_histogram busy;		/**< awake to finish time */
+};
+
+#define PW_PROFILER_SHM_MAGIC		0x52504350u	/* "PCPR" */
+#define PW_PROFILER_SHM_VERSION		0
+/** The feed is at \a PW_KEY_PROFILER_SHM_PATH or by default in the runtime dir,
+ * named after the core with this suffix */
+#define PW_PROFILER_SHM_SUFFIX		"-profiler"
+
+/** Header of the shared memory profiler feed. The node table and the record
+ * ring follow at the given offsets. Records are written by one thread. A
+ * record is valid when its seq matches before and after copying it. */
+struct pw_profiler_shm {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t nodes_offset;				/**< offset of the node table */
+	uint32_t max_nodes;
+	uint32_t n_nodes;
+	uint32_t nodes_seq;				/**< odd while the node table is updated */
+	uint32_t records_offset;			/**< offset of the record ring */
+	uint32_t n_records;				/**< power of 2 */
+	uint64_t write_index;				/**< number of records written */
+};
+
+/** Read the record at \a index. Returns 1 and increments \a index when a
+ * record was read, 0 when there is nothing new. When the writer went past
+ * \a index, it is moved to the oldest record still available. */
+static inline int pw_profiler_shm_read(const struct pw_profiler_shm *shm,
+		uint64_t *index, struct pw_profiler_record *record)
+{
+	const struct pw_profiler_record *records =
+		SPA_MEMBER(shm, shm->records_offset, const struct pw_profiler_record);
+	uint64_t windex;
+	uint32_t seq;
+
+	while (true) {
+		windex = __atomic_load_n(&shm->write_index, __ATOMIC_ACQUIRE);
+		if (*index >= windex)
+			return 0;
+		if (windex - *index > shm->n_records)
+			*index = windex - shm->n_records;
+
+		seq = __atomic_load_n(&records[*index & (shm->n_records - 1)].seq,
+				__ATOMIC_ACQUIRE);
+		*record = records[*index & (shm->n_records - 1)];
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		if (seq == (uint32_t)(*index + 1) &&
+		    __atomic_load_n(&records[*index & (shm->n_records - 1)].seq,
+			    __ATOMIC_RELAXED) == seq) {
+			(*index)++;
+			return 1;
+		}
+		/* overwritten while we read, skip ahead */
+		(*index)++;
+	}
+}
+
+/** Copy at most \a max_nodes entries of the node table into \a nodes.
+ * Returns the number of nodes or -EAGAIN when the table was being updated. */
+static inline int pw_profiler_shm_read_nodes(const struct pw_profiler_shm *shm,
+		struct pw_profiler_node *nodes, uint32_t max_nodes)
+{
+	const struct pw_profiler_node *table =
+		SPA_MEMBER(shm, shm->nodes_offset, const struct pw_profiler_node);
+	uint32_t seq, n_nodes;
+
+	seq = __atomic_load_n(&shm->nodes_seq, __ATOMIC_ACQUIRE);
+	if (seq & 1)
+		return -EAGAIN;
+	n_nodes = SPA_MIN(SPA_MIN(shm->n_nodes, shm->max_nodes), max_nodes);
+	memcpy(nodes, table, n_nodes * sizeof(struct pw_profiler_node));
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+	if (__atomic_load_n(&shm->nodes_seq, __ATOMIC_RELAXED) != seq)
+		return -EAGAIN;
+	return n_nodes;
+}
 
 #ifdef __cplusplus
 }  /* extern "C" */
@@ -0,0 +1,246 @@
+/* PipeWire
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef PIPEWIRE_EXT_REGISTRY_SNAPSHOT_H
+#define PIPEWIRE_EXT_REGISTRY_SNAPSHOT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <errno.h>
+#include <string.h>
+
+#include <spa/utils/defs.h>
+#include <spa/utils/dict.h>
+
+#define PW_TYPE_INTERFACE_RegistrySnapshot	PW_TYPE_INFO_INTERFACE_BASE "RegistrySnapshot"
+
+#define PW_VERSION_REGISTRY_SNAPSHOT		0
+struct pw_registry_snapshot;
+
+#define PW_EXTENSION_MODULE_REGISTRY_SNAPSHOT	PIPEWIRE_MODULE_PREFIX "module-registry-snapshot"
+
+/** The name of the factory that creates snapshot objects, use with
+ * \ref pw_core_create_object */
+#define PW_REGISTRY_SNAPSHOT_FACTORY		"registry-snapshot"
+
+#define PW_REGISTRY_SNAPSHOT_EVENT_SNAPSHOT	0
+#define PW_REGISTRY_SNAPSHOT_EVENT_GLOBAL	1
+#define PW_REGISTRY_SNAPSHOT_EVENT_GLOBAL_REMOVE	2
+#define PW_REGISTRY_SNAPSHOT_EVENT_NUM		3
+
+/** \ref pw_registry_snapshot events */
+struct pw_registry_snapshot_events {
+#define PW_VERSION_REGISTRY_SNAPSHOT_EVENTS	0
+	uint32_t version;
+	/**
+	 * All globals visible to the client
+	 *
+	 * Emitted once, right after the object is created. The snapshot
+	 * is a \ref pw_registry_snapshot_header in the memory with \a mem_id
+	 * of the core mempool. Map it with pw_mempool_map_id() and check it
+	 * with \ref pw_registry_snapshot_check. The memory stays valid until
+	 * the snapshot object is destroyed.
+	 *
+	 * \param mem_id the memory id, see \ref pw_core_events.add_mem
+	 * \param offset offset of the snapshot in the memory
+	 * \param size size of the snapshot
+	 */
+	void (*snapshot) (void *object, uint32_t mem_id, uint32_t offset, uint32_t size);
+	/**
+	 * A global was added, became visible or changed after the snapshot
+	 *
+	 * Same as \ref pw_registry_events.global. When \a id is already
+	 * known, its permissions changed and the new values replace the
+	 * ones from the snapshot or an earlier event.
+	 */
+	void (*global) (void *object, uint32_t id,
+		      uint32_t permissions, const char *type, uint32_t version,
+		      const struct spa_dict *props);
+	/**
+	 * A global was removed or became invisible after the snapshot
+	 *
+	 * Same as \ref pw_registry_events.global_remove
+	 */
+	void (*global_remove) (void *object, uint32_t id);
+};
+
+#define PW_REGISTRY_SNAPSHOT_METHOD_ADD_LISTENER	0
+#define PW_REGISTRY_SNAPSHOT_METHOD_BIND	1
+#define PW_REGISTRY_SNAPSHOT_METHOD_NUM		2
+
+/** \ref pw_registry_snapshot methods */
+struct pw_registry_snapshot_methods {
+#define PW_VERSION_REGISTRY_SNAPSHOT_METHODS	0
+	uint32_t version;
+
+	int (*add_listener) (void *object,
+			struct spa_hook *listener,
+			const struct pw_registry_snapshot_events *events,
+			void *data);
+	/**
+	 * Bind to a global, same as \ref pw_registry_methods.bind so that
+	 * clients don't need a registry to bind the globals in the snapshot.
+	 */
+	void * (*bind) (void *object, uint32_t id, const char *type, uint32_t version,
+			size_t user_data_size);
+};
+
+#define pw_registry_snapshot_method(o,method,version,...)		\
+({									\
+	int _res = -ENOTSUP;						\
+	spa_interface_call_res((struct spa_interface*)o,		\
+			struct pw_registry_snapshot_methods, _res,	\
+			method, version, ##__VA_ARGS__);		\
+	_res;								\
+})
+
+#define pw_registry_snapshot_add_listener(c,...)	pw_registry_snapshot_method(c,add_listener,0,__VA_ARGS__)
+
+static inline void *
+pw_registry_snapshot_bind(struct pw_registry_snapshot *snapshot,
+		uint32_t id, const char *type, uint32_t version,
+		size_t user_data_size)
+{
+	void *res = NULL;
+	spa_interface_call_res((struct spa_interface*)snapshot,
+			struct pw_registry_snapshot_methods, res,
+			bind, 0, id, type, version, user_data_size);
+	return res;
+}
+
+#define PW_REGISTRY_SNAPSHOT_MAGIC	0x50534752u	/* "RGSP" */
+#define PW_REGISTRY_SNAPSHOT_FORMAT	0
+
+/** A global in the snapshot. Strings are offsets in the string table. */
+struct pw_registry_snapshot_global {
+	uint32_t id;
+	uint32_t permissions;
+	uint32_t type;					/**< string offset of the type */
+	uint32_t version;
+	uint32_t n_items;				/**< number of properties */
+	uint32_t items;					/**< index of the first property */
+};
+
+/** A property of a global */
+struct pw_registry_snapshot_item {
+	uint32_t key;					/**< string offset of the key */
+	uint32_t value;					/**< string offset of the value */
+};
+
+/** Header of the snapshot. The globals, the items and the string table of
+ * 0 terminated strings follow at the given offsets. Equal strings are
+ * stored once. */
+struct pw_registry_snapshot_header {
+	uint32_t magic;
+	uint32_t format;
+	uint32_t n_globals;
+	uint32_t globals_offset;
+	uint32_t n_items;
+	uint32_t items_offset;
+	uint32_t strings_offset;
+	uint32_t strings_size;
+};
+
+/** Check that a snapshot of \a size bytes is complete and that all offsets
+ * and indexes in it are valid. Returns 0 on success. */
+static inline int pw_registry_snapshot_check(const void *data, size_t size)
+{
+	const struct pw_registry_snapshot_header *h = (const struct pw_registry_snapshot_header *)data;
+	const struct pw_registry_snapshot_global *g;
+	const struct pw_registry_snapshot_item *it;
+	const char *str;
+	uint32_t i;
+
+	if (size < sizeof(*h) || h->magic != PW_REGISTRY_SNAPSHOT_MAGIC)
+		return -EINVAL;
+	if (h->format != PW_REGISTRY_SNAPSHOT_FORMAT)
+		return -ENOTSUP;
+	if (h->globals_offset > size ||
+	    h->n_globals > (size - h->globals_offset) / sizeof(*g) ||
+	    h->items_offset > size ||
+	    h->n_items > (size - h->items_offset) / sizeof(*it) ||
+	    h->strings_offset > size ||
+	    h->strings_size == 0 ||
+	    h->strings_size > size - h->strings_offset)
+		return -EINVAL;
+
+	str = SPA_MEMBER(data, h->strings_offset, const char);
+	if (str[h->strings_size - 1] != '\0')
+		return -EINVAL;
+
+	g = SPA_MEMBER(data, h->globals_offset, const struct pw_registry_snapshot_global);
+	for (i = 0; i < h->n_globals; i++) {
+		if (g[i].type >= h->strings_size ||
+		    g[i].items > h->n_items ||
+		    g[i].n_items > h->n_items - g[i].items)
+			return -EINVAL;
+	}
+	it = SPA_MEMBER(data, h->items_offset, const struct pw_registry_snapshot_item);
+	for (i = 0; i < h->n_items; i++) {
+		if (it[i].key >= h->strings_size ||
+		    it[i].value >= h->strings_size)
+			return -EINVAL;
+	}
+	return 0;
+}
+
+static inline const struct pw_registry_snapshot_global *
+pw_registry_snapshot_get_global(const struct pw_registry_snapshot_header *h, uint32_t index)
+{
+	if (index >= h->n_globals)
+		return NULL;
+	return SPA_MEMBER(h, h->globals_offset, const struct pw_registry_snapshot_global) + index;
+}
+
+static inline const char *
+pw_registry_snapshot_get_string(const struct pw_registry_snapshot_header *h, uint32_t offset)
+{
+	return SPA_MEMBER(h, h->strings_offset + offset, const char);
+}
+
+/** Fill \a items with at most \a max_items properties of \a global. The
+ * strings point into the snapshot. Returns the number of items. */
+static inline uint32_t
+pw_registry_snapshot_get_props(const struct pw_registry_snapshot_header *h,
+		const struct pw_registry_snapshot_global *global,
+		struct spa_dict_item *items, uint32_t max_items)
+{
+	const struct pw_registry_snapshot_item *it =
+		SPA_MEMBER(h, h->items_offset, const struct pw_registry_snapshot_item);
+	uint32_t i, n_items = SPA_MIN(global->n_items, max_items);
+
+	for (i = 0; i < n_items; i++) {
+		items[i].key = pw_registry_snapshot_get_string(h, it[global->items + i].key);
+		items[i].value = pw_registry_snapshot_get_string(h, it[global->items + i].value);
+	}
+	return n_items;
+}
+
+#ifdef __cplusplus
+}  /* extern "C" */
+#endif
+
+#endif /* PIPEWIRE_EXT_REGISTRY_SNAPSHOT_H */
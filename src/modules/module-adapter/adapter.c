@@ -248,6 +248,10 @@ struct pw_impl_node *pw_adapter_new(struct pw_context *context,
 	if ((res = find_format(follower, direction, &media_type, &media_subtype)) < 0)
 		goto error;
 
+	/* the adapter runs the follower, it needs to use the same data loop */
+	str = pw_properties_get(pw_impl_node_get_properties(follower), PW_KEY_NODE_DATA_LOOP);
+	pw_properties_set(props, PW_KEY_NODE_DATA_LOOP, str ? str : "0");
+
 	if (media_type == SPA_MEDIA_TYPE_audio) {
 		pw_properties_setf(props, "audio.adapt.follower", "pointer:%p",
 				pw_impl_node_get_implementation(follower));
@@ -921,6 +921,9 @@ static int impl_node_process(void *object)
 	n->rt.activation->status = PW_NODE_ACTIVATION_TRIGGERED;
 	n->rt.activation->signal_time = SPA_TIMESPEC_TO_NSEC(&ts);
 
+	if (pw_node_activation_wake(n->rt.activation))
+		return SPA_STATUS_OK;
+
 	if (SPA_UNLIKELY(spa_system_eventfd_write(this->data_system, this->writefd, 1) < 0))
 		spa_log_warn(this->log, NAME" %p: error %m", this);
 
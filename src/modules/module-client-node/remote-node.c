@@ -43,6 +43,10 @@
 
 #define MAX_MIX	4096
 
+#define WAKEUP_EVENTFD	0
+#define WAKEUP_SPIN	1
+#define WAKEUP_FUTEX	2
+
 /** \cond */
 static bool mlock_warned = false;
 
@@ -80,6 +84,11 @@ struct node_data {
 	unsigned int have_transport:1;
 	unsigned int allow_mlock:1;
 	unsigned int warn_mlock:1;
+	unsigned int have_wakeup_hook:1;
+
+	uint32_t wakeup;
+	uint64_t wakeup_spin;
+	struct spa_hook wakeup_hook;
 
 	struct pw_client_node *client_node;
 	struct spa_hook client_node_listener;
@@ -132,6 +141,149 @@ static void clear_link(struct node_data *data, struct link *link)
 	free(link);
 }
 
+static inline void cpu_relax(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+	__asm__ __volatile__("yield");
+#endif
+}
+
+static inline uint64_t get_time_ns(struct spa_system *system)
+{
+	struct timespec ts;
+	spa_system_clock_gettime(system, CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+/* check the loop for events without dispatching them. This goes through
+ * the loop's system so that a system that holds back writes until the
+ * next poll submits them now. */
+static inline bool loop_pending(struct pw_loop *loop)
+{
+	struct spa_poll_event ev;
+	return spa_system_pollfd_wait(loop->system, pw_loop_get_fd(loop), &ev, 1, 0) != 0;
+}
+
+/* called in the data loop before it goes to sleep in epoll. When the
+ * node wants it, we spin and/or sleep on the wakeup word of our activation
+ * so that peers can wake us without the eventfd. We return to the loop as
+ * soon as it has something else to do or when no cycle arrived in time.
+ * The eventfd stays armed for peers that don't know about the wakeup word. */
+static void wakeup_before(void *_data)
+{
+	struct node_data *data = _data;
+	struct pw_impl_node *node = data->node;
+	struct pw_node_activation *a = node->rt.activation;
+	struct spa_system *data_system = data->context->data_system;
+	uint32_t w;
+
+	if (!pw_data_loop_in_thread(data->context->data_loop_impl))
+		return;
+
+	while (true) {
+		uint64_t start, timeout = data->wakeup_spin;
+
+		ATOMIC_STORE(a->wakeup, PW_NODE_ACTIVATION_WAKEUP_SPIN);
+
+		/* peers that signaled before we started spinning used the
+		 * eventfd, let the loop handle that and any other event */
+		if (loop_pending(node->data_loop))
+			goto done;
+
+		start = get_time_ns(data_system);
+		while (ATOMIC_LOAD(a->wakeup) == PW_NODE_ACTIVATION_WAKEUP_SPIN &&
+		    get_time_ns(data_system) - start < timeout)
+			cpu_relax();
+
+		if (data->wakeup == WAKEUP_FUTEX &&
+		    ATOMIC_CAS(a->wakeup, PW_NODE_ACTIVATION_WAKEUP_SPIN,
+				    PW_NODE_ACTIVATION_WAKEUP_WAIT)) {
+			struct spa_io_position *pos = node->rt.position;
+			struct timespec ts;
+
+			/* sleep for at most one cycle, then check the loop again */
+			if (pos != NULL && pos->clock.rate.denom != 0)
+				timeout = pos->clock.duration * SPA_NSEC_PER_SEC /
+					pos->clock.rate.denom;
+			else
+				timeout = 10 * SPA_NSEC_PER_MSEC;
+			ts.tv_sec = timeout / SPA_NSEC_PER_SEC;
+			ts.tv_nsec = timeout % SPA_NSEC_PER_SEC;
+
+			while (ATOMIC_LOAD(a->wakeup) == PW_NODE_ACTIVATION_WAKEUP_WAIT) {
+				if (pw_futex_wait(&a->wakeup, PW_NODE_ACTIVATION_WAKEUP_WAIT, &ts) < 0 &&
+				    errno == ETIMEDOUT)
+					break;
+			}
+		}
+done:
+		w = ATOMIC_XCHG(a->wakeup, PW_NODE_ACTIVATION_WAKEUP_EVENTFD);
+		if (w != PW_NODE_ACTIVATION_WAKEUP_SIGNALED)
+			break;
+
+		pw_log_trace_fp("remote-node %p: got process", data);
+		node->rt.target.signal(node->rt.target.data);
+
+		if (loop_pending(node->data_loop))
+			break;
+	}
+}
+
+static const struct spa_loop_control_hooks wakeup_hooks = {
+	SPA_VERSION_LOOP_CONTROL_HOOKS,
+	.before = wakeup_before,
+};
+
+static int
+do_add_wakeup_hook(struct spa_loop *loop,
+                bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct node_data *d = user_data;
+	pw_loop_add_hook(d->node->data_loop, &d->wakeup_hook, &wakeup_hooks, d);
+	return 0;
+}
+
+static int
+do_remove_wakeup_hook(struct spa_loop *loop,
+                bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct node_data *d = user_data;
+	spa_hook_remove(&d->wakeup_hook);
+	return 0;
+}
+
+static void add_wakeup_hook(struct node_data *data, uint32_t size)
+{
+	struct pw_impl_node *node = data->node;
+
+	if (data->wakeup == WAKEUP_EVENTFD || data->have_wakeup_hook)
+		return;
+	/* only when the activation has a wakeup word and we are the only
+	 * node in the data loop of the context */
+	if (size < sizeof(struct pw_node_activation) ||
+	    node->data_loop != data->context->data_loop) {
+		pw_log_info("remote-node %p: wakeup mode not possible, using eventfd", data);
+		return;
+	}
+	pw_log_debug("remote-node %p: wakeup mode %s spin:%"PRIu64, data,
+			data->wakeup == WAKEUP_FUTEX ? "futex" : "spin", data->wakeup_spin);
+
+	pw_loop_invoke(node->data_loop,
+		do_add_wakeup_hook, SPA_ID_INVALID, NULL, 0, true, data);
+	data->have_wakeup_hook = true;
+}
+
+static void remove_wakeup_hook(struct node_data *data)
+{
+	if (!data->have_wakeup_hook)
+		return;
+	pw_loop_invoke(data->node->data_loop,
+		do_remove_wakeup_hook, SPA_ID_INVALID, NULL, 0, true, data);
+	data->have_wakeup_hook = false;
+}
+
 static void clean_transport(struct node_data *data)
 {
 	struct link *l;
@@ -141,6 +293,8 @@ static void clean_transport(struct node_data *data)
 	if (!data->have_transport)
 		return;
 
+	remove_wakeup_hook(data);
+
 	spa_list_consume(l, &data->links, link)
 		clear_link(data, l);
 
@@ -272,6 +426,8 @@ static int client_node_transport(void *object,
 
 	data->have_transport = true;
 
+	add_wakeup_hook(data, size);
+
 	if (data->node->active)
 		pw_client_node_set_active(data->client_node, true);
 
@@ -827,6 +983,9 @@ static int link_signal_func(void *user_data)
 	link->target.activation->status = PW_NODE_ACTIVATION_TRIGGERED;
 	link->target.activation->signal_time = SPA_TIMESPEC_TO_NSEC(&ts);
 
+	if (pw_node_activation_wake(link->target.activation))
+		return 0;
+
 	if (SPA_UNLIKELY(spa_system_eventfd_write(data_system, link->signalfd, 1) < 0))
 		pw_log_warn("link %p: write failed %m", link);
 
@@ -1223,6 +1382,18 @@ static struct pw_proxy *node_export(struct pw_core *core, void *object, bool do_
 	if ((str = pw_properties_get(node->properties, "mem.warn-mlock")) != NULL)
 		data->warn_mlock = pw_properties_parse_bool(str);
 
+	data->wakeup = WAKEUP_EVENTFD;
+	if ((str = pw_properties_get(node->properties, PW_KEY_NODE_WAKEUP)) != NULL) {
+		if (strcmp(str, "futex") == 0)
+			data->wakeup = WAKEUP_FUTEX;
+		else if (strcmp(str, "spin") == 0)
+			data->wakeup = WAKEUP_SPIN;
+	}
+	data->wakeup_spin = data->wakeup == WAKEUP_SPIN ? 20 : 0;
+	if ((str = pw_properties_get(node->properties, PW_KEY_NODE_WAKEUP_SPIN)) != NULL)
+		data->wakeup_spin = strtoull(str, NULL, 10);
+	data->wakeup_spin *= SPA_NSEC_PER_USEC;
+
 	node->exported = true;
 
 	spa_list_init(&data->free_mix);
@@ -29,6 +29,9 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <pwd.h>
+#include <limits.h>
+#include <sys/mman.h>
 
 #include "config.h"
 
@@ -44,10 +47,15 @@
 #define NAME "profiler"
 
 #define MAX_BUFFER		(8 * 1024 * 1024)
+#define MAX_POD			(64 * 1024)
 #define MIN_FLUSH		(16 * 1024)
 #define DEFAULT_IDLE		5
 #define DEFAULT_INTERVAL	1
 
+#define SHM_NODES		256
+#define SHM_RECORDS		16384
+#define MAX_NODE_IDS		4096
+
 int pw_protocol_native_ext_profiler_init(struct pw_context *context);
 
 #define pw_profiler_resource(r,m,v,...)      \
@@ -62,6 +70,18 @@ static const struct spa_dict_item module_props[] = {
 	{ PW_KEY_MODULE_VERSION, PACKAGE_VERSION },
 };
 
+/* the histograms of a node, written by the data loop while the shm feed
+ * is active. They are assigned to node ids by the main loop and only freed
+ * with the feed. */
+struct node_stats {
+	struct spa_list link;
+	struct pw_impl_node *node;	/**< the node or NULL when unused */
+	uint32_t id;
+	bool seen;
+	struct pw_profiler_histogram wait;	/**< signal to awake time */
+	struct pw_profiler_histogram busy;	/**< awake to finish time */
+};
+
 struct impl {
 	struct pw_context *context;
 	struct pw_properties *properties;
@@ -76,12 +96,36 @@ struct impl {
 	uint32_t empty;
 	struct spa_source *flush_timeout;
 	unsigned int flushing:1;
-	unsigned int listening:1;
+	unsigned int shm_active:1;
+
+	/* owned by the data loop */
+	bool listening;
+	bool build_pod;
+	bool write_shm;
+
+	char *shm_path;
+	struct pw_profiler_shm *shm;
+	size_t shm_size;
+	struct pw_profiler_node *shm_nodes;
+	struct pw_profiler_record *shm_records;
+	uint64_t shm_index;
+	struct spa_source *shm_timeout;
+
+	struct spa_list stats_list;
+	struct node_stats *stats[MAX_NODE_IDS];	/**< indexed by node id */
+
+	uint8_t pod[MAX_POD];
 
 	struct spa_ringbuffer buffer;
 	uint8_t data[MAX_BUFFER];
 };
 
+struct listen_state {
+	bool listen;
+	bool build_pod;
+	bool write_shm;
+};
+
 struct resource_data {
 	struct impl *impl;
 
@@ -150,10 +194,93 @@ static void flush_timeout(void *data, uint64_t expirations)
 		pw_profiler_resource_profile(resource, &p->pod);
 }
 
-static void context_do_profile(void *data, struct pw_impl_node *node)
+static void add_histograms(struct impl *impl, struct pw_impl_node *node,
+		uint64_t cycle_start)
+{
+	struct pw_node_activation *a = node->rt.activation;
+	struct node_stats *s;
+	uint32_t id = node->info.id;
+
+	if (id >= MAX_NODE_IDS ||
+	    (s = __atomic_load_n(&impl->stats[id], __ATOMIC_ACQUIRE)) == NULL ||
+	    __atomic_load_n(&s->node, __ATOMIC_RELAXED) != node)
+		return;
+
+	/* skip nodes that did not complete in this cycle */
+	if (a->signal_time < cycle_start ||
+	    a->awake_time < a->signal_time ||
+	    a->finish_time < a->awake_time)
+		return;
+
+	pw_profiler_histogram_add(&s->wait, a->awake_time - a->signal_time);
+	pw_profiler_histogram_add(&s->busy, a->finish_time - a->awake_time);
+}
+
+static void write_record(struct impl *impl, uint32_t type,
+		struct pw_impl_node *driver, struct pw_impl_node *node,
+		uint64_t prev_signal_time)
+{
+	struct pw_node_activation *a = driver->rt.activation;
+	struct pw_node_activation *na = node->rt.activation;
+	struct spa_io_position *pos = &a->position;
+	uint64_t index = impl->shm_index;
+	struct pw_profiler_record *r;
+
+	r = &impl->shm_records[index & (impl->shm->n_records - 1)];
+
+	__atomic_store_n(&r->seq, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	r->type = type;
+	r->id = node->info.id;
+	r->status = na->status;
+	r->count = impl->count;
+	r->latency = node->latency;
+	r->prev_signal_time = prev_signal_time;
+	r->signal_time = na->signal_time;
+	r->awake_time = na->awake_time;
+	r->finish_time = na->finish_time;
+	r->driver_id = driver->info.id;
+	r->xrun_count = a->xrun_count;
+	r->cpu_load[0] = a->cpu_load[0];
+	r->cpu_load[1] = a->cpu_load[1];
+	r->cpu_load[2] = a->cpu_load[2];
+	r->clock_flags = pos->clock.flags;
+	r->clock_id = pos->clock.id;
+	r->clock_rate = pos->clock.rate;
+	r->clock_nsec = pos->clock.nsec;
+	r->clock_position = pos->clock.position;
+	r->clock_duration = pos->clock.duration;
+	r->clock_delay = pos->clock.delay;
+	r->clock_rate_diff = pos->clock.rate_diff;
+	r->clock_next_nsec = pos->clock.next_nsec;
+
+	__atomic_store_n(&r->seq, (uint32_t)(index + 1), __ATOMIC_RELEASE);
+	impl->shm_index = ++index;
+	__atomic_store_n(&impl->shm->write_index, index, __ATOMIC_RELEASE);
+}
+
+static void add_fanout(struct spa_pod_builder *b, struct pw_impl_node *n)
+{
+	struct pw_impl_port *p;
+
+	spa_list_for_each(p, &n->rt.output_mix, rt.node_link) {
+		if (p->fanout.buffers == 0)
+			continue;
+
+		spa_pod_builder_prop(b, SPA_PROFILER_followerFanout, 0);
+		spa_pod_builder_add_struct(b,
+			SPA_POD_Int(n->info.id),
+			SPA_POD_Int(p->info.id),
+			SPA_POD_Long(p->fanout.buffers),
+			SPA_POD_Long(p->fanout.shared),
+			SPA_POD_Int(p->fanout.consumers),
+			SPA_POD_Int(p->fanout.max_consumers));
+	}
+}
+
+static void build_pod(struct impl *impl, struct pw_impl_node *node)
 {
-	struct impl *impl = data;
-	char buffer[4096];
 	struct spa_pod_builder b;
 	struct spa_pod_frame f[2];
 	struct pw_node_activation *a = node->rt.activation;
@@ -162,7 +289,7 @@ static void context_do_profile(void *data, struct pw_impl_node *node)
 	int32_t filled;
 	uint32_t idx, avail;
 
-	spa_pod_builder_init(&b, buffer, sizeof(buffer));
+	spa_pod_builder_init(&b, impl->pod, sizeof(impl->pod));
 	spa_pod_builder_push_object(&b, &f[0],
 			SPA_TYPE_OBJECT_Profiler, 0);
 
@@ -197,6 +324,7 @@ static void context_do_profile(void *data, struct pw_impl_node *node)
 			SPA_POD_Long(a->finish_time),
 			SPA_POD_Int(a->status),
 			SPA_POD_Fraction(&node->latency));
+	add_fanout(&b, node);
 
 	spa_list_for_each(t, &node->rt.target_list, link) {
 		struct pw_impl_node *n = t->node;
@@ -216,18 +344,24 @@ static void context_do_profile(void *data, struct pw_impl_node *node)
 			SPA_POD_Long(na->finish_time),
 			SPA_POD_Int(na->status),
 			SPA_POD_Fraction(&n->latency));
+		/* the ports of followers in other loops change under us */
+		if (pw_impl_node_rt_loop(n) == pw_impl_node_rt_loop(node))
+			add_fanout(&b, n);
+	}
+	if (spa_pod_builder_pop(&b, &f[0]) == NULL) {
+		pw_log_warn(NAME " %p: profile does not fit in %d bytes", impl, MAX_POD);
+		return;
 	}
-	spa_pod_builder_pop(&b, &f[0]);
 
 	filled = spa_ringbuffer_get_write_index(&impl->buffer, &idx);
 	if (filled < 0 || filled > MAX_BUFFER) {
 		pw_log_warn(NAME " %p: queue xrun %d", impl, filled);
-		goto done;
+		return;
 	}
 	avail = MAX_BUFFER - filled;
 	if (avail < b.state.offset) {
 		pw_log_warn(NAME " %p: queue full %d < %d", impl, avail, b.state.offset);
-		goto done;
+		return;
 	}
 	spa_ringbuffer_write_data(&impl->buffer,
 			impl->data, MAX_BUFFER,
@@ -237,7 +371,36 @@ static void context_do_profile(void *data, struct pw_impl_node *node)
 
 	if (!impl->flushing || filled + b.state.offset > MIN_FLUSH)
 		start_flush(impl);
-done:
+}
+
+static void context_do_profile(void *data, struct pw_impl_node *node)
+{
+	struct impl *impl = data;
+	struct pw_node_activation *a = node->rt.activation;
+	struct pw_node_target *t;
+
+	if (impl->write_shm) {
+		add_histograms(impl, node, a->signal_time);
+		write_record(impl, PW_PROFILER_RECORD_DRIVER, node, node,
+				a->prev_signal_time);
+	}
+
+	spa_list_for_each(t, &node->rt.target_list, link) {
+		struct pw_impl_node *n = t->node;
+
+		if (n == NULL || n == node)
+			continue;
+
+		if (impl->write_shm) {
+			add_histograms(impl, n, a->signal_time);
+			write_record(impl, PW_PROFILER_RECORD_FOLLOWER, node, n,
+					a->signal_time);
+		}
+	}
+
+	if (impl->build_pod)
+		build_pod(impl, node);
+
 	impl->count++;
 }
 
@@ -247,21 +410,36 @@ static const struct pw_context_driver_events context_events = {
 	.complete = context_do_profile,
 };
 
-static int do_stop(struct spa_loop *loop,
+static int do_update_listener(struct spa_loop *loop,
 		bool async, uint32_t seq, const void *data, size_t size, void *user_data)
 {
 	struct impl *impl = user_data;
-	spa_hook_remove(&impl->context_listener);
+	const struct listen_state *state = data;
+
+	if (state->listen && !impl->listening)
+		spa_hook_list_append(&impl->context->driver_listener_list,
+				&impl->context_listener,
+				&context_events, impl);
+	else if (!state->listen && impl->listening)
+		spa_hook_remove(&impl->context_listener);
+
+	impl->listening = state->listen;
+	impl->build_pod = state->build_pod;
+	impl->write_shm = state->write_shm;
 	return 0;
 }
 
-static void stop_listener(struct impl *impl)
+static void update_listener(struct impl *impl)
 {
-	if (impl->listening) {
-		pw_loop_invoke(impl->context->data_loop,
-                       do_stop, SPA_ID_INVALID, NULL, 0, true, impl);
-		impl->listening = false;
-	}
+	struct listen_state state;
+
+	state.build_pod = impl->busy > 0;
+	state.write_shm = impl->shm_active;
+	state.listen = state.build_pod || state.write_shm;
+
+	pw_loop_invoke(impl->context->data_loop,
+			do_update_listener, SPA_ID_INVALID, &state, sizeof(state),
+			true, impl);
 }
 
 static void resource_destroy(void *data)
@@ -269,7 +447,7 @@ static void resource_destroy(void *data)
 	struct impl *impl = data;
 	if (--impl->busy == 0) {
 		pw_log_info(NAME" %p: stopping profiler", impl);
-		stop_listener(impl);
+		update_listener(impl);
 	}
 }
 
@@ -278,16 +456,6 @@ static const struct pw_resource_events resource_events = {
 	.destroy = resource_destroy,
 };
 
-static int
-do_start(struct spa_loop *loop,
-		bool async, uint32_t seq, const void *data, size_t size, void *user_data)
-{
-	struct impl *impl = user_data;
-	spa_hook_list_append(&impl->context->driver_listener_list,
-			&impl->context_listener,
-			&context_events, impl);
-	return 0;
-}
 static int
 global_bind(void *_data, struct pw_impl_client *client, uint32_t permissions,
             uint32_t version, uint32_t id)
@@ -312,11 +480,221 @@ global_bind(void *_data, struct pw_impl_client *client, uint32_t permissions,
 
 	if (++impl->busy == 1) {
 		pw_log_info(NAME" %p: starting profiler", impl);
-		pw_loop_invoke(impl->context->data_loop,
-                       do_start, SPA_ID_INVALID, NULL, 0, false, impl);
-		impl->listening = true;
+		update_listener(impl);
+	}
+	return 0;
+}
+
+static const char *get_runtime_dir(void)
+{
+	const char *runtime_dir;
+
+	runtime_dir = getenv("PIPEWIRE_RUNTIME_DIR");
+	if (runtime_dir == NULL)
+		runtime_dir = getenv("XDG_RUNTIME_DIR");
+	if (runtime_dir == NULL)
+		runtime_dir = getenv("HOME");
+	if (runtime_dir == NULL) {
+		struct passwd pwd, *result = NULL;
+		char buffer[4096];
+		if (getpwuid_r(getuid(), &pwd, buffer, sizeof(buffer), &result) == 0)
+			runtime_dir = result ? result->pw_dir : NULL;
+	}
+	return runtime_dir;
+}
+
+static struct node_stats *get_stats(struct impl *impl, struct pw_impl_node *node)
+{
+	struct node_stats *s;
+	uint32_t id = node->info.id;
+
+	if (id >= MAX_NODE_IDS)
+		return NULL;
+
+	if ((s = impl->stats[id]) == NULL) {
+		spa_list_for_each(s, &impl->stats_list, link)
+			if (s->node == NULL)
+				break;
+		if (&s->link == &impl->stats_list) {
+			if ((s = calloc(1, sizeof(*s))) == NULL)
+				return NULL;
+			spa_list_append(&impl->stats_list, &s->link);
+		}
+	}
+	if (s->node != node) {
+		/* a new node or the id was reused */
+		spa_zero(s->wait);
+		spa_zero(s->busy);
+		s->id = id;
+		__atomic_store_n(&s->node, node, __ATOMIC_RELAXED);
+		__atomic_store_n(&impl->stats[id], s, __ATOMIC_RELEASE);
+	}
+	s->seen = true;
+	return s;
+}
+
+static void free_stats(struct impl *impl)
+{
+	struct node_stats *s;
+
+	spa_list_consume(s, &impl->stats_list, link) {
+		spa_list_remove(&s->link);
+		free(s);
+	}
+	spa_zero(impl->stats);
+}
+
+static void shm_timeout(void *data, uint64_t expirations)
+{
+	struct impl *impl = data;
+	struct pw_profiler_shm *shm = impl->shm;
+	struct pw_impl_node *n;
+	struct node_stats *s;
+	uint32_t n_nodes = 0;
+
+	spa_list_for_each(s, &impl->stats_list, link)
+		s->seen = false;
+
+	/* the histograms are only written by the data loop, a snapshot that
+	 * is off by a cycle is fine */
+	__atomic_store_n(&shm->nodes_seq, shm->nodes_seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	spa_list_for_each(n, &impl->context->node_list, link) {
+		struct pw_profiler_node *pn;
+
+		if (!n->registered || n->rt.activation == NULL)
+			continue;
+		s = get_stats(impl, n);
+		if (n_nodes >= shm->max_nodes)
+			continue;
+
+		pn = &impl->shm_nodes[n_nodes++];
+		pn->id = n->info.id;
+		snprintf(pn->name, sizeof(pn->name), "%s", n->name);
+		if (s != NULL) {
+			pn->wait = s->wait;
+			pn->busy = s->busy;
+		} else {
+			spa_zero(pn->wait);
+			spa_zero(pn->busy);
+		}
+	}
+	shm->n_nodes = n_nodes;
+
+	/* the stats of removed nodes are kept around for new nodes */
+	spa_list_for_each(s, &impl->stats_list, link) {
+		if (s->seen || s->node == NULL)
+			continue;
+		if (impl->stats[s->id] == s)
+			__atomic_store_n(&impl->stats[s->id], NULL, __ATOMIC_RELEASE);
+		__atomic_store_n(&s->node, NULL, __ATOMIC_RELAXED);
+	}
+
+	__atomic_store_n(&shm->nodes_seq, shm->nodes_seq + 1, __ATOMIC_RELEASE);
+}
+
+static int shm_init(struct impl *impl, const char *path)
+{
+	struct pw_profiler_shm *shm;
+	struct timespec value, interval;
+	size_t nodes_offset, records_offset, size;
+	char buf[PATH_MAX];
+	void *data;
+	int fd, res;
+
+	if (path == NULL) {
+		const struct pw_properties *props = pw_context_get_properties(impl->context);
+		const char *runtime_dir, *name;
+
+		if ((runtime_dir = get_runtime_dir()) == NULL)
+			return -ENOENT;
+		if ((name = pw_properties_get(props, PW_KEY_CORE_NAME)) == NULL &&
+		    (name = getenv("PIPEWIRE_CORE")) == NULL)
+			name = PW_DEFAULT_REMOTE;
+
+		snprintf(buf, sizeof(buf), "%s/%s" PW_PROFILER_SHM_SUFFIX,
+				runtime_dir, name);
+		path = buf;
+	}
+
+	nodes_offset = SPA_ROUND_UP_N(sizeof(struct pw_profiler_shm), 64);
+	records_offset = SPA_ROUND_UP_N(nodes_offset +
+			SHM_NODES * sizeof(struct pw_profiler_node), 64);
+	size = records_offset + SHM_RECORDS * sizeof(struct pw_profiler_record);
+
+	/* never follow a link or reuse a file someone else created, a feed
+	 * left behind by a previous run is replaced */
+	fd = open(path, O_CREAT | O_EXCL | O_NOFOLLOW | O_RDWR | O_CLOEXEC, 0600);
+	if (fd < 0 && errno == EEXIST && unlink(path) == 0)
+		fd = open(path, O_CREAT | O_EXCL | O_NOFOLLOW | O_RDWR | O_CLOEXEC, 0600);
+	if (fd < 0)
+		return -errno;
+
+	if (ftruncate(fd, size) < 0) {
+		res = -errno;
+		goto error_unlink;
+	}
+	data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	if (data == MAP_FAILED) {
+		res = -errno;
+		goto error_unlink;
 	}
+	close(fd);
+
+	shm = data;
+	shm->version = PW_PROFILER_SHM_VERSION;
+	shm->nodes_offset = nodes_offset;
+	shm->max_nodes = SHM_NODES;
+	shm->records_offset = records_offset;
+	shm->n_records = SHM_RECORDS;
+	__atomic_store_n(&shm->magic, PW_PROFILER_SHM_MAGIC, __ATOMIC_RELEASE);
+
+	impl->shm_path = strdup(path);
+	impl->shm_size = size;
+	impl->shm_nodes = SPA_MEMBER(shm, nodes_offset, struct pw_profiler_node);
+	impl->shm_records = SPA_MEMBER(shm, records_offset, struct pw_profiler_record);
+	impl->shm = shm;
+	impl->shm_active = true;
+
+	impl->shm_timeout = pw_loop_add_timer(impl->context->main_loop, shm_timeout, impl);
+	value.tv_sec = DEFAULT_INTERVAL;
+	value.tv_nsec = 0;
+	interval.tv_sec = DEFAULT_INTERVAL;
+	interval.tv_nsec = 0;
+	pw_loop_update_timer(impl->context->main_loop,
+			impl->shm_timeout, &value, &interval, false);
+
+	pw_log_info(NAME" %p: writing profiler records to %s", impl, path);
+
+	update_listener(impl);
+	shm_timeout(impl, 0);
 	return 0;
+
+error_unlink:
+	close(fd);
+	unlink(path);
+	return res;
+}
+
+static void shm_clear(struct impl *impl)
+{
+	struct pw_profiler_shm *shm = impl->shm;
+
+	if (shm == NULL)
+		return;
+
+	pw_loop_destroy_source(impl->context->main_loop, impl->shm_timeout);
+
+	/* stop the writer before unmapping */
+	impl->shm_active = false;
+	update_listener(impl);
+
+	free_stats(impl);
+	impl->shm = NULL;
+	munmap(shm, impl->shm_size);
+	unlink(impl->shm_path);
+	free(impl->shm_path);
 }
 
 static void module_destroy(void *data)
@@ -325,6 +703,8 @@ static void module_destroy(void *data)
 
 	pw_global_destroy(impl->global);
 
+	shm_clear(impl);
+
 	spa_hook_remove(&impl->module_listener);
 
 	if (impl->properties)
@@ -345,6 +725,8 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	struct pw_properties *props;
 	struct impl *impl;
 	struct pw_loop *main_loop = pw_context_get_main_loop(context);
+	const char *str;
+	int res;
 
 	impl = calloc(1, sizeof(struct impl));
 	if (impl == NULL)
@@ -363,6 +745,7 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	impl->properties = props;
 
 	spa_ringbuffer_init(&impl->buffer);
+	spa_list_init(&impl->stats_list);
 
 	impl->global = pw_global_new(context,
 			PW_TYPE_INTERFACE_Profiler,
@@ -382,5 +765,13 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 
 	pw_global_register(impl->global);
 
+	if ((str = pw_properties_get(props, PW_KEY_PROFILER_SHM)) != NULL &&
+	    pw_properties_parse_bool(str)) {
+		if ((res = shm_init(impl,
+				pw_properties_get(props, PW_KEY_PROFILER_SHM_PATH))) < 0)
+			pw_log_warn(NAME" %p: can't create shared memory feed: %s",
+					impl, spa_strerror(res));
+	}
+
 	return 0;
 }
@@ -0,0 +1,330 @@
+/* PipeWire
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include <spa/param/props.h>
+#include <spa/pod/builder.h>
+
+#include <pipewire/pipewire.h>
+
+#include "manager.h"
+
+#define N_NODES		16
+#define N_UPDATES	20
+#define TIMEOUT_SEC	30
+
+/* Compares the pulse server setup where each client mirrors the graph in
+ * its own manager against one manager shared by all clients. Every client
+ * keeps its own core connection in both cases, like the pulse server does. */
+
+struct data;
+
+struct client {
+	struct data *data;
+	struct pw_core *core;
+	struct pw_manager *manager;	/* private manager or NULL */
+	struct spa_hook manager_listener;
+	unsigned int synced:1;
+};
+
+struct data {
+	struct pw_main_loop *loop;
+	struct pw_context *context;
+	struct pw_core *core;
+	struct spa_hook core_listener;
+	int pending;
+
+	struct pw_proxy *nodes[N_NODES];
+
+	bool shared;
+	struct pw_core *shared_core;
+	struct pw_manager *shared_manager;
+
+	struct client *clients;
+	uint32_t n_clients;
+	uint32_t n_synced;
+
+	uint32_t update_id;
+	uint32_t n_updated;
+
+	bool timeout;
+};
+
+static void check_done(struct data *d)
+{
+	if (d->n_synced == d->n_clients &&
+	    (d->update_id == SPA_ID_INVALID || d->n_updated == d->n_clients))
+		pw_main_loop_quit(d->loop);
+}
+
+static void manager_sync(void *data)
+{
+	struct client *c = data;
+	if (!c->synced) {
+		c->synced = true;
+		c->data->n_synced++;
+		check_done(c->data);
+	}
+}
+
+static void manager_updated(void *data, struct pw_manager_object *o)
+{
+	struct client *c = data;
+	if (o->id == c->data->update_id) {
+		c->data->n_updated++;
+		check_done(c->data);
+	}
+}
+
+static const struct pw_manager_events manager_events = {
+	PW_VERSION_MANAGER_EVENTS,
+	.sync = manager_sync,
+	.updated = manager_updated,
+};
+
+static void on_core_done(void *data, uint32_t id, int seq)
+{
+	struct data *d = data;
+	if (id == PW_ID_CORE && seq == d->pending)
+		pw_main_loop_quit(d->loop);
+}
+
+static const struct pw_core_events core_events = {
+	PW_VERSION_CORE_EVENTS,
+	.done = on_core_done,
+};
+
+static void on_timeout(void *data, uint64_t expirations)
+{
+	struct data *d = data;
+	d->timeout = true;
+	pw_main_loop_quit(d->loop);
+}
+
+static void roundtrip(struct data *d)
+{
+	d->pending = pw_core_sync(d->core, PW_ID_CORE, 0);
+	pw_main_loop_run(d->loop);
+}
+
+static uint64_t get_time_ns(clockid_t clock)
+{
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+static int create_nodes(struct data *d)
+{
+	uint32_t i;
+
+	for (i = 0; i < N_NODES; i++) {
+		struct pw_properties *props;
+
+		props = pw_properties_new(
+				"factory.name", "support.null-audio-sink",
+				PW_KEY_MEDIA_CLASS, "Audio/Sink",
+				"audio.position", "FL,FR",
+				NULL);
+		pw_properties_setf(props, PW_KEY_NODE_NAME, "benchmark-sink-%u", i);
+
+		d->nodes[i] = pw_core_create_object(d->core, "adapter",
+				PW_TYPE_INTERFACE_Node, PW_VERSION_NODE,
+				&props->dict, 0);
+		pw_properties_free(props);
+		if (d->nodes[i] == NULL)
+			return -errno;
+	}
+	roundtrip(d);
+
+	for (i = 0; i < N_NODES; i++) {
+		if (pw_proxy_get_bound_id(d->nodes[i]) == SPA_ID_INVALID)
+			return -EIO;
+	}
+	return 0;
+}
+
+static int add_clients(struct data *d)
+{
+	uint32_t i;
+
+	d->clients = calloc(d->n_clients, sizeof(struct client));
+	if (d->clients == NULL)
+		return -errno;
+
+	if (d->shared) {
+		d->shared_core = pw_context_connect_self(d->context, NULL, 0);
+		if (d->shared_core == NULL)
+			return -errno;
+		d->shared_manager = pw_manager_new(d->shared_core);
+		if (d->shared_manager == NULL)
+			return -errno;
+	}
+
+	for (i = 0; i < d->n_clients; i++) {
+		struct client *c = &d->clients[i];
+		struct pw_manager *m;
+
+		c->data = d;
+		c->core = pw_context_connect_self(d->context, NULL, 0);
+		if (c->core == NULL)
+			return -errno;
+
+		if (d->shared) {
+			m = d->shared_manager;
+		} else {
+			m = c->manager = pw_manager_new(c->core);
+			if (m == NULL)
+				return -errno;
+		}
+		pw_manager_add_listener(m, &c->manager_listener,
+				&manager_events, c);
+	}
+	return 0;
+}
+
+static void set_volume(struct data *d, struct pw_proxy *node, float volume)
+{
+	uint8_t buffer[1024];
+	struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+
+	pw_node_set_param((struct pw_node*)node, SPA_PARAM_Props, 0,
+			spa_pod_builder_add_object(&b,
+				SPA_TYPE_OBJECT_Props, SPA_PARAM_Props,
+				SPA_PROP_volume, SPA_POD_Float(volume)));
+}
+
+static int run(bool shared, uint32_t n_clients)
+{
+	struct data data = { 0, };
+	struct data *d = &data;
+	struct spa_source *timer;
+	struct timespec timeout = { TIMEOUT_SEC, 0 };
+	struct rusage usage;
+	uint64_t wall, cpu, setup_wall, setup_cpu, update_wall, update_cpu;
+	uint32_t i;
+	int res;
+
+	d->shared = shared;
+	d->n_clients = n_clients;
+	d->update_id = SPA_ID_INVALID;
+
+	d->loop = pw_main_loop_new(NULL);
+	d->context = pw_context_new(pw_main_loop_get_loop(d->loop), NULL, 0);
+	d->core = pw_context_connect_self(d->context, NULL, 0);
+	if (d->core == NULL)
+		return -errno;
+	pw_core_add_listener(d->core, &d->core_listener, &core_events, d);
+
+	timer = pw_loop_add_timer(pw_main_loop_get_loop(d->loop), on_timeout, d);
+	pw_loop_update_timer(pw_main_loop_get_loop(d->loop), timer, &timeout, NULL, false);
+
+	if ((res = create_nodes(d)) < 0)
+		return res;
+
+	/* connect all clients and wait until each has the full graph */
+	wall = get_time_ns(CLOCK_MONOTONIC);
+	cpu = get_time_ns(CLOCK_PROCESS_CPUTIME_ID);
+	if ((res = add_clients(d)) < 0)
+		return res;
+	pw_main_loop_run(d->loop);
+	setup_wall = get_time_ns(CLOCK_MONOTONIC) - wall;
+	setup_cpu = get_time_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu;
+
+	/* change a param and wait until every client saw the update */
+	wall = get_time_ns(CLOCK_MONOTONIC);
+	cpu = get_time_ns(CLOCK_PROCESS_CPUTIME_ID);
+	for (i = 0; i < N_UPDATES && !d->timeout; i++) {
+		struct pw_proxy *node = d->nodes[i % N_NODES];
+
+		d->update_id = pw_proxy_get_bound_id(node);
+		d->n_updated = 0;
+		set_volume(d, node, (i & 1) ? 0.5f : 0.25f);
+		pw_main_loop_run(d->loop);
+	}
+	update_wall = get_time_ns(CLOCK_MONOTONIC) - wall;
+	update_cpu = get_time_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu;
+
+	if (d->timeout) {
+		fprintf(stderr, "%s %u clients: timeout\n",
+				shared ? "shared" : "private", n_clients);
+		return -ETIMEDOUT;
+	}
+
+	getrusage(RUSAGE_SELF, &usage);
+
+	fprintf(stdout, "%-8s %8u %12.3f %12.3f %12.3f %12.3f %12ld\n",
+			shared ? "shared" : "private", n_clients,
+			setup_wall / 1e6, setup_cpu / 1e6,
+			update_wall / 1e6 / N_UPDATES, update_cpu / 1e6 / N_UPDATES,
+			usage.ru_maxrss);
+	fflush(stdout);
+
+	/* the process exits after this, the kernel cleans up */
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	static const uint32_t default_counts[] = { 1, 10, 50, 150 };
+	uint32_t counts[32], n_counts = 0, i, j;
+	int status;
+
+	pw_init(&argc, &argv);
+
+	for (i = 1; i < (uint32_t)argc && n_counts < SPA_N_ELEMENTS(counts); i++)
+		counts[n_counts++] = atoi(argv[i]);
+	if (n_counts == 0) {
+		for (i = 0; i < SPA_N_ELEMENTS(default_counts); i++)
+			counts[n_counts++] = default_counts[i];
+	}
+
+	fprintf(stdout, "%-8s %8s %12s %12s %12s %12s %12s\n",
+			"manager", "clients", "setup(ms)", "setup-cpu", "update(ms)",
+			"update-cpu", "maxrss(KB)");
+	fflush(stdout);
+
+	/* each run in its own process so that maxrss is not shared */
+	for (i = 0; i < n_counts; i++) {
+		for (j = 0; j < 2; j++) {
+			pid_t pid = fork();
+
+			if (pid < 0)
+				return EXIT_FAILURE;
+			if (pid == 0)
+				_exit(run(j == 1, counts[i]) < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+
+			if (waitpid(pid, &status, 0) < 0 ||
+			    !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+				return EXIT_FAILURE;
+		}
+	}
+	return EXIT_SUCCESS;
+}
@@ -134,6 +134,15 @@ static struct pw_manager_object *select_object(struct pw_manager *m,
 	struct pw_manager_object *o;
 	const char *str;
 
+	if (s->id != SPA_ID_INVALID && s->value == NULL && s->accumulate == NULL) {
+		/* only the id can match, use the index */
+		o = pw_manager_find_object(m, s->id);
+		if (o == NULL || o->removing ||
+		    (s->type != NULL && !s->type(o)))
+			return NULL;
+		return o;
+	}
+
 	spa_list_for_each(o, &m->object_list, link) {
 		if (o->creating || o->removing)
 			continue;
@@ -37,9 +37,17 @@
 
 #define FRAME_SIZE_MAX_ALLOW (1024*1024*16)
 
+#define SHM_INFO_BLOCKID	0
+#define SHM_INFO_SHMID		1
+#define SHM_INFO_INDEX		2
+#define SHM_INFO_LENGTH		3
+#define SHM_INFO_MAX		4
+
 #define PROTOCOL_FLAG_MASK	0xffff0000u
 #define PROTOCOL_VERSION_MASK	0x0000ffffu
 #define PROTOCOL_VERSION	35
+#define PROTOCOL_FLAG_SHM	0x80000000u
+#define PROTOCOL_FLAG_MEMFD	0x40000000u
 
 #define NATIVE_COOKIE_LENGTH 256
 #define MAX_TAG_SIZE (64*1024)
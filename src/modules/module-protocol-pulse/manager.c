@@ -34,6 +34,9 @@
 #define manager_emit_removed(m,o) spa_hook_list_call(&m->hooks, struct pw_manager_events, removed, 0, o)
 #define manager_emit_metadata(m,o,s,k,t,v) spa_hook_list_call(&m->hooks, struct pw_manager_events, metadata,0,o,s,k,t,v)
 
+#define OBJECT_HASH_SIZE	256
+#define OBJECT_HASH_MASK	(OBJECT_HASH_SIZE-1)
+
 struct object;
 
 struct manager {
@@ -44,6 +47,8 @@ struct manager {
 	int sync_seq;
 
 	struct spa_hook_list hooks;
+
+	struct spa_list object_hash[OBJECT_HASH_SIZE];
 };
 
 struct object_info {
@@ -60,6 +65,14 @@ struct object_data {
 	size_t size;
 };
 
+struct metadata_entry {
+	struct spa_list link;
+	uint32_t subject;
+	char *key;
+	char *type;
+	char *value;
+};
+
 struct object {
 	struct pw_manager_object this;
 
@@ -67,12 +80,15 @@ struct object {
 
 	const struct object_info *info;
 
+	struct spa_list hash_link;	/**< link in manager object_hash */
+
 	struct spa_list pending_list;
 
 	struct spa_hook proxy_listener;
 	struct spa_hook object_listener;
 
 	struct spa_list data_list;
+	struct spa_list metadata_list;
 };
 
 static int core_sync(struct manager *m)
@@ -142,7 +158,7 @@ static bool has_param(struct spa_list *param_list, struct pw_manager_param *p)
 static struct object *find_object(struct manager *m, uint32_t id)
 {
 	struct object *o;
-	spa_list_for_each(o, &m->this.object_list, this.link) {
+	spa_list_for_each(o, &m->object_hash[id & OBJECT_HASH_MASK], hash_link) {
 		if (o->this.creating)
 			continue;
 		if (o->this.id == id)
@@ -151,6 +167,28 @@ static struct object *find_object(struct manager *m, uint32_t id)
 	return NULL;
 }
 
+static void metadata_entry_free(struct metadata_entry *e)
+{
+	spa_list_remove(&e->link);
+	free(e->key);
+	free(e->type);
+	free(e->value);
+	free(e);
+}
+
+static void clear_metadata(struct object *o, uint32_t subject, const char *key)
+{
+	struct metadata_entry *e, *t;
+
+	spa_list_for_each_safe(e, t, &o->metadata_list, link) {
+		if (subject != SPA_ID_INVALID && e->subject != subject)
+			continue;
+		if (key != NULL && strcmp(e->key, key) != 0)
+			continue;
+		metadata_entry_free(e);
+	}
+}
+
 static void object_update_params(struct object *o)
 {
 	struct pw_manager_param *p;
@@ -171,6 +209,7 @@ static void object_destroy(struct object *o)
 	struct manager *m = o->manager;
 	struct object_data *d;
 	spa_list_remove(&o->this.link);
+	spa_list_remove(&o->hash_link);
 	m->this.n_objects--;
 	if (o->this.proxy)
 		pw_proxy_destroy(o->this.proxy);
@@ -184,6 +223,7 @@ static void object_destroy(struct object *o)
 		spa_list_remove(&d->link);
 		free(d);
 	}
+	clear_metadata(o, SPA_ID_INVALID, NULL);
 	free(o);
 }
 
@@ -464,6 +504,19 @@ static int metadata_property(void *object,
 {
 	struct object *o = object;
 	struct manager *m = o->manager;
+	struct metadata_entry *e;
+
+	/* keep a copy so that listeners added later can be brought up to date */
+	clear_metadata(o, subject, key);
+	if (key != NULL && value != NULL &&
+	    (e = calloc(1, sizeof(*e))) != NULL) {
+		e->subject = subject;
+		e->key = strdup(key);
+		e->type = type ? strdup(type) : NULL;
+		e->value = strdup(value);
+		spa_list_append(&o->metadata_list, &e->link);
+	}
+
 	manager_emit_metadata(m, &o->this, subject, key, type, value);
 	return 0;
 }
@@ -574,10 +627,12 @@ static void registry_event_global(void *data, uint32_t id,
 	spa_list_init(&o->this.param_list);
 	spa_list_init(&o->pending_list);
 	spa_list_init(&o->data_list);
+	spa_list_init(&o->metadata_list);
 
 	o->manager = m;
 	o->info = info;
 	spa_list_append(&m->this.object_list, &o->this.link);
+	spa_list_append(&m->object_hash[id & OBJECT_HASH_MASK], &o->hash_link);
 	m->this.n_objects++;
 
 	if (info->events)
@@ -659,6 +714,7 @@ static const struct pw_core_events core_events = {
 struct pw_manager *pw_manager_new(struct pw_core *core)
 {
 	struct manager *m;
+	uint32_t i;
 
 	m = calloc(1, sizeof(*m));
 	if (m == NULL)
@@ -675,6 +731,8 @@ struct pw_manager *pw_manager_new(struct pw_core *core)
 	spa_hook_list_init(&m->hooks);
 
 	spa_list_init(&m->this.object_list);
+	for (i = 0; i < OBJECT_HASH_SIZE; i++)
+		spa_list_init(&m->object_hash[i]);
 
 	pw_core_add_listener(m->this.core,
 			&m->core_listener,
@@ -691,7 +749,22 @@ void pw_manager_add_listener(struct pw_manager *manager,
 		const struct pw_manager_events *events, void *data)
 {
 	struct manager *m = SPA_CONTAINER_OF(manager, struct manager, this);
+	struct object *o;
+	struct metadata_entry *e;
+
 	spa_hook_list_append(&m->hooks, listener, events, data);
+
+	/* a manager can be shared, replay what the new listener missed */
+	spa_list_for_each(o, &m->this.object_list, this.link) {
+		if (o->this.creating || o->this.removing)
+			continue;
+		spa_callbacks_call(&listener->cb, struct pw_manager_events,
+				added, 0, &o->this);
+		spa_list_for_each(e, &o->metadata_list, link)
+			spa_callbacks_call(&listener->cb, struct pw_manager_events,
+					metadata, 0, &o->this, e->subject,
+					e->key, e->type, e->value);
+	}
 	core_sync(m);
 }
 
@@ -733,6 +806,14 @@ int pw_manager_set_metadata(struct pw_manager *manager,
 	return 0;
 }
 
+struct pw_manager_object *pw_manager_find_object(struct pw_manager *manager,
+		uint32_t id)
+{
+	struct manager *m = SPA_CONTAINER_OF(manager, struct manager, this);
+	struct object *o = find_object(m, id);
+	return o ? &o->this : NULL;
+}
+
 int pw_manager_for_each_object(struct pw_manager *manager,
 		int (*callback) (void *data, struct pw_manager_object *object),
 		void *data)
@@ -105,6 +105,9 @@ int pw_manager_set_metadata(struct pw_manager *manager,
 		uint32_t subject, const char *key, const char *type,
 		const char *format, ...) SPA_PRINTF_FUNC(6,7);
 
+struct pw_manager_object *pw_manager_find_object(struct pw_manager *manager,
+		uint32_t id);
+
 int pw_manager_for_each_object(struct pw_manager *manager,
 		int (*callback) (void *data, struct pw_manager_object *object),
 		void *data);
@@ -121,6 +121,8 @@ struct message {
 	struct stats *stat;
 	uint32_t extra[4];
 	uint32_t channel;
+	uint32_t flags;
+	uint32_t block_id;
 	uint32_t allocated;
 	uint32_t length;
 	uint32_t offset;
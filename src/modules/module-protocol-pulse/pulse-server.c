@@ -39,6 +39,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sys/time.h>
+#include <sys/mman.h>
 #include <arpa/inet.h>
 #include <fcntl.h>
 #include <regex.h>
@@ -95,6 +96,13 @@ struct stats {
 
 #define MAX_FORMATS	32
 
+#ifndef F_GET_SEALS
+#define F_GET_SEALS	(1024 + 10)
+#endif
+#ifndef F_SEAL_SHRINK
+#define F_SEAL_SHRINK	0x0002
+#endif
+
 struct defs {
 	struct spa_fraction min_req;
 	struct spa_fraction default_req;
@@ -124,6 +132,21 @@ struct operation {
 	struct spa_list link;
 	struct client *client;
 	uint32_t tag;
+	unsigned int synced:1;		/* the client core has processed our requests */
+};
+
+#define MAX_FDS		8
+#define MAX_IOV		64
+#define IN_BUFFER_SIZE	(16 * 1024)
+
+struct shm_segment {
+	struct spa_list link;
+	uint32_t id;
+	unsigned int memfd:1;
+	unsigned int sealed:1;		/* can't shrink, data is mapped */
+	int fd;				/* unsealed segments are read from the fd */
+	void *data;
+	size_t size;
 };
 
 struct client {
@@ -133,6 +156,7 @@ struct client {
 
 	int ref;
 	const char *name;
+	uid_t uid;			/* peer uid or -1 when unknown */
 
 	struct spa_source *source;
 	struct spa_source *cleanup;
@@ -142,10 +166,13 @@ struct client {
 	struct pw_properties *props;
 
 	struct pw_core *core;
-	struct pw_manager *manager;
+	struct spa_hook core_listener;
+	int core_sync_seq;
+	struct pw_manager *manager;		/* private or the shared impl manager */
 	struct spa_hook manager_listener;
 
 	uint32_t subscribed;
+	struct pw_array latency_offsets;
 
 	struct pw_manager_object *metadata_default;
 	char *default_sink;
@@ -159,6 +186,14 @@ struct client {
 	uint32_t out_index;
 	struct descriptor desc;
 	struct message *message;
+	int fds[MAX_FDS];
+	uint32_t n_fds;
+
+	uint32_t in_buffer_offset;
+	uint32_t in_buffer_size;
+	uint8_t in_buffer[IN_BUFFER_SIZE];
+
+	struct spa_list shm_segments;
 
 	struct pw_map streams;
 	struct spa_list out_messages;
@@ -171,14 +206,16 @@ struct client {
 	unsigned int disconnect:1;
 	unsigned int disconnecting:1;
 	unsigned int need_flush:1;
+	unsigned int use_shm:1;
+	unsigned int use_memfd:1;
 
 	struct pw_manager_object *prev_default_sink;
 	struct pw_manager_object *prev_default_source;
 };
 
 struct latency_offset_data {
+	uint32_t id;
 	int64_t prev_latency_offset;
-	unsigned int initialized:1;
 };
 
 struct buffer_attr {
@@ -278,6 +315,9 @@ struct impl {
 	struct pw_map samples;
 	struct pw_map modules;
 
+	struct pw_core *core;
+	struct pw_manager *manager;		/* shared by unrestricted clients */
+
 	struct spa_list free_messages;
 	struct defs defs;
 	struct stats stat;
@@ -365,6 +405,8 @@ static struct message *message_alloc(struct impl *impl, uint32_t channel, uint32
 		return NULL;
 	spa_zero(msg->extra);
 	msg->channel = channel;
+	msg->flags = 0;
+	msg->block_id = 0;
 	msg->offset = 0;
 	msg->length = size;
 	return msg;
@@ -373,51 +415,73 @@ static struct message *message_alloc(struct impl *impl, uint32_t channel, uint32
 static int flush_messages(struct client *client)
 {
 	struct impl *impl = client->impl;
-	int res;
+	struct descriptor desc[MAX_IOV];
+	struct iovec iov[MAX_IOV];
+	struct msghdr hdr;
+	struct message *m;
+	uint32_t n_iov, n_desc, idx;
+	ssize_t res;
+
+	while (!spa_list_is_empty(&client->out_messages)) {
+		/* gather as many queued messages as we can in one sendmsg() */
+		n_iov = n_desc = 0;
+		idx = client->out_index;
+		spa_list_for_each(m, &client->out_messages, link) {
+			if (n_iov + 2 > MAX_IOV)
+				break;
 
-	while (true) {
-		struct message *m;
-		struct descriptor desc;
-		void *data;
-		size_t size;
+			if (idx < sizeof(struct descriptor)) {
+				struct descriptor *d = &desc[n_desc++];
 
-		if (spa_list_is_empty(&client->out_messages))
-			break;
-		m = spa_list_first(&client->out_messages, struct message, link);
-
-		if (client->out_index < sizeof(desc)) {
-			desc.length = htonl(m->length);
-			desc.channel = htonl(m->channel);
-			desc.offset_hi = 0;
-			desc.offset_lo = 0;
-			desc.flags = 0;
-
-			data = SPA_MEMBER(&desc, client->out_index, void);
-			size = sizeof(desc) - client->out_index;
-		} else if (client->out_index < m->length + sizeof(desc)) {
-			uint32_t idx = client->out_index - sizeof(desc);
-			data = m->data + idx;
-			size = m->length - idx;
-		} else {
-			if (debug_messages && m->channel == SPA_ID_INVALID)
-				message_dump(SPA_LOG_LEVEL_INFO, m);
-			message_free(impl, m, true, false);
-			client->out_index = 0;
-			continue;
+				d->length = htonl(m->length);
+				d->channel = htonl(m->channel);
+				d->offset_hi = htonl(m->block_id);
+				d->offset_lo = 0;
+				d->flags = htonl(m->flags);
+
+				iov[n_iov].iov_base = SPA_MEMBER(d, idx, void);
+				iov[n_iov].iov_len = sizeof(struct descriptor) - idx;
+				n_iov++;
+				idx = 0;
+			} else {
+				idx -= sizeof(struct descriptor);
+			}
+			if (idx < m->length) {
+				iov[n_iov].iov_base = m->data + idx;
+				iov[n_iov].iov_len = m->length - idx;
+				n_iov++;
+			}
+			idx = 0;
 		}
 
+		spa_zero(hdr);
+		hdr.msg_iov = iov;
+		hdr.msg_iovlen = n_iov;
+
 		while (true) {
-			res = send(client->source->fd, data, size, MSG_NOSIGNAL | MSG_DONTWAIT);
+			res = sendmsg(client->source->fd, &hdr, MSG_NOSIGNAL | MSG_DONTWAIT);
 			if (res < 0) {
 				if (errno == EINTR)
 					continue;
 				if (errno != EAGAIN && errno != EWOULDBLOCK)
-					pw_log_warn("send channel:%d %zu, res %d: %m", m->channel, size, res);
+					pw_log_warn("sendmsg client:%p n_iov:%u res %zd: %m",
+							client, n_iov, res);
 				return -errno;
 			}
-			client->out_index += res;
 			break;
 		}
+
+		/* release all the messages that were completely sent */
+		client->out_index += res;
+		while (!spa_list_is_empty(&client->out_messages)) {
+			m = spa_list_first(&client->out_messages, struct message, link);
+			if (client->out_index < m->length + sizeof(struct descriptor))
+				break;
+			client->out_index -= m->length + sizeof(struct descriptor);
+			if (debug_messages && m->channel == SPA_ID_INVALID)
+				message_dump(SPA_LOG_LEVEL_INFO, m);
+			message_free(impl, m, true, false);
+		}
 	}
 	return 0;
 }
@@ -430,7 +494,7 @@ static int send_message(struct client *client, struct message *m)
 	if (m == NULL)
 		return -EINVAL;
 
-	if (m->length == 0) {
+	if (m->length == 0 && m->flags == 0) {
 		res = 0;
 		goto error;
 	} else if (m->length > m->allocated) {
@@ -507,7 +571,16 @@ static int operation_new(struct client *client, uint32_t tag)
 	o->client = client;
 	o->tag = tag;
 	spa_list_append(&client->operations, &o->link);
-	pw_manager_sync(client->manager);
+
+	if (client->manager->core != client->core) {
+		/* the shared manager only knows about our requests after
+		 * the client core processed them */
+		client->core_sync_seq = pw_core_sync(client->core,
+				PW_ID_CORE, client->core_sync_seq);
+	} else {
+		o->synced = true;
+		pw_manager_sync(client->manager);
+	}
 	pw_log_debug(NAME" %p: operation tag:%u", client, tag);
 	return 0;
 }
@@ -680,6 +753,7 @@ static int do_command_auth(struct client *client, uint32_t command, uint32_t tag
 	uint32_t version;
 	const void *cookie;
 	size_t len;
+	bool shm_on_remote = false, memfd_on_remote = false;
 
 	if (message_get(m,
 			TAG_U32, &version,
@@ -692,16 +766,28 @@ static int do_command_auth(struct client *client, uint32_t command, uint32_t tag
 	if (len != NATIVE_COOKIE_LENGTH)
 		return -EINVAL;
 
-	if ((version & PROTOCOL_VERSION_MASK) >= 13)
+	if ((version & PROTOCOL_VERSION_MASK) >= 13) {
+		shm_on_remote = SPA_FLAG_IS_SET(version, PROTOCOL_FLAG_SHM);
+		if ((version & PROTOCOL_VERSION_MASK) >= 31)
+			memfd_on_remote = SPA_FLAG_IS_SET(version, PROTOCOL_FLAG_MEMFD);
 		version &= PROTOCOL_VERSION_MASK;
+	}
 
 	client->version = version;
 
-	pw_log_info(NAME" %p: client:%p AUTH tag:%u version:%d", impl, client, tag, version);
+	/* the client can send audio from its shared memory pool when
+	 * it is on the same machine */
+	client->use_shm = shm_on_remote && client->server->type == SERVER_TYPE_UNIX;
+	client->use_memfd = client->use_shm && memfd_on_remote;
+
+	pw_log_info(NAME" %p: client:%p AUTH tag:%u version:%d shm:%d memfd:%d", impl,
+			client, tag, version, client->use_shm, client->use_memfd);
 
 	reply = reply_new(client, tag);
 	message_put(reply,
-			TAG_U32, PROTOCOL_VERSION,
+			TAG_U32, PROTOCOL_VERSION |
+				(client->use_shm ? PROTOCOL_FLAG_SHM : 0) |
+				(client->use_memfd ? PROTOCOL_FLAG_MEMFD : 0),
 			TAG_INVALID);
 
 	return send_message(client, reply);
@@ -734,7 +820,7 @@ static int reply_set_client_name(struct client *client, uint32_t tag)
 static void manager_sync(void *data)
 {
 	struct client *client = data;
-	struct operation *o;
+	struct operation *o, *t;
 
 	pw_log_debug(NAME" %p: manager sync", client);
 
@@ -742,10 +828,31 @@ static void manager_sync(void *data)
 		reply_set_client_name(client, client->connect_tag);
 		client->connect_tag = SPA_ID_INVALID;
 	}
-	spa_list_consume(o, &client->operations, link)
-		operation_complete(o);
+	spa_list_for_each_safe(o, t, &client->operations, link) {
+		if (o->synced)
+			operation_complete(o);
+	}
 }
 
+static void client_core_done(void *data, uint32_t id, int seq)
+{
+	struct client *client = data;
+	struct operation *o;
+
+	if (id != PW_ID_CORE || seq != client->core_sync_seq ||
+	    client->disconnect)
+		return;
+
+	spa_list_for_each(o, &client->operations, link)
+		o->synced = true;
+	pw_manager_sync(client->manager);
+}
+
+static const struct pw_core_events client_core_events = {
+	PW_VERSION_CORE_EVENTS,
+	.done = client_core_done,
+};
+
 static struct stream *find_stream(struct client *client, uint32_t id)
 {
 	union pw_map_item *item;
@@ -817,6 +924,23 @@ static int64_t get_node_latency_offset(struct pw_manager_object *o)
 	return latency_offset;
 }
 
+static struct latency_offset_data *find_latency_offset(struct client *client, uint32_t id)
+{
+	struct latency_offset_data *d;
+	pw_array_for_each(d, &client->latency_offsets) {
+		if (d->id == id)
+			return d;
+	}
+	return NULL;
+}
+
+static void remove_latency_offset(struct client *client, uint32_t id)
+{
+	struct latency_offset_data *d;
+	if ((d = find_latency_offset(client, id)) != NULL)
+		pw_array_remove(&client->latency_offsets, d);
+}
+
 static void send_latency_offset_subscribe_event(struct client *client, struct pw_manager_object *o)
 {
 	struct latency_offset_data *d;
@@ -826,6 +950,8 @@ static void send_latency_offset_subscribe_event(struct client *client, struct pw
 	int64_t latency_offset = 0LL;
 	bool changed = false;
 
+	if (!(client->subscribed & SUBSCRIPTION_MASK_CARD))
+		return;
 	if (!object_is_sink(o) && !object_is_source_or_monitor(o))
 		return;
 
@@ -840,15 +966,18 @@ static void send_latency_offset_subscribe_event(struct client *client, struct pw
 	if (card_id == SPA_ID_INVALID)
 		return;
 
-	d = pw_manager_object_add_data(o, "latency_offset_data", sizeof(struct latency_offset_data));
-	if (d == NULL)
-		return;
-
+	/* the object can be shared with other clients, keep our own state */
 	latency_offset = get_node_latency_offset(o);
-	changed = (!d->initialized || latency_offset != d->prev_latency_offset);
-
+	if ((d = find_latency_offset(client, o->id)) == NULL) {
+		d = pw_array_add(&client->latency_offsets, sizeof(*d));
+		if (d == NULL)
+			return;
+		d->id = o->id;
+		changed = true;
+	} else {
+		changed = latency_offset != d->prev_latency_offset;
+	}
 	d->prev_latency_offset = latency_offset;
-	d->initialized = true;
 
 	if (changed)
 		send_subscribe_event(client,
@@ -949,6 +1078,7 @@ static void manager_removed(void *data, struct pw_manager_object *o)
 				id);
 
 	send_default_change_subscribe_event(client, object_is_sink(o), object_is_source_or_monitor(o));
+	remove_latency_offset(client, o->id);
 
 	if (strcmp(o->type, PW_TYPE_INTERFACE_Metadata) == 0) {
 		if (o->props != NULL &&
@@ -1047,6 +1177,36 @@ static const struct pw_manager_events manager_events = {
 	.metadata = manager_metadata,
 };
 
+static struct pw_manager *impl_get_manager(struct impl *impl)
+{
+	if (impl->manager != NULL)
+		return impl->manager;
+
+	if (impl->core == NULL) {
+		impl->core = pw_context_connect(impl->context,
+				pw_properties_new(
+					PW_KEY_CLIENT_API, "pipewire-pulse",
+					NULL),
+				0);
+		if (impl->core == NULL)
+			return NULL;
+	}
+	impl->manager = pw_manager_new(impl->core);
+	return impl->manager;
+}
+
+static void impl_clear_manager(struct impl *impl)
+{
+	if (impl->manager != NULL) {
+		pw_manager_destroy(impl->manager);
+		impl->manager = NULL;
+	}
+	if (impl->core != NULL) {
+		pw_core_disconnect(impl->core);
+		impl->core = NULL;
+	}
+}
+
 static int do_set_client_name(struct client *client, uint32_t command, uint32_t tag, struct message *m)
 {
 	struct impl *impl = client->impl;
@@ -1080,7 +1240,16 @@ static int do_set_client_name(struct client *client, uint32_t command, uint32_t
 			res = -errno;
 			goto error;
 		}
-		client->manager = pw_manager_new(client->core);
+		pw_core_add_listener(client->core, &client->core_listener,
+				&client_core_events, client);
+
+		/* clients with an access restriction need to see the graph
+		 * through their own connection, everybody else shares the
+		 * objects of the server */
+		if (pw_properties_get(client->props, PW_KEY_CLIENT_ACCESS) == NULL)
+			client->manager = impl_get_manager(impl);
+		else
+			client->manager = pw_manager_new(client->core);
 		if (client->manager == NULL) {
 			res = -errno;
 			goto error;
@@ -5297,6 +5466,73 @@ static int do_send_object_message(struct client *client, uint32_t command, uint3
 	return send_message(client, reply);
 }
 
+static int do_register_memfd_shmid(struct client *client, uint32_t command, uint32_t tag, struct message *m)
+{
+	struct impl *impl = client->impl;
+	struct shm_segment *seg;
+	struct stat st;
+	uint32_t shm_id;
+	int res, fd;
+
+	if (message_get(m,
+			TAG_U32, &shm_id,
+			TAG_INVALID) < 0)
+		return -EPROTO;
+
+	if (!client->use_memfd || client->n_fds == 0)
+		return -EPROTO;
+
+	/* fds are consumed in the order they were received */
+	fd = client->fds[0];
+	memmove(&client->fds[0], &client->fds[1], --client->n_fds * sizeof(int));
+
+	pw_log_info(NAME" %p: client:%p REGISTER_MEMFD_SHMID shm_id:%u fd:%d",
+			impl, client, shm_id, fd);
+
+	spa_list_for_each(seg, &client->shm_segments, link) {
+		if (seg->id == shm_id && seg->memfd) {
+			res = -EEXIST;
+			goto error;
+		}
+	}
+	if (fstat(fd, &st) < 0 || st.st_size <= 0) {
+		res = -EINVAL;
+		goto error;
+	}
+	if (st.st_uid != client->uid) {
+		res = -EPERM;
+		goto error;
+	}
+	if ((seg = calloc(1, sizeof(*seg))) == NULL) {
+		res = -errno;
+		goto error;
+	}
+	seg->id = shm_id;
+	seg->memfd = true;
+	seg->fd = fd;
+	seg->size = st.st_size;
+	/* only map the memory when the client can't truncate it while we
+	 * read from it, libpulse does not seal its memfds */
+	res = fcntl(fd, F_GET_SEALS);
+	seg->sealed = res >= 0 && SPA_FLAG_IS_SET(res, F_SEAL_SHRINK);
+	if (seg->sealed) {
+		seg->data = mmap(NULL, seg->size, PROT_READ, MAP_SHARED, fd, 0);
+		if (seg->data == MAP_FAILED) {
+			res = -errno;
+			free(seg);
+			goto error;
+		}
+	}
+	spa_list_append(&client->shm_segments, &seg->link);
+	return 0;
+
+error:
+	pw_log_warn(NAME" %p: client:%p can't register memfd %u: %s",
+			impl, client, shm_id, spa_strerror(res));
+	close(fd);
+	return res;
+}
+
 static int do_error_access(struct client *client, uint32_t command, uint32_t tag, struct message *m)
 {
 	return -EACCES;
@@ -5464,7 +5700,7 @@ static const struct command commands[COMMAND_MAX] =
 
 	/* Supported since protocol v31 (9.0)
 	 * BOTH DIRECTIONS */
-	[COMMAND_REGISTER_MEMFD_SHMID] = { "REGISTER_MEMFD_SHMID", do_error_access, },
+	[COMMAND_REGISTER_MEMFD_SHMID] = { "REGISTER_MEMFD_SHMID", do_register_memfd_shmid, },
 
 	/* Supported since protocol v35 (15.0) */
 	[COMMAND_SEND_OBJECT_MESSAGE] = { "SEND_OBJECT_MESSAGE", do_send_object_message, },
@@ -5477,6 +5713,19 @@ static int client_free_stream(void *item, void *data)
 	return 0;
 }
 
+static void client_clear_manager(struct client *client)
+{
+	struct impl *impl = client->impl;
+
+	if (client->manager == NULL)
+		return;
+
+	spa_hook_remove(&client->manager_listener);
+	if (client->manager != impl->manager)
+		pw_manager_destroy(client->manager);
+	client->manager = NULL;
+}
+
 static void client_disconnect(struct client *client)
 {
 	struct impl *impl = client->impl;
@@ -5492,8 +5741,7 @@ static void client_disconnect(struct client *client)
 
 	if (client->source)
 		pw_loop_destroy_source(impl->loop, client->source);
-	if (client->manager)
-		pw_manager_destroy(client->manager);
+	client_clear_manager(client);
 }
 
 static void client_free(struct client *client)
@@ -5502,6 +5750,7 @@ static void client_free(struct client *client)
 	struct message *msg;
 	struct pending_sample *p;
 	struct operation *o;
+	struct shm_segment *seg;
 
 	pw_log_info(NAME" %p: client %p free", impl, client);
 
@@ -5518,11 +5767,25 @@ static void client_free(struct client *client)
 	spa_list_consume(o, &client->operations, link)
 		operation_free(o);
 
+	spa_list_consume(seg, &client->shm_segments, link) {
+		spa_list_remove(&seg->link);
+		if (seg->sealed)
+			munmap(seg->data, seg->size);
+		close(seg->fd);
+		free(seg);
+	}
+	while (client->n_fds > 0)
+		close(client->fds[--client->n_fds]);
+
+	client_clear_manager(client);
+
 	if (client->core) {
 		client->disconnecting = true;
+		spa_hook_remove(&client->core_listener);
 		pw_core_disconnect(client->core);
 	}
 	pw_map_clear(&client->streams);
+	pw_array_clear(&client->latency_offsets);
 	free(client->default_sink);
 	free(client->default_source);
 	if (client->props)
@@ -5580,11 +5843,92 @@ finish:
 	return 0;
 }
 
+static struct shm_segment *find_shm_segment(struct client *client, uint32_t shm_id, bool memfd)
+{
+	struct shm_segment *seg;
+	struct stat st;
+	char name[64];
+	int fd;
+
+	spa_list_for_each(seg, &client->shm_segments, link) {
+		if (seg->id == shm_id && seg->memfd == memfd)
+			return seg;
+	}
+	/* memfd segments need to be registered first */
+	if (memfd)
+		return NULL;
+
+	/* a client with an access restriction can't name files of the
+	 * server, only allow segments that the client itself owns */
+	if (pw_properties_get(client->props, PW_KEY_CLIENT_ACCESS) != NULL)
+		return NULL;
+
+	snprintf(name, sizeof(name), "/dev/shm/pulse-shm-%u", shm_id);
+	if ((fd = open(name, O_RDONLY | O_CLOEXEC | O_NOFOLLOW)) < 0)
+		return NULL;
+	if (fstat(fd, &st) < 0 || !S_ISREG(st.st_mode) || st.st_size <= 0)
+		goto error_close;
+	if (st.st_uid != client->uid)
+		goto error_close;
+	if ((seg = calloc(1, sizeof(*seg))) == NULL)
+		goto error_close;
+	seg->id = shm_id;
+	seg->fd = fd;
+	seg->size = st.st_size;
+	spa_list_append(&client->shm_segments, &seg->link);
+	return seg;
+
+error_close:
+	close(fd);
+	return NULL;
+}
+
+static bool shm_segment_check(struct shm_segment *seg, uint32_t index, uint32_t length)
+{
+	return (uint64_t)index + length <= seg->size;
+}
+
+/* The client can truncate an unsealed segment at any time, reading it
+ * through a mapping would then fault. Read it with pread(), which returns
+ * short instead. */
+static int shm_segment_read(struct shm_segment *seg, uint32_t offset,
+		void *buffer, uint32_t size, uint32_t index, uint32_t length)
+{
+	uint32_t l0, l1;
+	ssize_t res;
+
+	l0 = SPA_MIN(length, size - index);
+	l1 = length - l0;
+
+	res = pread(seg->fd, SPA_MEMBER(buffer, index, void), l0, offset);
+	if (res == (ssize_t)l0 && l1 > 0)
+		res = pread(seg->fd, buffer, l1, offset + l0) + l0;
+	if (res < 0)
+		return -errno;
+	if (res != (ssize_t)length)
+		return -EINVAL;
+	return 0;
+}
+
+static int send_shm_release(struct client *client, uint32_t block_id)
+{
+	struct message *msg;
+
+	if ((msg = message_alloc(client->impl, -1, 0)) == NULL)
+		return -errno;
+	msg->flags = FLAG_SHMRELEASE;
+	msg->block_id = block_id;
+	return send_message(client, msg);
+}
+
 static int handle_memblock(struct client *client, struct message *msg)
 {
 	struct impl *impl = client->impl;
 	struct stream *stream;
-	uint32_t channel, flags, index;
+	struct shm_segment *seg = NULL;
+	uint32_t channel, flags, index, length, block_id = SPA_ID_INVALID;
+	uint32_t *shm_info, shm_offset = 0;
+	const void *data;
 	int64_t offset;
 	int32_t filled, diff;
 	int res = 0;
@@ -5595,9 +5939,31 @@ static int handle_memblock(struct client *client, struct message *msg)
              (((uint64_t) ntohl(client->desc.offset_lo))));
 	flags = ntohl(client->desc.flags);
 
+	if (flags & FLAG_SHMDATA) {
+		/* the data is in the shared memory of the client, it is
+		 * copied straight into the ringbuffer from there */
+		shm_info = (uint32_t*)msg->data;
+		block_id = ntohl(shm_info[SHM_INFO_BLOCKID]);
+		shm_offset = ntohl(shm_info[SHM_INFO_INDEX]);
+		length = ntohl(shm_info[SHM_INFO_LENGTH]);
+
+		seg = find_shm_segment(client, ntohl(shm_info[SHM_INFO_SHMID]),
+				SPA_FLAG_IS_SET(flags, FLAG_SHMDATA_MEMFD_BLOCK));
+		if (seg == NULL || !shm_segment_check(seg, shm_offset, length)) {
+			pw_log_warn(NAME" %p: invalid shm block shm_id:%u index:%u length:%u",
+					impl, ntohl(shm_info[SHM_INFO_SHMID]), shm_offset, length);
+			res = -EINVAL;
+			goto finish;
+		}
+		data = seg->sealed ? SPA_MEMBER(seg->data, shm_offset, void) : NULL;
+	} else {
+		data = msg->data;
+		length = msg->length;
+	}
+
 	pw_log_debug(NAME" %p: Received memblock channel:%d offset:%"PRIi64
 			" flags:%08x size:%u", impl, channel, offset,
-			flags, msg->length);
+			flags, length);
 
 	stream = pw_map_lookup(&client->streams, channel);
 	if (stream == NULL || stream->type == STREAM_TYPE_RECORD) {
@@ -5607,7 +5973,7 @@ static int handle_memblock(struct client *client, struct message *msg)
 
 	filled = spa_ringbuffer_get_write_index(&stream->ring, &index);
 	pw_log_debug("new block %p %p/%u filled:%d index:%d flags:%02x offset:%"PRIu64,
-			msg, msg->data, msg->length, filled, index, flags, offset);
+			msg, data, length, filled, index, flags, offset);
 
 
 	switch (flags & FLAG_SEEKMASK) {
@@ -5633,26 +5999,111 @@ static int handle_memblock(struct client *client, struct message *msg)
 
 	if (filled < 0) {
 		/* underrun, reported on reader side */
-	} else if (filled + msg->length > stream->attr.maxlength) {
+	} else if (filled + length > stream->attr.maxlength) {
 		/* overrun */
 		send_overflow(stream);
 	}
 
 	/* always write data to ringbuffer, we expect the other side
 	 * to recover */
-	spa_ringbuffer_write_data(&stream->ring,
-			stream->buffer, stream->attr.maxlength,
-			index % stream->attr.maxlength,
-			msg->data,
-			SPA_MIN(msg->length, stream->attr.maxlength));
-	stream->write_index = index + msg->length;
+	if (data != NULL) {
+		spa_ringbuffer_write_data(&stream->ring,
+				stream->buffer, stream->attr.maxlength,
+				index % stream->attr.maxlength,
+				data,
+				SPA_MIN(length, stream->attr.maxlength));
+	} else if ((res = shm_segment_read(seg, shm_offset,
+				stream->buffer, stream->attr.maxlength,
+				index % stream->attr.maxlength,
+				SPA_MIN(length, stream->attr.maxlength))) < 0) {
+		pw_log_warn(NAME" %p: can't read shm block shm_id:%u index:%u length:%u: %s",
+				impl, seg->id, shm_offset, length, spa_strerror(res));
+		goto finish;
+	}
+	stream->write_index = index + length;
 	spa_ringbuffer_write_update(&stream->ring, stream->write_index);
-	stream->requested -= msg->length;
+	stream->requested -= length;
 finish:
 	message_free(impl, msg, false, false);
+	if (block_id != SPA_ID_INVALID)
+		send_shm_release(client, block_id);
 	return res;
 }
 
+static void collect_fds(struct client *client, struct msghdr *hdr)
+{
+	struct cmsghdr *cmsg;
+	int *fds;
+	uint32_t i, n_fds;
+
+	for (cmsg = CMSG_FIRSTHDR(hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(hdr, cmsg)) {
+		if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS)
+			continue;
+
+		fds = (int*)CMSG_DATA(cmsg);
+		n_fds = (cmsg->cmsg_len - ((uint8_t*)fds - (uint8_t*)cmsg)) / sizeof(int);
+		for (i = 0; i < n_fds; i++) {
+			if (client->n_fds < MAX_FDS)
+				client->fds[client->n_fds++] = fds[i];
+			else
+				close(fds[i]);
+		}
+	}
+}
+
+/* Read data from the client. Small reads are served from a buffer that is
+ * filled with as much data as is available so that many frames can be
+ * parsed per wakeup, large payloads are read directly. */
+static ssize_t client_recv(struct client *client, void *data, size_t size)
+{
+	struct iovec iov;
+	struct msghdr hdr;
+	char cmsgbuf[CMSG_SPACE(MAX_FDS * sizeof(int))];
+	ssize_t r;
+
+	if (client->in_buffer_offset == client->in_buffer_size) {
+		client->in_buffer_offset = client->in_buffer_size = 0;
+
+		if (size >= IN_BUFFER_SIZE) {
+			iov.iov_base = data;
+			iov.iov_len = size;
+		} else {
+			iov.iov_base = client->in_buffer;
+			iov.iov_len = IN_BUFFER_SIZE;
+		}
+		spa_zero(hdr);
+		hdr.msg_iov = &iov;
+		hdr.msg_iovlen = 1;
+		hdr.msg_control = cmsgbuf;
+		hdr.msg_controllen = sizeof(cmsgbuf);
+
+		while (true) {
+			r = recvmsg(client->source->fd, &hdr, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+			if (r == 0 && size != 0) {
+				return -EPIPE;
+			} else if (r < 0) {
+				if (errno == EINTR)
+					continue;
+				if (errno != EAGAIN && errno != EWOULDBLOCK)
+					pw_log_warn("recv client:%p res %zd: %m", client, r);
+				return -errno;
+			}
+			break;
+		}
+		if (hdr.msg_controllen > 0)
+			collect_fds(client, &hdr);
+
+		if (iov.iov_base == data)
+			return r;
+
+		client->in_buffer_size = r;
+	}
+	r = SPA_MIN(size, client->in_buffer_size - client->in_buffer_offset);
+	memcpy(data, &client->in_buffer[client->in_buffer_offset], r);
+	client->in_buffer_offset += r;
+	return r;
+}
+
 static int do_read(struct client *client)
 {
 	struct impl *impl = client->impl;
@@ -5674,31 +6125,27 @@ static int do_read(struct client *client)
 		data = SPA_MEMBER(client->message->data, idx, void);
 		size = client->message->length - idx;
 	}
-	while (true) {
-		r = recv(client->source->fd, data, size, MSG_DONTWAIT);
-		if (r == 0 && size != 0) {
-			res = -EPIPE;
-			goto exit;
-		} else if (r < 0) {
-			if (errno == EINTR)
-		                continue;
-			res = -errno;
-			if (errno != EAGAIN && errno != EWOULDBLOCK)
-				pw_log_warn("recv client:%p res %zd: %m", client, r);
-			goto exit;
-		}
-		client->in_index += r;
-		break;
+	if ((r = client_recv(client, data, size)) < 0) {
+		res = r;
+		goto exit;
 	}
+	client->in_index += r;
 
 	if (client->in_index == sizeof(client->desc)) {
 		uint32_t flags, length, channel;
 
 		flags = ntohl(client->desc.flags);
-		if ((flags & FLAG_SHMMASK) != 0) {
+		if ((flags & FLAG_SHMMASK) != 0 && !client->use_shm) {
 			res = -ENOTSUP;
 			goto exit;
 		}
+		if (flags == FLAG_SHMRELEASE || flags == FLAG_SHMREVOKE) {
+			/* we don't export memory to clients */
+			pw_log_warn(NAME" %p: unexpected release/revoke %08x for block %u",
+					impl, flags, ntohl(client->desc.offset_hi));
+			client->in_index = 0;
+			goto exit;
+		}
 
 		length = ntohl(client->desc.length);
 		if (length > FRAME_SIZE_MAX_ALLOW || length <= 0) {
@@ -5715,6 +6162,18 @@ static int do_read(struct client *client)
 				res = -EPROTO;
 				goto exit;
 			}
+		} else if (flags & FLAG_SHMDATA) {
+			if (length != SHM_INFO_MAX * sizeof(uint32_t)) {
+				pw_log_warn(NAME" %p: Received invalid shm frame size: %u",
+						impl, length);
+				res = -EPROTO;
+				goto exit;
+			}
+		} else if ((flags & FLAG_SHMMASK) != 0) {
+			pw_log_warn(NAME" %p: Received memblock frame with invalid "
+					"flags value %08x.", impl, flags);
+			res = -EPROTO;
+			goto exit;
 		}
 		if (client->message)
 			message_free(impl, client->message, false, false);
@@ -5864,14 +6323,17 @@ static int get_client_pid(struct client *client, int client_fd)
 	len = sizeof(ucred);
 	if (getsockopt(client_fd, SOL_SOCKET, SO_PEERCRED, &ucred, &len) < 0) {
                 pw_log_warn(NAME": client %p: no peercred: %m", client);
-	} else
+	} else {
+		client->uid = ucred.uid;
 		return ucred.pid;
+	}
 #elif defined(__FreeBSD__)
 	struct xucred xucred;
 	len = sizeof(xucred);
 	if (getsockopt(client_fd, 0, LOCAL_PEERCRED, &xucred, &len) < 0) {
                 pw_log_warn(NAME": client %p: no peercred: %m", client);
 	} else {
+		client->uid = xucred.cr_uid;
 #if __FreeBSD__ >= 13
 		return xucred.cr_pid;
 #endif
@@ -5898,11 +6360,14 @@ on_connect(void *data, int fd, uint32_t mask)
 	client->ref = 1;
 	client->server = server;
 	client->connect_tag = SPA_ID_INVALID;
+	client->uid = (uid_t)-1;
 	spa_list_append(&server->clients, &client->link);
 	pw_map_init(&client->streams, 16, 16);
+	pw_array_init(&client->latency_offsets, 16 * sizeof(struct latency_offset_data));
 	spa_list_init(&client->out_messages);
 	spa_list_init(&client->operations);
 	spa_list_init(&client->pending_samples);
+	spa_list_init(&client->shm_segments);
 
 	client->props = pw_properties_new(
 			PW_KEY_CLIENT_API, "pipewire-pulse",
@@ -6306,6 +6771,8 @@ static void impl_free(struct impl *impl)
 	pw_map_for_each(&impl->modules, impl_free_module, impl);
 	pw_map_clear(&impl->modules);
 
+	impl_clear_manager(impl);
+
 	if (impl->cleanup != NULL)
 		pw_loop_destroy_source(impl->loop, impl->cleanup);
 	pw_properties_free(impl->props);
@@ -6318,6 +6785,7 @@ static void context_destroy(void *data)
 	struct server *s;
 	spa_list_consume(s, &impl->servers, link)
 		server_free(s);
+	impl_clear_manager(impl);
 	spa_hook_remove(&impl->context_listener);
 	impl->context = NULL;
 }
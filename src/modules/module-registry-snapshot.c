@@ -0,0 +1,560 @@
+/* PipeWire
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <errno.h>
+
+#include "config.h"
+
+#include <spa/utils/result.h>
+
+#include <pipewire/private.h>
+#include <pipewire/impl.h>
+#include <extensions/registry-snapshot.h>
+
+#define NAME "registry-snapshot"
+
+int pw_protocol_native_ext_registry_snapshot_init(struct pw_context *context);
+
+#define pw_registry_snapshot_resource(r,m,v,...)	\
+	pw_resource_call(r,struct pw_registry_snapshot_events,m,v,__VA_ARGS__)
+
+#define pw_registry_snapshot_resource_snapshot(r,...)		\
+	pw_registry_snapshot_resource(r,snapshot,0,__VA_ARGS__)
+#define pw_registry_snapshot_resource_global(r,...)		\
+	pw_registry_snapshot_resource(r,global,0,__VA_ARGS__)
+#define pw_registry_snapshot_resource_global_remove(r,...)	\
+	pw_registry_snapshot_resource(r,global_remove,0,__VA_ARGS__)
+
+static const struct spa_dict_item module_props[] = {
+	{ PW_KEY_MODULE_AUTHOR, "Wim Taymans <wim.taymans@gmail.com>" },
+	{ PW_KEY_MODULE_DESCRIPTION, "Send the registry to clients in one shared memory snapshot" },
+	{ PW_KEY_MODULE_VERSION, PACKAGE_VERSION },
+};
+
+struct impl {
+	struct pw_context *context;
+	struct pw_impl_factory *factory;
+
+	struct pw_impl_module *module;
+	struct spa_hook module_listener;
+	struct spa_hook context_listener;
+
+	struct spa_list global_list;
+	struct spa_list snapshot_list;
+};
+
+/* a registered global, to follow the permission changes */
+struct global_data {
+	struct impl *impl;
+	struct spa_list link;
+	struct pw_global *global;
+	struct spa_hook global_listener;
+};
+
+struct snapshot {
+	struct impl *impl;
+	struct spa_list link;
+	struct pw_impl_client *client;
+	struct pw_resource *resource;
+	struct spa_hook resource_listener;
+	struct spa_hook object_listener;
+	struct pw_memblock *mem;
+};
+
+struct builder {
+	struct pw_impl_client *client;
+
+	uint32_t n_globals;
+	uint32_t n_items;
+	size_t max_strings;
+
+	struct pw_registry_snapshot_header *header;
+	struct pw_registry_snapshot_global *globals;
+	struct pw_registry_snapshot_item *items;
+	char *strings;
+
+	uint32_t *hash;				/* string offset + 1, 0 is free */
+	uint32_t hash_mask;
+};
+
+static inline const char *item_value(const struct spa_dict_item *item)
+{
+	/* pointers are not valid in the client */
+	if (strstr(item->value, "pointer:") == item->value)
+		return "";
+	return item->value;
+}
+
+static int count_global(void *data, struct pw_global *global)
+{
+	struct builder *b = data;
+	const struct spa_dict *props = &global->properties->dict;
+	uint32_t i;
+
+	if (!PW_PERM_IS_R(pw_global_get_permissions(global, b->client)))
+		return 0;
+
+	b->n_globals++;
+	b->n_items += props->n_items;
+	b->max_strings += strlen(global->type) + 1;
+	for (i = 0; i < props->n_items; i++)
+		b->max_strings += strlen(props->items[i].key) +
+			strlen(item_value(&props->items[i])) + 2;
+	return 0;
+}
+
+static uint32_t add_string(struct builder *b, const char *str)
+{
+	struct pw_registry_snapshot_header *h = b->header;
+	uint32_t hash = 2166136261u, idx, offset;
+	const char *s;
+	size_t len;
+
+	for (s = str; *s; s++)
+		hash = (hash ^ (uint8_t)*s) * 16777619u;
+
+	for (idx = hash & b->hash_mask; b->hash[idx] != 0; idx = (idx + 1) & b->hash_mask) {
+		offset = b->hash[idx] - 1;
+		if (strcmp(&b->strings[offset], str) == 0)
+			return offset;
+	}
+	len = s - str + 1;
+	offset = h->strings_size;
+	memcpy(&b->strings[offset], str, len);
+	h->strings_size += len;
+	b->hash[idx] = offset + 1;
+	return offset;
+}
+
+static int add_global(void *data, struct pw_global *global)
+{
+	struct builder *b = data;
+	struct pw_registry_snapshot_header *h = b->header;
+	const struct spa_dict *props = &global->properties->dict;
+	struct pw_registry_snapshot_global *g;
+	uint32_t i, permissions;
+
+	permissions = pw_global_get_permissions(global, b->client);
+	if (!PW_PERM_IS_R(permissions))
+		return 0;
+
+	g = &b->globals[h->n_globals++];
+	g->id = global->id;
+	g->permissions = permissions;
+	g->type = add_string(b, global->type);
+	g->version = global->version;
+	g->n_items = props->n_items;
+	g->items = h->n_items;
+
+	for (i = 0; i < props->n_items; i++) {
+		struct pw_registry_snapshot_item *it = &b->items[h->n_items++];
+		it->key = add_string(b, props->items[i].key);
+		it->value = add_string(b, item_value(&props->items[i]));
+	}
+	return 0;
+}
+
+static int build_snapshot(struct snapshot *s)
+{
+	struct impl *impl = s->impl;
+	struct builder b = { .client = s->client, };
+	struct pw_registry_snapshot_header *h;
+	uint32_t hash_size;
+	size_t size;
+	void *data;
+	int res;
+
+	/* count first so that everything fits in one allocation, the strings
+	 * only take the space of the unique ones in the end */
+	pw_context_for_each_global(impl->context, count_global, &b);
+
+	b.max_strings += 1;
+	size = sizeof(*h) +
+		b.n_globals * sizeof(struct pw_registry_snapshot_global) +
+		b.n_items * sizeof(struct pw_registry_snapshot_item) +
+		b.max_strings;
+	if (size > UINT32_MAX)
+		return -E2BIG;
+
+	for (hash_size = 64; hash_size < 2 * (b.n_globals + 2 * b.n_items); hash_size <<= 1);
+	b.hash_mask = hash_size - 1;
+
+	if ((data = malloc(size)) == NULL)
+		return -errno;
+	if ((b.hash = calloc(hash_size, sizeof(uint32_t))) == NULL) {
+		res = -errno;
+		free(data);
+		return res;
+	}
+
+	h = b.header = data;
+	*h = (struct pw_registry_snapshot_header) {
+		.magic = PW_REGISTRY_SNAPSHOT_MAGIC,
+		.format = PW_REGISTRY_SNAPSHOT_FORMAT,
+		.globals_offset = sizeof(*h),
+		.items_offset = sizeof(*h) +
+			b.n_globals * sizeof(struct pw_registry_snapshot_global),
+	};
+	h->strings_offset = h->items_offset +
+		b.n_items * sizeof(struct pw_registry_snapshot_item);
+
+	b.globals = SPA_MEMBER(data, h->globals_offset, struct pw_registry_snapshot_global);
+	b.items = SPA_MEMBER(data, h->items_offset, struct pw_registry_snapshot_item);
+	b.strings = SPA_MEMBER(data, h->strings_offset, char);
+
+	/* offset 0 is the empty string */
+	add_string(&b, "");
+	pw_context_for_each_global(impl->context, add_global, &b);
+
+	size = h->strings_offset + h->strings_size;
+
+	pw_log_debug(NAME" %p: client %p: %u globals %u items %u bytes of strings",
+			impl, s->client, h->n_globals, h->n_items, h->strings_size);
+
+	s->mem = pw_mempool_alloc(s->client->pool,
+			PW_MEMBLOCK_FLAG_READWRITE |
+			PW_MEMBLOCK_FLAG_SEAL |
+			PW_MEMBLOCK_FLAG_MAP,
+			SPA_DATA_MemFd, size);
+	if (s->mem == NULL) {
+		res = -errno;
+	} else {
+		memcpy(s->mem->map->ptr, data, size);
+		res = 0;
+	}
+	free(b.hash);
+	free(data);
+	return res;
+}
+
+static void * snapshot_bind(void *object, uint32_t id,
+		const char *type, uint32_t version, size_t user_data_size)
+{
+	struct snapshot *s = object;
+	struct pw_resource *resource = s->resource;
+	struct pw_impl_client *client = s->client;
+	struct pw_global *global;
+	uint32_t permissions, new_id = user_data_size;
+
+	if ((global = pw_context_find_global(s->impl->context, id)) == NULL)
+		goto error_no_id;
+
+	permissions = pw_global_get_permissions(global, client);
+
+	if (!PW_PERM_IS_R(permissions))
+		goto error_no_id;
+
+	if (!pw_global_is_type(global, type))
+		goto error_wrong_interface;
+
+	pw_log_debug(NAME" %p: bind global id %d, iface %s/%d to %d", s, id,
+		     type, version, new_id);
+
+	if (pw_global_bind(global, client, permissions, version, new_id) < 0)
+		goto error_exit_clean;
+
+	return NULL;
+
+error_no_id:
+	pw_log_debug(NAME" %p: no global with id %u to bind to %u", s, id, new_id);
+	pw_resource_errorf_id(resource, new_id, -ENOENT, "no global %u", id);
+	goto error_exit_clean;
+error_wrong_interface:
+	pw_log_debug(NAME" %p: global with id %u has no interface %s", s, id, type);
+	pw_resource_errorf_id(resource, new_id, -ENOSYS, "no interface %s", type);
+	goto error_exit_clean;
+error_exit_clean:
+	/* mark new_id as used and freed, like the registry does */
+	pw_map_insert_at(&client->objects, new_id, NULL);
+	pw_core_resource_remove_id(client->core_resource, new_id);
+	return NULL;
+}
+
+static const struct pw_registry_snapshot_methods snapshot_methods = {
+	PW_VERSION_REGISTRY_SNAPSHOT_METHODS,
+	.bind = snapshot_bind,
+};
+
+static void snapshot_resource_destroy(void *data)
+{
+	struct snapshot *s = data;
+
+	pw_log_debug(NAME" %p: destroy snapshot %p", s->impl, s);
+
+	spa_list_remove(&s->link);
+	spa_hook_remove(&s->resource_listener);
+	spa_hook_remove(&s->object_listener);
+	if (s->mem)
+		pw_memblock_unref(s->mem);
+}
+
+static const struct pw_resource_events snapshot_resource_events = {
+	PW_VERSION_RESOURCE_EVENTS,
+	.destroy = snapshot_resource_destroy,
+};
+
+static void global_permissions_changed(void *data, struct pw_impl_client *client,
+		uint32_t old_permissions, uint32_t new_permissions)
+{
+	struct global_data *g = data;
+	struct pw_global *global = g->global;
+	struct snapshot *s;
+
+	if (old_permissions == new_permissions ||
+	    (!PW_PERM_IS_R(old_permissions) && !PW_PERM_IS_R(new_permissions)))
+		return;
+
+	/* a global that stays visible is sent again with the new permissions */
+	spa_list_for_each(s, &g->impl->snapshot_list, link) {
+		if (s->client != client)
+			continue;
+		if (!PW_PERM_IS_R(new_permissions))
+			pw_registry_snapshot_resource_global_remove(s->resource, global->id);
+		else
+			pw_registry_snapshot_resource_global(s->resource,
+					global->id, new_permissions,
+					global->type, global->version,
+					&global->properties->dict);
+	}
+}
+
+static const struct pw_global_events global_events = {
+	PW_VERSION_GLOBAL_EVENTS,
+	.permissions_changed = global_permissions_changed,
+};
+
+static int add_global_data(void *data, struct pw_global *global)
+{
+	struct impl *impl = data;
+	struct global_data *g;
+
+	g = calloc(1, sizeof(*g));
+	if (g == NULL)
+		return -errno;
+
+	g->impl = impl;
+	g->global = global;
+	pw_global_add_listener(global, &g->global_listener, &global_events, g);
+	spa_list_append(&impl->global_list, &g->link);
+	return 0;
+}
+
+static void free_global_data(struct global_data *g)
+{
+	spa_list_remove(&g->link);
+	spa_hook_remove(&g->global_listener);
+	free(g);
+}
+
+static void context_global_added(void *data, struct pw_global *global)
+{
+	struct impl *impl = data;
+	struct snapshot *s;
+	uint32_t permissions;
+
+	add_global_data(impl, global);
+
+	spa_list_for_each(s, &impl->snapshot_list, link) {
+		permissions = pw_global_get_permissions(global, s->client);
+		if (PW_PERM_IS_R(permissions))
+			pw_registry_snapshot_resource_global(s->resource,
+					global->id, permissions,
+					global->type, global->version,
+					&global->properties->dict);
+	}
+}
+
+static void context_global_removed(void *data, struct pw_global *global)
+{
+	struct impl *impl = data;
+	struct global_data *g;
+	struct snapshot *s;
+
+	spa_list_for_each(g, &impl->global_list, link) {
+		if (g->global == global) {
+			free_global_data(g);
+			break;
+		}
+	}
+
+	spa_list_for_each(s, &impl->snapshot_list, link) {
+		if (PW_PERM_IS_R(pw_global_get_permissions(global, s->client)))
+			pw_registry_snapshot_resource_global_remove(s->resource, global->id);
+	}
+}
+
+static const struct pw_context_events context_events = {
+	PW_VERSION_CONTEXT_EVENTS,
+	.global_added = context_global_added,
+	.global_removed = context_global_removed,
+};
+
+static void *create_object(void *_data,
+			   struct pw_resource *resource,
+			   const char *type,
+			   uint32_t version,
+			   struct pw_properties *properties,
+			   uint32_t new_id)
+{
+	struct impl *impl = _data;
+	struct pw_impl_client *client = pw_resource_get_client(resource);
+	struct pw_resource *snapshot_resource;
+	struct snapshot *s;
+	int res;
+
+	snapshot_resource = pw_resource_new(client, new_id, PW_PERM_ALL, type, version,
+			sizeof(*s));
+	if (snapshot_resource == NULL) {
+		res = -errno;
+		goto error_resource;
+	}
+
+	s = pw_resource_get_user_data(snapshot_resource);
+	s->impl = impl;
+	s->client = client;
+	s->resource = snapshot_resource;
+	spa_list_append(&impl->snapshot_list, &s->link);
+
+	pw_resource_add_listener(snapshot_resource, &s->resource_listener,
+			&snapshot_resource_events, s);
+	pw_resource_add_object_listener(snapshot_resource, &s->object_listener,
+			&snapshot_methods, s);
+
+	if ((res = build_snapshot(s)) < 0)
+		goto error_snapshot;
+
+	pw_registry_snapshot_resource_snapshot(snapshot_resource,
+			s->mem->id, 0, s->mem->size);
+
+	if (properties)
+		pw_properties_free(properties);
+
+	return s;
+
+error_resource:
+	pw_log_error("can't create resource: %s", spa_strerror(res));
+	pw_resource_errorf_id(resource, new_id, res, "can't create resource: %s", spa_strerror(res));
+	goto error_exit;
+error_snapshot:
+	pw_log_error("can't create snapshot: %s", spa_strerror(res));
+	pw_resource_errorf_id(resource, new_id, res, "can't create snapshot: %s", spa_strerror(res));
+	pw_resource_remove(snapshot_resource);
+	goto error_exit;
+error_exit:
+	if (properties)
+		pw_properties_free(properties);
+	errno = -res;
+	return NULL;
+}
+
+static const struct pw_impl_factory_implementation impl_factory = {
+	PW_VERSION_IMPL_FACTORY_IMPLEMENTATION,
+	.create_object = create_object,
+};
+
+static void module_destroy(void *data)
+{
+	struct impl *impl = data;
+	struct snapshot *s;
+	struct global_data *g;
+
+	spa_hook_remove(&impl->module_listener);
+	spa_hook_remove(&impl->context_listener);
+
+	spa_list_consume(s, &impl->snapshot_list, link)
+		pw_resource_destroy(s->resource);
+	spa_list_consume(g, &impl->global_list, link)
+		free_global_data(g);
+
+	pw_impl_factory_destroy(impl->factory);
+}
+
+static void module_registered(void *data)
+{
+	struct impl *impl = data;
+	struct pw_impl_module *module = impl->module;
+	struct pw_impl_factory *factory = impl->factory;
+	struct spa_dict_item items[1];
+	char id[16];
+	int res;
+
+	snprintf(id, sizeof(id), "%d", pw_global_get_id(pw_impl_module_get_global(module)));
+	items[0] = SPA_DICT_ITEM_INIT(PW_KEY_MODULE_ID, id);
+	pw_impl_factory_update_properties(factory, &SPA_DICT_INIT(items, 1));
+
+	if ((res = pw_impl_factory_register(factory, NULL)) < 0) {
+		pw_log_error(NAME" %p: can't register factory: %s", factory, spa_strerror(res));
+	}
+}
+
+static const struct pw_impl_module_events module_events = {
+	PW_VERSION_IMPL_MODULE_EVENTS,
+	.destroy = module_destroy,
+	.registered = module_registered,
+};
+
+SPA_EXPORT
+int pipewire__module_init(struct pw_impl_module *module, const char *args)
+{
+	struct pw_context *context = pw_impl_module_get_context(module);
+	struct pw_impl_factory *factory;
+	struct impl *impl;
+	int res;
+
+	if ((res = pw_protocol_native_ext_registry_snapshot_init(context)) < 0)
+		return res;
+
+	factory = pw_context_create_factory(context,
+				 PW_REGISTRY_SNAPSHOT_FACTORY,
+				 PW_TYPE_INTERFACE_RegistrySnapshot,
+				 PW_VERSION_REGISTRY_SNAPSHOT,
+				 NULL,
+				 sizeof(*impl));
+	if (factory == NULL)
+		return -errno;
+
+	impl = pw_impl_factory_get_user_data(factory);
+	impl->context = context;
+	impl->factory = factory;
+	impl->module = module;
+	spa_list_init(&impl->global_list);
+	spa_list_init(&impl->snapshot_list);
+
+	pw_log_debug("module %p: new", module);
+
+	pw_impl_factory_set_implementation(factory,
+				      &impl_factory,
+				      impl);
+
+	pw_context_for_each_global(context, add_global_data, impl);
+	pw_context_add_listener(context, &impl->context_listener, &context_events, impl);
+
+	pw_impl_module_add_listener(module, &impl->module_listener, &module_events, impl);
+
+	pw_impl_module_update_properties(module, &SPA_DICT_INIT_ARRAY(module_props));
+
+	return 0;
+}
@@ -0,0 +1,346 @@
+/* PipeWire
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <spa/utils/result.h>
+
+#include <pipewire/impl.h>
+#include <extensions/registry-snapshot.h>
+
+#define N_PROPS		12
+#define TIMEOUT_SEC	30
+
+/* Compares a client joining a large graph through the registry, with one
+ * global event per object, against one registry snapshot. The globals are
+ * made in the same process, the client connects over the native protocol. */
+
+struct data {
+	struct pw_main_loop *loop;
+	struct pw_context *context;
+	struct pw_core *core;
+	struct spa_hook core_listener;
+	int pending;
+
+	struct pw_registry *registry;
+	struct spa_hook registry_listener;
+	struct pw_proxy *snapshot;
+	struct spa_hook snapshot_listener;
+
+	uint32_t n_globals;
+	uint32_t size;
+	uint32_t added_id;
+	uint32_t removed_id;
+	int res;
+
+	bool timeout;
+};
+
+static int global_bind(void *_data, struct pw_impl_client *client,
+		uint32_t permissions, uint32_t version, uint32_t id)
+{
+	return -ENOTSUP;
+}
+
+static struct pw_global *add_global(struct data *d, uint32_t index)
+{
+	struct pw_properties *props;
+	struct pw_global *global;
+	uint32_t i;
+
+	/* about what a node has, with some values that repeat */
+	props = pw_properties_new(
+			PW_KEY_MEDIA_CLASS, (index & 1) ? "Audio/Sink" : "Stream/Output/Audio",
+			PW_KEY_FACTORY_NAME, "support.null-audio-sink",
+			NULL);
+	pw_properties_setf(props, PW_KEY_NODE_NAME, "benchmark-node-%u", index);
+	pw_properties_setf(props, PW_KEY_NODE_DESCRIPTION, "Benchmark Node %u", index);
+	pw_properties_setf(props, PW_KEY_OBJECT_PATH, "benchmark:%u", index);
+	pw_properties_setf(props, PW_KEY_CLIENT_ID, "%u", index % 32);
+	for (i = 0; i < N_PROPS - 6; i++) {
+		char key[64];
+		snprintf(key, sizeof(key), "benchmark.prop.%u", i);
+		pw_properties_setf(props, key, "%u", i);
+	}
+
+	global = pw_global_new(d->context, PW_TYPE_INTERFACE_Node, PW_VERSION_NODE,
+			props, global_bind, d);
+	if (global != NULL)
+		pw_global_register(global);
+	return global;
+}
+
+static void on_core_done(void *data, uint32_t id, int seq)
+{
+	struct data *d = data;
+	if (id == PW_ID_CORE && seq == d->pending)
+		pw_main_loop_quit(d->loop);
+}
+
+static void on_core_error(void *data, uint32_t id, int seq, int res, const char *message)
+{
+	struct data *d = data;
+	fprintf(stderr, "error id:%u seq:%d res:%d (%s): %s\n",
+			id, seq, res, spa_strerror(res), message);
+	d->res = res;
+	pw_main_loop_quit(d->loop);
+}
+
+static const struct pw_core_events core_events = {
+	PW_VERSION_CORE_EVENTS,
+	.done = on_core_done,
+	.error = on_core_error,
+};
+
+static void registry_global(void *data, uint32_t id,
+		uint32_t permissions, const char *type, uint32_t version,
+		const struct spa_dict *props)
+{
+	struct data *d = data;
+	d->n_globals++;
+}
+
+static const struct pw_registry_events registry_events = {
+	PW_VERSION_REGISTRY_EVENTS,
+	.global = registry_global,
+};
+
+static void snapshot_snapshot(void *data, uint32_t mem_id, uint32_t offset, uint32_t size)
+{
+	struct data *d = data;
+	struct spa_dict_item items[64];
+	const struct pw_registry_snapshot_header *h;
+	struct pw_memmap *mm;
+	uint32_t i;
+
+	mm = pw_mempool_map_id(pw_core_get_mempool(d->core), mem_id,
+			PW_MEMMAP_FLAG_READ, offset, size, NULL);
+	if (mm == NULL) {
+		d->res = -errno;
+		return;
+	}
+	h = mm->ptr;
+	if ((d->res = pw_registry_snapshot_check(h, size)) < 0) {
+		pw_memmap_free(mm);
+		return;
+	}
+	/* do the same as a registry listener would get */
+	for (i = 0; i < h->n_globals; i++) {
+		const struct pw_registry_snapshot_global *g = pw_registry_snapshot_get_global(h, i);
+		struct spa_dict props = SPA_DICT_INIT(items,
+				pw_registry_snapshot_get_props(h, g, items, SPA_N_ELEMENTS(items)));
+
+		registry_global(d, g->id, g->permissions,
+				pw_registry_snapshot_get_string(h, g->type),
+				g->version, &props);
+	}
+	d->size = size;
+	pw_memmap_free(mm);
+}
+
+static void snapshot_global(void *data, uint32_t id,
+		uint32_t permissions, const char *type, uint32_t version,
+		const struct spa_dict *props)
+{
+	struct data *d = data;
+	d->added_id = id;
+}
+
+static void snapshot_global_remove(void *data, uint32_t id)
+{
+	struct data *d = data;
+	d->removed_id = id;
+}
+
+static const struct pw_registry_snapshot_events snapshot_events = {
+	PW_VERSION_REGISTRY_SNAPSHOT_EVENTS,
+	.snapshot = snapshot_snapshot,
+	.global = snapshot_global,
+	.global_remove = snapshot_global_remove,
+};
+
+static void on_timeout(void *data, uint64_t expirations)
+{
+	struct data *d = data;
+	d->timeout = true;
+	pw_main_loop_quit(d->loop);
+}
+
+static void roundtrip(struct data *d)
+{
+	d->pending = pw_core_sync(d->core, PW_ID_CORE, 0);
+	pw_main_loop_run(d->loop);
+}
+
+static uint64_t get_time_ns(clockid_t clock)
+{
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+/* check that globals added and removed after the snapshot are sent */
+static int check_deltas(struct data *d, uint32_t n_globals)
+{
+	struct pw_global *global;
+	uint32_t id;
+
+	if ((global = add_global(d, n_globals)) == NULL)
+		return -errno;
+	id = pw_global_get_id(global);
+	roundtrip(d);
+	if (d->added_id != id)
+		return -EIO;
+
+	pw_global_destroy(global);
+	roundtrip(d);
+	if (d->removed_id != id)
+		return -EIO;
+	return 0;
+}
+
+static int run(bool snapshot, uint32_t n_globals)
+{
+	struct data data = { 0, };
+	struct data *d = &data;
+	struct spa_source *timer;
+	struct timespec timeout = { TIMEOUT_SEC, 0 };
+	uint64_t wall, cpu;
+	uint32_t i;
+	int res;
+
+	d->added_id = d->removed_id = SPA_ID_INVALID;
+
+	d->loop = pw_main_loop_new(NULL);
+	d->context = pw_context_new(pw_main_loop_get_loop(d->loop), NULL, 0);
+	if (d->context == NULL)
+		return -errno;
+	if (pw_context_load_module(d->context,
+			PW_EXTENSION_MODULE_REGISTRY_SNAPSHOT, NULL, NULL) == NULL)
+		return -errno;
+
+	timer = pw_loop_add_timer(pw_main_loop_get_loop(d->loop), on_timeout, d);
+	pw_loop_update_timer(pw_main_loop_get_loop(d->loop), timer, &timeout, NULL, false);
+
+	for (i = 0; i < n_globals; i++) {
+		if (add_global(d, i) == NULL)
+			return -errno;
+	}
+
+	/* connect and wait until the client has all globals */
+	wall = get_time_ns(CLOCK_MONOTONIC);
+	cpu = get_time_ns(CLOCK_PROCESS_CPUTIME_ID);
+
+	d->core = pw_context_connect_self(d->context, NULL, 0);
+	if (d->core == NULL)
+		return -errno;
+	pw_core_add_listener(d->core, &d->core_listener, &core_events, d);
+
+	if (snapshot) {
+		d->snapshot = pw_core_create_object(d->core,
+				PW_REGISTRY_SNAPSHOT_FACTORY,
+				PW_TYPE_INTERFACE_RegistrySnapshot,
+				PW_VERSION_REGISTRY_SNAPSHOT, NULL, 0);
+		if (d->snapshot == NULL)
+			return -errno;
+		pw_registry_snapshot_add_listener(d->snapshot, &d->snapshot_listener,
+				&snapshot_events, d);
+	} else {
+		d->registry = pw_core_get_registry(d->core, PW_VERSION_REGISTRY, 0);
+		if (d->registry == NULL)
+			return -errno;
+		pw_registry_add_listener(d->registry, &d->registry_listener,
+				&registry_events, d);
+	}
+	roundtrip(d);
+
+	wall = get_time_ns(CLOCK_MONOTONIC) - wall;
+	cpu = get_time_ns(CLOCK_PROCESS_CPUTIME_ID) - cpu;
+
+	if (d->timeout) {
+		fprintf(stderr, "%s %u globals: timeout\n",
+				snapshot ? "snapshot" : "registry", n_globals);
+		return -ETIMEDOUT;
+	}
+	if (d->res < 0)
+		return d->res;
+	/* the core, client and module globals are in there as well */
+	if (d->n_globals < n_globals)
+		return -EIO;
+
+	if (snapshot && (res = check_deltas(d, n_globals)) < 0) {
+		fprintf(stderr, "snapshot %u globals: missing delta\n", n_globals);
+		return res;
+	}
+
+	fprintf(stdout, "%-8s %8u %8u %12.3f %12.3f %12u\n",
+			snapshot ? "snapshot" : "registry", n_globals, d->n_globals,
+			wall / 1e6, cpu / 1e6, d->size);
+	fflush(stdout);
+
+	/* the process exits after this, the kernel cleans up */
+	return 0;
+}
+
+int main(int argc, char *argv[])
+{
+	static const uint32_t default_counts[] = { 100, 1000, 3000, 10000 };
+	uint32_t counts[32], n_counts = 0, i, j;
+	int status;
+
+	pw_init(&argc, &argv);
+
+	for (i = 1; i < (uint32_t)argc && n_counts < SPA_N_ELEMENTS(counts); i++)
+		counts[n_counts++] = atoi(argv[i]);
+	if (n_counts == 0) {
+		for (i = 0; i < SPA_N_ELEMENTS(default_counts); i++)
+			counts[n_counts++] = default_counts[i];
+	}
+
+	fprintf(stdout, "%-8s %8s %8s %12s %12s %12s\n",
+			"join", "globals", "received", "join(ms)", "join-cpu",
+			"shm(bytes)");
+	fflush(stdout);
+
+	/* each run in its own process */
+	for (i = 0; i < n_counts; i++) {
+		for (j = 0; j < 2; j++) {
+			pid_t pid = fork();
+
+			if (pid < 0)
+				return EXIT_FAILURE;
+			if (pid == 0)
+				_exit(run(j == 1, counts[i]) < 0 ? EXIT_FAILURE : EXIT_SUCCESS);
+
+			if (waitpid(pid, &status, 0) < 0 ||
+			    !WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS)
+				return EXIT_FAILURE;
+		}
+	}
+	return EXIT_SUCCESS;
+}
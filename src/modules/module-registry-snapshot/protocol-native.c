@@ -0,0 +1,305 @@
+/* PipeWire
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include <spa/pod/builder.h>
+#include <spa/pod/parser.h>
+#include <spa/utils/result.h>
+
+#include <pipewire/pipewire.h>
+
+#include <extensions/protocol-native.h>
+#include <extensions/registry-snapshot.h>
+
+static void push_dict(struct spa_pod_builder *b, const struct spa_dict *dict)
+{
+	struct spa_pod_frame f;
+	uint32_t n_items;
+	uint32_t i;
+
+	n_items = dict ? dict->n_items : 0;
+
+	spa_pod_builder_push_struct(b, &f);
+	spa_pod_builder_add(b, SPA_POD_Int(n_items), NULL);
+	for (i = 0; i < n_items; i++) {
+		const char *str = dict->items[i].value;
+		if (strstr(str, "pointer:") == str)
+			str = "";
+		spa_pod_builder_add(b,
+			SPA_POD_String(dict->items[i].key),
+			SPA_POD_String(str),
+			NULL);
+	}
+	spa_pod_builder_pop(b, &f);
+}
+
+/* macro because of alloca() */
+#define parse_dict(p, f, dict) \
+do { \
+	uint32_t i; \
+	\
+	if (spa_pod_parser_push_struct(p, f) < 0 || \
+	    spa_pod_parser_get(p, SPA_POD_Int(&(dict)->n_items), NULL) < 0) \
+		return -EINVAL; \
+	\
+	if ((dict)->n_items > 0) { \
+		(dict)->items = alloca((dict)->n_items * sizeof(struct spa_dict_item)); \
+		for (i = 0; i < (dict)->n_items; i++) { \
+			if (spa_pod_parser_get(p, \
+					SPA_POD_String(&(dict)->items[i].key), \
+					SPA_POD_String(&(dict)->items[i].value), \
+					NULL) < 0) \
+				return -EINVAL; \
+		} \
+	} \
+	spa_pod_parser_pop(p, f); \
+} while(0)
+
+static int registry_snapshot_proxy_marshal_add_listener(void *object,
+			struct spa_hook *listener,
+			const struct pw_registry_snapshot_events *events,
+			void *data)
+{
+	struct pw_proxy *proxy = object;
+	pw_proxy_add_object_listener(proxy, listener, events, data);
+	return 0;
+}
+
+static int registry_snapshot_demarshal_add_listener(void *object,
+			const struct pw_protocol_native_message *msg)
+{
+	return -ENOTSUP;
+}
+
+static void * registry_snapshot_proxy_marshal_bind(void *object, uint32_t id,
+			const char *type, uint32_t version, size_t user_data_size)
+{
+	struct pw_proxy *proxy = object;
+	struct spa_pod_builder *b;
+	struct pw_proxy *res;
+	uint32_t new_id;
+
+	res = pw_proxy_new(object, type, version, user_data_size);
+	if (res == NULL)
+		return NULL;
+
+	new_id = pw_proxy_get_id(res);
+
+	b = pw_protocol_native_begin_proxy(proxy, PW_REGISTRY_SNAPSHOT_METHOD_BIND, NULL);
+
+	spa_pod_builder_add_struct(b,
+			SPA_POD_Int(id),
+			SPA_POD_String(type),
+			SPA_POD_Int(version),
+			SPA_POD_Int(new_id));
+
+	pw_protocol_native_end_proxy(proxy, b);
+
+	return (void *) res;
+}
+
+static int registry_snapshot_resource_demarshal_bind(void *object,
+			const struct pw_protocol_native_message *msg)
+{
+	struct pw_resource *resource = object;
+	struct spa_pod_parser prs;
+	uint32_t id, version, new_id;
+	char *type;
+
+	spa_pod_parser_init(&prs, msg->data, msg->size);
+	if (spa_pod_parser_get_struct(&prs,
+			SPA_POD_Int(&id),
+			SPA_POD_String(&type),
+			SPA_POD_Int(&version),
+			SPA_POD_Int(&new_id)) < 0)
+		return -EINVAL;
+
+	return pw_resource_notify(resource, struct pw_registry_snapshot_methods,
+			bind, 0, id, type, version, new_id);
+}
+
+static void registry_snapshot_resource_marshal_snapshot(void *object,
+			uint32_t mem_id, uint32_t offset, uint32_t size)
+{
+	struct pw_resource *resource = object;
+	struct spa_pod_builder *b;
+
+	b = pw_protocol_native_begin_resource(resource, PW_REGISTRY_SNAPSHOT_EVENT_SNAPSHOT, NULL);
+
+	spa_pod_builder_add_struct(b,
+			SPA_POD_Int(mem_id),
+			SPA_POD_Int(offset),
+			SPA_POD_Int(size));
+
+	pw_protocol_native_end_resource(resource, b);
+}
+
+static int registry_snapshot_proxy_demarshal_snapshot(void *object,
+			const struct pw_protocol_native_message *msg)
+{
+	struct pw_proxy *proxy = object;
+	struct spa_pod_parser prs;
+	uint32_t mem_id, offset, size;
+
+	spa_pod_parser_init(&prs, msg->data, msg->size);
+	if (spa_pod_parser_get_struct(&prs,
+			SPA_POD_Int(&mem_id),
+			SPA_POD_Int(&offset),
+			SPA_POD_Int(&size)) < 0)
+		return -EINVAL;
+
+	return pw_proxy_notify(proxy, struct pw_registry_snapshot_events,
+			snapshot, 0, mem_id, offset, size);
+}
+
+static void registry_snapshot_resource_marshal_global(void *object, uint32_t id,
+			uint32_t permissions, const char *type, uint32_t version,
+			const struct spa_dict *props)
+{
+	struct pw_resource *resource = object;
+	struct spa_pod_builder *b;
+	struct spa_pod_frame f;
+
+	b = pw_protocol_native_begin_resource(resource, PW_REGISTRY_SNAPSHOT_EVENT_GLOBAL, NULL);
+
+	spa_pod_builder_push_struct(b, &f);
+	spa_pod_builder_add(b,
+			SPA_POD_Int(id),
+			SPA_POD_Int(permissions),
+			SPA_POD_String(type),
+			SPA_POD_Int(version),
+			NULL);
+	push_dict(b, props);
+	spa_pod_builder_pop(b, &f);
+
+	pw_protocol_native_end_resource(resource, b);
+}
+
+static int registry_snapshot_proxy_demarshal_global(void *object,
+			const struct pw_protocol_native_message *msg)
+{
+	struct pw_proxy *proxy = object;
+	struct spa_pod_parser prs;
+	struct spa_pod_frame f[2];
+	uint32_t id, permissions, version;
+	char *type;
+	struct spa_dict props = SPA_DICT_INIT(NULL, 0);
+
+	spa_pod_parser_init(&prs, msg->data, msg->size);
+	if (spa_pod_parser_push_struct(&prs, &f[0]) < 0 ||
+	    spa_pod_parser_get(&prs,
+			SPA_POD_Int(&id),
+			SPA_POD_Int(&permissions),
+			SPA_POD_String(&type),
+			SPA_POD_Int(&version), NULL) < 0)
+		return -EINVAL;
+
+	parse_dict(&prs, &f[1], &props);
+
+	return pw_proxy_notify(proxy, struct pw_registry_snapshot_events,
+			global, 0, id, permissions, type, version,
+			props.n_items > 0 ? &props : NULL);
+}
+
+static void registry_snapshot_resource_marshal_global_remove(void *object, uint32_t id)
+{
+	struct pw_resource *resource = object;
+	struct spa_pod_builder *b;
+
+	b = pw_protocol_native_begin_resource(resource, PW_REGISTRY_SNAPSHOT_EVENT_GLOBAL_REMOVE, NULL);
+
+	spa_pod_builder_add_struct(b, SPA_POD_Int(id));
+
+	pw_protocol_native_end_resource(resource, b);
+}
+
+static int registry_snapshot_proxy_demarshal_global_remove(void *object,
+			const struct pw_protocol_native_message *msg)
+{
+	struct pw_proxy *proxy = object;
+	struct spa_pod_parser prs;
+	uint32_t id;
+
+	spa_pod_parser_init(&prs, msg->data, msg->size);
+	if (spa_pod_parser_get_struct(&prs,
+			SPA_POD_Int(&id)) < 0)
+		return -EINVAL;
+
+	return pw_proxy_notify(proxy, struct pw_registry_snapshot_events,
+			global_remove, 0, id);
+}
+
+static const struct pw_registry_snapshot_methods pw_protocol_native_registry_snapshot_client_method_marshal = {
+	PW_VERSION_REGISTRY_SNAPSHOT_METHODS,
+	.add_listener = &registry_snapshot_proxy_marshal_add_listener,
+	.bind = &registry_snapshot_proxy_marshal_bind,
+};
+
+static const struct pw_protocol_native_demarshal
+pw_protocol_native_registry_snapshot_server_method_demarshal[PW_REGISTRY_SNAPSHOT_METHOD_NUM] =
+{
+	[PW_REGISTRY_SNAPSHOT_METHOD_ADD_LISTENER] = { &registry_snapshot_demarshal_add_listener, 0 },
+	[PW_REGISTRY_SNAPSHOT_METHOD_BIND] = { &registry_snapshot_resource_demarshal_bind, 0 },
+};
+
+static const struct pw_registry_snapshot_events pw_protocol_native_registry_snapshot_server_event_marshal = {
+	PW_VERSION_REGISTRY_SNAPSHOT_EVENTS,
+	.snapshot = &registry_snapshot_resource_marshal_snapshot,
+	.global = &registry_snapshot_resource_marshal_global,
+	.global_remove = &registry_snapshot_resource_marshal_global_remove,
+};
+
+static const struct pw_protocol_native_demarshal
+pw_protocol_native_registry_snapshot_client_event_demarshal[PW_REGISTRY_SNAPSHOT_EVENT_NUM] =
+{
+	[PW_REGISTRY_SNAPSHOT_EVENT_SNAPSHOT] = { &registry_snapshot_proxy_demarshal_snapshot, 0 },
+	[PW_REGISTRY_SNAPSHOT_EVENT_GLOBAL] = { &registry_snapshot_proxy_demarshal_global, 0 },
+	[PW_REGISTRY_SNAPSHOT_EVENT_GLOBAL_REMOVE] = { &registry_snapshot_proxy_demarshal_global_remove, 0 },
+};
+
+static const struct pw_protocol_marshal pw_protocol_native_registry_snapshot_marshal = {
+	PW_TYPE_INTERFACE_RegistrySnapshot,
+	PW_VERSION_REGISTRY_SNAPSHOT,
+	0,
+	PW_REGISTRY_SNAPSHOT_METHOD_NUM,
+	PW_REGISTRY_SNAPSHOT_EVENT_NUM,
+	.client_marshal = &pw_protocol_native_registry_snapshot_client_method_marshal,
+	.server_demarshal = pw_protocol_native_registry_snapshot_server_method_demarshal,
+	.server_marshal = &pw_protocol_native_registry_snapshot_server_event_marshal,
+	.client_demarshal = pw_protocol_native_registry_snapshot_client_event_demarshal,
+};
+
+int pw_protocol_native_ext_registry_snapshot_init(struct pw_context *context)
+{
+	struct pw_protocol *protocol;
+
+	protocol = pw_context_find_protocol(context, PW_TYPE_INFO_PROTOCOL_Native);
+	if (protocol == NULL)
+		return -EPROTO;
+
+	pw_protocol_add_marshal(protocol, &pw_protocol_native_registry_snapshot_marshal);
+	return 0;
+}
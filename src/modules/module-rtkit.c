@@ -43,6 +43,7 @@
 #include <spa/utils/result.h>
 
 #include <pipewire/impl.h>
+#include <pipewire/private.h>
 
 #define DEFAULT_NICE_LEVEL	-11
 #define DEFAULT_RT_PRIO		88
@@ -63,12 +64,22 @@ static const struct spa_dict_item module_props[] = {
 
 struct pw_rtkit_bus;
 
+struct impl;
+
+struct rt_source {
+	struct impl *impl;
+	struct spa_loop *loop;
+	struct spa_source source;
+};
+
 struct impl {
 	struct pw_context *context;
 
-	struct spa_loop *loop;
 	struct spa_system *system;
-	struct spa_source source;
+	struct rt_source sources[MAX_DATA_LOOPS];
+	uint32_t n_sources;
+	uint32_t n_pending;
+	pthread_mutex_t lock;
 	struct pw_properties *props;
 
 	struct pw_rtkit_bus *system_bus;
@@ -432,26 +443,39 @@ static int do_remove_source(struct spa_loop *loop,
 	return 0;
 }
 
+static void remove_sources(struct impl *impl)
+{
+	uint32_t i;
+
+	for (i = 0; i < impl->n_sources; i++) {
+		struct rt_source *s = &impl->sources[i];
+
+		if (s->source.fd < 0)
+			continue;
+		if (s->source.loop != NULL)
+			spa_loop_invoke(s->loop,
+					do_remove_source,
+					SPA_ID_INVALID,
+					NULL,
+					0,
+					true,
+					&s->source);
+		spa_system_close(impl->system, s->source.fd);
+		s->source.fd = -1;
+	}
+}
+
 static void module_destroy(void *data)
 {
 	struct impl *impl = data;
 
 	spa_hook_remove(&impl->module_listener);
 
-	if (impl->source.fd != -1) {
-		spa_loop_invoke(impl->loop,
-				do_remove_source,
-				SPA_ID_INVALID,
-				NULL,
-				0,
-				true,
-				&impl->source);
-		spa_system_close(impl->system, impl->source.fd);
-		impl->source.fd = -1;
-	}
+	remove_sources(impl);
 	pw_properties_free(impl->props);
 	if (impl->system_bus)
 		pw_rtkit_bus_free(impl->system_bus);
+	pthread_mutex_destroy(&impl->lock);
 	free(impl);
 }
 
@@ -462,14 +486,20 @@ static const struct pw_impl_module_events module_events = {
 
 static void idle_func(struct spa_source *source)
 {
-	struct impl *impl = source->data;
+	struct rt_source *s = source->data;
+	struct impl *impl = s->impl;
 	struct sched_param sp;
 	struct rlimit rl;
 	int r, rtprio;
 	long long rttime;
 	uint64_t count;
 
-	spa_system_eventfd_read(impl->system, impl->source.fd, &count);
+	spa_system_eventfd_read(impl->system, source->fd, &count);
+
+	/* every data loop thread calls this, serialize access to the bus */
+	pthread_mutex_lock(&impl->lock);
+	if (impl->system_bus == NULL)
+		goto done;
 
 	rtprio = pw_rtkit_get_max_realtime_priority(impl->system_bus);
 	if (rtprio >= 0)
@@ -508,8 +538,12 @@ static void idle_func(struct spa_source *source)
 		pw_log_info("processing thread made realtime prio:%d", rtprio);
 	}
 exit:
-	pw_rtkit_bus_free(impl->system_bus);
-	impl->system_bus = NULL;
+	if (--impl->n_pending == 0) {
+		pw_rtkit_bus_free(impl->system_bus);
+		impl->system_bus = NULL;
+	}
+done:
+	pthread_mutex_unlock(&impl->lock);
 }
 
 static int set_nice(struct impl *impl, int nice_level)
@@ -545,7 +579,7 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	struct spa_loop *loop;
 	struct spa_system *system;
 	const struct spa_support *support;
-	uint32_t n_support;
+	uint32_t i, n_support;
 	const struct pw_properties *props;
 	const char *str;
 	int res;
@@ -572,8 +606,8 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	pw_log_debug("module %p: new", impl);
 
 	impl->context = context;
-	impl->loop = loop;
 	impl->system = system;
+	pthread_mutex_init(&impl->lock, NULL);
 	impl->props = args ? pw_properties_new_string(args) : pw_properties_new(NULL, NULL);
 	if (impl->props == NULL) {
 		res = -errno;
@@ -594,18 +628,29 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	impl->rt_time_soft = get_default_int(impl->props, "rt.time.soft", DEFAULT_RT_TIME_SOFT);
 	impl->rt_time_hard = get_default_int(impl->props, "rt.time.hard", DEFAULT_RT_TIME_HARD);
 
-	impl->source.loop = loop;
-	impl->source.func = idle_func;
-	impl->source.data = impl;
-	impl->source.fd = spa_system_eventfd_create(system, SPA_FD_CLOEXEC | SPA_FD_NONBLOCK);
-	impl->source.mask = SPA_IO_IN;
-	if (impl->source.fd == -1) {
-		res = -errno;
-		goto error;
+	/* make all the data loop threads realtime */
+	for (i = 0; i < context->n_data_loops; i++) {
+		struct rt_source *s = &impl->sources[i];
+
+		s->impl = impl;
+		s->loop = pw_data_loop_get_loop(context->data_loops[i])->loop;
+		s->source.func = idle_func;
+		s->source.data = s;
+		s->source.fd = spa_system_eventfd_create(system, SPA_FD_CLOEXEC | SPA_FD_NONBLOCK);
+		s->source.mask = SPA_IO_IN;
+		impl->n_sources++;
+		if (s->source.fd < 0) {
+			res = s->source.fd;
+			goto error;
+		}
 	}
+	impl->n_pending = impl->n_sources;
 
-	spa_loop_add_source(impl->loop, &impl->source);
-	spa_system_eventfd_write(system, impl->source.fd, 1);
+	for (i = 0; i < impl->n_sources; i++) {
+		struct rt_source *s = &impl->sources[i];
+		spa_loop_add_source(s->loop, &s->source);
+		spa_system_eventfd_write(system, s->source.fd, 1);
+	}
 
 	pw_impl_module_add_listener(module, &impl->module_listener, &module_events, impl);
 
@@ -615,10 +660,12 @@ int pipewire__module_init(struct pw_impl_module *module, const char *args)
 	return 0;
 
 error:
+	remove_sources(impl);
 	if (impl->props)
 		pw_properties_free(impl->props);
 	if (impl->system_bus)
 		pw_rtkit_bus_free(impl->system_bus);
+	pthread_mutex_destroy(&impl->lock);
 	free(impl);
 	return res;
 }
@@ -37,6 +37,8 @@
 #include <spa/pod/iter.h>
 #include <spa/debug/types.h>
 
+#include "pipewire/private.h"
+
 #include "spa-node.h"
 
 struct impl {
@@ -245,6 +247,9 @@ struct pw_impl_node *pw_spa_node_load(struct pw_context *context,
 	struct spa_handle *handle;
 	void *iface;
 
+	if (properties != NULL)
+		pw_context_assign_loop(context, properties);
+
 	handle = pw_context_load_spa_handle(context,
 			factory_name,
 			properties ? &properties->dict : NULL);
@@ -61,6 +61,7 @@
 #define DEFAULT_LINK_MAX_BUFFERS		64u
 #define DEFAULT_MEM_WARN_MLOCK			false
 #define DEFAULT_MEM_ALLOW_MLOCK			true
+#define DEFAULT_DATA_LOOPS			1u
 
 /** \cond */
 struct impl {
@@ -68,6 +69,15 @@ struct impl {
 	struct spa_handle *dbus_handle;
 	unsigned int recalc:1;
 	unsigned int recalc_pending:1;
+
+	struct pw_impl_node *target;	/* driver of the unassigned nodes */
+
+#define RECALC_HIST_SIZE	16
+	struct {
+		uint64_t n_full;
+		uint64_t n_incremental;
+		uint64_t hist[RECALC_HIST_SIZE];
+	} stats;
 };
 
 
@@ -152,6 +162,7 @@ static void fill_defaults(struct pw_context *this)
 	this->defaults.link_max_buffers = get_default_int(p, "link.max-buffers", DEFAULT_LINK_MAX_BUFFERS);
 	this->defaults.mem_warn_mlock = get_default_bool(p, "mem.warn-mlock", DEFAULT_MEM_WARN_MLOCK);
 	this->defaults.mem_allow_mlock = get_default_bool(p, "mem.allow-mlock", DEFAULT_MEM_ALLOW_MLOCK);
+	this->defaults.data_loops = get_default_int(p, "context.data-loops", DEFAULT_DATA_LOOPS);
 
 	this->defaults.clock_max_quantum = SPA_CLAMP(this->defaults.clock_max_quantum,
 			CLOCK_MIN_QUANTUM, CLOCK_MAX_QUANTUM);
@@ -159,6 +170,7 @@ static void fill_defaults(struct pw_context *this)
 			CLOCK_MIN_QUANTUM, this->defaults.clock_max_quantum);
 	this->defaults.clock_quantum = SPA_CLAMP(this->defaults.clock_quantum,
 			this->defaults.clock_min_quantum, this->defaults.clock_max_quantum);
+	this->defaults.data_loops = SPA_CLAMP(this->defaults.data_loops, 1u, MAX_DATA_LOOPS);
 }
 
 /** Create a new context object
@@ -181,6 +193,7 @@ struct pw_context *pw_context_new(struct pw_loop *main_loop,
 	uint32_t n_support;
 	struct pw_properties *pr, *conf = NULL;
 	struct spa_cpu *cpu;
+	uint32_t i;
 	int res = 0;
 
 	impl = calloc(1, sizeof(struct impl) + user_data_size);
@@ -265,13 +278,29 @@ struct pw_context *pw_context_new(struct pw_loop *main_loop,
 		pw_properties_set(pr, PW_KEY_LIBRARY_NAME_SYSTEM, str);
 
 	this->data_loop_impl = pw_data_loop_new(&pr->dict);
-	pw_properties_free(pr);
 	if (this->data_loop_impl == NULL)  {
 		res = -errno;
+		pw_properties_free(pr);
 		goto error_free;
 	}
+	this->data_loops[this->n_data_loops++] = this->data_loop_impl;
+
+	while (this->n_data_loops < this->defaults.data_loops) {
+		struct pw_data_loop *l = pw_data_loop_new(&pr->dict);
+		if (l == NULL)  {
+			res = -errno;
+			pw_properties_free(pr);
+			goto error_free_loop;
+		}
+		this->data_loops[this->n_data_loops++] = l;
+	}
+	pw_properties_free(pr);
+	pw_log_info(NAME" %p: using %u data loops", this, this->n_data_loops);
 
-	this->pool = pw_mempool_new(NULL);
+	this->pool = pw_mempool_new(pw_properties_new(
+				"mem.recycle", pw_properties_get(properties, "mem.recycle"),
+				"mem.hugepages", pw_properties_get(properties, "mem.hugepages"),
+				NULL));
 	if (this->pool == NULL) {
 		res = -errno;
 		goto error_free_loop;
@@ -342,8 +371,10 @@ struct pw_context *pw_context_new(struct pw_loop *main_loop,
 
 	fill_properties(this);
 
-	if ((res = pw_data_loop_start(this->data_loop_impl)) < 0)
-		goto error_free_loop;
+	for (i = 0; i < this->n_data_loops; i++) {
+		if ((res = pw_data_loop_start(this->data_loops[i])) < 0)
+			goto error_free_loop;
+	}
 
 	this->sc_pagesize = sysconf(_SC_PAGESIZE);
 
@@ -361,7 +392,8 @@ struct pw_context *pw_context_new(struct pw_loop *main_loop,
 	return this;
 
 error_free_loop:
-	pw_data_loop_destroy(this->data_loop_impl);
+	for (i = 0; i < this->n_data_loops; i++)
+		pw_data_loop_destroy(this->data_loops[i]);
 error_free:
 	free(this);
 error_cleanup:
@@ -392,10 +424,19 @@ void pw_context_destroy(struct pw_context *context)
 	struct pw_impl_node *node;
 	struct factory_entry *entry;
 	struct pw_impl_core *core_impl;
+	uint32_t i;
 
 	pw_log_debug(NAME" %p: destroy", context);
 	pw_context_emit_destroy(context);
 
+	pw_log_debug(NAME" %p: graph recalcs full:%"PRIu64" incremental:%"PRIu64,
+			context, impl->stats.n_full, impl->stats.n_incremental);
+	for (i = 0; i < RECALC_HIST_SIZE; i++) {
+		if (impl->stats.hist[i] > 0)
+			pw_log_debug(NAME" %p: recalc < %uus: %"PRIu64,
+					context, 1u << i, impl->stats.hist[i]);
+	}
+
 	spa_list_consume(core, &context->core_list, link)
 		pw_core_disconnect(core);
 
@@ -425,7 +466,8 @@ void pw_context_destroy(struct pw_context *context)
 
 	pw_mempool_destroy(context->pool);
 
-	pw_data_loop_destroy(context->data_loop_impl);
+	for (i = 0; i < context->n_data_loops; i++)
+		pw_data_loop_destroy(context->data_loops[i]);
 
 	pw_properties_free(context->properties);
 	pw_properties_free(context->conf);
@@ -925,37 +967,14 @@ static int collect_nodes(struct pw_context *context, struct pw_impl_node *driver
 	return 0;
 }
 
-int pw_context_recalc_graph(struct pw_context *context, const char *reason)
+/* find the driver that unassigned nodes are scheduled with: the first
+ * active driver with active followers or else the first active driver */
+static struct pw_impl_node *find_target(struct pw_context *context)
 {
-	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
-	struct pw_impl_node *n, *s, *target, *fallback;
+	struct pw_impl_node *n, *s, *fallback = NULL;
 
-	pw_log_info(NAME" %p: busy:%d reason:%s", context, impl->recalc, reason);
-
-	if (impl->recalc) {
-		impl->recalc_pending = true;
-		return -EBUSY;
-	}
-
-again:
-	impl->recalc = true;
-
-	/* start from all drivers and group all nodes that are linked
-	 * to it. Some nodes are not (yet) linked to anything and they
-	 * will end up 'unassigned' to a driver. Other nodes are drivers
-	 * and if they have active followers, we can use them to schedule
-	 * the unassigned nodes. */
-	target = fallback = NULL;
 	spa_list_for_each(n, &context->driver_list, driver_link) {
-		if (n->exported)
-			continue;
-
-		if (!n->visited)
-			collect_nodes(context, n);
-
-		/* from now on we are only interested in active driving nodes.
-		 * We're going to see if there are active followers. */
-		if (!n->driving || !n->active)
+		if (n->exported || !n->driving || !n->active)
 			continue;
 
 		/* first active driving node is fallback */
@@ -971,15 +990,102 @@ again:
 			if (s != n && s->active) {
 				/* if the driving node has active followers, it
 				 * is a target for our unassigned nodes */
-				if (target == NULL)
-					target = n;
-				break;
+				return n;
 			}
 		}
 	}
 	/* no active node, use fallback driving node */
-	if (target == NULL)
-		target = fallback;
+	return fallback;
+}
+
+/* assign a node that was not collected to the target driver or
+ * leave it alone. Returns true when the node was added to target */
+static bool assign_node(struct pw_context *context, struct pw_impl_node *n,
+		struct pw_impl_node *target)
+{
+	struct pw_impl_node *t;
+
+	pw_log_debug(NAME" %p: unassigned node %p: '%s' active:%d want_driver:%d target:%p",
+			context, n, n->name, n->active, n->want_driver, target);
+
+	t = (n->active && n->want_driver) ? target : NULL;
+
+	pw_impl_node_set_driver(n, t);
+	if (t == NULL)
+		ensure_state(n, false);
+	else
+		t->passive = false;
+
+	return t != NULL;
+}
+
+/* assign final quantum and set state for the followers of a driver */
+static void update_driver(struct pw_context *context, struct pw_impl_node *n)
+{
+	struct pw_impl_node *s;
+	bool running = false;
+	uint32_t max_quantum = context->defaults.clock_max_quantum;
+	uint32_t quantum = 0;
+
+	/* collect quantum and count active nodes */
+	spa_list_for_each(s, &n->follower_list, follower_link) {
+
+		if (s->quantum_size > 0) {
+			if (quantum == 0 || s->quantum_size < quantum)
+				quantum = s->quantum_size;
+		}
+		if (s->max_quantum_size > 0) {
+			if (s->max_quantum_size < max_quantum)
+				max_quantum = s->max_quantum_size;
+		}
+		if (s->active)
+			running = !n->passive;
+	}
+	if (quantum == 0)
+		quantum = context->defaults.clock_quantum;
+
+	quantum = SPA_CLAMP(quantum,
+			context->defaults.clock_min_quantum,
+			max_quantum);
+
+	if (n->rt.position && quantum != n->rt.position->clock.duration) {
+		pw_log_info("(%s-%u) new quantum:%"PRIu64"->%u",
+				n->name, n->info.id,
+				n->rt.position->clock.duration,
+				quantum);
+		n->rt.position->clock.duration = quantum;
+	}
+
+	pw_log_debug(NAME" %p: driving %p running:%d passive:%d quantum:%u '%s'",
+			context, n, running, n->passive, quantum, n->name);
+
+	spa_list_for_each(s, &n->follower_list, follower_link) {
+		if (s == n)
+			continue;
+		pw_log_debug(NAME" %p: follower %p: active:%d '%s'",
+				context, s, s->active, s->name);
+		ensure_state(s, running);
+	}
+	ensure_state(n, running);
+}
+
+static void recalc_full(struct pw_context *context)
+{
+	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
+	struct pw_impl_node *n;
+
+	/* start from all drivers and group all nodes that are linked
+	 * to it. Some nodes are not (yet) linked to anything and they
+	 * will end up 'unassigned' to a driver. Other nodes are drivers
+	 * and if they have active followers, we can use them to schedule
+	 * the unassigned nodes. */
+	spa_list_for_each(n, &context->driver_list, driver_link) {
+		if (n->exported)
+			continue;
+		if (!n->visited)
+			collect_nodes(context, n);
+	}
+	impl->target = find_target(context);
 
 	/* now go through all available nodes. The ones we didn't visit
 	 * in collect_nodes() are not linked to any driver. We assign them
@@ -987,83 +1093,287 @@ again:
 	spa_list_for_each(n, &context->node_list, link) {
 		if (n->exported)
 			continue;
+		if (!n->visited)
+			assign_node(context, n, impl->target);
+		n->visited = false;
+	}
 
-		if (!n->visited) {
-			struct pw_impl_node *t;
+	spa_list_for_each(n, &context->driver_list, driver_link) {
+		if (!n->driving || n->exported)
+			continue;
+		update_driver(context, n);
+	}
+}
 
-			pw_log_debug(NAME" %p: unassigned node %p: '%s' active:%d want_driver:%d target:%p",
-					context, n, n->name, n->active, n->want_driver, target);
+/* Add the component of a node to the set. The driver of a node is the
+ * representative of its component and all members are in the follower
+ * list of the driver, so this works like the find operation of a
+ * union-find structure with full path compression. */
+static void recalc_add_component(struct spa_list *set, struct pw_impl_node *n)
+{
+	struct pw_impl_node *f;
 
-			t = (n->active && n->want_driver) ? target : NULL;
+	spa_list_for_each(f, &n->driver_node->follower_list, follower_link) {
+		if (f->recalc_mark)
+			continue;
+		f->recalc_mark = true;
+		spa_list_append(set, &f->recalc_link);
+	}
+	/* a driver that follows another driver can still have followers */
+	if (n->driver && n->driver_node != n) {
+		spa_list_for_each(f, &n->follower_list, follower_link) {
+			if (f->recalc_mark)
+				continue;
+			f->recalc_mark = true;
+			spa_list_append(set, &f->recalc_link);
+		}
+	}
+}
 
-			pw_impl_node_set_driver(n, t);
-			if (t == NULL)
-				ensure_state(n, false);
-			else
-				t->passive = false;
+/* add the components of all the active nodes a node is linked or
+ * grouped with, they can be merged with the component of the node */
+static void recalc_add_peers(struct pw_context *context, struct spa_list *set,
+		struct pw_impl_node *n)
+{
+	struct pw_impl_port *p;
+	struct pw_impl_link *l;
+	struct pw_impl_node *t;
+
+	spa_list_for_each(p, &n->input_ports, link) {
+		spa_list_for_each(l, &p->links, input_link) {
+			t = l->output->node;
+			if (t->active && !t->recalc_mark)
+				recalc_add_component(set, t);
+		}
+	}
+	spa_list_for_each(p, &n->output_ports, link) {
+		spa_list_for_each(l, &p->links, output_link) {
+			t = l->input->node;
+			if (t->active && !t->recalc_mark)
+				recalc_add_component(set, t);
 		}
-		n->visited = false;
 	}
+	if (n->group_id == SPA_ID_INVALID)
+		return;
 
-	/* assign final quantum and set state for followers and drivers */
+	spa_list_for_each(t, &context->node_list, link) {
+		if (t->group_id == n->group_id && t->active && !t->recalc_mark)
+			recalc_add_component(set, t);
+	}
+}
+
+/* Only recalculate the components of the changed nodes and the components
+ * they can be merged with. The other components are left alone. Returns
+ * false when the change has an effect on the whole graph. */
+static bool recalc_nodes(struct pw_context *context, struct pw_impl_node *seeds[],
+		uint32_t n_seeds, uint32_t *n_nodes)
+{
+	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
+	struct pw_impl_node *n, *target = impl->target;
+	struct spa_list set;
+	bool extra = false;
+	uint32_t i;
+
+	spa_list_init(&set);
+	for (i = 0; i < n_seeds; i++) {
+		if (seeds[i] == NULL)
+			continue;
+		/* a node that is being destroyed is no longer in the
+		 * component of its driver and will not be added */
+		recalc_add_component(&set, seeds[i]);
+		recalc_add_peers(context, &set, seeds[i]);
+	}
+	spa_list_for_each(n, &set, recalc_link)
+		recalc_add_peers(context, &set, n);
+
+	*n_nodes = 0;
 	spa_list_for_each(n, &context->driver_list, driver_link) {
-		bool running = false;
-		uint32_t max_quantum = context->defaults.clock_max_quantum;
-		uint32_t quantum = 0;
+		if (n->exported || !n->recalc_mark)
+			continue;
+		if (!n->visited)
+			collect_nodes(context, n);
+	}
+
+	/* when the target for unassigned nodes changes, all unassigned nodes
+	 * need to move and we do a full recalc */
+	if (target != find_target(context)) {
+		spa_list_for_each(n, &set, recalc_link)
+			n->recalc_mark = false;
+		return false;
+	}
+
+	spa_list_for_each(n, &set, recalc_link) {
+		(*n_nodes)++;
+		if (n->exported)
+			continue;
+		if (!n->visited && assign_node(context, n, target) &&
+		    !target->recalc_mark)
+			extra = true;
+		n->visited = false;
+	}
 
+	spa_list_for_each(n, &context->driver_list, driver_link) {
 		if (!n->driving || n->exported)
 			continue;
+		if (n->recalc_mark || (extra && n == target))
+			update_driver(context, n);
+	}
 
-		/* collect quantum and count active nodes */
-		spa_list_for_each(s, &n->follower_list, follower_link) {
+	spa_list_for_each(n, &set, recalc_link)
+		n->recalc_mark = false;
+	return true;
+}
 
-			if (s->quantum_size > 0) {
-				if (quantum == 0 || s->quantum_size < quantum)
-					quantum = s->quantum_size;
-			}
-			if (s->max_quantum_size > 0) {
-				if (s->max_quantum_size < max_quantum)
-					max_quantum = s->max_quantum_size;
-			}
-			if (s->active)
-				running = !n->passive;
-		}
-		if (quantum == 0)
-			quantum = context->defaults.clock_quantum;
-
-		quantum = SPA_CLAMP(quantum,
-				context->defaults.clock_min_quantum,
-				max_quantum);
-
-		if (n->rt.position && quantum != n->rt.position->clock.duration) {
-			pw_log_info("(%s-%u) new quantum:%"PRIu64"->%u",
-					n->name, n->info.id,
-					n->rt.position->clock.duration,
-					quantum);
-			n->rt.position->clock.duration = quantum;
-		}
+static void recalc_stats(struct pw_context *context, const char *reason,
+		bool incremental, uint32_t n_nodes, uint64_t start)
+{
+	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
+	struct timespec ts;
+	uint64_t elapsed;
+	uint32_t bucket;
 
-		pw_log_debug(NAME" %p: driving %p running:%d passive:%d quantum:%u '%s'",
-				context, n, running, n->passive, quantum, n->name);
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	elapsed = (SPA_TIMESPEC_TO_NSEC(&ts) - start) / SPA_NSEC_PER_USEC;
 
-		spa_list_for_each(s, &n->follower_list, follower_link) {
-			if (s == n)
-				continue;
-			pw_log_debug(NAME" %p: follower %p: active:%d '%s'",
-					context, s, s->active, s->name);
-			ensure_state(s, running);
-		}
-		ensure_state(n, running);
+	if (incremental)
+		impl->stats.n_incremental++;
+	else
+		impl->stats.n_full++;
+
+	/* power of 2 buckets of microseconds */
+	bucket = elapsed ? SPA_MIN(64 - __builtin_clzll(elapsed), RECALC_HIST_SIZE - 1) : 0;
+	impl->stats.hist[bucket]++;
+
+	pw_log_debug(NAME" %p: %s recalc '%s' nodes:%u took %"PRIu64"us full:%"PRIu64
+			" incremental:%"PRIu64, context, incremental ? "incremental" : "full",
+			reason, n_nodes, elapsed, impl->stats.n_full, impl->stats.n_incremental);
+}
+
+static int do_recalc(struct pw_context *context, const char *reason,
+		struct pw_impl_node *seeds[], uint32_t n_seeds)
+{
+	struct impl *impl = SPA_CONTAINER_OF(context, struct impl, this);
+	struct timespec ts;
+	bool incremental;
+	uint32_t n_nodes;
+
+	pw_log_info(NAME" %p: busy:%d reason:%s", context, impl->recalc, reason);
+
+	if (impl->recalc) {
+		impl->recalc_pending = true;
+		return -EBUSY;
+	}
+
+again:
+	impl->recalc = true;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	incremental = n_seeds > 0 && recalc_nodes(context, seeds, n_seeds, &n_nodes);
+	if (!incremental) {
+		recalc_full(context);
+		n_nodes = 0;
 	}
+	recalc_stats(context, reason, incremental, n_nodes, SPA_TIMESPEC_TO_NSEC(&ts));
+
 	impl->recalc = false;
 	if (impl->recalc_pending) {
 		impl->recalc_pending = false;
+		/* we don't know what changed, recalc everything */
+		n_seeds = 0;
 		goto again;
 	}
 
 	return 0;
 }
 
+int pw_context_recalc_graph(struct pw_context *context, const char *reason)
+{
+	return do_recalc(context, reason, NULL, 0);
+}
+
+/* Recalculate after a change to node and peer, peer can be NULL. */
+int pw_context_recalc_nodes(struct pw_context *context, struct pw_impl_node *node,
+		struct pw_impl_node *peer, const char *reason)
+{
+	struct pw_impl_node *seeds[2] = { node, peer };
+	return do_recalc(context, reason, seeds, 2);
+}
+
+static uint32_t get_loop_index(struct pw_context *context, const struct spa_dict *props)
+{
+	const char *str;
+	uint32_t index;
+
+	if (props == NULL ||
+	    (str = spa_dict_lookup(props, PW_KEY_NODE_DATA_LOOP)) == NULL)
+		return 0;
+
+	index = pw_properties_parse_int(str);
+	if (index >= context->n_data_loops) {
+		pw_log_warn(NAME" %p: invalid data loop %s", context, str);
+		return 0;
+	}
+	return index;
+}
+
+/* Pick the data loop where a new node is going to be processed and store
+ * it in the node.data-loop property. This needs to be done before the spa
+ * handle of the node is loaded, the plugin gets the loop as its DataLoop
+ * and expects its sources and invokes to run in the same thread as its
+ * process function. Nodes are spread over the extra data loops so that
+ * independent followers of one driver can run concurrently. Nodes without
+ * the property stay on the main data loop. */
+SPA_EXPORT
+int pw_context_assign_loop(struct pw_context *context, struct pw_properties *props)
+{
+	uint32_t i, n, index, best = 0;
+
+	if (context->n_data_loops < 2 ||
+	    pw_properties_get(props, PW_KEY_NODE_DATA_LOOP) != NULL)
+		return 0;
+
+	n = context->n_data_loops - 1;
+	for (i = 0; i < n; i++) {
+		index = 1 + (context->next_data_loop + i) % n;
+		if (best == 0 ||
+		    context->data_loop_nodes[index] < context->data_loop_nodes[best])
+			best = index;
+	}
+	context->next_data_loop = best % n;
+
+	return pw_properties_setf(props, PW_KEY_NODE_DATA_LOOP, "%u", best);
+}
+
+/* Get the data loop where a node is processed when it starts. Remote and
+ * exported nodes are processed by the protocol on the main data loop. */
+struct pw_loop *pw_context_acquire_loop(struct pw_context *context, struct pw_impl_node *node)
+{
+	uint32_t index = 0;
+
+	if (!node->remote && !node->exported)
+		index = get_loop_index(context, &node->properties->dict);
+
+	context->data_loop_nodes[index]++;
+
+	pw_log_debug(NAME" %p: node %p uses data loop %u (%u nodes)", context, node,
+			index, context->data_loop_nodes[index]);
+
+	return pw_data_loop_get_loop(context->data_loops[index]);
+}
+
+void pw_context_release_loop(struct pw_context *context, struct pw_loop *loop)
+{
+	uint32_t i;
+
+	for (i = 0; i < context->n_data_loops; i++) {
+		if (pw_data_loop_get_loop(context->data_loops[i]) == loop) {
+			context->data_loop_nodes[i]--;
+			break;
+		}
+	}
+}
+
 SPA_EXPORT
 int pw_context_add_spa_lib(struct pw_context *context,
 		const char *factory_regexp, const char *lib)
@@ -1108,7 +1418,8 @@ struct spa_handle *pw_context_load_spa_handle(struct pw_context *context,
 {
 	const char *lib;
 	const struct spa_support *support;
-	uint32_t n_support;
+	struct spa_support data_support[SPA_N_ELEMENTS(context->support)];
+	uint32_t i, n_support, index;
 	struct spa_handle *handle;
 
 	pw_log_debug(NAME" %p: load factory %s", context, factory_name);
@@ -1125,6 +1436,17 @@ struct spa_handle *pw_context_load_spa_handle(struct pw_context *context,
 
 	support = pw_context_get_support(context, &n_support);
 
+	if ((index = get_loop_index(context, info)) > 0) {
+		/* the node is processed in another data loop */
+		memcpy(data_support, support, n_support * sizeof(struct spa_support));
+		for (i = 0; i < n_support; i++) {
+			if (strcmp(data_support[i].type, SPA_TYPE_INTERFACE_DataLoop) == 0)
+				data_support[i].data = pw_data_loop_get_loop(
+						context->data_loops[index])->loop;
+		}
+		support = data_support;
+	}
+
 	handle = pw_load_spa_handle(lib, factory_name,
 			info, n_support, support);
 
@@ -126,11 +126,13 @@ static void link_update_state(struct pw_impl_link *link, enum pw_link_state stat
 	if (old < PW_LINK_STATE_PAUSED && state == PW_LINK_STATE_PAUSED) {
 		link->prepared = true;
 		link->preparing = false;
-		pw_context_recalc_graph(link->context, "link prepared");
+		pw_context_recalc_nodes(link->context, link->output->node,
+				link->input->node, "link prepared");
 	} else if (old == PW_LINK_STATE_PAUSED && state < PW_LINK_STATE_PAUSED) {
 		link->prepared = false;
 		link->preparing = false;
-		pw_context_recalc_graph(link->context, "link unprepared");
+		pw_context_recalc_nodes(link->context, link->output->node,
+				link->input->node, "link unprepared");
 	}
 }
 
@@ -500,39 +502,58 @@ error:
 	return res;
 }
 
+/* called from the loop of the node of the port of the mix */
+static int
+do_add_mix(struct spa_loop *loop,
+		 bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct pw_impl_port_mix *mix = user_data;
+
+	pw_log_trace(NAME" %p: add mix %p", mix->p, mix);
+	spa_list_append(&mix->p->rt.mix_list, &mix->rt_link);
+	return 0;
+}
+
+static int
+do_remove_mix(struct spa_loop *loop,
+		 bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct pw_impl_port_mix *mix = user_data;
+
+	pw_log_trace(NAME" %p: remove mix %p", mix->p, mix);
+	spa_list_remove(&mix->rt_link);
+	return 0;
+}
+
+/* called from the loop of the node that triggers the other node */
 static int
 do_activate_link(struct spa_loop *loop,
 		 bool async, uint32_t seq, const void *data, size_t size, void *user_data)
 {
 	struct pw_impl_link *this = user_data;
 	struct impl *impl = SPA_CONTAINER_OF(this, struct impl, this);
+	struct pw_node_activation_state *state;
 
 	pw_log_trace(NAME" %p: activate", this);
 
-	spa_list_append(&this->output->rt.mix_list, &this->rt.out_mix.rt_link);
-	spa_list_append(&this->input->rt.mix_list, &this->rt.in_mix.rt_link);
-
-	if (impl->inode != impl->onode) {
-		struct pw_node_activation_state *state;
-
-		this->rt.target.activation = impl->inode->rt.activation;
-		spa_list_append(&impl->onode->rt.target_list, &this->rt.target.link);
-
-		state = &this->rt.target.activation->state[0];
-		if (!this->rt.target.active && impl->onode->rt.driver_target.node != NULL) {
-			state->required++;
-			this->rt.target.active = true;
-		}
+	this->rt.target.activation = impl->inode->rt.activation;
+	spa_list_append(&impl->onode->rt.target_list, &this->rt.target.link);
 
-		pw_log_trace(NAME" %p: node:%p state:%p pending:%d/%d", this, impl->inode,
-				state, state->pending, state->required);
+	state = &this->rt.target.activation->state[0];
+	if (!this->rt.target.active && impl->onode->rt.driver_target.node != NULL) {
+		ATOMIC_INC(state->required);
+		this->rt.target.active = true;
 	}
+
+	pw_log_trace(NAME" %p: node:%p state:%p pending:%d/%d", this, impl->inode,
+			state, state->pending, state->required);
 	return 0;
 }
 
 int pw_impl_link_activate(struct pw_impl_link *this)
 {
 	struct impl *impl = SPA_CONTAINER_OF(this, struct impl, this);
+	struct pw_loop *loop, *in_loop, *out_loop;
 	int res;
 
 	pw_log_debug(NAME" %p: activate activated:%d state:%s", this, impl->activated,
@@ -551,8 +572,19 @@ int pw_impl_link_activate(struct pw_impl_link *this)
 			return res;
 		impl->io_set = true;
 	}
-	pw_loop_invoke(this->output->node->data_loop,
-	       do_activate_link, SPA_ID_INVALID, NULL, 0, false, this);
+	/* the ports are changed in the loop of their node. They must be ready
+	 * before the nodes are linked, wait for them when that is done in
+	 * another loop. */
+	loop = pw_impl_node_rt_loop(impl->onode);
+	in_loop = pw_impl_node_rt_loop(this->input->node);
+	out_loop = pw_impl_node_rt_loop(this->output->node);
+
+	pw_loop_invoke(in_loop, do_add_mix, SPA_ID_INVALID, NULL, 0,
+			in_loop != loop, &this->rt.in_mix);
+	pw_loop_invoke(out_loop, do_add_mix, SPA_ID_INVALID, NULL, 0,
+			out_loop != loop, &this->rt.out_mix);
+	if (impl->inode != impl->onode)
+		pw_loop_invoke(loop, do_activate_link, SPA_ID_INVALID, NULL, 0, false, this);
 
 	impl->activated = true;
 	pw_log_info("(%s) activated", this->name);
@@ -679,32 +711,26 @@ int pw_impl_link_prepare(struct pw_impl_link *this)
 	return 0;
 }
 
+/* called from the loop of the node that triggers the other node */
 static int
 do_deactivate_link(struct spa_loop *loop,
 		   bool async, uint32_t seq, const void *data, size_t size, void *user_data)
 {
         struct pw_impl_link *this = user_data;
 	struct impl *impl = SPA_CONTAINER_OF(this, struct impl, this);
+	struct pw_node_activation_state *state;
 
-	pw_log_trace(NAME" %p: disable %p and %p", this, &this->rt.in_mix, &this->rt.out_mix);
-
-	spa_list_remove(&this->rt.out_mix.rt_link);
-	spa_list_remove(&this->rt.in_mix.rt_link);
-
-	if (this->input->node != this->output->node) {
-		struct pw_node_activation_state *state;
-
-		spa_list_remove(&this->rt.target.link);
-		state = &this->rt.target.activation->state[0];
-		if (this->rt.target.active) {
-			state->required--;
-			this->rt.target.active = false;
-		}
+	pw_log_trace(NAME" %p: deactivate", this);
 
-		pw_log_trace(NAME" %p: node:%p state:%p pending:%d/%d", this, impl->inode,
-				state, state->pending, state->required);
+	spa_list_remove(&this->rt.target.link);
+	state = &this->rt.target.activation->state[0];
+	if (this->rt.target.active) {
+		ATOMIC_DEC(state->required);
+		this->rt.target.active = false;
 	}
 
+	pw_log_trace(NAME" %p: node:%p state:%p pending:%d/%d", this, impl->inode,
+			state, state->pending, state->required);
 	return 0;
 }
 
@@ -717,8 +743,14 @@ int pw_impl_link_deactivate(struct pw_impl_link *this)
 	if (!impl->activated)
 		return 0;
 
-	pw_loop_invoke(this->output->node->data_loop,
+	/* first stop triggering the node, then remove the ports */
+	if (impl->inode != impl->onode)
+		pw_loop_invoke(pw_impl_node_rt_loop(impl->onode),
 		       do_deactivate_link, SPA_ID_INVALID, NULL, 0, true, this);
+	pw_loop_invoke(pw_impl_node_rt_loop(this->output->node),
+		       do_remove_mix, SPA_ID_INVALID, NULL, 0, true, &this->rt.out_mix);
+	pw_loop_invoke(pw_impl_node_rt_loop(this->input->node),
+		       do_remove_mix, SPA_ID_INVALID, NULL, 0, true, &this->rt.in_mix);
 
 	port_set_io(this, this->output, SPA_IO_Buffers, NULL, 0,
 			&this->rt.out_mix);
@@ -1116,6 +1148,8 @@ struct pw_impl_link *pw_context_create_link(struct pw_context *context,
 
 	pw_impl_port_init_mix(output, &this->rt.out_mix);
 	pw_impl_port_init_mix(input, &this->rt.in_mix);
+	this->rt.out_mix.peer = &this->rt.in_mix;
+	this->rt.in_mix.peer = &this->rt.out_mix;
 
 	if ((res = select_io(this)) < 0)
 		goto error_no_io;
@@ -1287,7 +1321,8 @@ void pw_impl_link_destroy(struct pw_impl_link *link)
 	}
 
 	if (link->prepared)
-		pw_context_recalc_graph(link->context, "link destroy");
+		pw_context_recalc_nodes(link->context, impl->onode, impl->inode,
+				"link destroy");
 
 	pw_log_debug(NAME" %p: free", impl);
 	pw_impl_link_emit_free(link);
@@ -98,9 +98,12 @@ static void node_deactivate(struct pw_impl_node *this)
 	}
 }
 
+/* Adding a node to a driver touches the target list of the node and the one
+ * of the driver. Both are changed in the loop that processes them, the node
+ * first so that it is ready when the driver starts to trigger it. */
 static void add_node(struct pw_impl_node *this, struct pw_impl_node *driver)
 {
-	struct pw_node_activation_state *dstate, *nstate;
+	struct pw_node_activation_state *dstate;
 	struct pw_node_target *t;
 
 	if (this->exported)
@@ -115,28 +118,20 @@ static void add_node(struct pw_impl_node *this, struct pw_impl_node *driver)
 	this->rt.driver_target.data = driver;
 	spa_list_append(&this->rt.target_list, &this->rt.driver_target.link);
 
-	spa_list_append(&driver->rt.target_list, &this->rt.target.link);
-	nstate = &this->rt.activation->state[0];
-	if (!this->rt.target.active) {
-		nstate->required++;
-		this->rt.target.active = true;
-	}
-
 	spa_list_for_each(t, &this->rt.target_list, link) {
 		dstate = &t->activation->state[0];
 		if (!t->active) {
-			dstate->required++;
+			ATOMIC_INC(dstate->required);
 			t->active = true;
 		}
-		pw_log_trace(NAME" %p: driver state:%p pending:%d/%d, node state:%p pending:%d/%d",
-				this, dstate, dstate->pending, dstate->required,
-				nstate, nstate->pending, nstate->required);
+		pw_log_trace(NAME" %p: driver state:%p pending:%d/%d", this,
+				dstate, dstate->pending, dstate->required);
 	}
 }
 
 static void remove_node(struct pw_impl_node *this)
 {
-	struct pw_node_activation_state *dstate, *nstate;
+	struct pw_node_activation_state *dstate;
 	struct pw_node_target *t;
 
 	if (this->exported)
@@ -146,29 +141,61 @@ static void remove_node(struct pw_impl_node *this)
 			this, this->rt.driver_target.data,
 			this->rt.driver_target.activation, this->rt.activation);
 
-	spa_list_remove(&this->rt.target.link);
-
-	nstate = &this->rt.activation->state[0];
-	if (this->rt.target.active) {
-		nstate->required--;
-		this->rt.target.active = false;
-	}
-
 	spa_list_for_each(t, &this->rt.target_list, link) {
 		dstate = &t->activation->state[0];
 		if (t->active) {
-			dstate->required--;
+			ATOMIC_DEC(dstate->required);
 			t->active = false;
 		}
-		pw_log_trace(NAME" %p: driver state:%p pending:%d/%d, node state:%p pending:%d/%d",
-				this, dstate, dstate->pending, dstate->required,
-				nstate, nstate->pending, nstate->required);
+		pw_log_trace(NAME" %p: driver state:%p pending:%d/%d", this,
+				dstate, dstate->pending, dstate->required);
 	}
 	spa_list_remove(&this->rt.driver_target.link);
 
 	this->rt.driver_target.node = NULL;
 }
 
+/* called from the loop of the driver */
+static int
+do_add_driver_target(struct spa_loop *loop,
+	       bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct pw_impl_node *this = user_data;
+	struct pw_impl_node *driver = *(struct pw_impl_node **)data;
+	struct pw_node_activation_state *nstate = &this->rt.activation->state[0];
+
+	if (this->exported)
+		return 0;
+
+	spa_list_append(&driver->rt.target_list, &this->rt.target.link);
+	if (!this->rt.target.active) {
+		ATOMIC_INC(nstate->required);
+		this->rt.target.active = true;
+	}
+	pw_log_trace(NAME" %p: node state:%p pending:%d/%d", this,
+			nstate, nstate->pending, nstate->required);
+	return 0;
+}
+
+/* called from the loop of the driver */
+static int
+do_remove_driver_target(struct spa_loop *loop,
+	       bool async, uint32_t seq, const void *data, size_t size, void *user_data)
+{
+	struct pw_impl_node *this = user_data;
+	struct pw_node_activation_state *nstate = &this->rt.activation->state[0];
+
+	if (this->exported)
+		return 0;
+
+	spa_list_remove(&this->rt.target.link);
+	if (this->rt.target.active) {
+		ATOMIC_DEC(nstate->required);
+		this->rt.target.active = false;
+	}
+	return 0;
+}
+
 static int
 do_node_remove(struct spa_loop *loop,
 	       bool async, uint32_t seq, const void *data, size_t size, void *user_data)
@@ -194,7 +221,13 @@ static int pause_node(struct pw_impl_node *this)
 
 	node_deactivate(this);
 
-	pw_loop_invoke(this->data_loop, do_node_remove, 1, NULL, 0, true, this);
+	/* stop the driver from triggering the node, then remove it from
+	 * its own loop */
+	if (this->source.loop != NULL)
+		pw_loop_invoke(pw_impl_node_rt_loop(this->driver_node),
+				do_remove_driver_target, 1, NULL, 0, true, this);
+	pw_loop_invoke(pw_impl_node_rt_loop(this),
+			do_node_remove, 1, NULL, 0, true, this);
 
 	res = spa_node_send_command(this->node,
 				    &SPA_NODE_COMMAND_INIT(SPA_NODE_COMMAND_Pause));
@@ -303,7 +336,7 @@ do_node_add(struct spa_loop *loop,
 	    bool async, uint32_t seq, const void *data, size_t size, void *user_data)
 {
 	struct pw_impl_node *this = user_data;
-	struct pw_impl_node *driver = this->driver_node;
+	struct pw_impl_node *driver = *(struct pw_impl_node **)data;
 
 	if (this->source.loop == NULL) {
 		spa_loop_add_source(loop, &this->source);
@@ -327,8 +360,22 @@ static void node_update_state(struct pw_impl_node *node, enum pw_node_state stat
 				error = spa_aprintf("Start error: %s", spa_strerror(res));
 			}
 		}
-		if (res >= 0)
-			pw_loop_invoke(node->data_loop, do_node_add, 1, NULL, 0, true, node);
+		if (res >= 0) {
+			struct pw_impl_node *driver = node->driver_node;
+
+			if (node->work_loop == NULL) {
+				/* flush the changes queued before the node had a loop */
+				pw_loop_invoke(node->data_loop, NULL, 1, NULL, 0, true, node);
+				node->work_loop = pw_context_acquire_loop(node->context, node);
+			}
+			if (node->source.loop == NULL) {
+				pw_loop_invoke(node->work_loop, do_node_add, 1,
+						&driver, sizeof(driver), true, node);
+				pw_loop_invoke(pw_impl_node_rt_loop(driver),
+						do_add_driver_target, 1,
+						&driver, sizeof(driver), true, node);
+			}
+		}
 		break;
 	default:
 		break;
@@ -712,7 +759,7 @@ int pw_impl_node_register(struct pw_impl_node *this,
 		pw_impl_port_register(port, NULL);
 
 	if (this->active)
-		pw_context_recalc_graph(context, "register active node");
+		pw_context_recalc_nodes(context, this, NULL, "register active node");
 
 	return 0;
 
@@ -759,6 +806,28 @@ do_move_nodes(struct spa_loop *loop,
 	return 0;
 }
 
+/* The node moves from the target list of the old driver to the one of the
+ * new driver, each is changed in the loop of the driver. */
+static void move_nodes(struct pw_impl_node *node, struct pw_impl_node *old,
+		struct pw_impl_node *driver)
+{
+	struct impl *impl = SPA_CONTAINER_OF(node, struct impl, this);
+	bool added = node->source.loop != NULL;
+
+	if (added)
+		pw_loop_invoke(pw_impl_node_rt_loop(old),
+			       do_remove_driver_target, SPA_ID_INVALID, NULL, 0, true, node);
+
+	pw_loop_invoke(pw_impl_node_rt_loop(node),
+		       do_move_nodes, SPA_ID_INVALID, &driver, sizeof(struct pw_impl_node *),
+		       true, impl);
+
+	if (added)
+		pw_loop_invoke(pw_impl_node_rt_loop(driver),
+			       do_add_driver_target, SPA_ID_INVALID,
+			       &driver, sizeof(struct pw_impl_node *), true, node);
+}
+
 static void remove_segment_owner(struct pw_impl_node *driver, uint32_t node_id)
 {
 	struct pw_node_activation *a = driver->rt.activation;
@@ -769,7 +838,6 @@ static void remove_segment_owner(struct pw_impl_node *driver, uint32_t node_id)
 SPA_EXPORT
 int pw_impl_node_set_driver(struct pw_impl_node *node, struct pw_impl_node *driver)
 {
-	struct impl *impl = SPA_CONTAINER_OF(node, struct impl, this);
 	struct pw_impl_node *old = node->driver_node;
 
 	if (driver == NULL)
@@ -792,9 +860,7 @@ int pw_impl_node_set_driver(struct pw_impl_node *node, struct pw_impl_node *driv
 
 	node->driver_node = driver;
 
-	pw_loop_invoke(node->data_loop,
-		       do_move_nodes, SPA_ID_INVALID, &driver, sizeof(struct pw_impl_node *),
-		       true, impl);
+	move_nodes(node, old, driver);
 
 	pw_impl_node_emit_driver_changed(node, old, driver);
 
@@ -923,7 +989,7 @@ static void check_properties(struct pw_impl_node *node)
 			recalc_reason, node->active);
 
 	if (recalc_reason && node->active)
-		pw_context_recalc_graph(context, recalc_reason);
+		pw_context_recalc_nodes(context, node, NULL, recalc_reason);
 }
 
 static const char *str_status(uint32_t status)
@@ -997,7 +1063,14 @@ static inline int resume_node(struct pw_impl_node *this, int status)
 		if (pw_node_activation_state_dec(state, 1)) {
 			a->status = PW_NODE_ACTIVATION_TRIGGERED;
 			a->signal_time = nsec;
-			t->signal(t->data);
+			/* nodes processed in another data loop are woken up
+			 * with their eventfd and run concurrently */
+			if (t->node == NULL || t->node->remote ||
+			    t->node->work_loop == this->work_loop)
+				t->signal(t->data);
+			else if (SPA_UNLIKELY(spa_system_eventfd_write(data_system,
+							t->node->source.fd, 1) < 0))
+				pw_log_warn(NAME" %p: write failed %m", t->node);
 		}
 	}
 	return 0;
@@ -1726,7 +1799,7 @@ void pw_impl_node_destroy(struct pw_impl_node *node)
 {
 	struct impl *impl = SPA_CONTAINER_OF(node, struct impl, this);
 	struct pw_impl_port *port;
-	struct pw_impl_node *follower;
+	struct pw_impl_node *follower, *driver_node = node->driver_node;
 	bool active;
 
 	active = node->active;
@@ -1772,8 +1845,14 @@ void pw_impl_node_destroy(struct pw_impl_node *node)
 		pw_global_destroy(node->global);
 	}
 
-	if (active)
-		pw_context_recalc_graph(node->context, "active node destroy");
+	if (active) {
+		/* when we drove other nodes, they all need a new driver */
+		if (node->driver || driver_node == node)
+			pw_context_recalc_graph(node->context, "active node destroy");
+		else
+			pw_context_recalc_nodes(node->context, driver_node, NULL,
+					"active node destroy");
+	}
 
 	pw_log_debug(NAME" %p: free", node);
 	pw_impl_node_emit_free(node);
@@ -1794,6 +1873,9 @@ void pw_impl_node_destroy(struct pw_impl_node *node)
 
 	clear_info(node);
 
+	if (node->work_loop != NULL)
+		pw_context_release_loop(node->context, node->work_loop);
+
 	spa_system_close(node->context->data_system, node->source.fd);
 	free(impl);
 }
@@ -2143,7 +2225,7 @@ int pw_impl_node_set_active(struct pw_impl_node *node, bool active)
 		pw_impl_node_emit_active_changed(node, active);
 
 		if (node->registered)
-			pw_context_recalc_graph(node->context,
+			pw_context_recalc_nodes(node->context, node, NULL,
 					active ? "node activate" : "node deactivate");
 	}
 	return 0;
@@ -38,6 +38,8 @@
 
 #define NAME "port"
 
+#define MAX_MIX_BUFFERS	64
+
 /** \cond */
 struct impl {
 	struct pw_impl_port this;
@@ -46,6 +48,8 @@ struct impl {
 	struct spa_list param_list;
 	struct spa_list pending_list;
 
+	uint32_t mix_port_ids[MAX_MIX_BUFFERS];	/**< mix port each buffer was passed from */
+
 	unsigned int cache_params:1;
 };
 
@@ -132,12 +136,23 @@ static int tee_process(void *object)
 	struct pw_impl_port *this = &impl->this;
 	struct pw_impl_port_mix *mix;
 	struct spa_io_buffers *io = &this->rt.io;
+	uint32_t consumers = 0;
 
+	/* all links share the buffers of the output port, every consumer gets
+	 * the same buffer by reference */
 	pw_log_trace_fp(NAME" %p: tee input %d %d", this, io->status, io->buffer_id);
 	spa_list_for_each(mix, &this->rt.mix_list, rt_link) {
 		pw_log_trace_fp(NAME" %p: port %d %p->%p %d", this,
 				mix->port.port_id, io, mix->io, mix->io->buffer_id);
 		*mix->io = *io;
+		consumers++;
+	}
+	if (io->status == SPA_STATUS_HAVE_DATA && consumers > 0) {
+		this->fanout.consumers = consumers;
+		if (consumers > this->fanout.max_consumers)
+			this->fanout.max_consumers = consumers;
+		this->fanout.buffers++;
+		this->fanout.shared += consumers;
 	}
 	io->status = SPA_STATUS_NEED_DATA;
 
@@ -166,18 +181,29 @@ static int schedule_mix_input(void *object)
 	struct impl *impl = object;
 	struct pw_impl_port *this = &impl->this;
 	struct spa_io_buffers *io = &this->rt.io;
-	struct pw_impl_port_mix *mix;
+	struct pw_impl_port_mix *mix, *pass = NULL;
 
 	if (SPA_UNLIKELY(PW_IMPL_PORT_IS_CONTROL(this)))
 		return SPA_STATUS_HAVE_DATA | SPA_STATUS_NEED_DATA;
 
+	/* without a mixer, the buffer of the first input with data is passed
+	 * to the node by reference. The other inputs are dropped. */
 	spa_list_for_each(mix, &this->rt.mix_list, rt_link) {
 		pw_log_trace_fp(NAME" %p: mix input %d %p->%p %d %d", this,
 				mix->port.port_id, mix->io, io, mix->io->status, mix->io->buffer_id);
-		*io = *mix->io;
-		mix->io->status = SPA_STATUS_NEED_DATA;
-		break;
+		if (pass == NULL || (pass->io->status != SPA_STATUS_HAVE_DATA &&
+		    mix->io->status == SPA_STATUS_HAVE_DATA))
+			pass = mix;
 	}
+	if (pass != NULL) {
+		*io = *pass->io;
+		if (io->status == SPA_STATUS_HAVE_DATA &&
+		    io->buffer_id < MAX_MIX_BUFFERS)
+			impl->mix_port_ids[io->buffer_id] = pass->port.port_id;
+	}
+	spa_list_for_each(mix, &this->rt.mix_list, rt_link)
+		mix->io->status = SPA_STATUS_NEED_DATA;
+
         return SPA_STATUS_HAVE_DATA | SPA_STATUS_NEED_DATA;
 }
 
@@ -185,11 +211,24 @@ static int schedule_mix_reuse_buffer(void *object, uint32_t port_id, uint32_t bu
 {
 	struct impl *impl = object;
 	struct pw_impl_port *this = &impl->this;
-	struct pw_impl_port_mix *mix;
+	struct pw_impl_port_mix *mix, *peer;
+	uint32_t mix_port_id;
+
+	if (buffer_id >= MAX_MIX_BUFFERS)
+		return 0;
 
+	/* the buffer belongs to the peer of the input it came from. The peer
+	 * can only be called when it is processed in the same loop. */
+	mix_port_id = impl->mix_port_ids[buffer_id];
 	spa_list_for_each(mix, &this->rt.mix_list, rt_link) {
-		pw_log_trace_fp(NAME" %p: reuse buffer %d %d", this, port_id, buffer_id);
-		/* FIXME send reuse buffer to peer */
+		if (mix->port.port_id != mix_port_id)
+			continue;
+		if ((peer = mix->peer) == NULL ||
+		    pw_impl_node_rt_loop(peer->p->node) != pw_impl_node_rt_loop(this->node))
+			break;
+		pw_log_trace_fp(NAME" %p: reuse buffer %d %d on %p", this,
+				port_id, buffer_id, peer->p);
+		spa_node_port_reuse_buffer(peer->p->mix, peer->port.port_id, buffer_id);
 		break;
 	}
 	return 0;
@@ -409,6 +448,7 @@ struct pw_impl_port *pw_context_create_port(
 	struct pw_impl_port *this;
 	struct pw_properties *properties;
 	const struct spa_node_methods *mix_methods;
+	uint32_t i;
 	int res;
 
 	impl = calloc(1, sizeof(struct impl) + user_data_size);
@@ -418,6 +458,8 @@ struct pw_impl_port *pw_context_create_port(
 	spa_list_init(&impl->param_list);
 	spa_list_init(&impl->pending_list);
 	impl->cache_params = true;
+	for (i = 0; i < MAX_MIX_BUFFERS; i++)
+		impl->mix_port_ids[i] = SPA_ID_INVALID;
 
 	this = &impl->this;
 	pw_log_debug(NAME" %p: new %s %d", this,
@@ -535,9 +577,10 @@ static int setup_mixer(struct pw_impl_port *port, const struct spa_pod *param)
 {
 	uint32_t media_type, media_subtype;
 	int res;
-	const char *fallback_lib, *factory_name;
+	const char *fallback_lib, *factory_name, *str;
 	struct spa_handle *handle;
-	struct spa_dict_item items[1];
+	struct spa_dict_item items[2];
+	uint32_t n_items = 0;
 	void *iface;
 
 	if ((res = spa_format_parse(param, &media_type, &media_subtype)) < 0)
@@ -583,9 +626,12 @@ static int setup_mixer(struct pw_impl_port *port, const struct spa_pod *param)
 		return -ENOTSUP;
 	}
 
-	items[0] = SPA_DICT_ITEM_INIT(SPA_KEY_LIBRARY_NAME, fallback_lib);
+	items[n_items++] = SPA_DICT_ITEM_INIT(SPA_KEY_LIBRARY_NAME, fallback_lib);
+	/* the mixer runs in the data loop of the node */
+	if ((str = pw_properties_get(port->node->properties, PW_KEY_NODE_DATA_LOOP)) != NULL)
+		items[n_items++] = SPA_DICT_ITEM_INIT(PW_KEY_NODE_DATA_LOOP, str);
 	handle = pw_context_load_spa_handle(port->node->context, factory_name,
-			&SPA_DICT_INIT_ARRAY(items));
+			&SPA_DICT_INIT(items, n_items));
 	if (handle == NULL)
 		return -errno;
 
@@ -1004,7 +1050,7 @@ static void pw_impl_port_remove(struct pw_impl_port *port)
 	pw_log_debug(NAME" %p: remove added:%d", port, port->added);
 
 	if (port->added) {
-		pw_loop_invoke(node->data_loop, do_remove_port,
+		pw_loop_invoke(pw_impl_node_rt_loop(node), do_remove_port,
 			       SPA_ID_INVALID, NULL, 0, true, port);
 		port->added = false;
 	}
@@ -1299,7 +1345,7 @@ int pw_impl_port_set_param(struct pw_impl_port *port, uint32_t id, uint32_t flag
 		pw_log_debug(NAME" %p: %d %p %d", port, port->state, param, res);
 
 		if (port->added) {
-			pw_loop_invoke(node->data_loop, do_remove_port, SPA_ID_INVALID, NULL, 0, true, port);
+			pw_loop_invoke(pw_impl_node_rt_loop(node), do_remove_port, SPA_ID_INVALID, NULL, 0, true, port);
 			port->added = false;
 		}
 		/* setting the format always destroys the negotiated buffers */
@@ -1335,7 +1381,7 @@ static int negotiate_mixer_buffers(struct pw_impl_port *port, uint32_t flags,
 				port, port->direction, port->port_id, n_buffers, node->node);
 
 		if (port->added) {
-			pw_loop_invoke(node->data_loop, do_remove_port, SPA_ID_INVALID, NULL, 0, true, port);
+			pw_loop_invoke(pw_impl_node_rt_loop(node), do_remove_port, SPA_ID_INVALID, NULL, 0, true, port);
 			port->added = false;
 		}
 
@@ -1369,7 +1415,7 @@ static int negotiate_mixer_buffers(struct pw_impl_port *port, uint32_t flags,
 			     0, buffers, n_buffers);
 	}
 	if (!port->added && n_buffers > 0) {
-		pw_loop_invoke(node->data_loop, do_add_port, SPA_ID_INVALID, NULL, 0, false, port);
+		pw_loop_invoke(pw_impl_node_rt_loop(node), do_add_port, SPA_ID_INVALID, NULL, 0, false, port);
 		port->added = true;
 	}
 	return res;
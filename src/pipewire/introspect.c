@@ -115,6 +115,9 @@ static struct spa_dict *pw_spa_dict_copy(struct spa_dict *dict)
 		items[i].key = strdup(dict->items[i].key);
 		items[i].value = dict->items[i].value ? strdup(dict->items[i].value) : NULL;
 	}
+	/* info properties are looked up a lot, sort them so that
+	 * spa_dict_lookup() can do a binary search */
+	spa_dict_qsort(copy);
 	return copy;
 
       no_items:
@@ -152,6 +152,16 @@ extern "C" {
 #define PW_KEY_NODE_DRIVER		"node.driver"		/**< node can drive the graph */
 #define PW_KEY_NODE_STREAM		"node.stream"		/**< node is a stream, the server side should
 								  *  add a converter */
+#define PW_KEY_NODE_WAKEUP		"node.wakeup"		/**< how a remote node waits for a new cycle,
+								  *  one of "eventfd" (default), "spin" or
+								  *  "futex". The spin and futex modes are
+								  *  meant for nodes with a dedicated data
+								  *  loop thread, ideally on an isolated core */
+#define PW_KEY_NODE_WAKEUP_SPIN		"node.wakeup-spin"	/**< time in microseconds to spin before
+								  *  sleeping in the futex or the eventfd */
+#define PW_KEY_NODE_DATA_LOOP		"node.data-loop"	/**< index of the data loop that processes
+								  *  the node, the spa plugin of the node
+								  *  gets this loop as its DataLoop */
 /** Port keys */
 #define PW_KEY_PORT_ID			"port.id"		/**< port id */
 #define PW_KEY_PORT_NAME		"port.name"		/**< port name */
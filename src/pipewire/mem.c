@@ -32,6 +32,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <stdlib.h>
+#include <inttypes.h>
 #include <sys/syscall.h>
 
 #include <spa/utils/list.h>
@@ -74,6 +75,14 @@ static inline int memfd_create(const char *name, unsigned int flags)
 #define MFD_ALLOW_SEALING 0x0002U
 #endif
 
+#define RECYCLE_NONE	0
+#define RECYCLE_LOCAL	1
+#define RECYCLE_ALL	2
+
+#define MAX_RECYCLE_BLOCKS	32
+#define MAX_RECYCLE_SIZE	(32u * 1024 * 1024)
+#define HUGEPAGE_SIZE		(2u * 1024 * 1024)
+
 /* fcntl() seals-related flags */
 
 #ifndef F_LINUX_SPECIFIC_BASE
@@ -107,6 +116,20 @@ struct mempool {
 	struct pw_map map;		/* map memblock to id */
 	struct spa_list blocks;		/* list of memblock */
 	uint32_t pagesize;
+
+	uint32_t recycle;
+	unsigned int hugepages:1;
+	unsigned int clearing:1;
+	struct spa_list free_blocks;	/* recycled memblocks, most recent first */
+	uint32_t n_free;
+	uint64_t free_size;
+
+	struct {
+		uint64_t hits;
+		uint64_t misses;
+		uint64_t requested;	/* bytes asked for in recycled allocations */
+		uint64_t allocated;	/* bytes handed out for those allocations */
+	} stats;
 };
 
 struct memblock {
@@ -114,6 +137,8 @@ struct memblock {
 	struct spa_list link;		/* link in mempool */
 	struct spa_list mappings;	/* list of struct mapping */
 	struct spa_list memmaps;	/* list of struct memmap */
+	unsigned int allocated:1;	/* memory was allocated by the pool */
+	unsigned int exported:1;	/* imported in another pool */
 };
 
 /* a mapped region of a block */
@@ -123,6 +148,7 @@ struct mapping {
 	uint32_t offset;
 	uint32_t size;
 	unsigned int do_unmap:1;
+	unsigned int twice:1;		/* mapped twice, the mapping spans 2 * size */
 	struct spa_list link;
 	void *ptr;
 };
@@ -134,10 +160,13 @@ struct memmap {
 	struct spa_list link;
 };
 
+static void free_block_destroy(struct mempool *impl, struct memblock *b);
+
 struct pw_mempool *pw_mempool_new(struct pw_properties *props)
 {
 	struct mempool *impl;
 	struct pw_mempool *this;
+	const char *str;
 
 	impl = calloc(1, sizeof(struct mempool));
 	if (impl == NULL)
@@ -148,11 +177,23 @@ struct pw_mempool *pw_mempool_new(struct pw_properties *props)
 
 	impl->pagesize = sysconf(_SC_PAGESIZE);
 
-	pw_log_debug(NAME" %p: new", this);
+	impl->recycle = RECYCLE_LOCAL;
+	if (props && (str = pw_properties_get(props, "mem.recycle")) != NULL) {
+		if (strcmp(str, "none") == 0)
+			impl->recycle = RECYCLE_NONE;
+		else if (strcmp(str, "all") == 0)
+			impl->recycle = RECYCLE_ALL;
+	}
+	if (props && (str = pw_properties_get(props, "mem.hugepages")) != NULL)
+		impl->hugepages = pw_properties_parse_bool(str);
+
+	pw_log_debug(NAME" %p: new recycle:%u hugepages:%u", this,
+			impl->recycle, impl->hugepages);
 
 	spa_hook_list_init(&impl->listener_list);
 	pw_map_init(&impl->map, 64, 64);
 	spa_list_init(&impl->blocks);
+	spa_list_init(&impl->free_blocks);
 
 	spa_list_append(&_mempools, &impl->link);
 
@@ -166,16 +207,24 @@ void pw_mempool_clear(struct pw_mempool *pool)
 
 	pw_log_debug(NAME" %p: clear", pool);
 
+	impl->clearing = true;
 	spa_list_consume(b, &impl->blocks, link)
 		pw_memblock_free(&b->this);
 	pw_map_reset(&impl->map);
+	impl->clearing = false;
+
+	spa_list_consume(b, &impl->free_blocks, link)
+		free_block_destroy(impl, b);
 }
 
 void pw_mempool_destroy(struct pw_mempool *pool)
 {
 	struct mempool *impl = SPA_CONTAINER_OF(pool, struct mempool, this);
 
-	pw_log_debug(NAME" %p: destroy", pool);
+	pw_log_debug(NAME" %p: destroy recycle hits:%"PRIu64" misses:%"PRIu64
+			" requested:%"PRIu64" allocated:%"PRIu64, pool,
+			impl->stats.hits, impl->stats.misses,
+			impl->stats.requested, impl->stats.allocated);
 
 	pw_mempool_emit_destroy(impl);
 
@@ -272,6 +321,11 @@ static struct mapping * memblock_find_mapping(struct memblock *b,
 		pw_log_debug(NAME" %p: check %p offset:(%d <= %d) end:(%d >= %d)",
 				pool, m, m->offset, offset, m->offset + m->size,
 				offset + size);
+		/* a mirrored mapping can only be reused for exactly the
+		 * same area */
+		if ((flags & PW_MEMMAP_FLAG_TWICE) &&
+		    (!m->twice || m->offset != offset || m->size != size))
+			continue;
 		if (m->offset <= offset && (m->offset + m->size) >= (offset + size)) {
 			pw_log_debug(NAME" %p: found %p id:%d fd:%d offs:%d size:%d ref:%d",
 					pool, &b->this, b->this.id, b->this.fd,
@@ -304,26 +358,45 @@ static struct mapping * memblock_map(struct memblock *b,
 		fl |= MAP_LOCKED;
 
 	if (flags & PW_MEMMAP_FLAG_TWICE) {
-		pw_log_error(NAME" %p: implement me PW_MEMMAP_FLAG_TWICE", p);
-		errno = ENOTSUP;
-		return NULL;
-	}
+		void *wrap;
 
-
-	ptr = mmap(NULL, size, prot, fl, b->this.fd, offset);
-	if (ptr == MAP_FAILED) {
-		pw_log_error(NAME" %p: Failed to mmap memory fd:%d offset:%u size:%u: %m",
-				p, b->this.fd, offset, size);
-		return NULL;
+		if (flags & PW_MEMMAP_FLAG_PRIVATE) {
+			pw_log_error(NAME" %p: can't map private memory twice", p);
+			errno = EINVAL;
+			return NULL;
+		}
+		/* reserve an area for both copies and then map the memory over
+		 * the first and the second half */
+		ptr = mmap(NULL, size << 1, PROT_NONE, MAP_ANONYMOUS | MAP_PRIVATE, -1, 0);
+		if (ptr == MAP_FAILED) {
+			pw_log_error(NAME" %p: Failed to reserve %u bytes: %m", p, size << 1);
+			return NULL;
+		}
+		wrap = SPA_MEMBER(ptr, size, void);
+		if (mmap(ptr, size, prot, fl | MAP_FIXED, b->this.fd, offset) != ptr ||
+		    mmap(wrap, size, prot, fl | MAP_FIXED, b->this.fd, offset) != wrap) {
+			pw_log_error(NAME" %p: Failed to mmap memory twice fd:%d offset:%u size:%u: %m",
+					p, b->this.fd, offset, size);
+			munmap(ptr, size << 1);
+			return NULL;
+		}
+	} else {
+		ptr = mmap(NULL, size, prot, fl, b->this.fd, offset);
+		if (ptr == MAP_FAILED) {
+			pw_log_error(NAME" %p: Failed to mmap memory fd:%d offset:%u size:%u: %m",
+					p, b->this.fd, offset, size);
+			return NULL;
+		}
 	}
 
 	m = calloc(1, sizeof(struct mapping));
 	if (m == NULL) {
-		munmap(ptr, size);
+		munmap(ptr, flags & PW_MEMMAP_FLAG_TWICE ? size << 1 : size);
 		return NULL;
 	}
 	m->ptr = ptr;
 	m->do_unmap = true;
+	m->twice = SPA_FLAG_IS_SET(flags, PW_MEMMAP_FLAG_TWICE);
 	m->block = b;
 	m->offset = offset;
 	m->size = size;
@@ -345,7 +418,7 @@ static void mapping_free(struct mapping *m)
 			p, m, b, b->this.fd, m->ptr, m->size, b->this.ref);
 
 	if (m->do_unmap)
-		munmap(m->ptr, m->size);
+		munmap(m->ptr, m->twice ? m->size << 1 : m->size);
 	spa_list_remove(&m->link);
 	free(m);
 }
@@ -372,6 +445,14 @@ struct pw_memmap * pw_memblock_map(struct pw_memblock *block,
 
 	pw_map_range_init(&range, offset, size, p->pagesize);
 
+	if ((flags & PW_MEMMAP_FLAG_TWICE) &&
+	    (range.start != 0 || range.size != size)) {
+		pw_log_error(NAME" %p: offset %u and size %u must be page aligned to map twice",
+				p, offset, size);
+		errno = EINVAL;
+		return NULL;
+	}
+
 	m = memblock_find_mapping(b, flags, offset, size);
 	if (m == NULL)
 		m = memblock_map(b, flags, range.offset, range.size);
@@ -463,6 +544,125 @@ static inline enum pw_memmap_flags block_flags_to_mem(enum pw_memblock_flags fla
  * \return a memblock structure or NULL with errno on error
  * \memberof pw_memblock
  */
+static void memblock_destroy(struct mempool *impl, struct memblock *b)
+{
+	struct pw_memblock *block = &b->this;
+	struct memmap *mm;
+	struct mapping *m;
+
+	spa_list_consume(mm, &b->memmaps, link)
+		pw_memmap_free(&mm->this);
+
+	spa_list_consume(m, &b->mappings, link) {
+		pw_log_warn(NAME" %p: stray mapping:%p", impl, m);
+		mapping_free(m);
+	}
+
+	if (block->fd != -1 && !(block->flags & PW_MEMBLOCK_FLAG_DONT_CLOSE)) {
+		pw_log_debug(NAME" %p: close fd:%d", impl, block->fd);
+		close(block->fd);
+	}
+	free(b);
+}
+
+static void free_block_destroy(struct mempool *impl, struct memblock *b)
+{
+	struct pw_memblock *block = &b->this;
+
+	spa_list_remove(&b->link);
+	impl->n_free--;
+	impl->free_size -= block->size;
+
+	block->ref++;
+	if (block->map)
+		block->ref++;
+	memblock_destroy(impl, b);
+}
+
+/* keep the block in the pool for a later allocation of the same size.
+ * Only blocks that have nothing mapped but their own map are kept. */
+static bool recycle_block(struct mempool *impl, struct memblock *b)
+{
+	struct pw_memblock *block = &b->this;
+
+	if (!SPA_FLAG_IS_SET(block->flags, PW_MEMBLOCK_FLAG_RECYCLE) ||
+	    !b->allocated || impl->clearing ||
+	    impl->recycle == RECYCLE_NONE ||
+	    (b->exported && impl->recycle != RECYCLE_ALL) ||
+	    block->size > MAX_RECYCLE_SIZE)
+		return false;
+
+	if (!spa_list_is_empty(&b->memmaps) &&
+	    (block->map == NULL ||
+	     b->memmaps.next != b->memmaps.prev ||
+	     spa_list_first(&b->memmaps, struct memmap, link) !=
+		SPA_CONTAINER_OF(block->map, struct memmap, this)))
+		return false;
+
+	while (impl->n_free >= MAX_RECYCLE_BLOCKS ||
+	    impl->free_size + block->size > MAX_RECYCLE_SIZE)
+		free_block_destroy(impl,
+			spa_list_last(&impl->free_blocks, struct memblock, link));
+
+	block->ref = 0;
+	block->id = SPA_ID_INVALID;
+	b->exported = false;
+	spa_list_prepend(&impl->free_blocks, &b->link);
+	impl->n_free++;
+	impl->free_size += block->size;
+
+	pw_log_debug(NAME" %p: recycle block:%p fd:%d size:%u free:%u/%"PRIu64, impl,
+			b, block->fd, block->size, impl->n_free, impl->free_size);
+	return true;
+}
+
+/* sizes are rounded up to whole pages, the memory is mapped with that
+ * granularity anyway. Larger rounding is wasted on the many blocks that
+ * are shared with clients and never recycled. */
+static size_t recycle_size(struct mempool *impl, size_t size)
+{
+	return SPA_ROUND_UP_N(size, impl->pagesize);
+}
+
+static struct memblock *recycle_take(struct mempool *impl,
+		enum pw_memblock_flags flags, uint32_t type, size_t size)
+{
+	struct memblock *b;
+
+	spa_list_for_each(b, &impl->free_blocks, link) {
+		if (b->this.flags == flags && b->this.type == type &&
+		    b->this.size == size) {
+			spa_list_remove(&b->link);
+			impl->n_free--;
+			impl->free_size -= size;
+			return b;
+		}
+	}
+	return NULL;
+}
+
+static int memfd_alloc(struct mempool *impl)
+{
+	int fd;
+#ifdef HAVE_MEMFD_CREATE
+	fd = memfd_create("pipewire-memfd", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	if (fd == -1)
+		pw_log_error(NAME" %p: Failed to create memfd: %m", impl);
+#elif defined(__FreeBSD__)
+	fd = shm_open(SHM_ANON, O_CREAT | O_RDWR | O_CLOEXEC, 0);
+	if (fd == -1)
+		pw_log_error(NAME" %p: Failed to create SHM_ANON fd: %m", impl);
+#else
+	char filename[] = "/dev/shm/pipewire-tmpfile.XXXXXX";
+	fd = mkostemp(filename, O_CLOEXEC);
+	if (fd == -1)
+		pw_log_error(NAME" %p: Failed to create temporary file: %m", impl);
+	else
+		unlink(filename);
+#endif
+	return fd;
+}
+
 SPA_EXPORT
 struct pw_memblock * pw_mempool_alloc(struct pw_mempool *pool, enum pw_memblock_flags flags,
 		uint32_t type, size_t size)
@@ -471,6 +671,33 @@ struct pw_memblock * pw_mempool_alloc(struct pw_mempool *pool, enum pw_memblock_
 	struct memblock *b;
 	int res;
 
+	if (SPA_FLAG_IS_SET(flags, PW_MEMBLOCK_FLAG_RECYCLE) &&
+	    impl->recycle != RECYCLE_NONE) {
+		size_t alloc_size = recycle_size(impl, size);
+
+		impl->stats.requested += size;
+		impl->stats.allocated += alloc_size;
+
+		if ((b = recycle_take(impl, flags, type, alloc_size)) != NULL) {
+			impl->stats.hits++;
+			b->this.ref = 1;
+			b->this.id = pw_map_insert_new(&impl->map, b);
+			spa_list_append(&impl->blocks, &b->link);
+			if (b->this.map)
+				memset(b->this.map->ptr, 0, b->this.map->size);
+
+			pw_log_debug(NAME" %p: reuse block:%p id:%d size:%zd hits:%"PRIu64
+					" misses:%"PRIu64, pool, &b->this, b->this.id, size,
+					impl->stats.hits, impl->stats.misses);
+
+			if (!SPA_FLAG_IS_SET(flags, PW_MEMBLOCK_FLAG_DONT_NOTIFY))
+				pw_mempool_emit_added(impl, &b->this);
+			return &b->this;
+		}
+		impl->stats.misses++;
+		size = alloc_size;
+	}
+
 	b = calloc(1, sizeof(struct memblock));
 	if (b == NULL)
 		return NULL;
@@ -480,33 +707,15 @@ struct pw_memblock * pw_mempool_alloc(struct pw_mempool *pool, enum pw_memblock_
 	b->this.flags = flags;
 	b->this.type = type;
 	b->this.size = size;
+	b->allocated = true;
 	spa_list_init(&b->mappings);
 	spa_list_init(&b->memmaps);
 
-#ifdef HAVE_MEMFD_CREATE
-	b->this.fd = memfd_create("pipewire-memfd", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+	b->this.fd = memfd_alloc(impl);
 	if (b->this.fd == -1) {
 		res = -errno;
-		pw_log_error(NAME" %p: Failed to create memfd: %m", pool);
 		goto error_free;
 	}
-#elif defined(__FreeBSD__)
-	b->this.fd = shm_open(SHM_ANON, O_CREAT | O_RDWR | O_CLOEXEC, 0);
-	if (b->this.fd == -1) {
-		res = -errno;
-		pw_log_error(NAME" %p: Failed to create SHM_ANON fd: %m", pool);
-		goto error_free;
-	}
-#else
-	char filename[] = "/dev/shm/pipewire-tmpfile.XXXXXX";
-	b->this.fd = mkostemp(filename, O_CLOEXEC);
-	if (b->this.fd == -1) {
-		res = -errno;
-		pw_log_error(NAME" %p: Failed to create temporary file: %m", pool);
-		goto error_free;
-	}
-	unlink(filename);
-#endif
 
 	if (ftruncate(b->this.fd, size) < 0) {
 		res = -errno;
@@ -530,6 +739,14 @@ struct pw_memblock * pw_mempool_alloc(struct pw_mempool *pool, enum pw_memblock_
 			goto error_close;
 		}
 		b->this.ref--;
+#ifdef MADV_HUGEPAGE
+		/* transparent huge pages for our own mapping only, clients
+		 * still map parts of the memory with normal pages */
+		if (impl->hugepages && SPA_FLAG_IS_SET(flags, PW_MEMBLOCK_FLAG_RECYCLE) &&
+		    size >= HUGEPAGE_SIZE &&
+		    madvise(b->this.map->ptr, size, MADV_HUGEPAGE) < 0)
+			pw_log_debug(NAME" %p: Failed to use huge pages: %m", pool);
+#endif
 	}
 
 	b->this.id = pw_map_insert_new(&impl->map, b);
@@ -605,8 +822,12 @@ SPA_EXPORT
 struct pw_memblock * pw_mempool_import_block(struct pw_mempool *pool,
 		struct pw_memblock *mem)
 {
+	struct memblock *b = SPA_CONTAINER_OF(mem, struct memblock, this);
+
 	pw_log_debug(NAME" %p: import block:%p type:%d fd:%d", pool,
 			mem, mem->type, mem->fd);
+	if (pool != mem->pool)
+		b->exported = true;
 	return pw_mempool_import(pool,
 			mem->flags | PW_MEMBLOCK_FLAG_DONT_CLOSE,
 			mem->type, mem->fd);
@@ -694,8 +915,6 @@ void pw_memblock_free(struct pw_memblock *block)
 	struct memblock *b = SPA_CONTAINER_OF(block, struct memblock, this);
 	struct pw_mempool *pool = block->pool;
 	struct mempool *impl = SPA_CONTAINER_OF(pool, struct mempool, this);
-	struct memmap *mm;
-	struct mapping *m;
 
 	spa_return_if_fail(block != NULL);
 
@@ -713,19 +932,10 @@ void pw_memblock_free(struct pw_memblock *block)
 	if (!SPA_FLAG_IS_SET(block->flags, PW_MEMBLOCK_FLAG_DONT_NOTIFY))
 		pw_mempool_emit_removed(impl, block);
 
-	spa_list_consume(mm, &b->memmaps, link)
-		pw_memmap_free(&mm->this);
+	if (recycle_block(impl, b))
+		return;
 
-	spa_list_consume(m, &b->mappings, link) {
-		pw_log_warn(NAME" %p: stray mapping:%p", pool, m);
-		mapping_free(m);
-	}
-
-	if (block->fd != -1 && !(block->flags & PW_MEMBLOCK_FLAG_DONT_CLOSE)) {
-		pw_log_debug(NAME" %p: close fd:%d", pool, block->fd);
-		close(block->fd);
-	}
-	free(b);
+	memblock_destroy(impl, b);
 }
 
 SPA_EXPORT
@@ -40,6 +40,9 @@ enum pw_memblock_flags {
 	PW_MEMBLOCK_FLAG_MAP =		(1 << 3),	/**< mmap the fd */
 	PW_MEMBLOCK_FLAG_DONT_CLOSE =	(1 << 4),	/**< don't close fd */
 	PW_MEMBLOCK_FLAG_DONT_NOTIFY =	(1 << 5),	/**< don't notify events */
+	PW_MEMBLOCK_FLAG_RECYCLE =	(1 << 6),	/**< the pool can keep the memory when
+							  *  freed and reuse it for a later
+							  *  allocation, see \ref pw_mempool_new */
 
 	PW_MEMBLOCK_FLAG_READWRITE = PW_MEMBLOCK_FLAG_READABLE | PW_MEMBLOCK_FLAG_WRITABLE,
 };
@@ -49,7 +52,8 @@ enum pw_memmap_flags {
 	PW_MEMMAP_FLAG_READ =		(1 << 0),	/**< map in read mode */
 	PW_MEMMAP_FLAG_WRITE =		(1 << 1),	/**< map in write mode */
 	PW_MEMMAP_FLAG_TWICE =		(1 << 2),	/**< map the same area twice after each other,
-							  *  creating a circular ringbuffer */
+							  *  creating a circular ringbuffer. offset and
+							  *  size must be page aligned */
 	PW_MEMMAP_FLAG_PRIVATE =	(1 << 3),	/**< writes will be private */
 	PW_MEMMAP_FLAG_LOCKED =		(1 << 4),	/**< lock the memory into RAM */
 	PW_MEMMAP_FLAG_READWRITE = PW_MEMMAP_FLAG_READ | PW_MEMMAP_FLAG_WRITE,
@@ -101,7 +105,20 @@ struct pw_mempool_events {
 	void (*removed) (void *data, struct pw_memblock *block);
 };
 
-/** Create a new memory pool */
+/** Create a new memory pool
+ *
+ * The pool keeps freed blocks that were allocated with
+ * PW_MEMBLOCK_FLAG_RECYCLE for reuse. The following properties
+ * are used:
+ *
+ *  - mem.recycle: "none" to disable recycling, "local" (the default) to
+ *    only recycle blocks that were never imported in another pool and
+ *    so never sent to a client, "all" to also recycle shared blocks. Only
+ *    use "all" when all clients are trusted, a client might keep the fd of
+ *    a block and see the data of the next user.
+ *  - mem.hugepages: ask for transparent huge pages for the mapping of large
+ *    recycled blocks
+ */
 struct pw_mempool *pw_mempool_new(struct pw_properties *props);
 
 /** Listen for events */
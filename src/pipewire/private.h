@@ -31,6 +31,12 @@ extern "C" {
 
 #include <sys/socket.h>
 #include <sys/types.h> /* for pthread_t */
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#endif
 
 #include "pipewire/impl.h"
 
@@ -56,6 +62,7 @@ struct defaults {
 	struct spa_rectangle video_size;
 	struct spa_fraction video_rate;
 	uint32_t link_max_buffers;
+	uint32_t data_loops;
 	unsigned int mem_warn_mlock:1;
 	unsigned int mem_allow_mlock:1;
 	unsigned int clock_power_of_two_quantum:1;
@@ -406,6 +413,14 @@ struct pw_context {
         struct pw_data_loop *data_loop_impl;
 	struct spa_system *data_system;	/**< data system for data passing */
 
+#define MAX_DATA_LOOPS	64
+	struct pw_data_loop *data_loops[MAX_DATA_LOOPS];	/**< data loops for processing, the
+								  *  first one is data_loop_impl */
+	uint32_t data_loop_nodes[MAX_DATA_LOOPS];	/**< nodes processed in each data loop */
+	uint32_t next_data_loop;			/**< where to start looking for the least
+							  *  loaded data loop */
+	uint32_t n_data_loops;
+
 	struct spa_support support[16];	/**< support for spa plugins */
 	uint32_t n_support;		/**< number of support items */
 	struct pw_array factory_lib;	/**< mapping of factory_name regexp to library */
@@ -567,6 +582,14 @@ struct pw_node_activation {
 	uint32_t command;				/* next command */
 	uint32_t reposition_owner;			/* owner id with new reposition info, last one
 							 * to update wins */
+
+#define PW_NODE_ACTIVATION_WAKEUP_EVENTFD	0	/* waiter sleeps on the eventfd */
+#define PW_NODE_ACTIVATION_WAKEUP_SPIN		1	/* waiter is spinning on wakeup */
+#define PW_NODE_ACTIVATION_WAKEUP_WAIT		2	/* waiter sleeps in a futex on wakeup */
+#define PW_NODE_ACTIVATION_WAKEUP_SIGNALED	3	/* waiter was woken without the eventfd */
+	uint32_t wakeup;				/* futex word, set by a waiter that wants to be
+							 * woken without the eventfd, see
+							 * pw_node_activation_wake() */
 };
 
 #define ATOMIC_CAS(v,ov,nv)						\
@@ -582,6 +605,134 @@ struct pw_node_activation {
 #define ATOMIC_STORE(s,v)		__atomic_store_n(&(s), (v), __ATOMIC_SEQ_CST)
 #define ATOMIC_XCHG(s,v)		__atomic_exchange_n(&(s), (v), __ATOMIC_SEQ_CST)
 
+/** A bounded queue of ids that can be pushed and popped from multiple
+ * threads without locks. Each cell carries a sequence number that tells
+ * producers and consumers if the cell is free or filled for their lap
+ * around the ring. The number of cells must be a power of 2. */
+struct pw_id_queue_cell {
+	uint32_t seq;
+	uint32_t id;
+};
+
+struct pw_id_queue {
+	uint32_t mask;
+	struct pw_id_queue_cell *cells;
+	uint32_t write_pos SPA_ALIGNED(64);	/* next cell to fill */
+	uint32_t read_pos SPA_ALIGNED(64);	/* next cell to drain */
+};
+
+static inline void pw_id_queue_init(struct pw_id_queue *q,
+		struct pw_id_queue_cell *cells, uint32_t n_cells)
+{
+	uint32_t i;
+	q->mask = n_cells - 1;
+	q->cells = cells;
+	for (i = 0; i < n_cells; i++)
+		__atomic_store_n(&cells[i].seq, i, __ATOMIC_RELAXED);
+	__atomic_store_n(&q->write_pos, 0, __ATOMIC_RELAXED);
+	__atomic_store_n(&q->read_pos, 0, __ATOMIC_RELEASE);
+}
+
+static inline int pw_id_queue_push(struct pw_id_queue *q, uint32_t id)
+{
+	struct pw_id_queue_cell *c;
+	uint32_t pos = __atomic_load_n(&q->write_pos, __ATOMIC_RELAXED);
+	int32_t diff;
+
+	while (true) {
+		c = &q->cells[pos & q->mask];
+		diff = (int32_t)(__atomic_load_n(&c->seq, __ATOMIC_ACQUIRE) - pos);
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&q->write_pos, &pos, pos + 1,
+					1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		} else if (diff < 0) {
+			return -ENOSPC;
+		} else {
+			pos = __atomic_load_n(&q->write_pos, __ATOMIC_RELAXED);
+		}
+	}
+	c->id = id;
+	__atomic_store_n(&c->seq, pos + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+static inline int pw_id_queue_pop(struct pw_id_queue *q, uint32_t *id)
+{
+	struct pw_id_queue_cell *c;
+	uint32_t pos = __atomic_load_n(&q->read_pos, __ATOMIC_RELAXED);
+	int32_t diff;
+
+	while (true) {
+		c = &q->cells[pos & q->mask];
+		diff = (int32_t)(__atomic_load_n(&c->seq, __ATOMIC_ACQUIRE) - (pos + 1));
+		if (diff == 0) {
+			if (__atomic_compare_exchange_n(&q->read_pos, &pos, pos + 1,
+					1, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+				break;
+		} else if (diff < 0) {
+			return -EPIPE;
+		} else {
+			pos = __atomic_load_n(&q->read_pos, __ATOMIC_RELAXED);
+		}
+	}
+	*id = c->id;
+	__atomic_store_n(&c->seq, pos + q->mask + 1, __ATOMIC_RELEASE);
+	return 0;
+}
+
+static inline bool pw_id_queue_is_empty(struct pw_id_queue *q)
+{
+	return (int32_t)(__atomic_load_n(&q->write_pos, __ATOMIC_ACQUIRE) -
+			__atomic_load_n(&q->read_pos, __ATOMIC_ACQUIRE)) <= 0;
+}
+
+#ifdef __linux__
+static inline int pw_futex_wait(uint32_t *addr, uint32_t val, const struct timespec *timeout)
+{
+	return syscall(SYS_futex, addr, FUTEX_WAIT, val, timeout, NULL, 0);
+}
+static inline int pw_futex_wake(uint32_t *addr, int n)
+{
+	return syscall(SYS_futex, addr, FUTEX_WAKE, n, NULL, NULL, 0);
+}
+#endif
+
+/** Try to wake up the owner of \a a without the eventfd. Returns true when
+ * the waiter was spinning or sleeping on the wakeup word and has been woken,
+ * false when the caller needs to write the eventfd. */
+static inline bool pw_node_activation_wake(struct pw_node_activation *a)
+{
+#ifdef __linux__
+	uint32_t w = ATOMIC_LOAD(a->wakeup);
+
+	while (true) {
+		switch (w) {
+		case PW_NODE_ACTIVATION_WAKEUP_SPIN:
+			if (__atomic_compare_exchange_n(&a->wakeup, &w,
+					PW_NODE_ACTIVATION_WAKEUP_SIGNALED, 0,
+					__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST))
+				return true;
+			break;
+		case PW_NODE_ACTIVATION_WAKEUP_WAIT:
+			if (__atomic_compare_exchange_n(&a->wakeup, &w,
+					PW_NODE_ACTIVATION_WAKEUP_SIGNALED, 0,
+					__ATOMIC_SEQ_CST, __ATOMIC_SEQ_CST)) {
+				pw_futex_wake(&a->wakeup, 1);
+				return true;
+			}
+			break;
+		case PW_NODE_ACTIVATION_WAKEUP_SIGNALED:
+			return true;
+		default:
+			return false;
+		}
+	}
+#else
+	return false;
+#endif
+}
+
 #define SEQ_WRITE(s)			ATOMIC_INC(s)
 #define SEQ_WRITE_SUCCESS(s1,s2)	((s1) + 1 == (s2) && ((s2) & 1) == 0)
 
@@ -635,6 +786,7 @@ struct pw_impl_node {
 	unsigned int visited:1;		/**< for sorting */
 	unsigned int want_driver:1;	/**< this node wants to be assigned to a driver */
 	unsigned int passive:1;		/**< driver graph only has passive links */
+	unsigned int recalc_mark:1;	/**< in the set of nodes to recalculate */
 
 	uint32_t port_user_data_size;	/**< extra size for port user data */
 
@@ -644,6 +796,7 @@ struct pw_impl_node {
 	struct spa_list follower_link;
 
 	struct spa_list sort_link;	/**< link used to sort nodes */
+	struct spa_list recalc_link;	/**< link in the set of nodes to recalculate */
 
 	struct spa_node *node;		/**< SPA node implementation */
 	struct spa_hook listener;
@@ -656,6 +809,11 @@ struct pw_impl_node {
 	struct spa_hook_list listener_list;
 
 	struct pw_loop *data_loop;		/**< the data loop for this node */
+	struct pw_loop *work_loop;		/**< the data loop where this node is
+						  *  processed, NULL when not assigned.
+						  *  The rt fields of the node and of its
+						  *  ports are only changed in this loop,
+						  *  see pw_impl_node_rt_loop() */
 
 	struct spa_fraction latency;		/**< requested latency */
 	uint32_t quantum_size;			/**< desired quantum */
@@ -680,7 +838,6 @@ struct pw_impl_node {
 
 		struct ratelimit rate_limit;
 	} rt;
-
         void *user_data;                /**< extra user data */
 };
 
@@ -693,6 +850,7 @@ struct pw_impl_port_mix {
 		uint32_t port_id;
 	} port;
 	struct spa_io_buffers *io;
+	struct pw_impl_port_mix *peer;	/**< mix on the other end of the link */
 	uint32_t id;
 	unsigned int have_buffers:1;
 };
@@ -786,6 +944,13 @@ struct pw_impl_port {
 		struct spa_list mix_list;
 		struct spa_list node_link;
 	} rt;					/**< data only accessed from the data thread */
+	struct {
+		uint32_t consumers;	/**< links that got the last buffer */
+		uint32_t max_consumers;
+		uint64_t buffers;	/**< buffers sent to the links */
+		uint64_t shared;	/**< times a buffer was passed to a link */
+	} fanout;			/**< stats of an output port, only accessed
+					  *  from the data thread */
 	unsigned int added:1;
 
 	void *owner_data;		/**< extra owner data */
@@ -1088,6 +1253,20 @@ int pw_proxy_init(struct pw_proxy *proxy, const char *type, uint32_t version);
 void pw_proxy_remove(struct pw_proxy *proxy);
 
 int pw_context_recalc_graph(struct pw_context *context, const char *reason);
+int pw_context_recalc_nodes(struct pw_context *context, struct pw_impl_node *node,
+		struct pw_impl_node *peer, const char *reason);
+
+int pw_context_assign_loop(struct pw_context *context, struct pw_properties *props);
+struct pw_loop *pw_context_acquire_loop(struct pw_context *context, struct pw_impl_node *node);
+void pw_context_release_loop(struct pw_context *context, struct pw_loop *loop);
+
+/** The loop to invoke changes to the rt fields of a node and its ports on.
+ * Changes that touch two nodes, like links and driver moves, are done with
+ * one invoke on the loop of each node. */
+static inline struct pw_loop *pw_impl_node_rt_loop(struct pw_impl_node *node)
+{
+	return node->work_loop ? node->work_loop : node->data_loop;
+}
 
 void pw_impl_port_update_info(struct pw_impl_port *port, const struct spa_port_info *info);
 
@@ -31,13 +31,96 @@
 #include "pipewire/properties.h"
 
 /** \cond */
+#define INDEX_MIN_ITEMS	16
+
 struct properties {
 	struct pw_properties this;
 
 	struct pw_array items;
+
+	/* open addressing hash of item positions + 1, 0 is a free slot.
+	 * Only changed when the items are changed so that lookups don't
+	 * write and can be done from multiple threads. */
+	uint32_t *index;
+	uint32_t index_mask;
 };
 /** \endcond */
 
+static inline uint32_t hash_key(const char *key)
+{
+	/* FNV-1a */
+	uint32_t h = 2166136261u;
+	while (*key)
+		h = (h ^ (uint8_t)*key++) * 16777619u;
+	return h;
+}
+
+static void index_clear(struct properties *impl)
+{
+	free(impl->index);
+	impl->index = NULL;
+	impl->index_mask = 0;
+}
+
+static void index_insert(struct properties *impl, const char *key, uint32_t pos)
+{
+	uint32_t i = hash_key(key) & impl->index_mask;
+	while (impl->index[i] != 0)
+		i = (i + 1) & impl->index_mask;
+	impl->index[i] = pos + 1;
+}
+
+static uint32_t index_slot(struct properties *impl, const char *key)
+{
+	const struct spa_dict_item *items = impl->this.dict.items;
+	uint32_t i = hash_key(key) & impl->index_mask, pos;
+
+	while ((pos = impl->index[i]) != 0) {
+		if (strcmp(items[pos - 1].key, key) == 0)
+			break;
+		i = (i + 1) & impl->index_mask;
+	}
+	return i;
+}
+
+static void index_remove(struct properties *impl, uint32_t i)
+{
+	const struct spa_dict_item *items = impl->this.dict.items;
+	uint32_t j = i, k, mask = impl->index_mask;
+
+	/* backward shift deletion, move entries up that would otherwise
+	 * become unreachable */
+	while (true) {
+		j = (j + 1) & mask;
+		if (impl->index[j] == 0)
+			break;
+		k = hash_key(items[impl->index[j] - 1].key) & mask;
+		if ((i <= j) ? (i < k && k <= j) : (i < k || k <= j))
+			continue;
+		impl->index[i] = impl->index[j];
+		i = j;
+	}
+	impl->index[i] = 0;
+}
+
+static int index_build(struct properties *impl)
+{
+	const struct spa_dict *dict = &impl->this.dict;
+	uint32_t i, size = 32;
+
+	while (size < dict->n_items * 2)
+		size <<= 1;
+
+	index_clear(impl);
+	if ((impl->index = calloc(size, sizeof(uint32_t))) == NULL)
+		return -errno;
+	impl->index_mask = size - 1;
+
+	for (i = 0; i < dict->n_items; i++)
+		index_insert(impl, dict->items[i].key, i);
+	return 0;
+}
+
 static int add_func(struct pw_properties *this, char *key, char *value)
 {
 	struct spa_dict_item *item;
@@ -55,6 +138,14 @@ static int add_func(struct pw_properties *this, char *key, char *value)
 
 	this->dict.items = impl->items.data;
 	this->dict.n_items++;
+
+	if (impl->index == NULL || this->dict.n_items * 2 > impl->index_mask + 1) {
+		/* lookups fall back to a linear search without index */
+		if (this->dict.n_items >= INDEX_MIN_ITEMS)
+			index_build(impl);
+	} else {
+		index_insert(impl, key, this->dict.n_items - 1);
+	}
 	return 0;
 }
 
@@ -66,7 +157,16 @@ static void clear_item(struct spa_dict_item *item)
 
 static int find_index(const struct pw_properties *this, const char *key)
 {
+	struct properties *impl = SPA_CONTAINER_OF(this, struct properties, this);
 	const struct spa_dict_item *item;
+
+	/* when the items were sorted behind our back, the index is stale
+	 * until the next change and we use bsearch */
+	if (impl->index != NULL &&
+	    !SPA_FLAG_IS_SET(this->dict.flags, SPA_DICT_FLAG_SORTED)) {
+		uint32_t pos = impl->index[index_slot(impl, key)];
+		return (int)pos - 1;
+	}
 	item = spa_dict_lookup_item(&this->dict, key);
 	if (item == NULL)
 		return -1;
@@ -288,6 +388,7 @@ void pw_properties_clear(struct pw_properties *properties)
 		clear_item(item);
 	pw_array_reset(&impl->items);
 	properties->dict.n_items = 0;
+	index_clear(impl);
 }
 
 /** Update properties
@@ -390,6 +491,11 @@ static int do_replace(struct pw_properties *properties, const char *key, char *v
 	if (key == NULL || key[0] == 0)
 		goto exit_noupdate;
 
+	/* the items were reordered, the positions in the index are wrong */
+	if (impl->index != NULL &&
+	    SPA_FLAG_IS_SET(properties->dict.flags, SPA_DICT_FLAG_SORTED))
+		index_clear(impl);
+
 	index = find_index(properties, key);
 
 	if (index == -1) {
@@ -405,9 +511,14 @@ static int do_replace(struct pw_properties *properties, const char *key, char *v
 			goto exit_noupdate;
 
 		if (value == NULL) {
+			uint32_t n_items = pw_array_get_len(&impl->items, struct spa_dict_item);
 			struct spa_dict_item *last = pw_array_get_unchecked(&impl->items,
-						     pw_array_get_len(&impl->items, struct spa_dict_item) - 1,
-						     struct spa_dict_item);
+						     n_items - 1, struct spa_dict_item);
+			if (impl->index != NULL) {
+				index_remove(impl, index_slot(impl, key));
+				if (item != last)
+					impl->index[index_slot(impl, last->key)] = index + 1;
+			}
 			clear_item(item);
 			item->key = last->key;
 			item->value = last->value;
@@ -44,7 +44,7 @@
 
 #define NAME "stream"
 
-#define MAX_BUFFERS	64
+#define MAX_BUFFERS	256
 
 #define MASK_BUFFERS	(MAX_BUFFERS-1)
 #define MAX_PORTS	1
@@ -66,6 +66,8 @@ struct buffer {
 struct queue {
 	uint32_t ids[MAX_BUFFERS];
 	struct spa_ringbuffer ring;
+	struct pw_id_queue mt;
+	struct pw_id_queue_cell cells[MAX_BUFFERS];
 	uint64_t incount;
 	uint64_t outcount;
 };
@@ -146,6 +148,7 @@ struct stream {
 	unsigned int allow_mlock:1;
 	unsigned int warn_mlock:1;
 	unsigned int process_rt:1;
+	unsigned int mt_queues:1;
 };
 
 static int get_param_index(uint32_t id)
@@ -261,10 +264,24 @@ static int update_params(struct stream *impl, uint32_t id,
 }
 
 
+static inline int push_queue_mt(struct stream *stream, struct queue *queue, struct buffer *buffer)
+{
+	if (__atomic_fetch_or(&buffer->flags, BUFFER_FLAG_QUEUED,
+				__ATOMIC_ACQ_REL) & BUFFER_FLAG_QUEUED)
+		return -EINVAL;
+
+	__atomic_fetch_add(&queue->incount, buffer->this.size, __ATOMIC_RELAXED);
+
+	return pw_id_queue_push(&queue->mt, buffer->id);
+}
+
 static inline int push_queue(struct stream *stream, struct queue *queue, struct buffer *buffer)
 {
 	uint32_t index;
 
+	if (stream->mt_queues)
+		return push_queue_mt(stream, queue, buffer);
+
 	if (SPA_FLAG_IS_SET(buffer->flags, BUFFER_FLAG_QUEUED))
 		return -EINVAL;
 
@@ -278,12 +295,33 @@ static inline int push_queue(struct stream *stream, struct queue *queue, struct
 	return 0;
 }
 
+static inline struct buffer *pop_queue_mt(struct stream *stream, struct queue *queue)
+{
+	uint32_t id;
+	struct buffer *buffer;
+	int res;
+
+	if ((res = pw_id_queue_pop(&queue->mt, &id)) < 0) {
+		errno = -res;
+		return NULL;
+	}
+
+	buffer = &stream->buffers[id];
+	__atomic_fetch_add(&queue->outcount, buffer->this.size, __ATOMIC_RELAXED);
+	__atomic_fetch_and(&buffer->flags, ~BUFFER_FLAG_QUEUED, __ATOMIC_ACQ_REL);
+
+	return buffer;
+}
+
 static inline struct buffer *pop_queue(struct stream *stream, struct queue *queue)
 {
 	int32_t avail;
 	uint32_t index, id;
 	struct buffer *buffer;
 
+	if (stream->mt_queues)
+		return pop_queue_mt(stream, queue);
+
 	if ((avail = spa_ringbuffer_get_read_index(&queue->ring, &index)) < 1) {
 		errno = EPIPE;
 		return NULL;
@@ -298,9 +336,20 @@ static inline struct buffer *pop_queue(struct stream *stream, struct queue *queu
 
 	return buffer;
 }
+static inline bool queue_is_empty(struct stream *stream, struct queue *queue)
+{
+	uint32_t index;
+
+	if (stream->mt_queues)
+		return pw_id_queue_is_empty(&queue->mt);
+
+	return spa_ringbuffer_get_read_index(&queue->ring, &index) < 1;
+}
+
 static inline void clear_queue(struct stream *stream, struct queue *queue)
 {
 	spa_ringbuffer_init(&queue->ring);
+	pw_id_queue_init(&queue->mt, queue->cells, MAX_BUFFERS);
 	queue->incount = queue->outcount;
 }
 
@@ -694,6 +743,8 @@ static int impl_port_use_buffers(void *object,
 
 	if (impl->disconnecting && n_buffers > 0)
 		return -EIO;
+	if (n_buffers > MAX_BUFFERS)
+		return -ENOSPC;
 
 	prot = PROT_READ | (direction == SPA_DIRECTION_OUTPUT ? PROT_WRITE : 0);
 
@@ -818,7 +869,6 @@ static int impl_node_process_output(void *object)
 	struct spa_io_buffers *io = impl->io;
 	struct buffer *b;
 	int res;
-	uint32_t index;
 
 again:
 	pw_log_trace(NAME" %p: process out status:%d id:%d", stream,
@@ -859,14 +909,14 @@ again:
 		if (!impl->process_rt) {
 			/* not realtime and we have a free buffer, trigger process so that we have
 			 * data in the next round. */
-			if (spa_ringbuffer_get_read_index(&impl->dequeued.ring, &index) > 0)
+			if (!queue_is_empty(impl, &impl->dequeued))
 				call_process(impl);
 		} else if (io->status == SPA_STATUS_NEED_DATA) {
 			/* realtime and we don't have a buffer, trigger process and try
 			 * again when there is something in the queue now */
 			call_process(impl);
 			if (impl->draining ||
-			    spa_ringbuffer_get_read_index(&impl->queued.ring, &index) > 0)
+			    !queue_is_empty(impl, &impl->queued))
 				goto again;
 		}
 	}
@@ -1204,8 +1254,8 @@ stream_new(struct pw_context *context, const char *name,
 	this->name = name ? strdup(name) : NULL;
 	this->node_id = SPA_ID_INVALID;
 
-	spa_ringbuffer_init(&impl->dequeued.ring);
-	spa_ringbuffer_init(&impl->queued.ring);
+	clear_queue(impl, &impl->dequeued);
+	clear_queue(impl, &impl->queued);
 	spa_list_init(&impl->param_list);
 
 	spa_hook_list_init(&this->listener_list);
@@ -1567,6 +1617,9 @@ pw_stream_connect(struct pw_stream *stream,
 		pw_properties_set(stream->properties, PW_KEY_NODE_DONT_RECONNECT, "true");
 
 	impl->process_rt = SPA_FLAG_IS_SET(flags, PW_STREAM_FLAG_RT_PROCESS);
+	impl->mt_queues = SPA_FLAG_IS_SET(flags, PW_STREAM_FLAG_MT_QUEUES);
+	clear_queue(impl, &impl->dequeued);
+	clear_queue(impl, &impl->queued);
 
 	if ((str = pw_properties_get(stream->properties, "mem.warn-mlock")) != NULL)
 		impl->warn_mlock = pw_properties_parse_bool(str);
@@ -254,6 +254,10 @@ enum pw_stream_flags {
 	PW_STREAM_FLAG_ALLOC_BUFFERS	= (1 << 8),	/**< the application will allocate buffer
 							  *  memory. In the add_buffer event, the
 							  *  data of the buffer should be set */
+	PW_STREAM_FLAG_MT_QUEUES	= (1 << 9),	/**< use lock-free buffer queues so that
+							  *  pw_stream_dequeue_buffer() and
+							  *  pw_stream_queue_buffer() can be called
+							  *  from multiple threads at once */
 };
 
 /** Create a new unconneced \ref pw_stream \memberof pw_stream
@@ -0,0 +1,155 @@
+/* PipeWire
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <assert.h>
+
+#include <spa/utils/dict.h>
+
+#include <pipewire/properties.h>
+#include <pipewire/keys.h>
+
+#define MAX_COUNT 200000
+#define MAX_ITEMS 128
+
+static const char *common_keys[] = {
+	PW_KEY_OBJECT_ID, PW_KEY_OBJECT_PATH, PW_KEY_CLIENT_ID, PW_KEY_DEVICE_ID,
+	PW_KEY_FACTORY_ID, PW_KEY_MEDIA_CLASS, PW_KEY_MEDIA_NAME, PW_KEY_MEDIA_ROLE,
+	PW_KEY_NODE_NAME, PW_KEY_NODE_DESCRIPTION, PW_KEY_NODE_NICK, PW_KEY_NODE_LATENCY,
+	PW_KEY_APP_NAME, PW_KEY_APP_ID, PW_KEY_APP_ICON_NAME, PW_KEY_APP_PROCESS_ID,
+	PW_KEY_APP_PROCESS_BINARY, PW_KEY_DEVICE_API, PW_KEY_DEVICE_NAME,
+	PW_KEY_DEVICE_DESCRIPTION, PW_KEY_PRIORITY_SESSION, PW_KEY_PRIORITY_DRIVER,
+	PW_KEY_AUDIO_CHANNELS, PW_KEY_AUDIO_FORMAT, PW_KEY_AUDIO_RATE,
+	PW_KEY_STREAM_MONITOR, PW_KEY_PORT_NAME, PW_KEY_PORT_DIRECTION,
+	PW_KEY_FORMAT_DSP, PW_KEY_NODE_GROUP,
+};
+
+static char keys[MAX_ITEMS][64];
+
+static void gen_keys(void)
+{
+	uint32_t i;
+
+	for (i = 0; i < MAX_ITEMS; i++) {
+		if (i < SPA_N_ELEMENTS(common_keys))
+			snprintf(keys[i], sizeof(keys[i]), "%s", common_keys[i]);
+		else
+			snprintf(keys[i], sizeof(keys[i]), "api.alsa.prop.%u", i);
+	}
+}
+
+static uint64_t get_time(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return SPA_TIMESPEC_TO_NSEC(&ts);
+}
+
+static void report(const char *what, uint32_t n_items, uint64_t t)
+{
+	fprintf(stderr, "%3u %-10s elapsed %"PRIu64" count %u = %"PRIu64"/sec\n",
+			n_items, what, t, MAX_COUNT,
+			MAX_COUNT * (uint64_t)SPA_NSEC_PER_SEC / t);
+}
+
+static void test_lookup(uint32_t n_items)
+{
+	struct pw_properties *props;
+	struct spa_dict_item *items;
+	struct spa_dict dict;
+	uint32_t i, idx;
+	uint64_t t1, t2;
+	const char *str;
+
+	props = pw_properties_new(NULL, NULL);
+	for (i = 0; i < n_items; i++)
+		pw_properties_set(props, keys[i], keys[i]);
+
+	/* pw_properties, with the hash index past the size threshold */
+	t1 = get_time();
+	for (i = 0; i < MAX_COUNT; i++) {
+		idx = random() % n_items;
+		str = pw_properties_get(props, keys[idx]);
+		assert(str != NULL && strcmp(str, keys[idx]) == 0);
+	}
+	t2 = get_time();
+	report("properties", n_items, t2 - t1);
+
+	/* a miss scans the whole dict in the linear case */
+	t1 = get_time();
+	for (i = 0; i < MAX_COUNT; i++) {
+		str = pw_properties_get(props, "not.a.key");
+		assert(str == NULL);
+	}
+	t2 = get_time();
+	report("miss", n_items, t2 - t1);
+
+	/* a plain unsorted copy, linear scan */
+	items = calloc(n_items, sizeof(struct spa_dict_item));
+	memcpy(items, props->dict.items, n_items * sizeof(struct spa_dict_item));
+	dict = SPA_DICT_INIT(items, n_items);
+
+	t1 = get_time();
+	for (i = 0; i < MAX_COUNT; i++) {
+		idx = random() % n_items;
+		str = spa_dict_lookup(&dict, keys[idx]);
+		assert(str != NULL && strcmp(str, keys[idx]) == 0);
+	}
+	t2 = get_time();
+	report("linear", n_items, t2 - t1);
+
+	/* the sorted copy, binary search */
+	spa_dict_qsort(&dict);
+
+	t1 = get_time();
+	for (i = 0; i < MAX_COUNT; i++) {
+		idx = random() % n_items;
+		str = spa_dict_lookup(&dict, keys[idx]);
+		assert(str != NULL && strcmp(str, keys[idx]) == 0);
+	}
+	t2 = get_time();
+	report("sorted", n_items, t2 - t1);
+
+	free(items);
+	pw_properties_free(props);
+}
+
+int main(int argc, char *argv[])
+{
+	gen_keys();
+
+	/* warmup */
+	test_lookup(MAX_ITEMS);
+
+	test_lookup(8);
+	test_lookup(16);
+	test_lookup(40);
+	test_lookup(80);
+	test_lookup(MAX_ITEMS);
+
+	return 0;
+}
@@ -0,0 +1,183 @@
+/* PipeWire
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+
+#include <spa/utils/defs.h>
+
+#include <pipewire/pipewire.h>
+
+#define MAX_CYCLES	2000
+#define N_CLIENTS	100
+#define QUANTUM		64
+#define RATE		48000
+
+/* A driver that wakes up N_CLIENTS clients every cycle and waits for
+ * all of them to signal completion, like the graph does with eventfds
+ * in resume_node() and node_on_fd_events(). The driver loop uses the
+ * system under test, the clients all run on one loop in another thread. */
+struct client {
+	struct data *data;
+	int fd;
+	struct spa_source *source;
+};
+
+struct data {
+	struct pw_loop *loop;
+	struct pw_loop *client_loop;
+	struct spa_source *done;
+	struct client clients[N_CLIENTS];
+	uint32_t pending;
+	uint32_t cycles;
+	bool running;
+};
+
+static void start_cycle(struct data *d)
+{
+	uint32_t i;
+
+	d->pending = N_CLIENTS;
+	for (i = 0; i < N_CLIENTS; i++)
+		spa_system_eventfd_write(d->loop->system, d->clients[i].fd, 1);
+}
+
+static void on_done(void *data, int fd, uint32_t mask)
+{
+	struct data *d = data;
+	uint64_t count;
+
+	if (spa_system_eventfd_read(d->loop->system, fd, &count) < 0)
+		return;
+
+	d->pending -= SPA_MIN(count, (uint64_t)d->pending);
+	if (d->pending > 0)
+		return;
+
+	if (++d->cycles < MAX_CYCLES)
+		start_cycle(d);
+}
+
+static void on_client(void *data, int fd, uint32_t mask)
+{
+	struct client *c = data;
+	struct pw_loop *loop = c->data->client_loop;
+	uint64_t count;
+
+	if (spa_system_eventfd_read(loop->system, fd, &count) < 0)
+		return;
+
+	spa_system_eventfd_write(loop->system, c->data->done->fd, 1);
+}
+
+static void *client_thread(void *data)
+{
+	struct data *d = data;
+
+	pw_loop_enter(d->client_loop);
+	while (d->running)
+		pw_loop_iterate(d->client_loop, -1);
+	pw_loop_leave(d->client_loop);
+	return NULL;
+}
+
+static void run_test(const char *lib, const char *sqpoll)
+{
+	struct data d = { 0, };
+	struct pw_properties *props;
+	struct timespec ts;
+	pthread_t thread;
+	uint64_t t1, t2, cycle;
+	uint32_t i;
+
+	props = pw_properties_new(PW_KEY_LIBRARY_NAME_SYSTEM, lib,
+			"system.io-uring.sqpoll", sqpoll,
+			NULL);
+	d.loop = pw_loop_new(&props->dict);
+	pw_properties_free(props);
+	if (d.loop == NULL) {
+		fprintf(stderr, "%s: skipped, can't load: %m\n", lib);
+		return;
+	}
+	d.client_loop = pw_loop_new(NULL);
+
+	d.done = pw_loop_add_io(d.loop,
+			spa_system_eventfd_create(d.loop->system,
+				SPA_FD_CLOEXEC | SPA_FD_NONBLOCK),
+			SPA_IO_IN, true, on_done, &d);
+
+	for (i = 0; i < N_CLIENTS; i++) {
+		struct client *c = &d.clients[i];
+		c->data = &d;
+		c->fd = spa_system_eventfd_create(d.client_loop->system,
+				SPA_FD_CLOEXEC | SPA_FD_NONBLOCK);
+		c->source = pw_loop_add_io(d.client_loop, c->fd,
+				SPA_IO_IN, true, on_client, c);
+	}
+
+	d.running = true;
+	pthread_create(&thread, NULL, client_thread, &d);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	pw_loop_enter(d.loop);
+	start_cycle(&d);
+	while (d.cycles < MAX_CYCLES)
+		pw_loop_iterate(d.loop, -1);
+	pw_loop_leave(d.loop);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	d.running = false;
+	spa_system_eventfd_write(d.client_loop->system, d.clients[0].fd, 1);
+	pthread_join(thread, NULL);
+
+	cycle = (t2 - t1) / MAX_CYCLES;
+	fprintf(stderr, "%s%s: elapsed %"PRIu64" cycles %u clients %u = %"PRIu64
+			" nsec/cycle (%.2f%% of a %u/%u quantum)\n",
+			lib, strcmp(sqpoll, "true") == 0 ? " (sqpoll)" : "",
+			t2 - t1, MAX_CYCLES, N_CLIENTS, cycle,
+			cycle * 100.0 / (QUANTUM * SPA_NSEC_PER_SEC / RATE),
+			QUANTUM, RATE);
+
+	for (i = 0; i < N_CLIENTS; i++)
+		pw_loop_destroy_source(d.client_loop, d.clients[i].source);
+	pw_loop_destroy_source(d.loop, d.done);
+	pw_loop_destroy(d.client_loop);
+	pw_loop_destroy(d.loop);
+}
+
+int main(int argc, char *argv[])
+{
+	pw_init(&argc, &argv);
+
+	run_test("support/libspa-support", "false");
+	run_test("support/libspa-uring", "false");
+	run_test("support/libspa-uring", "true");
+
+	return 0;
+}
@@ -0,0 +1,175 @@
+/* PipeWire
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/epoll.h>
+
+#include <spa/utils/defs.h>
+
+#include "pipewire/private.h"
+
+#define MAX_COUNT 100000
+
+enum mode {
+	MODE_EVENTFD,
+	MODE_FUTEX,
+	MODE_SPIN,
+};
+
+static const char *mode_names[] = { "eventfd", "futex", "spin" };
+
+/* one side of the ping-pong, like a node waiting for its activation */
+struct side {
+	struct pw_node_activation activation;
+	int fd;
+	int epfd;
+	enum mode mode;
+	struct side *peer;
+};
+
+static void side_wait(struct side *s)
+{
+	struct pw_node_activation *a = &s->activation;
+	struct epoll_event ev;
+	uint64_t cmd;
+
+	switch (s->mode) {
+	case MODE_SPIN:
+		while (ATOMIC_LOAD(a->wakeup) == PW_NODE_ACTIVATION_WAKEUP_SPIN);
+		break;
+	case MODE_FUTEX:
+		if (ATOMIC_CAS(a->wakeup, PW_NODE_ACTIVATION_WAKEUP_SPIN,
+					PW_NODE_ACTIVATION_WAKEUP_WAIT)) {
+			while (ATOMIC_LOAD(a->wakeup) == PW_NODE_ACTIVATION_WAKEUP_WAIT)
+				pw_futex_wait(&a->wakeup, PW_NODE_ACTIVATION_WAKEUP_WAIT, NULL);
+		}
+		break;
+	case MODE_EVENTFD:
+		while (epoll_wait(s->epfd, &ev, 1, -1) != 1);
+		if (read(s->fd, &cmd, sizeof(cmd)) != sizeof(cmd))
+			fprintf(stderr, "read failed: %m\n");
+		return;
+	}
+	/* the next wait starts spinning again, like the remote-node hook */
+	ATOMIC_STORE(a->wakeup, PW_NODE_ACTIVATION_WAKEUP_SPIN);
+}
+
+static void side_signal(struct side *s)
+{
+	struct side *p = s->peer;
+	uint64_t cmd = 1;
+
+	if (pw_node_activation_wake(&p->activation))
+		return;
+	if (write(p->fd, &cmd, sizeof(cmd)) != sizeof(cmd))
+		fprintf(stderr, "write failed: %m\n");
+}
+
+static void *pong_thread(void *data)
+{
+	struct side *s = data;
+	int i;
+
+	for (i = 0; i < MAX_COUNT; i++) {
+		side_wait(s);
+		side_signal(s);
+	}
+	return NULL;
+}
+
+static void side_init(struct side *s, enum mode mode, struct side *peer)
+{
+	struct epoll_event ev;
+
+	spa_zero(s->activation);
+	s->mode = mode;
+	s->peer = peer;
+	s->fd = eventfd(0, EFD_CLOEXEC);
+	s->epfd = epoll_create1(EPOLL_CLOEXEC);
+	ev.events = EPOLLIN;
+	ev.data.ptr = s;
+	epoll_ctl(s->epfd, EPOLL_CTL_ADD, s->fd, &ev);
+	if (mode != MODE_EVENTFD)
+		s->activation.wakeup = PW_NODE_ACTIVATION_WAKEUP_SPIN;
+}
+
+static void side_clear(struct side *s)
+{
+	close(s->epfd);
+	close(s->fd);
+}
+
+static void run_test(enum mode mode)
+{
+	struct side ping, pong;
+	struct timespec ts;
+	pthread_t thread;
+	uint64_t t1, t2;
+	int i;
+
+	side_init(&ping, mode, &pong);
+	side_init(&pong, mode, &ping);
+
+	pthread_create(&thread, NULL, pong_thread, &pong);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t1 = SPA_TIMESPEC_TO_NSEC(&ts);
+	for (i = 0; i < MAX_COUNT; i++) {
+		side_signal(&ping);
+		side_wait(&ping);
+	}
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	t2 = SPA_TIMESPEC_TO_NSEC(&ts);
+
+	pthread_join(thread, NULL);
+
+	fprintf(stderr, "%s: elapsed %"PRIu64" count %u = %"PRIu64" nsec/hop\n",
+			mode_names[mode], t2 - t1, MAX_COUNT,
+			(t2 - t1) / (MAX_COUNT * 2));
+
+	side_clear(&ping);
+	side_clear(&pong);
+}
+
+int main(int argc, char *argv[])
+{
+	cpu_set_t cpuset;
+
+	CPU_ZERO(&cpuset);
+	sched_getaffinity(0, sizeof(cpuset), &cpuset);
+
+	run_test(MODE_EVENTFD);
+	run_test(MODE_FUTEX);
+	/* spinning only makes sense when both sides have their own CPU */
+	if (CPU_COUNT(&cpuset) > 1)
+		run_test(MODE_SPIN);
+	else
+		fprintf(stderr, "spin: skipped, need more than 1 CPU\n");
+	return 0;
+}
@@ -0,0 +1,299 @@
+/* PipeWire
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <spa/node/node.h>
+#include <spa/param/props.h>
+#include <spa/pod/builder.h>
+
+#include <pipewire/pipewire.h>
+#include <pipewire/impl.h>
+
+#include "pipewire/private.h"
+
+#define N_LINKS	64
+#define N_MIX	3
+
+struct node {
+	struct spa_handle *handle;
+	struct pw_impl_node *node;
+};
+
+static void make_node(struct pw_context *context, struct node *n,
+		const char *factory, const char *name, bool driver)
+{
+	struct pw_properties *props;
+	void *iface;
+
+	props = pw_properties_new(
+			SPA_KEY_FACTORY_NAME, factory,
+			PW_KEY_NODE_NAME, name,
+			NULL);
+	/* the follower goes to the pool loop, its plugin gets that loop */
+	if (!driver)
+		pw_properties_set(props, PW_KEY_NODE_DATA_LOOP, "1");
+
+	n->handle = pw_context_load_spa_handle(context, factory, &props->dict);
+	spa_assert(n->handle != NULL);
+	spa_assert(spa_handle_get_interface(n->handle, SPA_TYPE_INTERFACE_Node, &iface) >= 0);
+
+	if (!driver) {
+		uint8_t buffer[1024];
+		struct spa_pod_builder b = SPA_POD_BUILDER_INIT(buffer, sizeof(buffer));
+
+		/* a live source needs to be configured before it can run */
+		spa_assert(spa_node_set_param(iface, SPA_PARAM_Props, 0,
+				spa_pod_builder_add_object(&b,
+					SPA_TYPE_OBJECT_Props, SPA_PARAM_Props,
+					SPA_PROP_live, SPA_POD_Bool(false))) >= 0);
+	}
+
+	n->node = pw_context_create_node(context, props, 0);
+	spa_assert(n->node != NULL);
+	spa_assert(pw_impl_node_set_implementation(n->node, iface) >= 0);
+
+	/* the spa node info says it can drive, make sure only the sink does */
+	pw_impl_node_update_properties(n->node,
+			&SPA_DICT_INIT_ARRAY(((struct spa_dict_item[]) {
+				{ PW_KEY_NODE_DRIVER, driver ? "true" : "false" } })));
+
+	spa_assert(pw_impl_node_register(n->node, NULL) >= 0);
+	spa_assert(pw_impl_node_set_active(n->node, true) >= 0);
+}
+
+static void clear_node(struct node *n)
+{
+	pw_impl_node_destroy(n->node);
+	pw_unload_spa_handle(n->handle);
+}
+
+static void iterate(struct pw_loop *loop, int n_iter)
+{
+	while (n_iter-- > 0)
+		pw_loop_iterate(loop, 1);
+}
+
+static void test_link_pool_loop(void)
+{
+	struct pw_main_loop *ml;
+	struct pw_loop *loop;
+	struct pw_context *context;
+	struct node src, sink;
+	struct pw_impl_port *out, *in;
+	uint64_t finish_time;
+	int i;
+
+	ml = pw_main_loop_new(NULL);
+	loop = pw_main_loop_get_loop(ml);
+	context = pw_context_new(loop,
+			pw_properties_new(
+				"context.data-loops", "2",
+				"default.clock.quantum", "64",
+				"default.clock.min-quantum", "64",
+				NULL),
+			0);
+	spa_assert(context != NULL);
+	pw_context_add_spa_lib(context, "audiotestsrc", "audiotestsrc/libspa-audiotestsrc");
+
+	make_node(context, &sink, "support.null-audio-sink", "sink", true);
+	make_node(context, &src, "audiotestsrc", "src", false);
+
+	out = pw_impl_node_find_port(src.node, PW_DIRECTION_OUTPUT, PW_ID_ANY);
+	in = pw_impl_node_find_port(sink.node, PW_DIRECTION_INPUT, PW_ID_ANY);
+	spa_assert(out != NULL);
+	spa_assert(in != NULL);
+
+	/* link and unlink while the source is being processed in its
+	 * pool loop and the sink drives the graph from the main data loop */
+	for (i = 0; i < N_LINKS; i++) {
+		struct pw_impl_link *link;
+
+		link = pw_context_create_link(context, out, in, NULL, NULL, 0);
+		spa_assert(link != NULL);
+		spa_assert(pw_impl_link_register(link, NULL) >= 0);
+
+		iterate(loop, 10);
+		spa_assert(src.node->info.state == PW_NODE_STATE_RUNNING);
+		spa_assert(src.node->driver_node == sink.node);
+		spa_assert(src.node->work_loop != NULL);
+		spa_assert(src.node->work_loop != sink.node->work_loop);
+		spa_assert(src.node->work_loop ==
+				pw_data_loop_get_loop(context->data_loops[1]));
+
+		finish_time = src.node->rt.activation->finish_time;
+		while (src.node->rt.activation->finish_time == finish_time)
+			pw_loop_iterate(loop, 1);
+
+		pw_impl_link_destroy(link);
+		iterate(loop, i % 4);
+	}
+
+	clear_node(&src);
+	clear_node(&sink);
+	pw_context_destroy(context);
+	pw_main_loop_destroy(ml);
+}
+
+struct reuse_node {
+	struct spa_node node;
+	uint32_t n_reuse;
+	uint32_t buffer_id;
+};
+
+static int reuse_node_port_reuse_buffer(void *object, uint32_t port_id, uint32_t buffer_id)
+{
+	struct reuse_node *r = object;
+	r->n_reuse++;
+	r->buffer_id = buffer_id;
+	return 0;
+}
+
+static const struct spa_node_methods reuse_node_methods = {
+	SPA_VERSION_NODE_METHODS,
+	.port_reuse_buffer = reuse_node_port_reuse_buffer,
+};
+
+static void test_mix_input(void)
+{
+	struct pw_main_loop *ml;
+	struct pw_context *context;
+	struct pw_impl_node node[N_MIX + 1];
+	struct pw_impl_port *in, *out[N_MIX];
+	struct pw_impl_port_mix in_mix[N_MIX], out_mix[N_MIX];
+	struct spa_io_buffers io[N_MIX];
+	struct reuse_node peer[N_MIX];
+	int i;
+
+	ml = pw_main_loop_new(NULL);
+	context = pw_context_new(pw_main_loop_get_loop(ml),
+			pw_properties_new("context.data-loops", "2", NULL), 0);
+	spa_assert(context != NULL);
+
+	/* only the loop of the nodes is looked at */
+	for (i = 0; i < N_MIX + 1; i++) {
+		spa_zero(node[i]);
+		node[i].data_loop = context->data_loop;
+	}
+
+	/* an input port without a mixer, linked to N_MIX output ports. The
+	 * output ports get a mixer that records the buffers given back */
+	in = pw_context_create_port(context, PW_DIRECTION_INPUT, 0, NULL, 0);
+	spa_assert(in != NULL);
+	in->node = &node[N_MIX];
+
+	for (i = 0; i < N_MIX; i++) {
+		out[i] = pw_context_create_port(context, PW_DIRECTION_OUTPUT, 0, NULL, 0);
+		spa_assert(out[i] != NULL);
+		out[i]->node = &node[i];
+
+		spa_zero(peer[i]);
+		peer[i].node.iface = SPA_INTERFACE_INIT(
+				SPA_TYPE_INTERFACE_Node,
+				SPA_VERSION_NODE,
+				&reuse_node_methods, &peer[i]);
+		pw_impl_port_set_mix(out[i], &peer[i].node, 0);
+
+		spa_zero(out_mix[i]);
+		out_mix[i].p = out[i];
+		out_mix[i].port.direction = PW_DIRECTION_OUTPUT;
+		out_mix[i].port.port_id = 0;
+
+		io[i] = SPA_IO_BUFFERS_INIT;
+		spa_zero(in_mix[i]);
+		in_mix[i].p = in;
+		in_mix[i].port.direction = PW_DIRECTION_INPUT;
+		in_mix[i].port.port_id = i;
+		in_mix[i].io = &io[i];
+		in_mix[i].peer = &out_mix[i];
+	}
+
+	/* a single link passes its buffer by reference and the buffer goes
+	 * back to the peer it came from */
+	spa_list_append(&in->rt.mix_list, &in_mix[0].rt_link);
+	io[0].status = SPA_STATUS_HAVE_DATA;
+	io[0].buffer_id = 3;
+	spa_node_process(in->mix);
+	spa_assert(in->rt.io.status == SPA_STATUS_HAVE_DATA);
+	spa_assert(in->rt.io.buffer_id == 3);
+	spa_assert(io[0].status == SPA_STATUS_NEED_DATA);
+
+	spa_node_port_reuse_buffer(in->mix, 0, 3);
+	spa_assert(peer[0].n_reuse == 1);
+	spa_assert(peer[0].buffer_id == 3);
+
+	/* with more links, the first input with data is passed, the others
+	 * are consumed and the reuse goes to the peer of the passed input */
+	for (i = 1; i < N_MIX; i++)
+		spa_list_append(&in->rt.mix_list, &in_mix[i].rt_link);
+	io[0].status = SPA_STATUS_NEED_DATA;
+	for (i = 1; i < N_MIX; i++) {
+		io[i].status = SPA_STATUS_HAVE_DATA;
+		io[i].buffer_id = 4 + i;
+	}
+	spa_node_process(in->mix);
+	spa_assert(in->rt.io.status == SPA_STATUS_HAVE_DATA);
+	spa_assert(in->rt.io.buffer_id == 5);
+	for (i = 0; i < N_MIX; i++)
+		spa_assert(io[i].status == SPA_STATUS_NEED_DATA);
+
+	spa_node_port_reuse_buffer(in->mix, 0, 5);
+	spa_assert(peer[0].n_reuse == 1);
+	spa_assert(peer[1].n_reuse == 1);
+	spa_assert(peer[1].buffer_id == 5);
+	spa_assert(peer[2].n_reuse == 0);
+
+	/* a peer processed in another loop is never called */
+	node[2].work_loop = pw_data_loop_get_loop(context->data_loops[1]);
+	io[2].status = SPA_STATUS_HAVE_DATA;
+	io[2].buffer_id = 7;
+	spa_node_process(in->mix);
+	spa_assert(in->rt.io.buffer_id == 7);
+
+	spa_node_port_reuse_buffer(in->mix, 0, 7);
+	spa_assert(peer[2].n_reuse == 0);
+
+	/* unknown buffers are ignored */
+	spa_node_port_reuse_buffer(in->mix, 0, 2);
+	for (i = 0; i < N_MIX; i++)
+		spa_assert(peer[i].n_reuse == (i == 0 || i == 1 ? 1 : 0));
+
+	for (i = 0; i < N_MIX; i++) {
+		spa_list_remove(&in_mix[i].rt_link);
+		out[i]->node = NULL;
+		pw_impl_port_destroy(out[i]);
+	}
+	in->node = NULL;
+	pw_impl_port_destroy(in);
+	pw_context_destroy(context);
+	pw_main_loop_destroy(ml);
+}
+
+int main(int argc, char *argv[])
+{
+	pw_init(&argc, &argv);
+
+	test_mix_input();
+	test_link_pool_loop();
+
+	return 0;
+}
@@ -0,0 +1,285 @@
+/* PipeWire
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <pthread.h>
+
+#include <pipewire/pipewire.h>
+
+#define N_THREADS	8
+#define N_ITEMS		20000
+#define N_BURST		1000
+
+struct msg {
+	uint32_t thread;
+	uint32_t seq;
+	char pad[200];
+};
+
+struct data {
+	struct pw_loop *loop;
+	bool running;
+	uint32_t last[N_THREADS];
+};
+
+static int do_item(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	struct data *d = user_data;
+	const struct msg *m = data;
+
+	spa_assert(size == sizeof(*m));
+	spa_assert(m->thread < N_THREADS);
+	/* items from one thread are run in order */
+	spa_assert(m->seq == d->last[m->thread] + 1);
+	d->last[m->thread] = m->seq;
+	return m->seq * 2;
+}
+
+static int do_quit(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	struct data *d = user_data;
+	d->running = false;
+	return 0;
+}
+
+static void *loop_thread(void *user_data)
+{
+	struct data *d = user_data;
+
+	pw_loop_enter(d->loop);
+	while (d->running)
+		pw_loop_iterate(d->loop, -1);
+	pw_loop_leave(d->loop);
+	return NULL;
+}
+
+struct producer {
+	struct data *data;
+	uint32_t id;
+	bool nonblock;
+	pthread_t thread;
+};
+
+static void *producer_thread(void *user_data)
+{
+	struct producer *p = user_data;
+	uint32_t i;
+
+	for (i = 1; i <= N_ITEMS; i++) {
+		struct msg m = { p->id, i, };
+		bool block = !p->nonblock && (i % 64) == 0;
+		int res;
+
+		res = pw_loop_invoke(p->data->loop, do_item, 1, &m, sizeof(m),
+				block, p->data);
+		if (block)
+			spa_assert(res == (int)i * 2);
+		else
+			spa_assert(res >= 0);
+	}
+	return NULL;
+}
+
+static void test_invoke(void)
+{
+	struct data data = { 0, };
+	struct producer prod[N_THREADS];
+	pthread_t thread;
+	uint32_t i;
+
+	data.loop = pw_loop_new(NULL);
+	spa_assert(data.loop != NULL);
+	data.running = true;
+
+	/* more than fits in the queue before the loop runs, the
+	 * remaining items are spilled and still run in order */
+	for (i = 1; i <= N_BURST; i++) {
+		struct msg m = { 0, i, };
+		spa_assert(pw_loop_invoke(data.loop, do_item, 1, &m, sizeof(m),
+					false, &data) >= 0);
+	}
+
+	pthread_create(&thread, NULL, loop_thread, &data);
+	for (i = 1; i < N_THREADS; i++) {
+		prod[i].data = &data;
+		prod[i].id = i;
+		pthread_create(&prod[i].thread, NULL, producer_thread, &prod[i]);
+	}
+	for (i = 1; i < N_THREADS; i++)
+		pthread_join(prod[i].thread, NULL);
+
+	pw_loop_invoke(data.loop, do_quit, 1, NULL, 0, true, &data);
+	pthread_join(thread, NULL);
+
+	spa_assert(data.last[0] == N_BURST);
+	for (i = 1; i < N_THREADS; i++)
+		spa_assert(data.last[i] == N_ITEMS);
+
+	pw_loop_destroy(data.loop);
+}
+
+static int do_count(struct spa_loop *loop, bool async, uint32_t seq,
+		const void *data, size_t size, void *user_data)
+{
+	uint32_t *count = user_data;
+	return ++(*count);
+}
+
+static void test_invoke_in_thread(void)
+{
+	struct data data = { 0, };
+	struct producer prod[N_THREADS];
+	uint32_t i, count = 0;
+	int res;
+
+	data.loop = pw_loop_new(NULL);
+	spa_assert(data.loop != NULL);
+
+	pw_loop_enter(data.loop);
+	for (i = 1; i < N_THREADS; i++) {
+		prod[i].data = &data;
+		prod[i].id = i;
+		prod[i].nonblock = true;
+		pthread_create(&prod[i].thread, NULL, producer_thread, &prod[i]);
+	}
+	/* the item has run when the invoke returns, also when other threads
+	 * are still writing their items */
+	for (i = 1; i <= N_ITEMS; i++) {
+		bool block = i & 1;
+
+		res = pw_loop_invoke(data.loop, do_count, 1, NULL, 0, block, &count);
+		spa_assert(count == i);
+		if (block)
+			spa_assert(res == (int)i);
+	}
+	for (i = 1; i < N_THREADS; i++)
+		pthread_join(prod[i].thread, NULL);
+
+	pw_loop_invoke(data.loop, NULL, 1, NULL, 0, true, NULL);
+	for (i = 1; i < N_THREADS; i++)
+		spa_assert(data.last[i] == N_ITEMS);
+	pw_loop_leave(data.loop);
+
+	pw_loop_destroy(data.loop);
+}
+
+#define N_TIMERS	8
+
+struct timers {
+	struct pw_loop *loop;
+	struct spa_source *timer[N_TIMERS];
+	struct spa_source *periodic;
+	uint32_t order[N_TIMERS];
+	uint64_t n_periodic;
+};
+
+static void on_one_shot(void *data, uint64_t expirations)
+{
+	uint32_t *fired = data;
+	spa_assert(expirations == 1);
+	(*fired)++;
+}
+
+static void on_periodic(void *data, uint64_t expirations)
+{
+	struct timers *t = data;
+
+	spa_assert(expirations >= 1);
+	t->n_periodic += expirations;
+	/* destroying a timer from its callback */
+	if (t->n_periodic >= 5) {
+		pw_loop_destroy_source(t->loop, t->periodic);
+		t->periodic = NULL;
+	}
+}
+
+static void test_timers(void)
+{
+	struct timers t = { 0, };
+	uint32_t fired[N_TIMERS] = { 0, }, i, n_fired = 0, seq = 0;
+	struct timespec value, interval;
+
+	t.loop = pw_loop_new(NULL);
+	spa_assert(t.loop != NULL);
+
+	/* timers armed out of order expire in order, the last one
+	 * is disarmed again and never expires */
+	for (i = 0; i < N_TIMERS; i++) {
+		uint32_t ms = ((i * 5) % N_TIMERS) + 1;
+
+		t.timer[i] = pw_loop_add_timer(t.loop, on_one_shot, &fired[i]);
+		spa_assert(t.timer[i] != NULL);
+		value.tv_sec = 0;
+		value.tv_nsec = ms * SPA_NSEC_PER_MSEC;
+		t.order[i] = ms;
+		pw_loop_update_timer(t.loop, t.timer[i], &value, NULL, false);
+	}
+	pw_loop_update_timer(t.loop, t.timer[N_TIMERS - 1], NULL, NULL, false);
+
+	value.tv_sec = 0;
+	value.tv_nsec = 1;
+	interval.tv_sec = 0;
+	interval.tv_nsec = 2 * SPA_NSEC_PER_MSEC;
+	t.periodic = pw_loop_add_timer(t.loop, on_periodic, &t);
+	spa_assert(t.periodic != NULL);
+	pw_loop_update_timer(t.loop, t.periodic, &value, &interval, false);
+
+	pw_loop_enter(t.loop);
+	while (n_fired < N_TIMERS - 1 || t.periodic != NULL) {
+		pw_loop_iterate(t.loop, -1);
+
+		for (i = 0, n_fired = 0; i < N_TIMERS; i++) {
+			spa_assert(fired[i] <= 1);
+			n_fired += fired[i];
+		}
+		/* all timers with an earlier timeout have expired */
+		for (i = 0; i < N_TIMERS; i++) {
+			if (!fired[i])
+				continue;
+			seq = SPA_MAX(seq, t.order[i]);
+		}
+		for (i = 0; i < N_TIMERS - 1; i++)
+			spa_assert(fired[i] || t.order[i] > seq);
+	}
+	pw_loop_leave(t.loop);
+
+	spa_assert(fired[N_TIMERS - 1] == 0);
+	spa_assert(t.n_periodic >= 5);
+
+	for (i = 0; i < N_TIMERS; i++)
+		pw_loop_destroy_source(t.loop, t.timer[i]);
+	pw_loop_destroy(t.loop);
+}
+
+int main(int argc, char *argv[])
+{
+	pw_init(&argc, &argv);
+
+	test_invoke();
+	test_invoke_in_thread();
+	test_timers();
+
+	return 0;
+}
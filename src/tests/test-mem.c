@@ -0,0 +1,201 @@
+/* PipeWire
+ *
+ * Copyright © 2021 Wim Taymans
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a
+ * copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation
+ * the rights to use, copy, modify, merge, publish, distribute, sublicense,
+ * and/or sell copies of the Software, and to permit persons to whom the
+ * Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice (including the next
+ * paragraph) shall be included in all copies or substantial portions of the
+ * Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+ * DEALINGS IN THE SOFTWARE.
+ */
+
+#include <unistd.h>
+
+#include <spa/utils/ringbuffer.h>
+
+#include <pipewire/pipewire.h>
+
+static void test_map_twice(void)
+{
+	struct pw_mempool *pool;
+	struct pw_memblock *mem;
+	struct pw_memmap *map, *map2;
+	uint32_t size = sysconf(_SC_PAGESIZE);
+	uint8_t *p;
+
+	pool = pw_mempool_new(NULL);
+	spa_assert(pool != NULL);
+
+	mem = pw_mempool_alloc(pool, PW_MEMBLOCK_FLAG_READWRITE,
+			SPA_DATA_MemFd, size);
+	spa_assert(mem != NULL);
+
+	/* unaligned areas can't be mirrored */
+	map = pw_memblock_map(mem, PW_MEMMAP_FLAG_READWRITE | PW_MEMMAP_FLAG_TWICE,
+			0, size - 16, NULL);
+	spa_assert(map == NULL);
+	map = pw_memblock_map(mem, PW_MEMMAP_FLAG_READWRITE | PW_MEMMAP_FLAG_TWICE |
+			PW_MEMMAP_FLAG_PRIVATE, 0, size, NULL);
+	spa_assert(map == NULL);
+
+	map = pw_memblock_map(mem, PW_MEMMAP_FLAG_READWRITE | PW_MEMMAP_FLAG_TWICE,
+			0, size, NULL);
+	spa_assert(map != NULL);
+	p = map->ptr;
+
+	/* writes in one copy show up in the other */
+	p[0] = 0x12;
+	spa_assert(p[size] == 0x12);
+	p[size + size - 1] = 0x34;
+	spa_assert(p[size - 1] == 0x34);
+
+	/* a normal map of the same area reuses the mapping */
+	map2 = pw_memblock_map(mem, PW_MEMMAP_FLAG_READWRITE, 16, 32, NULL);
+	spa_assert(map2 != NULL);
+	spa_assert(map2->ptr == p + 16);
+	pw_memmap_free(map2);
+
+	pw_memmap_free(map);
+	pw_memblock_unref(mem);
+	pw_mempool_destroy(pool);
+}
+
+static void test_ringbuffer_span(void)
+{
+	struct pw_mempool *pool;
+	struct pw_memblock *mem;
+	struct pw_memmap *map;
+	struct spa_ringbuffer rb;
+	uint32_t i, size = sysconf(_SC_PAGESIZE), idx;
+	const void *rd;
+	void *wr;
+	int32_t avail;
+
+	pool = pw_mempool_new(NULL);
+	mem = pw_mempool_alloc(pool, PW_MEMBLOCK_FLAG_READWRITE,
+			SPA_DATA_MemFd, size);
+	spa_assert(mem != NULL);
+	map = pw_memblock_map(mem, PW_MEMMAP_FLAG_READWRITE | PW_MEMMAP_FLAG_TWICE,
+			0, size, NULL);
+	spa_assert(map != NULL);
+
+	spa_ringbuffer_init(&rb);
+	spa_ringbuffer_write_update(&rb, size - 8);
+	spa_ringbuffer_read_update(&rb, size - 8);
+
+	/* write over the end of the memory in one go */
+	avail = spa_ringbuffer_get_write_span(&rb, map->ptr, size, &idx, &wr);
+	spa_assert(avail == (int32_t)size);
+	spa_assert(wr == SPA_MEMBER(map->ptr, size - 8, void));
+	for (i = 0; i < 32; i++)
+		((uint8_t*)wr)[i] = i;
+	spa_ringbuffer_write_update(&rb, idx + 32);
+
+	avail = spa_ringbuffer_get_write_span(&rb, map->ptr, size, &idx, &wr);
+	spa_assert(avail == (int32_t)size - 32);
+	spa_assert(wr == SPA_MEMBER(map->ptr, 24, void));
+
+	/* and read it back in one go */
+	avail = spa_ringbuffer_get_read_span(&rb, map->ptr, size, &idx, &rd);
+	spa_assert(avail == 32);
+	spa_assert(rd == SPA_MEMBER(map->ptr, size - 8, void));
+	for (i = 0; i < 32; i++)
+		spa_assert(((const uint8_t*)rd)[i] == i);
+	spa_ringbuffer_read_update(&rb, idx + 32);
+
+	/* the data wrapped around in the memory */
+	spa_assert(((uint8_t*)map->ptr)[0] == 8);
+
+	pw_memmap_free(map);
+	pw_memblock_unref(mem);
+	pw_mempool_destroy(pool);
+}
+
+static void test_recycle(void)
+{
+	struct pw_mempool *pool, *other;
+	struct pw_memblock *mem, *mem2, *imp;
+	uint32_t size = sysconf(_SC_PAGESIZE);
+	int fd;
+
+	pool = pw_mempool_new(NULL);
+	spa_assert(pool != NULL);
+
+	/* sizes are rounded up to pages so that the block can be reused */
+	mem = pw_mempool_alloc(pool, PW_MEMBLOCK_FLAG_READWRITE |
+			PW_MEMBLOCK_FLAG_MAP | PW_MEMBLOCK_FLAG_RECYCLE,
+			SPA_DATA_MemFd, size + 1);
+	spa_assert(mem != NULL);
+	spa_assert(mem->size == size * 2);
+	fd = mem->fd;
+	memset(mem->map->ptr, 0xff, mem->size);
+	pw_memblock_unref(mem);
+
+	/* a freed block of the same size is reused, cleared */
+	mem = pw_mempool_alloc(pool, PW_MEMBLOCK_FLAG_READWRITE |
+			PW_MEMBLOCK_FLAG_MAP | PW_MEMBLOCK_FLAG_RECYCLE,
+			SPA_DATA_MemFd, size + 16);
+	spa_assert(mem != NULL);
+	spa_assert(mem->fd == fd);
+	spa_assert(pw_mempool_find_id(pool, mem->id) == mem);
+	spa_assert(((uint8_t*)mem->map->ptr)[0] == 0);
+	spa_assert(((uint8_t*)mem->map->ptr)[size] == 0);
+
+	/* but not for other sizes */
+	mem2 = pw_mempool_alloc(pool, PW_MEMBLOCK_FLAG_READWRITE |
+			PW_MEMBLOCK_FLAG_MAP | PW_MEMBLOCK_FLAG_RECYCLE,
+			SPA_DATA_MemFd, size * 4);
+	spa_assert(mem2 != NULL);
+	spa_assert(mem2->fd != fd);
+	pw_memblock_unref(mem2);
+
+	/* blocks that were shared with another pool are not reused */
+	other = pw_mempool_new(NULL);
+	imp = pw_mempool_import_block(other, mem);
+	spa_assert(imp != NULL);
+	pw_memblock_unref(imp);
+	pw_memblock_unref(mem);
+
+	mem = pw_mempool_alloc(pool, PW_MEMBLOCK_FLAG_READWRITE |
+			PW_MEMBLOCK_FLAG_MAP | PW_MEMBLOCK_FLAG_RECYCLE,
+			SPA_DATA_MemFd, size * 2);
+	spa_assert(mem != NULL);
+	pw_memblock_unref(mem);
+
+	pw_mempool_destroy(other);
+	pw_mempool_destroy(pool);
+
+	/* recycling can be disabled */
+	pool = pw_mempool_new(pw_properties_new("mem.recycle", "none", NULL));
+	mem = pw_mempool_alloc(pool, PW_MEMBLOCK_FLAG_READWRITE |
+			PW_MEMBLOCK_FLAG_MAP | PW_MEMBLOCK_FLAG_RECYCLE,
+			SPA_DATA_MemFd, size + 1);
+	spa_assert(mem != NULL);
+	spa_assert(mem->size == size + 1);
+	pw_memblock_unref(mem);
+	pw_mempool_destroy(pool);
+}
+
+int main(int argc, char *argv[])
+{
+	pw_init(&argc, &argv);
+
+	test_map_twice();
+	test_ringbuffer_span();
+	test_recycle();
+
+	return 0;
+}
@@ -22,6 +22,8 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <pthread.h>
+
 #include <pipewire/properties.h>
 
 static void test_abi(void)
@@ -347,6 +349,119 @@ static void test_new_json(void)
 	pw_properties_free(props);
 }
 
+static void test_large(void)
+{
+	struct pw_properties *props;
+	char key[32], val[32];
+	const char *str;
+	int i;
+
+	props = pw_properties_new(NULL, NULL);
+	spa_assert(props != NULL);
+
+	for (i = 0; i < 200; i++) {
+		snprintf(key, sizeof(key), "key.%d", i);
+		snprintf(val, sizeof(val), "%d", i);
+		spa_assert(pw_properties_set(props, key, val) == 1);
+		spa_assert((str = pw_properties_get(props, key)) != NULL);
+		spa_assert(!strcmp(str, val));
+	}
+	spa_assert(props->dict.n_items == 200);
+	spa_assert(pw_properties_get(props, "key.200") == NULL);
+
+	/* remove every other key, moving the last item around */
+	for (i = 0; i < 200; i += 2) {
+		snprintf(key, sizeof(key), "key.%d", i);
+		spa_assert(pw_properties_set(props, key, NULL) == 1);
+		spa_assert(pw_properties_get(props, key) == NULL);
+	}
+	spa_assert(props->dict.n_items == 100);
+
+	for (i = 0; i < 200; i++) {
+		snprintf(key, sizeof(key), "key.%d", i);
+		str = pw_properties_get(props, key);
+		if (i & 1) {
+			spa_assert(str != NULL);
+			spa_assert(pw_properties_parse_int(str) == i);
+			spa_assert(pw_properties_set(props, key, "x") == 1);
+		} else {
+			spa_assert(str == NULL);
+		}
+	}
+	for (i = 1; i < 200; i += 2) {
+		snprintf(key, sizeof(key), "key.%d", i);
+		spa_assert(!strcmp(pw_properties_get(props, key), "x"));
+	}
+
+	/* reordering the items is still handled */
+	spa_dict_qsort(&props->dict);
+	spa_assert(!strcmp(pw_properties_get(props, "key.1"), "x"));
+	spa_assert(pw_properties_set(props, "key.0", "0") == 1);
+	spa_assert(pw_properties_set(props, "key.1", NULL) == 1);
+	spa_assert(pw_properties_get(props, "key.1") == NULL);
+	spa_assert(!strcmp(pw_properties_get(props, "key.0"), "0"));
+	spa_assert(!strcmp(pw_properties_get(props, "key.199"), "x"));
+
+	pw_properties_clear(props);
+	spa_assert(props->dict.n_items == 0);
+	spa_assert(pw_properties_get(props, "key.0") == NULL);
+
+	for (i = 0; i < 50; i++) {
+		snprintf(key, sizeof(key), "key.%d", i);
+		spa_assert(pw_properties_set(props, key, key) == 1);
+	}
+	for (i = 0; i < 50; i++) {
+		snprintf(key, sizeof(key), "key.%d", i);
+		spa_assert(!strcmp(pw_properties_get(props, key), key));
+	}
+	pw_properties_free(props);
+}
+
+#define N_THREADS	4
+
+static void *lookup_thread(void *data)
+{
+	const struct pw_properties *props = data;
+	char key[32];
+	int i, j;
+
+	for (j = 0; j < 1000; j++) {
+		for (i = 0; i < 64; i++) {
+			snprintf(key, sizeof(key), "key.%d", i);
+			spa_assert(pw_properties_parse_int(pw_properties_get(props, key)) == i);
+		}
+	}
+	return NULL;
+}
+
+static void test_threads(void)
+{
+	struct pw_properties *props, *copy;
+	pthread_t threads[N_THREADS];
+	char key[32], val[32];
+	int i;
+
+	props = pw_properties_new(NULL, NULL);
+	spa_assert(props != NULL);
+	for (i = 0; i < 64; i++) {
+		snprintf(key, sizeof(key), "key.%d", i);
+		snprintf(val, sizeof(val), "%d", i);
+		pw_properties_set(props, key, val);
+	}
+	copy = pw_properties_copy(props);
+	spa_assert(copy != NULL);
+
+	/* lookups don't change the properties and can run concurrently,
+	 * also on a copy that was never looked up before */
+	for (i = 0; i < N_THREADS; i++)
+		spa_assert(pthread_create(&threads[i], NULL, lookup_thread, copy) == 0);
+	for (i = 0; i < N_THREADS; i++)
+		pthread_join(threads[i], NULL);
+
+	pw_properties_free(copy);
+	pw_properties_free(props);
+}
+
 int main(int argc, char *argv[])
 {
 	test_abi();
@@ -359,6 +474,8 @@ int main(int argc, char *argv[])
 	test_update();
 	test_parse();
 	test_new_json();
+	test_large();
+	test_threads();
 
 	return 0;
 }
@@ -22,10 +22,15 @@
  * DEALINGS IN THE SOFTWARE.
  */
 
+#include <pthread.h>
+#include <sched.h>
+
 #include <pipewire/pipewire.h>
 #include <pipewire/main-loop.h>
 #include <pipewire/stream.h>
 
+#include "pipewire/private.h"
+
 #define TEST_FUNC(a,b,func)	\
 do {				\
 	a.func = b.func;	\
@@ -235,6 +240,235 @@ static void test_properties(void)
 	pw_main_loop_destroy(loop);
 }
 
+#define MT_QUEUE_SIZE		256
+#define MT_QUEUE_THREADS	4
+#define MT_QUEUE_LOOPS		200000
+
+struct mt_queue_data {
+	struct pw_id_queue free;
+	struct pw_id_queue_cell free_cells[MT_QUEUE_SIZE];
+	struct pw_id_queue filled;
+	struct pw_id_queue_cell filled_cells[MT_QUEUE_SIZE];
+	uint32_t owned[MT_QUEUE_SIZE];
+};
+
+/* like an encoder thread: dequeue a free id, own it and queue it */
+static void *mt_queue_producer(void *user_data)
+{
+	struct mt_queue_data *d = user_data;
+	uint32_t i, id;
+
+	for (i = 0; i < MT_QUEUE_LOOPS; i++) {
+		while (pw_id_queue_pop(&d->free, &id) < 0)
+			sched_yield();
+		spa_assert(id < MT_QUEUE_SIZE);
+		spa_assert(ATOMIC_XCHG(d->owned[id], 1) == 0);
+		spa_assert(ATOMIC_XCHG(d->owned[id], 0) == 1);
+		spa_assert(pw_id_queue_push(&d->filled, id) == 0);
+	}
+	return NULL;
+}
+
+/* like the process thread: take queued ids and recycle them */
+static void *mt_queue_consumer(void *user_data)
+{
+	struct mt_queue_data *d = user_data;
+	uint32_t i, id;
+
+	for (i = 0; i < MT_QUEUE_LOOPS; i++) {
+		while (pw_id_queue_pop(&d->filled, &id) < 0)
+			sched_yield();
+		spa_assert(id < MT_QUEUE_SIZE);
+		spa_assert(pw_id_queue_push(&d->free, id) == 0);
+	}
+	return NULL;
+}
+
+static void test_mt_queue(void)
+{
+	struct mt_queue_data *d;
+	pthread_t producers[MT_QUEUE_THREADS], consumers[MT_QUEUE_THREADS];
+	uint32_t i, id, count = 0;
+	uint8_t seen[MT_QUEUE_SIZE] = { 0, };
+
+	d = calloc(1, sizeof(*d));
+	spa_assert(d != NULL);
+	pw_id_queue_init(&d->free, d->free_cells, MT_QUEUE_SIZE);
+	pw_id_queue_init(&d->filled, d->filled_cells, MT_QUEUE_SIZE);
+
+	spa_assert(pw_id_queue_is_empty(&d->free));
+	spa_assert(pw_id_queue_pop(&d->free, &id) == -EPIPE);
+
+	for (i = 0; i < MT_QUEUE_SIZE; i++)
+		spa_assert(pw_id_queue_push(&d->free, i) == 0);
+	spa_assert(pw_id_queue_push(&d->free, 0) == -ENOSPC);
+
+	for (i = 0; i < MT_QUEUE_THREADS; i++) {
+		spa_assert(pthread_create(&producers[i], NULL, mt_queue_producer, d) == 0);
+		spa_assert(pthread_create(&consumers[i], NULL, mt_queue_consumer, d) == 0);
+	}
+	for (i = 0; i < MT_QUEUE_THREADS; i++) {
+		pthread_join(producers[i], NULL);
+		pthread_join(consumers[i], NULL);
+	}
+
+	/* every id must be back in the free queue exactly once */
+	spa_assert(pw_id_queue_is_empty(&d->filled));
+	while (pw_id_queue_pop(&d->free, &id) == 0) {
+		spa_assert(id < MT_QUEUE_SIZE);
+		spa_assert(seen[id] == 0);
+		seen[id] = 1;
+		count++;
+	}
+	spa_assert(count == MT_QUEUE_SIZE);
+
+	free(d);
+}
+
+#define MT_STREAM_BUFFERS	16
+#define MT_STREAM_LOOPS		50000
+
+struct mt_stream_data {
+	struct pw_export_type export;
+	struct pw_stream *stream;
+	struct spa_node *node;
+	struct spa_io_buffers io;
+	struct spa_buffer buffers[MT_STREAM_BUFFERS];
+	uint32_t owned[MT_STREAM_BUFFERS];
+	uint32_t running;
+	uint32_t processed;
+};
+
+static struct mt_stream_data *mt_stream;
+
+/* keep the stream node local, the test is the peer of the node */
+static struct pw_proxy *mt_stream_export(struct pw_core *core,
+		const char *type, const struct spa_dict *props, void *object,
+		size_t user_data_size)
+{
+	struct pw_impl_node *node = object;
+	mt_stream->node = node->node;
+	return pw_proxy_new((struct pw_proxy*)core, type, PW_VERSION_NODE, user_data_size);
+}
+
+/* an application thread: fill a dequeued buffer and queue it */
+static void *mt_stream_producer(void *user_data)
+{
+	struct mt_stream_data *d = user_data;
+	struct pw_buffer *b;
+	uint32_t i, id;
+
+	for (i = 0; i < MT_STREAM_LOOPS; i++) {
+		while ((b = pw_stream_dequeue_buffer(d->stream)) == NULL)
+			sched_yield();
+		id = b->buffer - d->buffers;
+		spa_assert(id < MT_STREAM_BUFFERS);
+		spa_assert(ATOMIC_XCHG(d->owned[id], 1) == 0);
+		spa_assert(ATOMIC_XCHG(d->owned[id], 0) == 1);
+		spa_assert(pw_stream_queue_buffer(d->stream, b) == 0);
+	}
+	return NULL;
+}
+
+/* the data thread: take the queued buffer and recycle the previous one */
+static void *mt_stream_process(void *user_data)
+{
+	struct mt_stream_data *d = user_data;
+
+	while (__atomic_load_n(&d->running, __ATOMIC_ACQUIRE)) {
+		spa_node_process(d->node);
+		if (d->io.status != SPA_STATUS_HAVE_DATA) {
+			sched_yield();
+			continue;
+		}
+		spa_assert(d->io.buffer_id < MT_STREAM_BUFFERS);
+		spa_assert(__atomic_load_n(&d->owned[d->io.buffer_id], __ATOMIC_ACQUIRE) == 0);
+		d->io.status = SPA_STATUS_NEED_DATA;
+		d->processed++;
+	}
+	return NULL;
+}
+
+static void test_mt_stream(void)
+{
+	struct pw_main_loop *loop;
+	struct pw_context *context;
+	struct pw_core *core;
+	struct mt_stream_data *d;
+	struct spa_buffer *buffers[MT_STREAM_BUFFERS];
+	struct pw_buffer *b;
+	pthread_t producers[MT_QUEUE_THREADS], process;
+	uint32_t i, id, count = 0;
+	uint8_t seen[MT_STREAM_BUFFERS] = { 0, };
+
+	d = calloc(1, sizeof(*d));
+	spa_assert(d != NULL);
+
+	loop = pw_main_loop_new(NULL);
+	context = pw_context_new(pw_main_loop_get_loop(loop), NULL, 0);
+	spa_assert(context != NULL);
+	core = pw_context_connect_self(context, NULL, 0);
+	spa_assert(core != NULL);
+	/* go before the export of the client-node module */
+	mt_stream = d;
+	d->export.type = PW_TYPE_INTERFACE_Node;
+	d->export.func = mt_stream_export;
+	spa_list_prepend(&context->export_list, &d->export.link);
+
+	d->stream = pw_stream_new(core, "test", NULL);
+	spa_assert(d->stream != NULL);
+	spa_assert(pw_stream_connect(d->stream, PW_DIRECTION_OUTPUT, PW_ID_ANY,
+				PW_STREAM_FLAG_MT_QUEUES |
+				PW_STREAM_FLAG_RT_PROCESS, NULL, 0) == 0);
+	spa_assert(d->node != NULL);
+
+	/* give the stream node buffers and run its process function in a
+	 * data thread while the application threads queue buffers */
+
+	d->io = SPA_IO_BUFFERS_INIT;
+	spa_assert(spa_node_port_set_io(d->node, SPA_DIRECTION_OUTPUT, 0,
+				SPA_IO_Buffers, &d->io, sizeof(d->io)) == 0);
+	for (i = 0; i < MT_STREAM_BUFFERS; i++)
+		buffers[i] = &d->buffers[i];
+	spa_assert(spa_node_port_use_buffers(d->node, SPA_DIRECTION_OUTPUT, 0, 0,
+				buffers, MT_STREAM_BUFFERS) == 0);
+
+	d->running = 1;
+	spa_assert(pthread_create(&process, NULL, mt_stream_process, d) == 0);
+	for (i = 0; i < MT_QUEUE_THREADS; i++)
+		spa_assert(pthread_create(&producers[i], NULL, mt_stream_producer, d) == 0);
+	for (i = 0; i < MT_QUEUE_THREADS; i++)
+		pthread_join(producers[i], NULL);
+	__atomic_store_n(&d->running, 0, __ATOMIC_RELEASE);
+	pthread_join(process, NULL);
+
+	spa_assert(d->processed > 0);
+	spa_assert(d->processed <= MT_QUEUE_THREADS * MT_STREAM_LOOPS);
+
+	/* recycle what is left, every buffer must be dequeued exactly once */
+	do {
+		d->io.status = SPA_STATUS_NEED_DATA;
+		spa_node_process(d->node);
+	} while (d->io.status == SPA_STATUS_HAVE_DATA);
+
+	while ((b = pw_stream_dequeue_buffer(d->stream)) != NULL) {
+		id = b->buffer - d->buffers;
+		spa_assert(id < MT_STREAM_BUFFERS);
+		spa_assert(seen[id] == 0);
+		seen[id] = 1;
+		count++;
+	}
+	spa_assert(count == MT_STREAM_BUFFERS);
+
+	spa_assert(spa_node_port_use_buffers(d->node, SPA_DIRECTION_OUTPUT, 0, 0,
+				NULL, 0) == 0);
+	pw_stream_destroy(d->stream);
+	spa_list_remove(&d->export.link);
+	pw_context_destroy(context);
+	pw_main_loop_destroy(loop);
+	free(d);
+}
+
 int main(int argc, char *argv[])
 {
 	pw_init(&argc, &argv);
@@ -242,6 +476,8 @@ int main(int argc, char *argv[])
 	test_abi();
 	test_create();
 	test_properties();
+	test_mt_queue();
+	test_mt_stream();
 
 	return 0;
 }
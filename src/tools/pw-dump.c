@@ -37,6 +37,7 @@
 
 #include <pipewire/pipewire.h>
 #include <extensions/metadata.h>
+#include <extensions/registry-snapshot.h>
 
 #define INDENT 2
 
@@ -60,6 +61,10 @@ struct data {
 	struct pw_registry *registry;
 	struct spa_hook registry_listener;
 
+	struct pw_registry_snapshot *snapshot;
+	struct spa_hook snapshot_listener;
+	struct spa_hook snapshot_proxy_listener;
+
 	struct spa_list object_list;
 
 	uint32_t id;
@@ -1199,6 +1204,13 @@ static const struct pw_proxy_events proxy_events = {
         .destroy = destroy_proxy,
 };
 
+static void *bind_object(struct data *d, uint32_t id, const char *type, uint32_t version)
+{
+	if (d->registry)
+		return pw_registry_bind(d->registry, id, type, version, 0);
+	return pw_registry_snapshot_bind(d->snapshot, id, type, version, 0);
+}
+
 static void registry_event_global(void *data, uint32_t id,
 			uint32_t permissions, const char *type, uint32_t version,
 			const struct spa_dict *props)
@@ -1223,8 +1235,7 @@ static void registry_event_global(void *data, uint32_t id,
 
 	o->class = find_class(type, version);
 	if (o->class != NULL) {
-		o->proxy = pw_registry_bind(d->registry,
-				id, type, o->class->version, 0);
+		o->proxy = bind_object(d, id, type, o->class->version);
 		if (o->proxy == NULL)
 			goto bind_failed;
 
@@ -1271,6 +1282,120 @@ static const struct pw_registry_events registry_events = {
 	.global_remove = registry_event_global_remove,
 };
 
+static void snapshot_event_snapshot(void *data, uint32_t mem_id, uint32_t offset, uint32_t size)
+{
+	struct data *d = data;
+	const struct pw_registry_snapshot_header *h;
+	const struct pw_registry_snapshot_global *g;
+	struct spa_dict_item *items = NULL;
+	struct pw_memmap *mm;
+	uint32_t i, max_items = 0;
+	int res;
+
+	mm = pw_mempool_map_id(pw_core_get_mempool(d->core), mem_id,
+			PW_MEMMAP_FLAG_READ, offset, size, NULL);
+	if (mm == NULL) {
+		pw_log_error("can't map snapshot: %m");
+		return;
+	}
+	h = mm->ptr;
+	if ((res = pw_registry_snapshot_check(h, size)) < 0) {
+		pw_log_error("invalid snapshot: %s", spa_strerror(res));
+		goto done;
+	}
+	for (i = 0; i < h->n_globals; i++)
+		max_items = SPA_MAX(max_items, pw_registry_snapshot_get_global(h, i)->n_items);
+	if (max_items > 0 && (items = calloc(max_items, sizeof(*items))) == NULL) {
+		pw_log_error("can't alloc snapshot properties: %m");
+		goto done;
+	}
+	for (i = 0; i < h->n_globals; i++) {
+		struct spa_dict props;
+
+		g = pw_registry_snapshot_get_global(h, i);
+		props = SPA_DICT_INIT(items,
+				pw_registry_snapshot_get_props(h, g, items, max_items));
+		registry_event_global(d, g->id, g->permissions,
+				pw_registry_snapshot_get_string(h, g->type),
+				g->version, &props);
+	}
+	free(items);
+	core_sync(d);
+done:
+	pw_memmap_free(mm);
+}
+
+static void snapshot_event_global(void *data, uint32_t id,
+			uint32_t permissions, const char *type, uint32_t version,
+			const struct spa_dict *props)
+{
+	struct data *d = data;
+	struct object *o;
+
+	if ((o = find_object(d, id)) == NULL) {
+		registry_event_global(data, id, permissions, type, version, props);
+		return;
+	}
+	/* the permissions or properties of a known global changed */
+	o->permissions = permissions;
+	if (o->props)
+		pw_properties_free(o->props);
+	o->props = props ? pw_properties_new_dict(props) : NULL;
+	o->changed++;
+	core_sync(d);
+}
+
+static const struct pw_registry_snapshot_events snapshot_events = {
+	PW_VERSION_REGISTRY_SNAPSHOT_EVENTS,
+	.snapshot = snapshot_event_snapshot,
+	.global = snapshot_event_global,
+	.global_remove = registry_event_global_remove,
+};
+
+static void get_registry(struct data *d)
+{
+	d->registry = pw_core_get_registry(d->core,
+			PW_VERSION_REGISTRY, 0);
+	pw_registry_add_listener(d->registry,
+			&d->registry_listener,
+			&registry_events, d);
+}
+
+static void snapshot_removed(void *data)
+{
+	struct data *d = data;
+
+	spa_hook_remove(&d->snapshot_listener);
+	spa_hook_remove(&d->snapshot_proxy_listener);
+	pw_proxy_destroy((struct pw_proxy*)d->snapshot);
+	d->snapshot = NULL;
+}
+
+static const struct pw_proxy_events snapshot_proxy_events = {
+	PW_VERSION_PROXY_EVENTS,
+	.removed = snapshot_removed,
+};
+
+static void get_globals(struct data *d)
+{
+	/* get all globals at once from a snapshot when the server can
+	 * make one, else follow the registry */
+	d->snapshot = pw_core_create_object(d->core,
+			PW_REGISTRY_SNAPSHOT_FACTORY,
+			PW_TYPE_INTERFACE_RegistrySnapshot,
+			PW_VERSION_REGISTRY_SNAPSHOT, NULL, 0);
+	if (d->snapshot == NULL) {
+		get_registry(d);
+		return;
+	}
+	pw_registry_snapshot_add_listener(d->snapshot,
+			&d->snapshot_listener,
+			&snapshot_events, d);
+	pw_proxy_add_listener((struct pw_proxy*)d->snapshot,
+			&d->snapshot_proxy_listener,
+			&snapshot_proxy_events, d);
+}
+
 static void dump_objects(struct data *d)
 {
 	struct object *o;
@@ -1309,6 +1434,15 @@ static void on_core_error(void *data, uint32_t id, int seq, int res, const char
 {
 	struct data *d = data;
 
+	if (d->snapshot && id == pw_proxy_get_id((struct pw_proxy*)d->snapshot) &&
+	    d->registry == NULL) {
+		/* the server has no snapshot factory, it removes the
+		 * snapshot object next */
+		pw_log_info("no registry snapshot: %s, using the registry", message);
+		get_registry(d);
+		return;
+	}
+
 	pw_log_error("error id:%u seq:%d res:%d (%s): %s",
 			id, seq, res, spa_strerror(res), message);
 
@@ -1451,11 +1585,7 @@ int main(int argc, char *argv[])
 	pw_core_add_listener(data.core,
 			&data.core_listener,
 			&core_events, &data);
-	data.registry = pw_core_get_registry(data.core,
-			PW_VERSION_REGISTRY, 0);
-	pw_registry_add_listener(data.registry,
-			&data.registry_listener,
-			&registry_events, &data);
+	get_globals(&data);
 
 	pw_main_loop_run(data.loop);
 
@@ -1464,7 +1594,10 @@ int main(int argc, char *argv[])
 	if (data.info)
 		pw_core_info_free(data.info);
 
-	pw_proxy_destroy((struct pw_proxy*)data.registry);
+	if (data.snapshot)
+		pw_proxy_destroy((struct pw_proxy*)data.snapshot);
+	if (data.registry)
+		pw_proxy_destroy((struct pw_proxy*)data.registry);
 	pw_context_destroy(data.context);
 	pw_main_loop_destroy(data.loop);
 	pw_deinit();
@@ -26,6 +26,11 @@
 #include <signal.h>
 #include <getopt.h>
 #include <locale.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <ncurses.h>
 
 #include <spa/utils/result.h>
@@ -64,6 +69,9 @@ struct node {
 	struct node *driver;
 	uint32_t errors;
 	int32_t last_error_status;
+	struct pw_profiler_histogram wait;
+	struct pw_profiler_histogram busy;
+	unsigned int seen:1;
 };
 
 struct data {
@@ -85,7 +93,13 @@ struct data {
 	int n_nodes;
 	struct spa_list node_list;
 
+	struct pw_profiler_shm *shm;
+	size_t shm_size;
+	uint64_t shm_index;
+	struct pw_profiler_node *shm_nodes;
+
 	WINDOW *win;
+	unsigned int show_percentiles:1;
 };
 
 struct point {
@@ -154,6 +168,21 @@ static void remove_node(struct data *d, struct node *n)
 	free(n);
 }
 
+static void update_node(struct node *n, const struct measurement *m, bool histograms)
+{
+	n->measurement = *m;
+	if (m->status != 3) {
+		n->errors++;
+		if (n->last_error_status == -1)
+			n->last_error_status = m->status;
+	}
+	if (histograms && m->signal > 0 && m->signal >= m->prev_signal &&
+	    m->awake >= m->signal && m->finish >= m->awake) {
+		pw_profiler_histogram_add(&n->wait, m->awake - m->signal);
+		pw_profiler_histogram_add(&n->busy, m->finish - m->awake);
+	}
+}
+
 static int process_driver_block(struct data *d, const struct spa_pod *pod, struct point *point)
 {
 	char *name = NULL;
@@ -178,15 +207,9 @@ static int process_driver_block(struct data *d, const struct spa_pod *pod, struc
 		return -ENOENT;
 
 	n->driver = n;
-	n->measurement = m;
 	n->info = point->info;
 	point->driver = n;
-
-	if (m.status != 3) {
-		n->errors++;
-		if (n->last_error_status == -1)
-			n->last_error_status = m.status;
-	}
+	update_node(n, &m, true);
 	return 0;
 }
 
@@ -213,13 +236,8 @@ static int process_follower_block(struct data *d, const struct spa_pod *pod, str
 	if ((n = find_node(d, id)) == NULL)
 		return -ENOENT;
 
-	n->measurement = m;
 	n->driver = point->driver;
-	if (m.status != 3) {
-		n->errors++;
-		if (n->last_error_status == -1)
-			n->last_error_status = m.status;
-	}
+	update_node(n, &m, true);
 	return 0;
 }
 
@@ -247,6 +265,8 @@ static void print_node(struct data *d, struct driver *i, struct node *n)
 	char buf2[64];
 	char buf3[64];
 	char buf4[64];
+	char buf5[64];
+	char buf6[64];
 	float waiting, busy, quantum;
 	struct spa_fraction frac;
 
@@ -260,10 +280,25 @@ static void print_node(struct data *d, struct driver *i, struct node *n)
 	else
 		quantum = 0.0;
 
-	waiting = (n->measurement.awake - n->measurement.signal) / 1000000000.f,
-	busy = (n->measurement.finish - n->measurement.awake) / 1000000000.f,
+	waiting = (n->measurement.awake - n->measurement.signal) / 1000000000.f;
+	busy = (n->measurement.finish - n->measurement.awake) / 1000000000.f;
 
-	snprintf(line, sizeof(line), "%s %4.1u %6.1u %6.1u %s %s %s %s  %3.1u  %s%s",
+	if (d->show_percentiles)
+		snprintf(line, sizeof(line), "%s %4.1u %6.1u %6.1u %s %s %s %s %s %s  %3.1u  %s%s",
+			n->measurement.status != 3 ? "!" : " ",
+			n->id,
+			frac.num, frac.denom,
+			print_time(buf1, 64, pw_profiler_histogram_percentile(&n->wait, 0.5)),
+			print_time(buf2, 64, pw_profiler_histogram_percentile(&n->wait, 0.99)),
+			print_time(buf3, 64, pw_profiler_histogram_percentile(&n->wait, 0.999)),
+			print_time(buf4, 64, pw_profiler_histogram_percentile(&n->busy, 0.5)),
+			print_time(buf5, 64, pw_profiler_histogram_percentile(&n->busy, 0.99)),
+			print_time(buf6, 64, pw_profiler_histogram_percentile(&n->busy, 0.999)),
+			i->xrun_count + n->errors,
+			n->driver == n ? "" : " + ",
+			n->name);
+	else
+		snprintf(line, sizeof(line), "%s %4.1u %6.1u %6.1u %s %s %s %s  %3.1u  %s%s",
 			n->measurement.status != 3 ? "!" : " ",
 			n->id,
 			frac.num, frac.denom,
@@ -284,7 +319,9 @@ static void do_refresh(struct data *d)
 
 	wclear(d->win);
 	wattron(d->win, A_REVERSE);
-	wprintw(d->win, "%-*.*s", COLS, COLS, "S   ID  QUANT   RATE    WAIT    BUSY   W/Q   B/Q  ERR  NAME ");
+	wprintw(d->win, "%-*.*s", COLS, COLS, d->show_percentiles ?
+			"S   ID  QUANT   RATE  WAIT50  WAIT99 WAIT999  BUSY50  BUSY99 BUSY999  ERR  NAME " :
+			"S   ID  QUANT   RATE    WAIT    BUSY   W/Q   B/Q  ERR  NAME ");
 	wattroff(d->win, A_REVERSE);
 	wprintw(d->win, "\n");
 
@@ -304,12 +341,156 @@ static void do_refresh(struct data *d)
 	wrefresh(d->win);
 }
 
+static void process_shm_nodes(struct data *d)
+{
+	struct node *n, *t;
+	int i, n_nodes;
+
+	if ((n_nodes = pw_profiler_shm_read_nodes(d->shm, d->shm_nodes, d->shm->max_nodes)) < 0)
+		return;
+
+	spa_list_for_each(n, &d->node_list, link)
+		n->seen = false;
+
+	for (i = 0; i < n_nodes; i++) {
+		struct pw_profiler_node *pn = &d->shm_nodes[i];
+
+		pn->name[sizeof(pn->name) - 1] = '\0';
+		if ((n = find_node(d, pn->id)) == NULL &&
+		    (n = add_node(d, pn->id, pn->name)) == NULL)
+			continue;
+		n->wait = pn->wait;
+		n->busy = pn->busy;
+		n->seen = true;
+	}
+
+	spa_list_for_each(n, &d->node_list, link) {
+		if (!n->driver->seen)
+			n->driver = n;
+	}
+	spa_list_for_each_safe(n, t, &d->node_list, link) {
+		if (!n->seen)
+			remove_node(d, n);
+	}
+}
+
+static void process_shm_record(struct data *d, const struct pw_profiler_record *r)
+{
+	struct measurement m;
+	struct node *n, *driver;
+
+	if ((n = find_node(d, r->id)) == NULL ||
+	    (driver = find_node(d, r->driver_id)) == NULL)
+		return;
+
+	spa_zero(m);
+	m.status = r->status;
+	m.prev_signal = r->prev_signal_time;
+	m.signal = r->signal_time;
+	m.awake = r->awake_time;
+	m.finish = r->finish_time;
+	m.latency = r->latency;
+
+	if (r->type == PW_PROFILER_RECORD_DRIVER) {
+		n->info.count = r->count;
+		n->info.cpu_load[0] = r->cpu_load[0];
+		n->info.cpu_load[1] = r->cpu_load[1];
+		n->info.cpu_load[2] = r->cpu_load[2];
+		n->info.xrun_count = r->xrun_count;
+		n->info.clock.flags = r->clock_flags;
+		n->info.clock.id = r->clock_id;
+		n->info.clock.nsec = r->clock_nsec;
+		n->info.clock.rate = r->clock_rate;
+		n->info.clock.position = r->clock_position;
+		n->info.clock.duration = r->clock_duration;
+		n->info.clock.delay = r->clock_delay;
+		n->info.clock.rate_diff = r->clock_rate_diff;
+		n->info.clock.next_nsec = r->clock_next_nsec;
+	}
+	n->driver = driver;
+	/* the histograms come from the node table */
+	update_node(n, &m, false);
+}
+
+static void process_shm(struct data *d)
+{
+	struct pw_profiler_record r;
+
+	process_shm_nodes(d);
+
+	while (pw_profiler_shm_read(d->shm, &d->shm_index, &r) > 0)
+		process_shm_record(d, &r);
+}
+
 static void do_timeout(void *data, uint64_t expirations)
 {
 	struct data *d = data;
+	if (d->shm)
+		process_shm(d);
 	do_refresh(d);
 }
 
+static const char *get_shm_path(char *buf, size_t len, const char *remote)
+{
+	const char *runtime_dir;
+
+	if ((runtime_dir = getenv("PIPEWIRE_RUNTIME_DIR")) == NULL &&
+	    (runtime_dir = getenv("XDG_RUNTIME_DIR")) == NULL &&
+	    (runtime_dir = getenv("HOME")) == NULL)
+		return NULL;
+	if (remote == NULL &&
+	    (remote = getenv("PIPEWIRE_REMOTE")) == NULL)
+		remote = PW_DEFAULT_REMOTE;
+
+	snprintf(buf, len, "%s/%s" PW_PROFILER_SHM_SUFFIX, runtime_dir, remote);
+	return buf;
+}
+
+static int open_shm(struct data *d, const char *path)
+{
+	struct pw_profiler_shm *shm;
+	struct stat st;
+	int fd, res;
+
+	if ((fd = open(path, O_RDONLY | O_CLOEXEC)) < 0)
+		return -errno;
+	if (fstat(fd, &st) < 0) {
+		res = -errno;
+		goto error;
+	}
+	if ((size_t)st.st_size < sizeof(struct pw_profiler_shm)) {
+		res = -EINVAL;
+		goto error;
+	}
+	shm = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (shm == MAP_FAILED) {
+		res = -errno;
+		goto error;
+	}
+	close(fd);
+
+	if (__atomic_load_n(&shm->magic, __ATOMIC_ACQUIRE) != PW_PROFILER_SHM_MAGIC ||
+	    shm->version != PW_PROFILER_SHM_VERSION ||
+	    shm->records_offset + (uint64_t)shm->n_records * sizeof(struct pw_profiler_record) > (uint64_t)st.st_size ||
+	    shm->nodes_offset + (uint64_t)shm->max_nodes * sizeof(struct pw_profiler_node) > (uint64_t)st.st_size ||
+	    shm->n_records == 0 || (shm->n_records & (shm->n_records - 1)) != 0) {
+		munmap(shm, st.st_size);
+		return -EINVAL;
+	}
+	if ((d->shm_nodes = calloc(shm->max_nodes, sizeof(struct pw_profiler_node))) == NULL) {
+		res = -errno;
+		munmap(shm, st.st_size);
+		return res;
+	}
+	d->shm = shm;
+	d->shm_size = st.st_size;
+	d->shm_index = __atomic_load_n(&shm->write_index, __ATOMIC_ACQUIRE);
+	return 0;
+error:
+	close(fd);
+	return res;
+}
+
 static void profiler_profile(void *data, const struct spa_pod *pod)
 {
         struct data *d = data;
@@ -448,7 +629,10 @@ static void show_help(const char *name)
         fprintf(stdout, "%s [options]\n"
 		"  -h, --help                            Show this help\n"
 		"      --version                         Show version\n"
-		"  -r, --remote                          Remote daemon name\n",
+		"  -r, --remote                          Remote daemon name\n"
+		"  -s, --shm[=PATH]                      Read the shared memory profiler feed\n"
+		"\n"
+		"Press p to toggle the wait and busy percentiles, q to quit\n",
 		name);
 }
 
@@ -476,6 +660,10 @@ static void do_handle_io(void *data, int fd, uint32_t mask)
 		case 'q':
 			pw_main_loop_quit(d->loop);
 			break;
+		case 'p':
+			d->show_percentiles = !d->show_percentiles;
+			do_refresh(d);
+			break;
 		default:
 			do_refresh(d);
 			break;
@@ -488,10 +676,14 @@ int main(int argc, char *argv[])
 	struct data data = { 0 };
 	struct pw_loop *l;
 	const char *opt_remote = NULL;
+	const char *opt_shm = NULL;
+	bool use_shm = false;
+	char shm_path[PATH_MAX];
 	static const struct option long_options[] = {
 		{ "help",	no_argument,		NULL, 'h' },
 		{ "version",	no_argument,		NULL, 'V' },
 		{ "remote",	required_argument,	NULL, 'r' },
+		{ "shm",	optional_argument,	NULL, 's' },
 		{ NULL, 0, NULL, 0}
 	};
 	int c;
@@ -503,7 +695,7 @@ int main(int argc, char *argv[])
 
 	spa_list_init(&data.node_list);
 
-	while ((c = getopt_long(argc, argv, "hVr:o:", long_options, NULL)) != -1) {
+	while ((c = getopt_long(argc, argv, "hVr:s::", long_options, NULL)) != -1) {
 		switch (c) {
 		case 'h':
 			show_help(argv[0]);
@@ -519,6 +711,10 @@ int main(int argc, char *argv[])
 		case 'r':
 			opt_remote = optarg;
 			break;
+		case 's':
+			use_shm = true;
+			opt_shm = optarg;
+			break;
 		default:
 			show_help(argv[0]);
 			return -1;
@@ -541,6 +737,22 @@ int main(int argc, char *argv[])
 		return -1;
 	}
 
+	if (use_shm) {
+		int res;
+
+		if (opt_shm == NULL &&
+		    (opt_shm = get_shm_path(shm_path, sizeof(shm_path), opt_remote)) == NULL) {
+			fprintf(stderr, "Can't find the runtime dir\n");
+			return -1;
+		}
+		if ((res = open_shm(&data, opt_shm)) < 0) {
+			fprintf(stderr, "Can't open profiler feed %s: %s\n",
+					opt_shm, spa_strerror(res));
+			return -1;
+		}
+		goto start;
+	}
+
 	pw_context_load_module(data.context, PW_EXTENSION_MODULE_PROFILER, NULL, NULL);
 
 	data.core = pw_context_connect(data.context,
@@ -564,6 +776,7 @@ int main(int argc, char *argv[])
 
 	data.check_profiler = pw_core_sync(data.core, 0, 0);
 
+start:
 	terminal_start();
 
 	data.win = newwin(LINES, COLS, 0, 0);
@@ -584,8 +797,14 @@ int main(int argc, char *argv[])
 	spa_list_consume(n, &data.node_list, link)
 		remove_node(&data, n);
 
-	pw_proxy_destroy((struct pw_proxy*)data.profiler);
-	pw_proxy_destroy((struct pw_proxy*)data.registry);
+	if (data.shm) {
+		munmap(data.shm, data.shm_size);
+		free(data.shm_nodes);
+	}
+	if (data.profiler)
+		pw_proxy_destroy((struct pw_proxy*)data.profiler);
+	if (data.registry)
+		pw_proxy_destroy((struct pw_proxy*)data.registry);
 	pw_context_destroy(data.context);
 	pw_main_loop_destroy(data.loop);
 